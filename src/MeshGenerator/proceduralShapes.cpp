@@ -0,0 +1,435 @@
+#include "proceduralShapes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+#include <string>
+
+#include "../common/ThreadPool.h"
+
+namespace {
+
+constexpr float pi = std::numbers::pi_v<float>;
+
+/*
+    Appends vertices and triangles to caller buffers, vertex numbers local to the shape
+*/
+struct ShapeWriter {
+    float *positions;
+    float *normals;
+    uint32_t *indices;
+    uint32_t baseVertex;
+    uint32_t vertexCount{0};
+    size_t indexCount{0};
+
+    uint32_t vertex(float x, float y, float z, float nx, float ny, float nz) {
+        float *p = positions + size_t(vertexCount) * 3, *n = normals + size_t(vertexCount) * 3;
+        p[0] = x, p[1] = y, p[2] = z;
+        n[0] = nx, n[1] = ny, n[2] = nz;
+        return vertexCount++;
+    }
+
+    void triangle(uint32_t a, uint32_t b, uint32_t c) {
+        indices[indexCount++] = baseVertex + a;
+        indices[indexCount++] = baseVertex + b;
+        indices[indexCount++] = baseVertex + c;
+    }
+
+    // a, b, c, d counter-clockwise seen from the front
+    void quad(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+        triangle(a, b, c);
+        triangle(a, c, d);
+    }
+};
+
+void requireAtLeast(uint32_t value, uint32_t minimum, const char *what) {
+    if (value < minimum)
+        throw std::runtime_error(std::string("Procedural shape needs at least ") + std::to_string(minimum) + " " + what);
+}
+
+/*
+    Rings of points around y, from the north pole (ring 0) to the south pole (ring rings)
+*/
+void generateUvSphere(ShapeWriter &out, uint32_t segments, uint32_t rings) {
+    out.vertex(0, 1, 0, 0, 1, 0);
+    for (uint32_t ring = 1; ring < rings; ++ring) {
+        const float theta = pi * ring / rings;
+        for (uint32_t k = 0; k < segments; ++k) {
+            const float phi = 2.0f * pi * k / segments;
+            const float x = std::sin(theta) * std::cos(phi), y = std::cos(theta), z = std::sin(theta) * std::sin(phi);
+            out.vertex(x, y, z, x, y, z);
+        }
+    }
+    const uint32_t south = out.vertex(0, -1, 0, 0, -1, 0);
+
+    auto ringVertex = [&](uint32_t ring, uint32_t k) { return 1 + (ring - 1) * segments + k % segments; };
+    for (uint32_t k = 0; k < segments; ++k)
+        out.triangle(0, ringVertex(1, k + 1), ringVertex(1, k));
+    for (uint32_t ring = 1; ring + 1 < rings; ++ring)
+        for (uint32_t k = 0; k < segments; ++k)
+            out.quad(ringVertex(ring, k), ringVertex(ring, k + 1), ringVertex(ring + 1, k + 1), ringVertex(ring + 1, k));
+    for (uint32_t k = 0; k < segments; ++k)
+        out.triangle(south, ringVertex(rings - 1, k), ringVertex(rings - 1, k + 1));
+}
+
+/*
+    The icosahedron, counter-clockwise faces, and its edges in the order their points are stored
+*/
+struct Icosahedron {
+    float corners[12][3];
+    uint32_t faces[20][3];
+    uint32_t edges[30][2];
+};
+
+const Icosahedron &icosahedron() {
+    static const Icosahedron shape = [] {
+        const float t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+        const float corners[12][3] = {{-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0}, {0, -1, t}, {0, 1, t},
+                                      {0, -1, -t}, {0, 1, -t}, {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1}};
+        Icosahedron result{{},
+                           {{0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11}, {1, 5, 9}, {5, 11, 4},
+                            {11, 10, 2}, {10, 7, 6}, {7, 1, 8}, {3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8},
+                            {3, 8, 9}, {4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1}},
+                           {}};
+        const float length = std::sqrt(1.0f + t * t);
+        for (int c = 0; c < 12; ++c)
+            for (int k = 0; k < 3; ++k)
+                result.corners[c][k] = corners[c][k] / length;
+        uint32_t edgeCount = 0;
+        for (const auto &face : result.faces) {
+            for (int e = 0; e < 3; ++e) {
+                const uint32_t a = std::min(face[e], face[(e + 1) % 3]), b = std::max(face[e], face[(e + 1) % 3]);
+                if (std::none_of(result.edges, result.edges + edgeCount,
+                                 [&](const uint32_t (&edge)[2]) { return edge[0] == a && edge[1] == b; }))
+                    result.edges[edgeCount][0] = a, result.edges[edgeCount++][1] = b;
+            }
+        }
+        return result;
+    }();
+    return shape;
+}
+
+/*
+    Every face becomes a triangular grid of frequency n. Corners, edge points and face interiors
+    are each stored once, so points on shared edges are shared without any lookup table:
+
+        [12 corners][30 edges x (n - 1)][20 faces x (n - 1)(n - 2) / 2]
+*/
+void generateIcosphere(ShapeWriter &out, uint32_t n) {
+    const Icosahedron &shape = icosahedron();
+    auto spherePoint = [&](const float *a, const float *b, const float *c, float wb, float wc) {
+        float p[3];
+        for (int k = 0; k < 3; ++k)
+            p[k] = a[k] + (b[k] - a[k]) * wb + (c[k] - a[k]) * wc;
+        const float length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        out.vertex(p[0] / length, p[1] / length, p[2] / length, p[0] / length, p[1] / length, p[2] / length);
+    };
+
+    for (const auto &corner : shape.corners)
+        out.vertex(corner[0], corner[1], corner[2], corner[0], corner[1], corner[2]);
+    for (const auto &edge : shape.edges)
+        for (uint32_t k = 1; k < n; ++k)
+            spherePoint(shape.corners[edge[0]], shape.corners[edge[1]], shape.corners[edge[0]], float(k) / n, 0.0f);
+    for (const auto &face : shape.faces)
+        for (uint32_t i = 1; i + 1 < n; ++i)
+            for (uint32_t j = 1; i + j < n; ++j)
+                spherePoint(shape.corners[face[0]], shape.corners[face[1]], shape.corners[face[2]], float(i) / n,
+                            float(j) / n);
+
+    const uint32_t edgeBase = 12, faceBase = edgeBase + 30 * (n - 1), perFace = (n - 1) * (n - 2) / 2;
+    // Maps point k of n along the edge from corner a to corner b to a vertex
+    struct EdgeRun {
+        uint32_t a, b, first;
+        int32_t step;
+
+        uint32_t operator()(uint32_t k, uint32_t n) const { return k == 0 ? a : k == n ? b : first + step * int32_t(k - 1); }
+    };
+    auto edgeRun = [&](uint32_t a, uint32_t b) {
+        for (uint32_t e = 0; e < 30; ++e) {
+            if (shape.edges[e][0] == a && shape.edges[e][1] == b)
+                return EdgeRun{a, b, edgeBase + e * (n - 1), 1};
+            if (shape.edges[e][0] == b && shape.edges[e][1] == a)
+                return EdgeRun{a, b, edgeBase + e * (n - 1) + n - 2, -1};
+        }
+        throw std::runtime_error("Icosahedron edge missing");
+    };
+    for (uint32_t f = 0; f < 20; ++f) {
+        const uint32_t a = shape.faces[f][0], b = shape.faces[f][1], c = shape.faces[f][2];
+        const EdgeRun ab = edgeRun(a, b), ac = edgeRun(a, c), bc = edgeRun(b, c);
+        // Point i steps towards b and j towards c
+        auto point = [&](uint32_t i, uint32_t j) -> uint32_t {
+            if (j == 0)
+                return ab(i, n);
+            if (i == 0)
+                return ac(j, n);
+            if (i + j == n)
+                return bc(j, n);
+            // Interior rows i = 1 .. n - 2 hold n - 1 - i points each
+            const uint32_t rowStart = (i - 1) * (n - 1) - (i - 1) * i / 2;
+            return faceBase + f * perFace + rowStart + j - 1;
+        };
+        for (uint32_t i = 0; i < n; ++i) {
+            for (uint32_t j = 0; i + j < n; ++j) {
+                out.triangle(point(i, j), point(i + 1, j), point(i, j + 1));
+                if (i + j + 1 < n)
+                    out.triangle(point(i + 1, j), point(i + 1, j + 1), point(i, j + 1));
+            }
+        }
+    }
+}
+
+void generateCube(ShapeWriter &out, uint32_t n) {
+    // Normal, then u and v with u x v = normal so the grid winds counter-clockwise
+    static const float faces[6][3][3] = {
+        {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}},  {{-1, 0, 0}, {0, 0, 1}, {0, 1, 0}},
+        {{0, 1, 0}, {0, 0, 1}, {1, 0, 0}},  {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}},
+        {{0, 0, 1}, {1, 0, 0}, {0, 1, 0}},  {{0, 0, -1}, {0, 1, 0}, {1, 0, 0}},
+    };
+    for (const auto &face : faces) {
+        const float *normal = face[0], *u = face[1], *v = face[2];
+        const uint32_t first = out.vertexCount;
+        for (uint32_t j = 0; j <= n; ++j) {
+            for (uint32_t i = 0; i <= n; ++i) {
+                const float s = 2.0f * i / n - 1.0f, t = 2.0f * j / n - 1.0f;
+                out.vertex(normal[0] + u[0] * s + v[0] * t, normal[1] + u[1] * s + v[1] * t,
+                           normal[2] + u[2] * s + v[2] * t, normal[0], normal[1], normal[2]);
+            }
+        }
+        for (uint32_t j = 0; j < n; ++j) {
+            for (uint32_t i = 0; i < n; ++i) {
+                const uint32_t a = first + j * (n + 1) + i;
+                out.quad(a, a + 1, a + n + 2, a + n + 1);
+            }
+        }
+    }
+}
+
+void generateCylinder(ShapeWriter &out, uint32_t segments, uint32_t rings) {
+    for (uint32_t ring = 0; ring <= rings; ++ring) {
+        const float y = 1.0f - 2.0f * ring / rings;
+        for (uint32_t k = 0; k < segments; ++k) {
+            const float phi = 2.0f * pi * k / segments;
+            out.vertex(std::cos(phi), y, std::sin(phi), std::cos(phi), 0, std::sin(phi));
+        }
+    }
+    for (uint32_t ring = 0; ring < rings; ++ring) {
+        for (uint32_t k = 0; k < segments; ++k) {
+            const uint32_t a = ring * segments + k, b = ring * segments + (k + 1) % segments;
+            out.quad(a, b, b + segments, a + segments);
+        }
+    }
+
+    // Caps get their own vertices for the flat normals
+    for (const float y : {1.0f, -1.0f}) {
+        const uint32_t center = out.vertex(0, y, 0, 0, y, 0);
+        for (uint32_t k = 0; k < segments; ++k) {
+            const float phi = 2.0f * pi * k / segments;
+            out.vertex(std::cos(phi), y, std::sin(phi), 0, y, 0);
+        }
+        for (uint32_t k = 0; k < segments; ++k) {
+            const uint32_t a = center + 1 + k, b = center + 1 + (k + 1) % segments;
+            if (y > 0)
+                out.triangle(center, b, a);
+            else
+                out.triangle(center, a, b);
+        }
+    }
+}
+
+void generateTorus(ShapeWriter &out, uint32_t segments, uint32_t rings, float thickness) {
+    const float major = 1.0f - thickness;
+    for (uint32_t k = 0; k < segments; ++k) {
+        const float phi = 2.0f * pi * k / segments;
+        const float cx = std::cos(phi), cz = std::sin(phi);
+        for (uint32_t ring = 0; ring < rings; ++ring) {
+            const float psi = 2.0f * pi * ring / rings;
+            const float nx = std::cos(psi) * cx, ny = std::sin(psi), nz = std::cos(psi) * cz;
+            out.vertex(major * cx + thickness * nx, thickness * ny, major * cz + thickness * nz, nx, ny, nz);
+        }
+    }
+    for (uint32_t k = 0; k < segments; ++k) {
+        const uint32_t row = k * rings, next = (k + 1) % segments * rings;
+        for (uint32_t ring = 0; ring < rings; ++ring) {
+            const uint32_t following = (ring + 1) % rings;
+            out.quad(row + ring, row + following, next + following, next + ring);
+        }
+    }
+}
+
+/*
+    Rows along z, heights optional. Normals come from central differences of the heights,
+    one sided at the borders.
+*/
+void generatePlane(ShapeWriter &out, uint32_t segments, uint32_t rings, const float *heights) {
+    const uint32_t row = segments + 1;
+    auto height = [&](uint32_t i, uint32_t j) { return heights ? heights[size_t(j) * row + i] : 0.0f; };
+    for (uint32_t j = 0; j <= rings; ++j) {
+        for (uint32_t i = 0; i <= segments; ++i) {
+            const uint32_t left = i > 0 ? i - 1 : i, right = std::min(i + 1, segments);
+            const uint32_t back = j > 0 ? j - 1 : j, front = std::min(j + 1, rings);
+            const float slopeX = (height(right, j) - height(left, j)) / (2.0f * (right - left) / segments);
+            const float slopeZ = (height(i, front) - height(i, back)) / (2.0f * (front - back) / rings);
+            const float length = std::sqrt(slopeX * slopeX + slopeZ * slopeZ + 1.0f);
+            out.vertex(2.0f * i / segments - 1.0f, height(i, j), 2.0f * j / rings - 1.0f, -slopeX / length,
+                       1.0f / length, -slopeZ / length);
+        }
+    }
+    for (uint32_t j = 0; j < rings; ++j) {
+        for (uint32_t i = 0; i < segments; ++i) {
+            const uint32_t a = j * row + i;
+            out.quad(a, a + row, a + row + 1, a + 1);
+        }
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Exact vertex and index counts of a shape, for sizing the buffers generateShape() fills.
+ *
+ * @throws std::runtime_error If the resolution is too low for the shape or the counts overflow 32 bits.
+ */
+ShapeSize shapeSize(const ShapeDesc &shape) {
+    const uint64_t s = shape.segments, r = shape.rings;
+    uint64_t vertices = 0, triangles = 0;
+    switch (shape.type) {
+    case ShapeType::UvSphere:
+        requireAtLeast(shape.segments, 3, "segments");
+        requireAtLeast(shape.rings, 2, "rings");
+        vertices = 2 + (r - 1) * s, triangles = 2 * s * (r - 1);
+        break;
+    case ShapeType::Icosphere:
+        requireAtLeast(shape.segments, 1, "segments");
+        vertices = 10 * s * s + 2, triangles = 20 * s * s;
+        break;
+    case ShapeType::Cube:
+        requireAtLeast(shape.segments, 1, "segments");
+        vertices = 6 * (s + 1) * (s + 1), triangles = 12 * s * s;
+        break;
+    case ShapeType::Cylinder:
+        requireAtLeast(shape.segments, 3, "segments");
+        requireAtLeast(shape.rings, 1, "rings");
+        vertices = (r + 1) * s + 2 * (s + 1), triangles = 2 * s * r + 2 * s;
+        break;
+    case ShapeType::Torus:
+        requireAtLeast(shape.segments, 3, "segments");
+        requireAtLeast(shape.rings, 3, "rings");
+        if (!(shape.thickness > 0.0f && shape.thickness <= 0.5f))
+            throw std::runtime_error("Torus thickness must be in (0, 0.5]");
+        vertices = s * r, triangles = 2 * s * r;
+        break;
+    case ShapeType::Grid:
+        if (!shape.heights)
+            throw std::runtime_error("Grid shape needs heights");
+        [[fallthrough]];
+    case ShapeType::Plane:
+        requireAtLeast(shape.segments, 1, "segments");
+        requireAtLeast(shape.rings, 1, "rings");
+        vertices = (s + 1) * (r + 1), triangles = 2 * s * r;
+        break;
+    default:
+        throw std::runtime_error("Unknown procedural shape type");
+    }
+    if (vertices > UINT32_MAX || triangles * 3 > UINT32_MAX)
+        throw std::runtime_error("Procedural shape resolution is too high");
+    return {static_cast<uint32_t>(vertices), static_cast<uint32_t>(triangles * 3)};
+}
+
+/**
+ * @brief Writes a shape into buffers sized by shapeSize(), without allocating.
+ *
+ * @param positions xyz per vertex.
+ * @param normals xyz per vertex, unit length.
+ * @param indices Triangle list, each index offset by @p baseVertex.
+ */
+void generateShape(const ShapeDesc &shape, float *positions, float *normals, uint32_t *indices, uint32_t baseVertex) {
+    shapeSize(shape);
+    ShapeWriter out{positions, normals, indices, baseVertex};
+    switch (shape.type) {
+    case ShapeType::UvSphere: generateUvSphere(out, shape.segments, shape.rings); break;
+    case ShapeType::Icosphere: generateIcosphere(out, shape.segments); break;
+    case ShapeType::Cube: generateCube(out, shape.segments); break;
+    case ShapeType::Cylinder: generateCylinder(out, shape.segments, shape.rings); break;
+    case ShapeType::Torus: generateTorus(out, shape.segments, shape.rings, shape.thickness); break;
+    case ShapeType::Plane: generatePlane(out, shape.segments, shape.rings, nullptr); break;
+    case ShapeType::Grid: generatePlane(out, shape.segments, shape.rings, shape.heights); break;
+    }
+}
+
+Mesh generateShape(const ShapeDesc &shape) {
+    const ShapeSize size = shapeSize(shape);
+    Mesh mesh;
+    mesh.positions.resize(size_t(size.vertexCount) * 3);
+    mesh.normals.resize(size_t(size.vertexCount) * 3);
+    mesh.indices.resize(size.indexCount);
+    generateShape(shape, mesh.positions.data(), mesh.normals.data(), mesh.indices.data());
+    return mesh;
+}
+
+/**
+ * @brief Generates a field of shapes into one Mesh.
+ *
+ * The mesh is sized once up front, then every instance is generated and transformed in place
+ * in its own slice, in parallel. Mirroring transforms have their triangles flipped so they
+ * still face outwards.
+ *
+ * @throws std::runtime_error If a shape is invalid or the field needs more than 32-bit indices.
+ */
+Mesh generateShapes(const std::vector<ShapeInstance> &instances) {
+    std::vector<ShapeSize> offsets(instances.size());
+    uint64_t vertexCount = 0, indexCount = 0;
+    for (size_t i = 0; i < instances.size(); ++i) {
+        const ShapeSize size = shapeSize(instances[i].shape);
+        offsets[i] = {static_cast<uint32_t>(vertexCount), static_cast<uint32_t>(indexCount)};
+        vertexCount += size.vertexCount;
+        indexCount += size.indexCount;
+        if (vertexCount > UINT32_MAX || indexCount > UINT32_MAX)
+            throw std::runtime_error("Too many procedural shapes for one mesh");
+    }
+
+    Mesh mesh;
+    mesh.positions.resize(vertexCount * 3);
+    mesh.normals.resize(vertexCount * 3);
+    mesh.colors.resize(vertexCount * 4);
+    mesh.indices.resize(indexCount);
+    ThreadPool::shared().parallelFor(instances.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const ShapeInstance &instance = instances[i];
+            const size_t first = offsets[i].vertexCount;
+            const size_t last = i + 1 < instances.size() ? offsets[i + 1].vertexCount : vertexCount;
+            const size_t firstIndex = offsets[i].indexCount;
+            const size_t lastIndex = i + 1 < instances.size() ? offsets[i + 1].indexCount : indexCount;
+            float *positions = mesh.positions.data() + first * 3, *normals = mesh.normals.data() + first * 3;
+            generateShape(instance.shape, positions, normals, mesh.indices.data() + firstIndex,
+                          static_cast<uint32_t>(first));
+
+            // Normals use the cofactor matrix, the inverse transpose up to a scale
+            const float *m = instance.transform.data();
+            const float cofactor[9] = {m[5] * m[10] - m[6] * m[9], m[6] * m[8] - m[4] * m[10], m[4] * m[9] - m[5] * m[8],
+                                       m[2] * m[9] - m[1] * m[10], m[0] * m[10] - m[2] * m[8], m[1] * m[8] - m[0] * m[9],
+                                       m[1] * m[6] - m[2] * m[5], m[2] * m[4] - m[0] * m[6], m[0] * m[5] - m[1] * m[4]};
+            const float determinant = m[0] * cofactor[0] + m[1] * cofactor[1] + m[2] * cofactor[2];
+            const float sign = determinant < 0 ? -1.0f : 1.0f;
+            for (size_t v = 0; v < last - first; ++v) {
+                float *p = positions + v * 3, *n = normals + v * 3;
+                const float x = p[0], y = p[1], z = p[2], nx = n[0], ny = n[1], nz = n[2];
+                float length = 0.0f;
+                for (int r = 0; r < 3; ++r) {
+                    p[r] = m[r] * x + m[4 + r] * y + m[8 + r] * z + m[12 + r];
+                    n[r] = sign * (cofactor[r] * nx + cofactor[3 + r] * ny + cofactor[6 + r] * nz);
+                    length += n[r] * n[r];
+                }
+                if (length > 0)
+                    for (int r = 0; r < 3; ++r)
+                        n[r] /= std::sqrt(length);
+            }
+            if (determinant < 0)
+                for (size_t k = firstIndex; k < lastIndex; k += 3)
+                    std::swap(mesh.indices[k + 1], mesh.indices[k + 2]);
+            for (size_t v = first; v < last; ++v)
+                std::copy(instance.color.begin(), instance.color.end(), mesh.colors.data() + v * 4);
+        }
+    });
+    return mesh;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "../common/Mesh.h"
+
+/*
+-------------------------------------------------------------------
+  PROCEDURAL SHAPES  ------------------------------------------------
+
+  Portable generators for indexed triangle meshes with normals. Every shape is centered on
+  the origin and fits [-1, 1] on each axis, counter-clockwise triangles facing outwards.
+
+    UvSphere    segments around the y axis, rings from pole to pole
+    Icosphere   subdivided icosahedron, segments per icosahedron edge (10 s^2 + 2 vertices)
+    Cube        segments x segments quads per face, flat normals
+    Cylinder    along y, segments around, rings along the side, capped
+    Torus       around y, segments around the ring, rings around the tube of radius thickness
+    Plane       segments x rings quads in the xz plane, facing +y
+    Grid        the same as Plane with y taken from a heightfield, normals from its slopes
+
+  shapeSize() gives the exact vertex and index counts, generateShape() writes into caller
+  buffers of that size and allocates nothing, so shapes can be generated from several threads
+  into slices of one shared buffer. generateShapes() does that for a whole field of shapes.
+-------------------------------------------------------------------
+*/
+
+enum class ShapeType : uint32_t {
+    UvSphere,
+    Icosphere,
+    Cube,
+    Cylinder,
+    Torus,
+    Plane,
+    Grid,
+};
+
+struct ShapeDesc {
+    ShapeType type{ShapeType::Cube};
+    uint32_t segments{16};
+    uint32_t rings{8};
+    float thickness{0.25f};             // Torus tube radius
+    const float *heights{nullptr};      // Grid, (segments + 1) * (rings + 1) row major, not copied
+};
+
+struct ShapeSize {
+    uint32_t vertexCount;
+    uint32_t indexCount;
+};
+
+// Throws std::runtime_error if the resolution is out of range for the shape
+ShapeSize shapeSize(const ShapeDesc &shape);
+
+// xyz positions and normals per vertex, indices offset by baseVertex
+void generateShape(const ShapeDesc &shape, float *positions, float *normals, uint32_t *indices,
+                   uint32_t baseVertex = 0);
+
+Mesh generateShape(const ShapeDesc &shape);
+
+/**
+ * @brief One shape of a field, placed by a column-major 4x4 transform.
+ */
+struct ShapeInstance {
+    ShapeDesc shape;
+    std::array<float, 16> transform{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    std::array<float, 4> color{1, 1, 1, 1};
+};
+
+// Every instance in one Mesh with colors, generated in parallel on the shared ThreadPool
+Mesh generateShapes(const std::vector<ShapeInstance> &instances);
@@ -0,0 +1,541 @@
+#include "gltfLoader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "../common/ThreadPool.h"
+#include "json.h"
+
+namespace {
+
+constexpr uint32_t glbMagic = 0x46546C67;       // "glTF"
+constexpr uint32_t glbJsonChunk = 0x4E4F534A;   // "JSON"
+constexpr uint32_t glbBinaryChunk = 0x004E4942; // "BIN\0"
+
+constexpr std::array<float, 16> identity = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+
+// glTF is little endian, as is every machine the renderer runs on
+uint32_t readUint32(const char *p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+size_t componentSize(GltfComponentType type) {
+    switch (type) {
+    case GltfComponentType::Int8:
+    case GltfComponentType::Uint8: return 1;
+    case GltfComponentType::Int16:
+    case GltfComponentType::Uint16: return 2;
+    case GltfComponentType::Uint32:
+    case GltfComponentType::Float32: return 4;
+    }
+    throw std::runtime_error("Unknown glTF component type " + std::to_string(static_cast<uint32_t>(type)));
+}
+
+uint32_t componentCount(const std::string &type) {
+    static const std::pair<const char *, uint32_t> types[] = {
+        {"SCALAR", 1}, {"VEC2", 2}, {"VEC3", 3}, {"VEC4", 4}, {"MAT2", 4}, {"MAT3", 9}, {"MAT4", 16}};
+    for (const auto &[name, count] : types)
+        if (type == name)
+            return count;
+    throw std::runtime_error("Unknown glTF accessor type: " + type);
+}
+
+std::vector<uint8_t> decodeBase64(const char *text, size_t size) {
+    auto value = [](char c) -> int {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '+' || c == '-') return 62;
+        if (c == '/' || c == '_') return 63;
+        return -1;
+    };
+
+    std::vector<uint8_t> bytes;
+    bytes.reserve(size / 4 * 3);
+    uint32_t bits = 0;
+    int bitCount = 0;
+    for (size_t i = 0; i < size && text[i] != '='; ++i) {
+        const int v = value(text[i]);
+        if (v < 0)
+            throw std::runtime_error("Malformed base64 in glTF data URI");
+        bits = bits << 6 | static_cast<uint32_t>(v);
+        bitCount += 6;
+        if (bitCount >= 8) {
+            bitCount -= 8;
+            bytes.push_back(static_cast<uint8_t>(bits >> bitCount));
+        }
+    }
+    return bytes;
+}
+
+std::array<float, 16> multiply(const std::array<float, 16> &a, const std::array<float, 16> &b) {
+    std::array<float, 16> result{};
+    for (int column = 0; column < 4; ++column)
+        for (int row = 0; row < 4; ++row)
+            for (int k = 0; k < 4; ++k)
+                result[column * 4 + row] += a[k * 4 + row] * b[column * 4 + k];
+    return result;
+}
+
+std::array<float, 16> localMatrix(const JsonValue &node) {
+    std::array<float, 16> matrix = identity;
+    if (node["matrix"].size() == 16) {
+        for (size_t i = 0; i < 16; ++i)
+            matrix[i] = static_cast<float>(node["matrix"][i].asNumber());
+        return matrix;
+    }
+
+    // T * R * S, the rotation is a unit quaternion x y z w
+    auto component = [](const JsonValue &array, size_t i, double fallback) {
+        return static_cast<float>(array[i].asNumber(fallback));
+    };
+    const JsonValue &t = node["translation"], &r = node["rotation"], &s = node["scale"];
+    const float x = component(r, 0, 0), y = component(r, 1, 0), z = component(r, 2, 0), w = component(r, 3, 1);
+    const float sx = component(s, 0, 1), sy = component(s, 1, 1), sz = component(s, 2, 1);
+    matrix[0] = (1 - 2 * (y * y + z * z)) * sx;
+    matrix[1] = 2 * (x * y + z * w) * sx;
+    matrix[2] = 2 * (x * z - y * w) * sx;
+    matrix[4] = 2 * (x * y - z * w) * sy;
+    matrix[5] = (1 - 2 * (x * x + z * z)) * sy;
+    matrix[6] = 2 * (y * z + x * w) * sy;
+    matrix[8] = 2 * (x * z + y * w) * sz;
+    matrix[9] = 2 * (y * z - x * w) * sz;
+    matrix[10] = (1 - 2 * (x * x + y * y)) * sz;
+    matrix[12] = component(t, 0, 0);
+    matrix[13] = component(t, 1, 0);
+    matrix[14] = component(t, 2, 0);
+    return matrix;
+}
+
+/*
+    Calls f with a value of the C++ type of an index accessor
+*/
+template <typename F>
+void withIndexType(GltfComponentType type, F &&f) {
+    switch (type) {
+    case GltfComponentType::Uint8: f(uint8_t{}); break;
+    case GltfComponentType::Uint16: f(uint16_t{}); break;
+    case GltfComponentType::Uint32: f(uint32_t{}); break;
+    default: throw std::runtime_error("glTF indices must be unsigned integers");
+    }
+}
+
+} // namespace
+
+size_t AccessorView::elementSize() const {
+    return componentSize(componentType) * components;
+}
+
+float AccessorView::getFloat(size_t i, uint32_t c) const {
+    const uint8_t *p = data + i * stride;
+    switch (componentType) {
+    case GltfComponentType::Float32: {
+        float value;
+        std::memcpy(&value, p + c * 4, 4);
+        return value;
+    }
+    case GltfComponentType::Uint8:
+        return normalized ? p[c] / 255.0f : p[c];
+    case GltfComponentType::Int8: {
+        const float value = static_cast<int8_t>(p[c]);
+        return normalized ? std::max(value / 127.0f, -1.0f) : value;
+    }
+    case GltfComponentType::Uint16: {
+        uint16_t value;
+        std::memcpy(&value, p + c * 2, 2);
+        return normalized ? value / 65535.0f : value;
+    }
+    case GltfComponentType::Int16: {
+        int16_t value;
+        std::memcpy(&value, p + c * 2, 2);
+        return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+    }
+    case GltfComponentType::Uint32: {
+        uint32_t value;
+        std::memcpy(&value, p + c * 4, 4);
+        return static_cast<float>(value);
+    }
+    }
+    return 0.0f;
+}
+
+uint32_t AccessorView::getIndex(size_t i) const {
+    uint32_t index = 0;
+    withIndexType(componentType, [&](auto type) { index = get<decltype(type)>(i); });
+    return index;
+}
+
+/**
+ * @brief Opens a .gltf or .glb file and parses its JSON, buffers are mapped but not read.
+ *
+ * @throws std::runtime_error If a file can't be mapped or the asset is malformed.
+ */
+GltfAsset::GltfAsset(const std::string &fileName) {
+    const size_t slash = fileName.find_last_of("/\\");
+    const std::string directory = slash == std::string::npos ? "" : fileName.substr(0, slash + 1);
+
+    files.push_back(std::make_unique<MappedFile>(fileName));
+    const char *data = files.back()->data();
+    const size_t size = files.back()->size();
+
+    if (size < 12 || readUint32(data) != glbMagic) {
+        parse(data, size, {nullptr, 0}, directory);
+        return;
+    }
+
+    // GLB: 12 byte header, then chunks of (length, type, data padded to 4 bytes)
+    if (readUint32(data + 4) != 2)
+        throw std::runtime_error("Only GLB version 2 is supported: " + fileName);
+    const size_t length = std::min<size_t>(readUint32(data + 8), size);
+    size_t offset = 12;
+    const char *json = nullptr;
+    size_t jsonSize = 0;
+    Buffer binary{nullptr, 0};
+    while (offset + 8 <= length) {
+        const size_t chunkSize = readUint32(data + offset);
+        const uint32_t chunkType = readUint32(data + offset + 4);
+        if (chunkSize > length - offset - 8)
+            throw std::runtime_error("GLB chunk runs past the end of the file: " + fileName);
+        const char *chunk = data + offset + 8;
+        if (chunkType == glbJsonChunk && !json) {
+            json = chunk;
+            jsonSize = chunkSize;
+        } else if (chunkType == glbBinaryChunk && !binary.data) {
+            binary = {reinterpret_cast<const uint8_t *>(chunk), chunkSize};
+        }
+        offset += 8 + (chunkSize + 3) / 4 * 4;
+    }
+    if (!json)
+        throw std::runtime_error("GLB without a JSON chunk: " + fileName);
+    parse(json, jsonSize, binary, directory);
+}
+
+void GltfAsset::parse(const char *text, size_t textSize, const Buffer &binaryChunk, const std::string &directory) {
+    const JsonValue json = parseJson(text, textSize);
+    if (json["asset"]["version"].asString().rfind("2.", 0) != 0)
+        throw std::runtime_error("Only glTF 2.0 is supported");
+
+    // Buffers - the GLB BIN chunk, base64 data: URIs or files next to the .gltf
+    const JsonValue &jsonBuffers = json["buffers"];
+    for (size_t i = 0; i < jsonBuffers.size(); ++i) {
+        const std::string &uri = jsonBuffers[i]["uri"].asString();
+        const size_t byteLength = jsonBuffers[i]["byteLength"].asSize();
+        Buffer buffer{nullptr, 0};
+        if (uri.empty()) {
+            if (i != 0 || !binaryChunk.data)
+                throw std::runtime_error("glTF buffer " + std::to_string(i) + " has no uri");
+            buffer = binaryChunk;
+        } else if (uri.rfind("data:", 0) == 0) {
+            const size_t comma = uri.find(',');
+            if (comma == std::string::npos || uri.rfind(";base64", comma) == std::string::npos)
+                throw std::runtime_error("Only base64 data URIs are supported in glTF buffers");
+            decodedBuffers.push_back(decodeBase64(uri.data() + comma + 1, uri.size() - comma - 1));
+            buffer = {decodedBuffers.back().data(), decodedBuffers.back().size()};
+        } else {
+            files.push_back(std::make_unique<MappedFile>(directory + uri));
+            buffer = {reinterpret_cast<const uint8_t *>(files.back()->data()), files.back()->size()};
+        }
+        if (buffer.size < byteLength)
+            throw std::runtime_error("glTF buffer " + std::to_string(i) + " is shorter than its byteLength");
+        buffers.push_back({buffer.data, byteLength});
+    }
+
+    // Buffer views as byte ranges, accessors become views into them
+    struct View {
+        const uint8_t *data;
+        size_t size;
+        size_t stride;
+    };
+    std::vector<View> views;
+    const JsonValue &jsonViews = json["bufferViews"];
+    for (size_t i = 0; i < jsonViews.size(); ++i) {
+        const JsonValue &view = jsonViews[i];
+        const size_t buffer = view["buffer"].asSize(buffers.size());
+        const size_t offset = view["byteOffset"].asSize(0), length = view["byteLength"].asSize();
+        if (buffer >= buffers.size() || offset > buffers[buffer].size || length > buffers[buffer].size - offset)
+            throw std::runtime_error("glTF buffer view " + std::to_string(i) + " is out of range");
+        views.push_back({buffers[buffer].data + offset, length, view["byteStride"].asSize(0)});
+    }
+
+    const JsonValue &accessors = json["accessors"];
+    auto makeView = [&](const JsonValue &index) {
+        AccessorView result;
+        if (index.isNull())
+            return result;
+        const JsonValue &accessor = accessors[index.asSize()];
+        if (!accessor.isObject())
+            throw std::runtime_error("glTF accessor " + std::to_string(index.asSize()) + " doesn't exist");
+        if (!accessor["sparse"].isNull() || accessor["bufferView"].isNull())
+            throw std::runtime_error("Sparse glTF accessors and accessors without a buffer view aren't supported");
+
+        const size_t viewIndex = accessor["bufferView"].asSize();
+        if (viewIndex >= views.size())
+            throw std::runtime_error("glTF accessor refers to a missing buffer view");
+        const View &view = views[viewIndex];
+        result.componentType = static_cast<GltfComponentType>(accessor["componentType"].asSize());
+        result.components = componentCount(accessor["type"].asString());
+        result.normalized = accessor["normalized"].asBool();
+        result.count = accessor["count"].asSize();
+        result.stride = view.stride ? view.stride : result.elementSize();
+
+        const size_t offset = accessor["byteOffset"].asSize(0), available = view.size - std::min(offset, view.size);
+        const bool fits = result.count == 0 || (offset <= view.size && (result.count - 1) <= available / result.stride &&
+                                                (result.count - 1) * result.stride + result.elementSize() <= available);
+        if (!fits)
+            throw std::runtime_error("glTF accessor runs past its buffer view");
+        result.data = view.data + offset;
+        return result;
+    };
+
+    const JsonValue &jsonMeshes = json["meshes"];
+    for (size_t i = 0; i < jsonMeshes.size(); ++i) {
+        GltfMesh mesh;
+        mesh.name = jsonMeshes[i]["name"].asString();
+        const JsonValue &primitives = jsonMeshes[i]["primitives"];
+        for (size_t p = 0; p < primitives.size(); ++p) {
+            const JsonValue &attributes = primitives[p]["attributes"];
+            GltfPrimitive primitive;
+            primitive.positions = makeView(attributes["POSITION"]);
+            primitive.normals = makeView(attributes["NORMAL"]);
+            primitive.colors = makeView(attributes["COLOR_0"]);
+            primitive.indices = makeView(primitives[p]["indices"]);
+            primitive.mode = static_cast<uint32_t>(primitives[p]["mode"].asSize(4));
+            if (!primitive.positions)
+                throw std::runtime_error("glTF primitive without POSITION in mesh " + std::to_string(i));
+            mesh.primitives.push_back(primitive);
+        }
+        meshes.push_back(std::move(mesh));
+    }
+
+    // Nodes, each child may only have one parent
+    const JsonValue &jsonNodes = json["nodes"];
+    nodes.resize(jsonNodes.size());
+    for (size_t i = 0; i < jsonNodes.size(); ++i) {
+        GltfNode &node = nodes[i];
+        node.name = jsonNodes[i]["name"].asString();
+        node.local = localMatrix(jsonNodes[i]);
+        node.world = identity;
+        if (!jsonNodes[i]["mesh"].isNull()) {
+            node.mesh = static_cast<int32_t>(jsonNodes[i]["mesh"].asSize());
+            if (static_cast<size_t>(node.mesh) >= meshes.size())
+                throw std::runtime_error("glTF node " + std::to_string(i) + " refers to a missing mesh");
+        }
+        const JsonValue &children = jsonNodes[i]["children"];
+        for (size_t c = 0; c < children.size(); ++c) {
+            const size_t child = children[c].asSize();
+            if (child >= nodes.size() || child == i)
+                throw std::runtime_error("glTF node " + std::to_string(i) + " has an invalid child");
+            node.children.push_back(static_cast<int32_t>(child));
+        }
+    }
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        for (const int32_t child : nodes[i].children) {
+            if (nodes[child].parent >= 0)
+                throw std::runtime_error("glTF node " + std::to_string(child) + " has more than one parent");
+            nodes[child].parent = static_cast<int32_t>(i);
+        }
+    }
+
+    // The default scene's roots, or every parentless node if there are no scenes
+    std::vector<int32_t> roots;
+    const JsonValue &scenes = json["scenes"];
+    if (scenes.size() > 0) {
+        const JsonValue &sceneRoots = scenes[json["scene"].asSize(0)]["nodes"];
+        for (size_t i = 0; i < sceneRoots.size(); ++i) {
+            const size_t root = sceneRoots[i].asSize();
+            if (root >= nodes.size() || nodes[root].parent >= 0)
+                throw std::runtime_error("glTF scene root " + std::to_string(root) + " is invalid");
+            roots.push_back(static_cast<int32_t>(root));
+        }
+    } else {
+        for (size_t i = 0; i < nodes.size(); ++i)
+            if (nodes[i].parent < 0)
+                roots.push_back(static_cast<int32_t>(i));
+    }
+
+    // Breadth first, so parents are always listed (and their world matrix known) before children
+    sceneNodes = roots;
+    for (size_t i = 0; i < sceneNodes.size(); ++i) {
+        GltfNode &node = nodes[sceneNodes[i]];
+        node.world = node.parent < 0 ? node.local : multiply(nodes[node.parent].world, node.local);
+        sceneNodes.insert(sceneNodes.end(), node.children.begin(), node.children.end());
+        if (sceneNodes.size() > nodes.size())
+            throw std::runtime_error("glTF node hierarchy has a cycle");
+    }
+}
+
+const std::vector<GltfMesh> &GltfAsset::getMeshes() const {
+    return meshes;
+}
+
+const std::vector<GltfNode> &GltfAsset::getNodes() const {
+    return nodes;
+}
+
+const std::vector<int32_t> &GltfAsset::getSceneNodes() const {
+    return sceneNodes;
+}
+
+size_t GltfAsset::getBufferBytes() const {
+    size_t bytes = 0;
+    for (const Buffer &buffer : buffers)
+        bytes += buffer.size;
+    return bytes;
+}
+
+/**
+ * @brief Gathers a triangle, strip or fan primitive into an indexed triangle list.
+ *
+ * This is the only pass over the vertex data, reading it straight from the mapped pages.
+ *
+ * @throws std::runtime_error For points and lines, mismatched attribute counts or indices out of range.
+ */
+Mesh GltfAsset::toMesh(const GltfPrimitive &primitive) {
+    if (primitive.mode < 4 || primitive.mode > 6)
+        throw std::runtime_error("Only triangle glTF primitives can be turned into a Mesh");
+    const AccessorView &positions = primitive.positions, &normals = primitive.normals,
+                       &colors = primitive.colors, &indices = primitive.indices;
+    const size_t vertexCount = positions.count;
+    if (positions.components != 3 || (normals && (normals.components != 3 || normals.count != vertexCount)) ||
+        (colors && (colors.components < 3 || colors.components > 4 || colors.count != vertexCount)))
+        throw std::runtime_error("glTF primitive with mismatched attributes");
+
+    Mesh mesh;
+    mesh.positions.resize(vertexCount * 3);
+    mesh.normals.resize(normals ? vertexCount * 3 : 0);
+    mesh.colors.resize(colors ? vertexCount * 4 : 0);
+    ThreadPool &pool = ThreadPool::shared();
+    pool.parallelFor(vertexCount, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            for (uint32_t c = 0; c < 3; ++c) {
+                mesh.positions[v * 3 + c] = positions.getFloat(v, c);
+                if (normals)
+                    mesh.normals[v * 3 + c] = normals.getFloat(v, c);
+            }
+            if (colors)
+                for (uint32_t c = 0; c < 4; ++c)
+                    mesh.colors[v * 4 + c] = c < colors.components ? colors.getFloat(v, c) : 1.0f;
+        }
+    });
+
+    // Corner i of the primitive as a vertex index
+    const size_t cornerCount = indices ? indices.count : vertexCount;
+    std::vector<uint32_t> corners(cornerCount);
+    if (indices) {
+        withIndexType(indices.componentType, [&](auto type) {
+            using T = decltype(type);
+            pool.parallelFor(cornerCount, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i)
+                    corners[i] = indices.get<T>(i);
+            });
+        });
+    } else {
+        for (size_t i = 0; i < cornerCount; ++i)
+            corners[i] = static_cast<uint32_t>(i);
+    }
+    if (!std::all_of(corners.begin(), corners.end(), [&](uint32_t i) { return i < vertexCount; }))
+        throw std::runtime_error("glTF index out of range");
+
+    if (primitive.mode == 4) {
+        corners.resize(cornerCount / 3 * 3);
+        mesh.indices = std::move(corners);
+    } else if (cornerCount >= 3) {
+        // Strips alternate winding so every triangle faces the same way, fans pivot on corner 0
+        mesh.indices.reserve((cornerCount - 2) * 3);
+        for (size_t i = 0; i + 2 < cornerCount; ++i) {
+            if (primitive.mode == 5)
+                mesh.indices.insert(mesh.indices.end(),
+                                    {corners[i], corners[i + 1 + i % 2], corners[i + 2 - i % 2]});
+            else
+                mesh.indices.insert(mesh.indices.end(), {corners[i + 1], corners[i + 2], corners[0]});
+        }
+    }
+    return mesh;
+}
+
+/**
+ * @brief Bakes every mesh instance of the default scene into one Mesh.
+ *
+ * Normals are kept if every primitive has them, colors if any has them (white elsewhere).
+ * Points and lines are skipped. Meshes used by several nodes are gathered once.
+ */
+Mesh GltfAsset::flatten() const {
+    struct Instance {
+        const Mesh *mesh;
+        const std::array<float, 16> *world;
+        size_t vertexOffset;
+        size_t indexOffset;
+    };
+
+    std::vector<std::vector<Mesh>> gathered(meshes.size());
+    std::vector<Instance> instances;
+    size_t vertexCount = 0, indexCount = 0;
+    bool allNormals = true, anyColors = false;
+    for (const int32_t n : sceneNodes) {
+        const GltfNode &node = nodes[n];
+        if (node.mesh < 0)
+            continue;
+        std::vector<Mesh> &parts = gathered[node.mesh];
+        if (parts.empty())
+            for (const GltfPrimitive &primitive : meshes[node.mesh].primitives)
+                parts.push_back(primitive.mode >= 4 && primitive.mode <= 6 ? toMesh(primitive) : Mesh{});
+        for (const Mesh &part : parts) {
+            if (part.indices.empty())
+                continue;
+            instances.push_back({&part, &node.world, vertexCount, indexCount});
+            vertexCount += part.vertexCount();
+            indexCount += part.indices.size();
+            allNormals &= !part.normals.empty();
+            anyColors |= !part.colors.empty();
+        }
+    }
+
+    Mesh mesh;
+    mesh.positions.resize(vertexCount * 3);
+    mesh.normals.resize(allNormals ? vertexCount * 3 : 0);
+    mesh.colors.resize(anyColors ? vertexCount * 4 : 0);
+    mesh.indices.resize(indexCount);
+    ThreadPool::shared().parallelFor(instances.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const Instance &instance = instances[i];
+            const Mesh &part = *instance.mesh;
+            const float *m = instance.world->data();
+
+            // Normals use the cofactor matrix, the inverse transpose up to a scale, flipped
+            // back for mirroring transforms. Stored transposed, expanded along column 0
+            const float cofactor[9] = {m[5] * m[10] - m[6] * m[9], m[6] * m[8] - m[4] * m[10], m[4] * m[9] - m[5] * m[8],
+                                       m[2] * m[9] - m[1] * m[10], m[0] * m[10] - m[2] * m[8], m[1] * m[8] - m[0] * m[9],
+                                       m[1] * m[6] - m[2] * m[5], m[2] * m[4] - m[0] * m[6], m[0] * m[5] - m[1] * m[4]};
+            const float determinant = m[0] * cofactor[0] + m[1] * cofactor[1] + m[2] * cofactor[2];
+            const float sign = determinant < 0 ? -1.0f : 1.0f;
+
+            for (size_t v = 0; v < part.vertexCount(); ++v) {
+                const float *p = &part.positions[v * 3];
+                float *out = &mesh.positions[(instance.vertexOffset + v) * 3];
+                for (int r = 0; r < 3; ++r)
+                    out[r] = m[r] * p[0] + m[4 + r] * p[1] + m[8 + r] * p[2] + m[12 + r];
+
+                if (allNormals) {
+                    const float *n = &part.normals[v * 3];
+                    float *normal = &mesh.normals[(instance.vertexOffset + v) * 3];
+                    for (int r = 0; r < 3; ++r)
+                        normal[r] = sign * (cofactor[r] * n[0] + cofactor[3 + r] * n[1] + cofactor[6 + r] * n[2]);
+                    const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+                    if (length > 0)
+                        for (int r = 0; r < 3; ++r)
+                            normal[r] /= length;
+                }
+            }
+            if (anyColors && part.colors.empty())
+                std::fill_n(mesh.colors.data() + instance.vertexOffset * 4, part.vertexCount() * 4, 1.0f);
+            else if (anyColors)
+                std::copy(part.colors.begin(), part.colors.end(), mesh.colors.data() + instance.vertexOffset * 4);
+            for (size_t k = 0; k < part.indices.size(); ++k)
+                mesh.indices[instance.indexOffset + k] = part.indices[k] + static_cast<uint32_t>(instance.vertexOffset);
+        }
+    });
+    return mesh;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../common/MappedFile.h"
+#include "../common/Mesh.h"
+
+/*
+-------------------------------------------------------------------
+  glTF LOADER  ------------------------------------------------------
+
+  glTF 2.0, both .gltf (JSON with external or base64 data: buffers) and .glb (one file
+  with a JSON and a BIN chunk). Buffers are memory-mapped and accessors are exposed as
+  strided views into the mapped pages, so opening an asset only parses the JSON header and
+  vertex data is read exactly once, by whoever consumes the views.
+
+  Not supported: sparse accessors, accessors without a buffer view, and images/materials
+  (ignored).
+-------------------------------------------------------------------
+*/
+
+enum class GltfComponentType : uint32_t {
+    Int8 = 5120,
+    Uint8 = 5121,
+    Int16 = 5122,
+    Uint16 = 5123,
+    Uint32 = 5125,
+    Float32 = 5126,
+};
+
+/**
+ * @brief A typed, strided window onto an accessor's bytes, nothing is copied.
+ *
+ * Elements may be unaligned in the file, so reads go through memcpy, which compiles to a plain
+ * load on every target we build for.
+ */
+struct AccessorView {
+    const uint8_t *data{nullptr};   // First element
+    size_t count{0};
+    size_t stride{0};               // Bytes from one element to the next
+    uint32_t components{0};         // 1 for SCALAR, 3 for VEC3, 16 for MAT4...
+    GltfComponentType componentType{GltfComponentType::Float32};
+    bool normalized{false};
+
+    explicit operator bool() const { return data != nullptr; }
+
+    // Bytes of one element without padding
+    size_t elementSize() const;
+
+    // Element i reinterpreted as T, e.g. std::array<float, 3> for a float VEC3
+    template <typename T>
+    T get(size_t i) const {
+        T value;
+        std::memcpy(&value, data + i * stride, sizeof(T));
+        return value;
+    }
+
+    // Component c of element i as a float, normalized integers map to [0, 1] or [-1, 1]
+    float getFloat(size_t i, uint32_t c) const;
+
+    // Scalar element i of an index accessor
+    uint32_t getIndex(size_t i) const;
+};
+
+/**
+ * @brief One draw of a glTF mesh, views into the asset's buffers.
+ */
+struct GltfPrimitive {
+    AccessorView positions;
+    AccessorView normals;           // Optional
+    AccessorView colors;            // COLOR_0, optional, VEC3 or VEC4
+    AccessorView indices;           // Optional, draw positions in order without it
+    uint32_t mode{4};               // 4 = triangles, 5 = strip, 6 = fan, others are points and lines
+};
+
+struct GltfMesh {
+    std::string name;
+    std::vector<GltfPrimitive> primitives;
+};
+
+/**
+ * @brief A scene node. Matrices are column-major like glTF and Eigen.
+ */
+struct GltfNode {
+    std::string name;
+    int32_t parent{-1};
+    int32_t mesh{-1};
+    std::vector<int32_t> children;
+    std::array<float, 16> local;    // Relative to the parent
+    std::array<float, 16> world;    // Parent's world * local, identity above the roots
+};
+
+/**
+ * @class GltfAsset
+ * @brief An opened glTF file, its nodes and meshes with views into the mapped buffers.
+ *
+ * Usage:
+ * - Keep the asset alive for as long as its AccessorViews are in use.
+ * - getSceneNodes() lists the nodes of the default scene in parent-before-child order, so
+ *   a transform hierarchy can be built in one pass.
+ * - toMesh() gathers a triangle primitive into a Mesh for the mesh passes and MeshPrimitive.
+ */
+class GltfAsset final {
+public:
+    explicit GltfAsset(const std::string &fileName);
+
+    GltfAsset(const GltfAsset &) = delete;
+    GltfAsset &operator=(const GltfAsset &) = delete;
+
+    const std::vector<GltfMesh> &getMeshes() const;
+
+    const std::vector<GltfNode> &getNodes() const;
+
+    const std::vector<int32_t> &getSceneNodes() const;
+
+    // Bytes of buffer data, all of it mapped rather than read
+    size_t getBufferBytes() const;
+
+    // Throws if the primitive isn't made of triangles
+    static Mesh toMesh(const GltfPrimitive &primitive);
+
+    // Every mesh instance of the scene in one Mesh, with node transforms applied
+    Mesh flatten() const;
+
+private:
+    struct Buffer {
+        const uint8_t *data;
+        size_t size;
+    };
+
+    std::vector<std::unique_ptr<MappedFile>> files;
+    std::vector<std::vector<uint8_t>> decodedBuffers;   // base64 data: URIs, usually tiny
+    std::vector<Buffer> buffers;
+    std::vector<GltfMesh> meshes;
+    std::vector<GltfNode> nodes;
+    std::vector<int32_t> sceneNodes;
+
+    void parse(const char *json, size_t jsonSize, const Buffer &binaryChunk, const std::string &directory);
+};
@@ -0,0 +1,252 @@
+#include "json.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+/*
+    Recursive descent over the whole text, nesting is capped so hostile files can't overflow
+    the stack
+*/
+class JsonParser {
+public:
+    JsonParser(const char *text, size_t size) : begin(text), p(text), end(text + size) {}
+
+    JsonValue parseDocument() {
+        JsonValue value = parseValue(0);
+        skipSpaces();
+        if (p != end)
+            fail("trailing characters");
+        return value;
+    }
+
+private:
+    static constexpr int maxDepth = 256;
+
+    const char *begin;
+    const char *p;
+    const char *end;
+
+    [[noreturn]] void fail(const char *what) const {
+        throw std::runtime_error(std::string("Malformed JSON (") + what + ") at byte " + std::to_string(p - begin));
+    }
+
+    void skipSpaces() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+            ++p;
+    }
+
+    void expect(char c) {
+        skipSpaces();
+        if (p >= end || *p != c)
+            fail("unexpected character");
+        ++p;
+    }
+
+    bool consume(const char *word) {
+        const size_t length = std::strlen(word);
+        if (static_cast<size_t>(end - p) < length || std::memcmp(p, word, length) != 0)
+            return false;
+        p += length;
+        return true;
+    }
+
+    JsonValue parseValue(int depth) {
+        if (depth > maxDepth)
+            fail("nested too deeply");
+        skipSpaces();
+        if (p >= end)
+            fail("unexpected end");
+
+        JsonValue value;
+        switch (*p) {
+        case '{':
+            value.type = JsonValue::Type::Object;
+            ++p;
+            skipSpaces();
+            if (p < end && *p == '}') {
+                ++p;
+                break;
+            }
+            do {
+                skipSpaces();
+                std::string name = parseString();
+                expect(':');
+                value.members.emplace_back(std::move(name), parseValue(depth + 1));
+                skipSpaces();
+            } while (p < end && *p == ',' && ++p);
+            expect('}');
+            break;
+        case '[':
+            value.type = JsonValue::Type::Array;
+            ++p;
+            skipSpaces();
+            if (p < end && *p == ']') {
+                ++p;
+                break;
+            }
+            do {
+                value.elements.push_back(parseValue(depth + 1));
+                skipSpaces();
+            } while (p < end && *p == ',' && ++p);
+            expect(']');
+            break;
+        case '"':
+            value.type = JsonValue::Type::String;
+            value.text = parseString();
+            break;
+        default:
+            if (consume("true")) {
+                value.type = JsonValue::Type::Bool;
+                value.boolean = true;
+            } else if (consume("false")) {
+                value.type = JsonValue::Type::Bool;
+            } else if (consume("null")) {
+                value.type = JsonValue::Type::Null;
+            } else {
+                value.type = JsonValue::Type::Number;
+                value.number = parseNumber();
+            }
+        }
+        return value;
+    }
+
+    double parseNumber() {
+        const char *start = p;
+        if (p < end && *p == '-')
+            ++p;
+        while (p < end && ((*p >= '0' && *p <= '9') || *p == '.' || *p == 'e' || *p == 'E' || *p == '+' || *p == '-'))
+            ++p;
+        char buffer[64];
+        const size_t length = static_cast<size_t>(p - start);
+        if (length == 0 || length >= sizeof(buffer))
+            fail("bad number");
+        std::memcpy(buffer, start, length);
+        buffer[length] = '\0';
+        char *stop = nullptr;
+        const double number = std::strtod(buffer, &stop);
+        if (stop != buffer + length)
+            fail("bad number");
+        return number;
+    }
+
+    void appendUtf8(std::string &out, uint32_t codePoint) {
+        if (codePoint < 0x80) {
+            out += static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+            out += static_cast<char>(0xC0 | codePoint >> 6);
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else if (codePoint < 0x10000) {
+            out += static_cast<char>(0xE0 | codePoint >> 12);
+            out += static_cast<char>(0x80 | (codePoint >> 6 & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | codePoint >> 18);
+            out += static_cast<char>(0x80 | (codePoint >> 12 & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint >> 6 & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+
+    uint32_t parseHex4() {
+        if (end - p < 4)
+            fail("bad escape");
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i, ++p) {
+            const char c = *p;
+            const int digit = c >= '0' && c <= '9' ? c - '0'
+                            : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                            : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                                   : -1;
+            if (digit < 0)
+                fail("bad escape");
+            value = value << 4 | static_cast<uint32_t>(digit);
+        }
+        return value;
+    }
+
+    std::string parseString() {
+        if (p >= end || *p != '"')
+            fail("expected a string");
+        ++p;
+        std::string out;
+        while (true) {
+            // Copy runs without escapes in one go
+            const char *run = p;
+            while (p < end && *p != '"' && *p != '\\')
+                ++p;
+            out.append(run, p);
+            if (p >= end)
+                fail("unterminated string");
+            if (*p++ == '"')
+                return out;
+
+            if (p >= end)
+                fail("bad escape");
+            switch (*p++) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t codePoint = parseHex4();
+                if (codePoint >= 0xD800 && codePoint < 0xDC00 && consume("\\u")) {
+                    const uint32_t low = parseHex4();
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(out, codePoint);
+                break;
+            }
+            default: fail("bad escape");
+            }
+        }
+    }
+};
+
+size_t JsonValue::size() const {
+    return type == Type::Array ? elements.size() : type == Type::Object ? members.size() : 0;
+}
+
+const JsonValue &JsonValue::operator[](const char *member) const {
+    static const JsonValue null;
+    for (const auto &[name, value] : members)
+        if (name == member)
+            return value;
+    return null;
+}
+
+const JsonValue &JsonValue::operator[](size_t index) const {
+    static const JsonValue null;
+    return index < elements.size() ? elements[index] : null;
+}
+
+bool JsonValue::asBool(bool fallback) const {
+    return type == Type::Bool ? boolean : fallback;
+}
+
+double JsonValue::asNumber(double fallback) const {
+    return type == Type::Number ? number : fallback;
+}
+
+size_t JsonValue::asSize(size_t fallback) const {
+    if (type != Type::Number)
+        return fallback;
+    if (number < 0 || number != std::floor(number) || number > 9007199254740992.0)
+        throw std::runtime_error("Expected a non-negative integer in JSON, got " + std::to_string(number));
+    return static_cast<size_t>(number);
+}
+
+const std::string &JsonValue::asString() const {
+    static const std::string empty;
+    return type == Type::String ? text : empty;
+}
+
+JsonValue parseJson(const char *text, size_t size) {
+    return JsonParser(text, size).parseDocument();
+}
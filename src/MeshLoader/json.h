@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @class JsonValue
+ * @brief A parsed JSON document, just enough for glTF headers.
+ *
+ * Objects keep their members in file order and are searched linearly, glTF objects only have
+ * a handful of members. Looking up a missing member or index returns a null value instead of
+ * throwing, so optional glTF properties read naturally with a default.
+ *
+ * Usage:
+ * - JsonValue json = parseJson(text, size);
+ * - size_t offset = json["bufferViews"][view]["byteOffset"].asSize(0);
+ */
+class JsonValue {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type getType() const { return type; }
+    bool isNull() const { return type == Type::Null; }
+    bool isNumber() const { return type == Type::Number; }
+    bool isString() const { return type == Type::String; }
+    bool isArray() const { return type == Type::Array; }
+    bool isObject() const { return type == Type::Object; }
+
+    // Members of an object, elements of an array, 0 otherwise
+    size_t size() const;
+
+    const JsonValue &operator[](const char *member) const;
+    const JsonValue &operator[](size_t index) const;
+
+    bool asBool(bool fallback = false) const;
+    double asNumber(double fallback = 0.0) const;
+    // Throws if the number is negative or not a whole number
+    size_t asSize(size_t fallback = 0) const;
+    const std::string &asString() const;
+
+    const std::vector<std::pair<std::string, JsonValue>> &getMembers() const { return members; }
+
+private:
+    friend class JsonParser;
+
+    Type type{Type::Null};
+    bool boolean{false};
+    double number{0.0};
+    std::string text;
+    std::vector<JsonValue> elements;
+    std::vector<std::pair<std::string, JsonValue>> members;
+};
+
+// Throws std::runtime_error with the byte offset of the first syntax error
+JsonValue parseJson(const char *text, size_t size);
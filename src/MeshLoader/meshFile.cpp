@@ -0,0 +1,292 @@
+#include "meshFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "../common/IndexPacking.h"
+#include "../common/ThreadPool.h"
+#include "streamCodec.h"
+
+namespace {
+
+constexpr char meshFileMagic[4] = {'M', 'E', 'S', 'H'};
+
+uint32_t elementSizeOf(MeshSection type) {
+    switch (type) {
+    case MeshSection::Positions:
+    case MeshSection::Normals: return 3 * sizeof(float);
+    case MeshSection::Colors: return 4 * sizeof(float);
+    case MeshSection::Indices:
+    case MeshSection::MeshletVertices: return sizeof(uint32_t);
+    case MeshSection::Lods: return sizeof(MeshLod);
+    case MeshSection::Meshlets: return sizeof(Meshlet);
+    case MeshSection::MeshletTriangles: return sizeof(uint8_t);
+    }
+    return 0;
+}
+
+// Word streams compress, the small tables are left raw
+bool compressible(MeshSection type) {
+    return type != MeshSection::Lods && type != MeshSection::Meshlets && type != MeshSection::MeshletTriangles;
+}
+
+size_t alignUp(size_t offset) {
+    return (offset + meshFileAlignment - 1) / meshFileAlignment * meshFileAlignment;
+}
+
+uint32_t checkedCount(size_t count) {
+    if (count > UINT32_MAX)
+        throw std::runtime_error("Mesh is too large for a .mesh file");
+    return static_cast<uint32_t>(count);
+}
+
+} // namespace
+
+/**
+ * @brief Writes @p baked as a .mesh file, compressing word streams when that makes them smaller.
+ */
+void writeMeshFile(const std::string &fileName, const BakedMesh &baked, bool compress) {
+    const Mesh &mesh = baked.mesh;
+    struct Pending {
+        MeshSection type;
+        const void *data;
+        size_t count;
+        std::vector<uint8_t> encoded;
+        MeshFileSection section{};
+    };
+    std::vector<Pending> pending;
+    auto add = [&](MeshSection type, const void *data, size_t count) {
+        if (count > 0)
+            pending.push_back({type, data, count, {}, {}});
+    };
+    add(MeshSection::Positions, mesh.positions.data(), mesh.vertexCount());
+    add(MeshSection::Normals, mesh.normals.data(), mesh.normals.size() / 3);
+    add(MeshSection::Colors, mesh.colors.data(), mesh.colors.size() / 4);
+    add(MeshSection::Indices, mesh.indices.data(), mesh.indices.size());
+    add(MeshSection::Lods, baked.levels.data(), baked.levels.size());
+    add(MeshSection::Meshlets, baked.meshlets.meshlets.data(), baked.meshlets.meshlets.size());
+    add(MeshSection::MeshletVertices, baked.meshlets.vertices.data(), baked.meshlets.vertices.size());
+    add(MeshSection::MeshletTriangles, baked.meshlets.triangles.data(), baked.meshlets.triangles.size());
+
+    ThreadPool::shared().parallelFor(pending.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            Pending &entry = pending[i];
+            // Raw indices of small meshes are stored, and uploaded, as uint16
+            const bool narrow = entry.type == MeshSection::Indices && mesh.vertexCount() <= maxUInt16Vertices;
+            const uint32_t elementSize = elementSizeOf(entry.type);
+            const uint32_t rawElementSize = narrow ? sizeof(uint16_t) : elementSize;
+            const size_t rawSize = entry.count * rawElementSize;
+            entry.section = {entry.type, SectionEncoding::Raw, rawElementSize, checkedCount(entry.count), 0, rawSize};
+            if (compress && compressible(entry.type)) {
+                entry.encoded = encodeWordStream(static_cast<const uint32_t *>(entry.data), entry.count, elementSize / 4);
+                if (entry.encoded.size() < rawSize) {
+                    entry.section = {entry.type, SectionEncoding::DeltaBytePlane, elementSize, checkedCount(entry.count),
+                                     0, entry.encoded.size()};
+                    continue;
+                }
+            }
+            entry.encoded.clear();
+            if (narrow) {
+                entry.encoded.resize(rawSize);
+                const uint32_t *indices = static_cast<const uint32_t *>(entry.data);
+                for (size_t k = 0; k < entry.count; ++k) {
+                    const uint16_t index = static_cast<uint16_t>(indices[k]);
+                    std::memcpy(entry.encoded.data() + k * sizeof(index), &index, sizeof(index));
+                }
+            }
+        }
+    });
+
+    MeshFileHeader header{};
+    std::memcpy(header.magic, meshFileMagic, sizeof(header.magic));
+    header.version = meshFileVersion;
+    header.sectionCount = static_cast<uint32_t>(pending.size());
+    header.vertexCount = checkedCount(mesh.vertexCount());
+    header.indexCount = checkedCount(mesh.indices.size());
+    header.lodCount = checkedCount(baked.levels.size());
+    header.meshletCount = checkedCount(baked.meshlets.meshlets.size());
+
+    // Bounding box, and a sphere around its center
+    for (int c = 0; c < 3; ++c) {
+        header.boundsMin[c] = mesh.vertexCount() ? INFINITY : 0.0f;
+        header.boundsMax[c] = mesh.vertexCount() ? -INFINITY : 0.0f;
+    }
+    for (size_t v = 0; v < mesh.vertexCount(); ++v) {
+        for (int c = 0; c < 3; ++c) {
+            header.boundsMin[c] = std::min(header.boundsMin[c], mesh.positions[v * 3 + c]);
+            header.boundsMax[c] = std::max(header.boundsMax[c], mesh.positions[v * 3 + c]);
+        }
+    }
+    float radiusSquared = 0.0f;
+    for (int c = 0; c < 3; ++c)
+        header.sphere[c] = 0.5f * (header.boundsMin[c] + header.boundsMax[c]);
+    for (size_t v = 0; v < mesh.vertexCount(); ++v) {
+        float distanceSquared = 0.0f;
+        for (int c = 0; c < 3; ++c)
+            distanceSquared += (mesh.positions[v * 3 + c] - header.sphere[c]) * (mesh.positions[v * 3 + c] - header.sphere[c]);
+        radiusSquared = std::max(radiusSquared, distanceSquared);
+    }
+    header.sphere[3] = std::sqrt(radiusSquared);
+
+    size_t offset = alignUp(sizeof(MeshFileHeader) + pending.size() * sizeof(MeshFileSection));
+    for (Pending &entry : pending) {
+        entry.section.offset = offset;
+        offset = alignUp(offset + entry.section.storedSize);
+    }
+    header.fileSize = offset;
+
+    std::ofstream file(fileName, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to write mesh file: " + fileName);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const Pending &entry : pending)
+        file.write(reinterpret_cast<const char *>(&entry.section), sizeof(entry.section));
+
+    static const char padding[meshFileAlignment] = {};
+    size_t written = sizeof(header) + pending.size() * sizeof(MeshFileSection);
+    for (const Pending &entry : pending) {
+        file.write(padding, static_cast<std::streamsize>(entry.section.offset - written));
+        const void *bytes = entry.encoded.empty() ? entry.data : entry.encoded.data();
+        file.write(static_cast<const char *>(bytes), static_cast<std::streamsize>(entry.section.storedSize));
+        written = entry.section.offset + entry.section.storedSize;
+    }
+    file.write(padding, static_cast<std::streamsize>(header.fileSize - written));
+    if (!file)
+        throw std::runtime_error("Failed to write mesh file: " + fileName);
+}
+
+/**
+ * @brief Maps a .mesh file and checks its header and section table.
+ *
+ * @throws std::runtime_error If the file isn't a .mesh file of this version or is inconsistent.
+ */
+MeshFile::MeshFile(const std::string &fileName) : file(fileName) {
+    const size_t size = file.size();
+    if (size < sizeof(MeshFileHeader) || std::memcmp(file.data(), meshFileMagic, sizeof(meshFileMagic)) != 0)
+        throw std::runtime_error("Not a .mesh file: " + fileName);
+
+    // Mappings are page aligned, so the header and sections can be used in place
+    header = reinterpret_cast<const MeshFileHeader *>(file.data());
+    if (header->version != meshFileVersion)
+        throw std::runtime_error(fileName + " is .mesh version " + std::to_string(header->version) + ", expected " +
+                                 std::to_string(meshFileVersion) + ", bake it again");
+    if (header->fileSize != size || header->sectionCount > (size - sizeof(MeshFileHeader)) / sizeof(MeshFileSection))
+        throw std::runtime_error("Truncated .mesh file: " + fileName);
+    sections = reinterpret_cast<const MeshFileSection *>(file.data() + sizeof(MeshFileHeader));
+
+    for (uint32_t i = 0; i < header->sectionCount; ++i) {
+        const MeshFileSection &section = sections[i];
+        const uint32_t expectedSize = elementSizeOf(section.type);
+        const uint64_t rawSize = uint64_t(section.elementSize) * section.elementCount;
+        const bool narrowIndices = section.type == MeshSection::Indices && section.elementSize == sizeof(uint16_t) &&
+                                   section.encoding == SectionEncoding::Raw;
+        bool valid = expectedSize != 0 && (section.elementSize == expectedSize || narrowIndices) && section.offset <= size &&
+                     section.storedSize <= size - section.offset && section.offset % meshFileAlignment == 0;
+        if (section.encoding == SectionEncoding::Raw)
+            valid &= section.storedSize == rawSize;
+        else
+            valid &= section.encoding == SectionEncoding::DeltaBytePlane && compressible(section.type);
+
+        switch (section.type) {
+        case MeshSection::Positions:
+        case MeshSection::Normals:
+        case MeshSection::Colors: valid &= section.elementCount == header->vertexCount; break;
+        case MeshSection::Indices: valid &= section.elementCount == header->indexCount; break;
+        case MeshSection::Lods: valid &= section.elementCount == header->lodCount; break;
+        case MeshSection::Meshlets: valid &= section.elementCount == header->meshletCount; break;
+        default: break;
+        }
+        if (!valid)
+            throw std::runtime_error("Corrupt section " + std::to_string(i) + " in .mesh file: " + fileName);
+    }
+    if (!findSection(MeshSection::Positions) || !findSection(MeshSection::Indices))
+        throw std::runtime_error(".mesh file without positions or indices: " + fileName);
+}
+
+const MeshFileHeader &MeshFile::getHeader() const {
+    return *header;
+}
+
+const MeshFileSection *MeshFile::findSection(MeshSection type) const {
+    for (uint32_t i = 0; i < header->sectionCount; ++i)
+        if (sections[i].type == type)
+            return &sections[i];
+    return nullptr;
+}
+
+const void *MeshFile::getRawData(MeshSection type) const {
+    const MeshFileSection *section = findSection(type);
+    if (!section || section->encoding != SectionEncoding::Raw)
+        return nullptr;
+    return file.data() + section->offset;
+}
+
+/**
+ * @brief Copies or decodes a section into @p destination, elementSize * elementCount bytes.
+ *
+ * Raw index sections of meshes with up to 65536 vertices hold uint16 indices.
+ *
+ * @throws std::runtime_error If the section is missing or its compressed data is malformed.
+ */
+void MeshFile::read(MeshSection type, void *destination) const {
+    const MeshFileSection *section = findSection(type);
+    if (!section)
+        throw std::runtime_error("Missing .mesh section " + std::to_string(static_cast<uint32_t>(type)));
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(file.data()) + section->offset;
+    if (section->encoding == SectionEncoding::Raw)
+        std::memcpy(destination, data, section->storedSize);
+    else
+        decodeWordStream(static_cast<uint32_t *>(destination), section->elementCount, section->elementSize / 4, data,
+                         section->storedSize);
+}
+
+/**
+ * @brief Reads every section, in parallel, and checks that indices and ranges are in bounds.
+ */
+BakedMesh MeshFile::load() const {
+    BakedMesh baked;
+    Mesh &mesh = baked.mesh;
+    auto sized = [&](MeshSection type, auto &vector, size_t perElement) -> void * {
+        const MeshFileSection *section = findSection(type);
+        vector.resize(section ? size_t(section->elementCount) * perElement : 0);
+        return section ? vector.data() : nullptr;
+    };
+    // uint16 indices are widened once read
+    std::vector<uint16_t> narrowIndices;
+    const bool narrow = findSection(MeshSection::Indices)->elementSize == sizeof(uint16_t);
+    const std::pair<MeshSection, void *> targets[] = {
+        {MeshSection::Positions, sized(MeshSection::Positions, mesh.positions, 3)},
+        {MeshSection::Normals, sized(MeshSection::Normals, mesh.normals, 3)},
+        {MeshSection::Colors, sized(MeshSection::Colors, mesh.colors, 4)},
+        {MeshSection::Indices, narrow ? sized(MeshSection::Indices, narrowIndices, 1)
+                                      : sized(MeshSection::Indices, mesh.indices, 1)},
+        {MeshSection::Lods, sized(MeshSection::Lods, baked.levels, 1)},
+        {MeshSection::Meshlets, sized(MeshSection::Meshlets, baked.meshlets.meshlets, 1)},
+        {MeshSection::MeshletVertices, sized(MeshSection::MeshletVertices, baked.meshlets.vertices, 1)},
+        {MeshSection::MeshletTriangles, sized(MeshSection::MeshletTriangles, baked.meshlets.triangles, 1)},
+    };
+    ThreadPool::shared().parallelFor(std::size(targets), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            if (targets[i].second)
+                read(targets[i].first, targets[i].second);
+    });
+
+    if (narrow)
+        mesh.indices.assign(narrowIndices.begin(), narrowIndices.end());
+
+    const size_t vertexCount = mesh.vertexCount(), indexCount = mesh.indices.size();
+    bool valid = std::all_of(mesh.indices.begin(), mesh.indices.end(), [&](uint32_t i) { return i < vertexCount; }) &&
+                 std::all_of(baked.meshlets.vertices.begin(), baked.meshlets.vertices.end(),
+                             [&](uint32_t i) { return i < vertexCount; });
+    for (const MeshLod &level : baked.levels)
+        valid &= level.indexOffset <= indexCount && level.indexCount <= indexCount - level.indexOffset;
+    for (const Meshlet &meshlet : baked.meshlets.meshlets)
+        valid &= uint64_t(meshlet.vertexOffset) + meshlet.vertexCount <= baked.meshlets.vertices.size() &&
+                 (uint64_t(meshlet.triangleOffset) + meshlet.triangleCount * 3) <= baked.meshlets.triangles.size();
+    if (!valid)
+        throw std::runtime_error(".mesh file has indices or ranges out of bounds");
+    return baked;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../common/MappedFile.h"
+#include "../common/Mesh.h"
+
+/*
+-------------------------------------------------------------------
+  .mesh FILES  ------------------------------------------------------
+
+  A baked, memory-mappable mesh: everything the renderer needs, already optimized and in
+  the layout it's uploaded in, so loading is a mapping plus at most a decode.
+
+    MeshFileHeader              96 bytes, counts and bounds
+    MeshFileSection[count]      32 bytes each
+    section data                each section starts on a 64 byte boundary
+
+  Sections are stored raw (upload straight from the mapping) or with the delta/byte-plane
+  coding of streamCodec.h. Check elementSize before uploading raw indices, small meshes
+  store them as uint16. All values are little endian.
+-------------------------------------------------------------------
+*/
+
+constexpr uint32_t meshFileVersion = 1;
+constexpr size_t meshFileAlignment = 64;
+
+enum class MeshSection : uint32_t {
+    Positions = 1,          // float xyz
+    Normals = 2,            // float xyz
+    Colors = 3,             // float rgba
+    Indices = 4,            // uint32, every level of detail back to back. uint16 when raw
+                            // and there are at most 65536 vertices
+    Lods = 5,               // MeshLod
+    Meshlets = 6,           // Meshlet
+    MeshletVertices = 7,    // uint32
+    MeshletTriangles = 8,   // uint8, three per triangle
+};
+
+enum class SectionEncoding : uint32_t {
+    Raw = 0,
+    DeltaBytePlane = 1,
+};
+
+struct MeshFileHeader {
+    char magic[4];                  // "MESH"
+    uint32_t version;               // meshFileVersion
+    uint32_t sectionCount;
+    uint32_t flags;                 // Reserved, 0
+    uint32_t vertexCount;
+    uint32_t indexCount;            // All levels of detail
+    uint32_t lodCount;
+    uint32_t meshletCount;
+    float boundsMin[3];
+    float boundsMax[3];
+    float sphere[4];                // Center xyz, radius
+    uint64_t fileSize;
+    uint32_t reserved[4];
+};
+static_assert(sizeof(MeshFileHeader) == 96, "MeshFileHeader is part of the file format");
+
+struct MeshFileSection {
+    MeshSection type;
+    SectionEncoding encoding;
+    uint32_t elementSize;           // Bytes per element once decoded
+    uint32_t elementCount;
+    uint64_t offset;                // From the start of the file
+    uint64_t storedSize;            // Bytes in the file
+};
+static_assert(sizeof(MeshFileSection) == 32, "MeshFileSection is part of the file format");
+
+/**
+ * @brief The contents of a .mesh file.
+ *
+ * mesh.indices holds every level back to back and levels index into it, level 0 being the
+ * full detail mesh. Meshlets cover level 0.
+ */
+struct BakedMesh {
+    Mesh mesh;
+    std::vector<MeshLod> levels;
+    MeshletSet meshlets;
+};
+
+// Throws std::runtime_error if the file can't be written
+void writeMeshFile(const std::string &fileName, const BakedMesh &baked, bool compress);
+
+/**
+ * @class MeshFile
+ * @brief A mapped .mesh file, validated on open.
+ *
+ * Usage:
+ * - getRawData() returns raw sections in place, ready to be copied into a GPU buffer.
+ * - read() decodes a section into caller-provided memory (elementSize * elementCount bytes),
+ *   e.g. a buffer's contents, so compressed sections aren't copied twice either.
+ * - load() reads everything into a BakedMesh.
+ */
+class MeshFile final {
+public:
+    explicit MeshFile(const std::string &fileName);
+
+    const MeshFileHeader &getHeader() const;
+
+    // nullptr if the file has no such section
+    const MeshFileSection *findSection(MeshSection type) const;
+
+    // nullptr if the section is missing or compressed
+    const void *getRawData(MeshSection type) const;
+
+    void read(MeshSection type, void *destination) const;
+
+    BakedMesh load() const;
+
+private:
+    MappedFile file;
+    const MeshFileHeader *header{nullptr};
+    const MeshFileSection *sections{nullptr};
+};
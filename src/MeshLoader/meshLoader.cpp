@@ -0,0 +1,39 @@
+#include "meshLoader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+#include "../common/MappedFile.h"
+#include "gltfLoader.h"
+#include "meshFile.h"
+
+/**
+ * @brief Memory-maps @p fileName and parses it as OBJ, PLY, glTF or .mesh, chosen by the extension.
+ *
+ * A .mesh file gives its full detail level only, use MeshFile to get the rest.
+ *
+ * @throws std::runtime_error If the file can't be read, has an unknown extension or is malformed.
+ */
+Mesh loadMesh(const std::string &fileName) {
+    const size_t dot = fileName.find_last_of('.');
+    std::string extension = dot == std::string::npos ? "" : fileName.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (extension == "gltf" || extension == "glb")
+        return GltfAsset(fileName).flatten();
+    if (extension == "mesh") {
+        BakedMesh baked = MeshFile(fileName).load();
+        if (!baked.levels.empty()) {
+            std::vector<uint32_t> &indices = baked.mesh.indices;
+            indices.erase(indices.begin() + baked.levels[0].indexOffset + baked.levels[0].indexCount, indices.end());
+            indices.erase(indices.begin(), indices.begin() + baked.levels[0].indexOffset);
+        }
+        return std::move(baked.mesh);
+    }
+    if (extension != "obj" && extension != "ply")
+        throw std::runtime_error("Unsupported mesh file: " + fileName);
+
+    const MappedFile file(fileName);
+    return extension == "obj" ? loadObj(file.data(), file.size()) : loadPly(file.data(), file.size());
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "../common/Mesh.h"
+
+/*
+-------------------------------------------------------------------
+  MESH LOADER  ------------------------------------------------------
+
+  Portable OBJ, PLY (ASCII, binary little and big endian) and glTF readers that produce
+  indexed triangle Meshes. Files are memory-mapped and cut into chunks that are parsed in
+  parallel on the shared ThreadPool, then stitched back together in file order, so the
+  result never depends on the thread count.
+
+    OBJ - v (with optional r g b), vn and f. Polygons are fanned into triangles and
+          negative (relative) indices are resolved. Faces that give vn indices get one
+          vertex per distinct position/normal pair.
+    PLY - vertex x y z, optional nx ny nz and red green blue alpha, face vertex_indices
+          (or vertex_index). Other elements and properties are skipped.
+    glTF - .gltf and .glb through GltfAsset (gltfLoader.h), flattened into one Mesh with the
+           node transforms applied. Use GltfAsset directly to keep the node hierarchy.
+    .mesh - Baked files from meshbake (meshFile.h), full detail level only. Use MeshFile
+            directly for the levels of detail and meshlets.
+-------------------------------------------------------------------
+*/
+
+// Picks the format from the file extension
+Mesh loadMesh(const std::string &fileName);
+
+Mesh loadObj(const char *data, size_t size);
+
+Mesh loadPly(const char *data, size_t size);
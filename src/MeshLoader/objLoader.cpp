@@ -0,0 +1,301 @@
+#include "meshLoader.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "../common/ThreadPool.h"
+#include "textParsing.h"
+
+/*
+-------------------------------------------------------------------
+  OBJ  --------------------------------------------------------------
+
+  Every chunk is parsed on its own into chunk-local arrays. A negative index is relative
+  to the vertices read so far, which a chunk doesn't know in full, so it is stored relative
+  to the chunk's first vertex and its slot is remembered. Merging adds each chunk's
+  starting vertex to those slots after the chunks have been concatenated.
+-------------------------------------------------------------------
+*/
+
+namespace {
+
+using namespace textParsing;
+
+constexpr uint32_t noNormal = ~0u;
+
+struct ObjChunk {
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<float> colors;                      // Empty until the chunk's first colored vertex
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> relativeIndices;          // Slots of indices that are chunk-relative
+    std::vector<uint32_t> normalIndices;            // Only once hasNormalIndices is set
+    std::vector<uint32_t> relativeNormalIndices;
+    bool hasNormalIndices{false};                   // Set by the chunk's first face with vn
+};
+
+struct Corner {
+    uint32_t position;
+    uint32_t normal;
+    bool relativePosition;
+    bool relativeNormal;
+};
+
+/*
+    OBJ indices are 1-based, negative ones count back from the last vertex read
+*/
+bool resolveIndex(int64_t index, size_t readSoFar, uint32_t &resolved) {
+    if (index > 0) {
+        resolved = static_cast<uint32_t>(index - 1);
+        return false;
+    }
+    if (index == 0)
+        throw std::runtime_error("OBJ index 0 is not valid");
+    resolved = static_cast<uint32_t>(static_cast<int64_t>(readSoFar) + index);  // May wrap, fixed when merging
+    return true;
+}
+
+void parseVertex(ObjChunk &chunk, const char *p, const char *end) {
+    float values[7];
+    size_t count = 0;
+    for (p = skipSpaces(p, end); count < 7 && !atLineEnd(p, end); p = skipSpaces(p, end)) {
+        p = parseFloat(p, end, values[count]);
+        if (!p)
+            throw std::runtime_error("Malformed OBJ vertex");
+        ++count;
+    }
+    if (count < 3)
+        throw std::runtime_error("OBJ vertex with fewer than 3 coordinates");
+
+    const size_t vertex = chunk.positions.size() / 3;
+    chunk.positions.insert(chunk.positions.end(), values, values + 3);
+
+    // "v x y z r g b" is a common extension, "v x y z w" is not a color
+    const bool colored = count >= 6;
+    if (colored && chunk.colors.empty())
+        chunk.colors.assign(vertex * 4, 1.0f);
+    if (colored)
+        chunk.colors.insert(chunk.colors.end(), {values[3], values[4], values[5], 1.0f});
+    else if (!chunk.colors.empty())
+        chunk.colors.insert(chunk.colors.end(), {1.0f, 1.0f, 1.0f, 1.0f});
+}
+
+void parseNormal(ObjChunk &chunk, const char *p, const char *end) {
+    float values[3];
+    for (float &value : values) {
+        p = parseFloat(skipSpaces(p, end), end, value);
+        if (!p)
+            throw std::runtime_error("Malformed OBJ normal");
+    }
+    chunk.normals.insert(chunk.normals.end(), values, values + 3);
+}
+
+void parseFace(ObjChunk &chunk, const char *p, const char *end, std::vector<Corner> &polygon) {
+    polygon.clear();
+    bool anyNormal = false;
+    for (p = skipSpaces(p, end); !atLineEnd(p, end); p = skipSpaces(p, end)) {
+        Corner corner{0, noNormal, false, false};
+        int64_t index;
+        p = parseInt(p, end, index);
+        if (!p)
+            throw std::runtime_error("Malformed OBJ face");
+        corner.relativePosition = resolveIndex(index, chunk.positions.size() / 3, corner.position);
+
+        // v, v/vt, v//vn or v/vt/vn, texture coordinates are not used
+        if (p < end && *p == '/') {
+            ++p;
+            if (p < end && *p != '/') {
+                p = parseInt(p, end, index);
+                if (!p)
+                    throw std::runtime_error("Malformed OBJ face");
+            }
+            if (p < end && *p == '/') {
+                p = parseInt(p + 1, end, index);
+                if (!p)
+                    throw std::runtime_error("Malformed OBJ face");
+                corner.relativeNormal = resolveIndex(index, chunk.normals.size() / 3, corner.normal);
+                anyNormal = true;
+            }
+        }
+        polygon.push_back(corner);
+    }
+    if (polygon.size() < 3)
+        return;     // Points and lines
+
+    if (anyNormal && !chunk.hasNormalIndices) {
+        chunk.normalIndices.assign(chunk.indices.size(), noNormal);
+        chunk.hasNormalIndices = true;
+    }
+
+    // Fan
+    for (size_t i = 2; i < polygon.size(); ++i) {
+        for (const Corner &corner : {polygon[0], polygon[i - 1], polygon[i]}) {
+            const uint32_t slot = static_cast<uint32_t>(chunk.indices.size());
+            chunk.indices.push_back(corner.position);
+            if (corner.relativePosition)
+                chunk.relativeIndices.push_back(slot);
+            if (chunk.hasNormalIndices) {
+                chunk.normalIndices.push_back(corner.normal);
+                if (corner.relativeNormal)
+                    chunk.relativeNormalIndices.push_back(slot);
+            }
+        }
+    }
+}
+
+void parseChunk(ObjChunk &chunk, const char *p, const char *end) {
+    std::vector<Corner> polygon;
+    while (p < end) {
+        p = skipSpaces(p, end);
+        if (p + 1 < end && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+            parseVertex(chunk, p + 2, end);
+        else if (p + 2 < end && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t'))
+            parseNormal(chunk, p + 3, end);
+        else if (p + 1 < end && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+            parseFace(chunk, p + 2, end, polygon);
+        p = skipLine(p, end);
+    }
+}
+
+/*
+    One vertex per distinct position/normal pair used by the faces
+*/
+void splitNormals(Mesh &mesh, const std::vector<float> &fileNormals, const std::vector<uint32_t> &normalIndices) {
+    const size_t vertexCount = mesh.vertexCount();
+
+    // Usually every position is paired with a single normal and nothing needs splitting
+    constexpr uint32_t unset = noNormal - 1;
+    std::vector<uint32_t> normalOf(vertexCount, unset);
+    bool consistent = true;
+    for (size_t i = 0; i < mesh.indices.size() && consistent; ++i) {
+        uint32_t &paired = normalOf[mesh.indices[i]];
+        if (paired == unset)
+            paired = normalIndices[i];
+        consistent = paired == normalIndices[i];
+    }
+
+    auto normalFor = [&](uint32_t normal, float *out) {
+        if (normal == noNormal || normal == unset)
+            std::fill_n(out, 3, 0.0f);
+        else
+            std::copy_n(&fileNormals[normal * 3], 3, out);
+    };
+
+    if (consistent) {
+        mesh.normals.resize(vertexCount * 3);
+        ThreadPool::shared().parallelFor(vertexCount, [&](size_t begin, size_t end) {
+            for (size_t v = begin; v < end; ++v)
+                normalFor(normalOf[v], &mesh.normals[v * 3]);
+        });
+        return;
+    }
+
+    std::vector<uint64_t> keys(mesh.indices.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+        keys[i] = uint64_t(mesh.indices[i]) << 32 | normalIndices[i];
+    std::vector<uint64_t> unique(keys);
+    std::sort(unique.begin(), unique.end());
+    unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+
+    Mesh split;
+    split.positions.resize(unique.size() * 3);
+    split.normals.resize(unique.size() * 3);
+    if (!mesh.colors.empty())
+        split.colors.resize(unique.size() * 4);
+    ThreadPool::shared().parallelFor(unique.size(), [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            const uint32_t position = static_cast<uint32_t>(unique[v] >> 32);
+            std::copy_n(&mesh.positions[position * 3], 3, &split.positions[v * 3]);
+            normalFor(static_cast<uint32_t>(unique[v]), &split.normals[v * 3]);
+            if (!mesh.colors.empty())
+                std::copy_n(&mesh.colors[position * 4], 4, &split.colors[v * 4]);
+        }
+    });
+
+    split.indices.resize(keys.size());
+    ThreadPool::shared().parallelFor(keys.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            split.indices[i] = static_cast<uint32_t>(std::lower_bound(unique.begin(), unique.end(), keys[i]) -
+                                                     unique.begin());
+    });
+    mesh = std::move(split);
+}
+
+} // namespace
+
+/**
+ * @brief Parses an OBJ file held in memory.
+ *
+ * @throws std::runtime_error On malformed vertices or faces, or indices out of range.
+ */
+Mesh loadObj(const char *data, size_t size) {
+    ThreadPool &pool = ThreadPool::shared();
+    const std::vector<const char *> bounds = splitLines(data, data + size, chunkCountFor(size, pool.size()));
+    const size_t chunkCount = bounds.size() - 1;
+
+    std::vector<ObjChunk> chunks(chunkCount);
+    pool.parallelFor(chunkCount, 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c)
+            parseChunk(chunks[c], bounds[c], bounds[c + 1]);
+    });
+
+    // Where each chunk's data starts in the merged arrays
+    std::vector<size_t> positionBase(chunkCount + 1, 0), normalBase(chunkCount + 1, 0), indexBase(chunkCount + 1, 0);
+    bool hasColors = false, hasFaceNormals = false;
+    for (size_t c = 0; c < chunkCount; ++c) {
+        positionBase[c + 1] = positionBase[c] + chunks[c].positions.size() / 3;
+        normalBase[c + 1] = normalBase[c] + chunks[c].normals.size() / 3;
+        indexBase[c + 1] = indexBase[c] + chunks[c].indices.size();
+        hasColors |= !chunks[c].colors.empty();
+        hasFaceNormals |= chunks[c].hasNormalIndices;
+    }
+    const size_t vertexCount = positionBase[chunkCount], normalCount = normalBase[chunkCount];
+    if (vertexCount >= noNormal || normalCount >= noNormal - 1)
+        throw std::runtime_error("OBJ file has too many vertices");
+
+    Mesh mesh;
+    mesh.positions.resize(vertexCount * 3);
+    mesh.indices.resize(indexBase[chunkCount]);
+    if (hasColors)
+        mesh.colors.resize(vertexCount * 4);
+    std::vector<float> fileNormals(hasFaceNormals ? normalCount * 3 : 0);
+    std::vector<uint32_t> normalIndices(hasFaceNormals ? mesh.indices.size() : 0);
+
+    pool.parallelFor(chunkCount, 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            ObjChunk &chunk = chunks[c];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), mesh.positions.data() + positionBase[c] * 3);
+            if (hasColors && chunk.colors.empty())
+                std::fill_n(mesh.colors.data() + positionBase[c] * 4, chunk.positions.size() / 3 * 4, 1.0f);
+            else if (hasColors)
+                std::copy(chunk.colors.begin(), chunk.colors.end(), mesh.colors.data() + positionBase[c] * 4);
+
+            uint32_t *indices = mesh.indices.data() + indexBase[c];
+            std::copy(chunk.indices.begin(), chunk.indices.end(), indices);
+            for (const uint32_t slot : chunk.relativeIndices)
+                indices[slot] += static_cast<uint32_t>(positionBase[c]);
+
+            if (hasFaceNormals) {
+                std::copy(chunk.normals.begin(), chunk.normals.end(), fileNormals.data() + normalBase[c] * 3);
+                uint32_t *normals = normalIndices.data() + indexBase[c];
+                if (!chunk.hasNormalIndices)
+                    std::fill_n(normals, chunk.indices.size(), noNormal);
+                std::copy(chunk.normalIndices.begin(), chunk.normalIndices.end(), normals);
+                for (const uint32_t slot : chunk.relativeNormalIndices)
+                    normals[slot] += static_cast<uint32_t>(normalBase[c]);
+            }
+            chunk = ObjChunk{};     // Free as we go, large files would otherwise need twice the memory
+        }
+    });
+
+    const bool inRange = std::all_of(mesh.indices.begin(), mesh.indices.end(),
+                                     [&](uint32_t i) { return i < vertexCount; }) &&
+                         std::all_of(normalIndices.begin(), normalIndices.end(),
+                                     [&](uint32_t i) { return i < normalCount || i == noNormal; });
+    if (!inRange)
+        throw std::runtime_error("OBJ face index out of range");
+
+    if (hasFaceNormals)
+        splitNormals(mesh, fileNormals, normalIndices);
+    return mesh;
+}
@@ -0,0 +1,546 @@
+#include "meshLoader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include "../common/ThreadPool.h"
+#include "textParsing.h"
+
+/*
+-------------------------------------------------------------------
+  PLY  --------------------------------------------------------------
+
+  Binary vertices have a fixed size, so they're decoded in parallel straight from their
+  offset. Binary faces almost always have the same corner count (scanners write triangles),
+  which is checked in parallel so they can be decoded the same way, with a serial walk as
+  the fallback. ASCII elements are one record per line, split into line-aligned chunks.
+-------------------------------------------------------------------
+*/
+
+namespace {
+
+using namespace textParsing;
+
+enum class PlyFormat { Ascii, BinaryLittleEndian, BinaryBigEndian };
+
+enum class PlyType : uint8_t { Int8, Uint8, Int16, Uint16, Int32, Uint32, Float32, Float64 };
+
+struct PlyProperty {
+    std::string name;
+    PlyType type{PlyType::Float32};
+    PlyType countType{PlyType::Uint8};  // Lists only
+    bool isList{false};
+    size_t offset{0};                   // Within a record, when the element has a fixed stride
+};
+
+struct PlyElement {
+    std::string name;
+    size_t count{0};
+    std::vector<PlyProperty> properties;
+    size_t stride{0};                   // 0 when the element has list properties
+
+    int find(const char *property) const {
+        for (size_t i = 0; i < properties.size(); ++i)
+            if (properties[i].name == property)
+                return static_cast<int>(i);
+        return -1;
+    }
+};
+
+struct PlyHeader {
+    PlyFormat format{PlyFormat::Ascii};
+    std::vector<PlyElement> elements;
+    size_t bodyOffset{0};
+};
+
+bool parseType(const std::string &name, PlyType &type) {
+    static const std::pair<const char *, PlyType> names[] = {
+        {"char", PlyType::Int8},     {"int8", PlyType::Int8},       {"uchar", PlyType::Uint8},
+        {"uint8", PlyType::Uint8},   {"short", PlyType::Int16},     {"int16", PlyType::Int16},
+        {"ushort", PlyType::Uint16}, {"uint16", PlyType::Uint16},   {"int", PlyType::Int32},
+        {"int32", PlyType::Int32},   {"uint", PlyType::Uint32},     {"uint32", PlyType::Uint32},
+        {"float", PlyType::Float32}, {"float32", PlyType::Float32}, {"double", PlyType::Float64},
+        {"float64", PlyType::Float64}};
+    for (const auto &[typeName, value] : names) {
+        if (name == typeName) {
+            type = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t typeSize(PlyType type) {
+    static constexpr size_t sizes[] = {1, 1, 2, 2, 4, 4, 4, 8};
+    return sizes[static_cast<size_t>(type)];
+}
+
+/*
+    Calls f with a value of the C++ type matching a PLY type
+*/
+template <typename F>
+decltype(auto) withType(PlyType type, F &&f) {
+    switch (type) {
+    case PlyType::Int8: return f(int8_t{});
+    case PlyType::Uint8: return f(uint8_t{});
+    case PlyType::Int16: return f(int16_t{});
+    case PlyType::Uint16: return f(uint16_t{});
+    case PlyType::Int32: return f(int32_t{});
+    case PlyType::Uint32: return f(uint32_t{});
+    case PlyType::Float32: return f(float{});
+    default: return f(double{});
+    }
+}
+
+template <typename T>
+T load(const char *p, bool swap) {
+    char bytes[sizeof(T)];
+    if (swap)
+        std::reverse_copy(p, p + sizeof(T), bytes);
+    else
+        std::memcpy(bytes, p, sizeof(T));
+    return std::bit_cast<T>(bytes);
+}
+
+double loadScalar(const char *p, PlyType type, bool swap) {
+    return withType(type, [&](auto value) { return static_cast<double>(load<decltype(value)>(p, swap)); });
+}
+
+PlyHeader parseHeader(const char *data, size_t size) {
+    PlyHeader header;
+    const char *p = data, *end = data + size;
+    bool sawFormat = false;
+    for (size_t line = 0;; ++line) {
+        if (p >= end)
+            throw std::runtime_error("PLY header has no end_header");
+        const char *next = skipLine(p, end);
+        std::istringstream words(std::string(p, next));
+        p = next;
+
+        std::string keyword;
+        words >> keyword;
+        if (line == 0) {
+            if (keyword != "ply")
+                throw std::runtime_error("Not a PLY file");
+        } else if (keyword == "format") {
+            std::string format;
+            words >> format;
+            if (format == "ascii")
+                header.format = PlyFormat::Ascii;
+            else if (format == "binary_little_endian")
+                header.format = PlyFormat::BinaryLittleEndian;
+            else if (format == "binary_big_endian")
+                header.format = PlyFormat::BinaryBigEndian;
+            else
+                throw std::runtime_error("Unknown PLY format: " + format);
+            sawFormat = true;
+        } else if (keyword == "element") {
+            PlyElement element;
+            if (!(words >> element.name >> element.count))
+                throw std::runtime_error("Malformed PLY element");
+            header.elements.push_back(std::move(element));
+        } else if (keyword == "property") {
+            if (header.elements.empty())
+                throw std::runtime_error("PLY property outside of an element");
+            PlyProperty property;
+            std::string type;
+            words >> type;
+            if (type == "list") {
+                std::string countType, itemType;
+                words >> countType >> itemType;
+                property.isList = true;
+                if (!parseType(countType, property.countType))
+                    throw std::runtime_error("Unknown PLY type: " + countType);
+                type = itemType;
+            }
+            if (!parseType(type, property.type) || !(words >> property.name))
+                throw std::runtime_error("Malformed PLY property");
+            header.elements.back().properties.push_back(std::move(property));
+        } else if (keyword == "end_header") {
+            break;
+        }
+        // comment, obj_info and anything unknown are ignored
+    }
+    if (!sawFormat)
+        throw std::runtime_error("PLY header has no format");
+    header.bodyOffset = static_cast<size_t>(p - data);
+
+    for (PlyElement &element : header.elements) {
+        size_t offset = 0;
+        bool fixed = true;
+        for (PlyProperty &property : element.properties) {
+            property.offset = offset;
+            offset += typeSize(property.type);
+            fixed &= !property.isList;
+        }
+        element.stride = fixed ? offset : 0;
+    }
+    return header;
+}
+
+/*
+    Which properties of the vertex element end up in the Mesh, -1 when missing
+*/
+struct VertexProperties {
+    int position[3];
+    int normal[3];
+    int color[4];
+    float colorScale[4];
+
+    explicit VertexProperties(const PlyElement &element) {
+        static const char *const positionNames[] = {"x", "y", "z"};
+        static const char *const normalNames[] = {"nx", "ny", "nz"};
+        static const char *const colorNames[] = {"red", "green", "blue", "alpha"};
+        for (int i = 0; i < 3; ++i) {
+            position[i] = element.find(positionNames[i]);
+            normal[i] = element.find(normalNames[i]);
+            if (position[i] < 0)
+                throw std::runtime_error("PLY vertex without x, y and z");
+        }
+        if (normal[0] < 0 || normal[1] < 0 || normal[2] < 0)
+            normal[0] = normal[1] = normal[2] = -1;
+
+        for (int i = 0; i < 4; ++i) {
+            color[i] = element.find(colorNames[i]);
+            const PlyType type = color[i] < 0 ? PlyType::Float32 : element.properties[color[i]].type;
+            colorScale[i] = type == PlyType::Uint8 ? 1.0f / 255.0f : type == PlyType::Uint16 ? 1.0f / 65535.0f : 1.0f;
+        }
+        if (color[0] < 0 || color[1] < 0 || color[2] < 0)
+            color[0] = color[1] = color[2] = color[3] = -1;
+    }
+
+    bool hasNormals() const { return normal[0] >= 0; }
+    bool hasColors() const { return color[0] >= 0; }
+
+    // value(i) returns property i of the current record as a float
+    template <typename Get>
+    void store(Mesh &mesh, size_t vertex, Get &&value) const {
+        for (int i = 0; i < 3; ++i)
+            mesh.positions[vertex * 3 + i] = value(position[i]);
+        if (hasNormals())
+            for (int i = 0; i < 3; ++i)
+                mesh.normals[vertex * 3 + i] = value(normal[i]);
+        if (hasColors())
+            for (int i = 0; i < 4; ++i)
+                mesh.colors[vertex * 4 + i] = color[i] < 0 ? 1.0f : value(color[i]) * colorScale[i];
+    }
+};
+
+void allocateVertices(Mesh &mesh, const VertexProperties &vertex, size_t count) {
+    mesh.positions.resize(count * 3);
+    if (vertex.hasNormals())
+        mesh.normals.resize(count * 3);
+    if (vertex.hasColors())
+        mesh.colors.resize(count * 4);
+}
+
+template <typename T>
+void appendFan(std::vector<uint32_t> &indices, const T *corners, size_t count) {
+    for (size_t i = 2; i < count; ++i)
+        indices.insert(indices.end(), {static_cast<uint32_t>(corners[0]), static_cast<uint32_t>(corners[i - 1]),
+                                       static_cast<uint32_t>(corners[i])});
+}
+
+int faceIndexProperty(const PlyElement &element) {
+    int property = element.find("vertex_indices");
+    if (property < 0)
+        property = element.find("vertex_index");
+    if (property < 0 || !element.properties[property].isList)
+        throw std::runtime_error("PLY face without a vertex_indices list");
+    return property;
+}
+
+/*
+-------------------------------------------------------------------
+  Binary  ---------------------------------------------------------
+-------------------------------------------------------------------
+*/
+
+struct BinaryReader {
+    const char *end;
+    bool swap;
+
+    void require(const char *p, size_t bytes) const {
+        if (static_cast<size_t>(end - p) < bytes)
+            throw std::runtime_error("PLY file is truncated");
+    }
+
+    // Size of one record of an element that has list properties
+    size_t recordSize(const PlyElement &element, const char *p) const {
+        const char *record = p;
+        for (const PlyProperty &property : element.properties) {
+            if (property.isList) {
+                require(p, typeSize(property.countType));
+                const double count = loadScalar(p, property.countType, swap);
+                if (count < 0)
+                    throw std::runtime_error("Negative PLY list length");
+                p += typeSize(property.countType) + static_cast<size_t>(count) * typeSize(property.type);
+            } else {
+                p += typeSize(property.type);
+            }
+            require(p, 0);
+        }
+        return static_cast<size_t>(p - record);
+    }
+
+    const char *skip(const PlyElement &element, const char *p) const {
+        if (element.stride) {
+            require(p, element.count * element.stride);
+            return p + element.count * element.stride;
+        }
+        for (size_t i = 0; i < element.count; ++i)
+            p += recordSize(element, p);
+        return p;
+    }
+
+    const char *readVertices(Mesh &mesh, const PlyElement &element, const char *p) const {
+        if (!element.stride)
+            throw std::runtime_error("PLY vertices with list properties are not supported");
+        require(p, element.count * element.stride);
+        const VertexProperties vertex(element);
+        allocateVertices(mesh, vertex, element.count);
+
+        const std::vector<PlyProperty> &properties = element.properties;
+        const size_t stride = element.stride;
+        ThreadPool::shared().parallelFor(element.count, [&](size_t begin, size_t end) {
+            for (size_t v = begin; v < end; ++v) {
+                const char *record = p + v * stride;
+                vertex.store(mesh, v, [&](int i) {
+                    const PlyProperty &property = properties[i];
+                    return property.type == PlyType::Float32
+                               ? load<float>(record + property.offset, swap)
+                               : static_cast<float>(loadScalar(record + property.offset, property.type, swap));
+                });
+            }
+        });
+        return p + element.count * stride;
+    }
+
+    const char *readFaces(Mesh &mesh, const PlyElement &element, const char *p) const {
+        if (element.count == 0)
+            return p;
+        const PlyProperty &list = element.properties[faceIndexProperty(element)];
+        const size_t countSize = typeSize(list.countType), indexSize = typeSize(list.type);
+
+        // Fast path: the list is the only property and every face has the same corner count
+        require(p, countSize);
+        const double firstCount = loadScalar(p, list.countType, swap);
+        const size_t corners = firstCount >= 3 ? static_cast<size_t>(firstCount) : 0;
+        const size_t stride = countSize + corners * indexSize;
+        bool uniform = element.properties.size() == 1 && corners != 0 &&
+                       static_cast<size_t>(end - p) / stride >= element.count;
+        if (uniform) {
+            std::atomic<bool> mismatch{false};
+            ThreadPool::shared().parallelFor(element.count, [&](size_t begin, size_t end) {
+                for (size_t f = begin; f < end && !mismatch.load(std::memory_order_relaxed); ++f)
+                    if (loadScalar(p + f * stride, list.countType, swap) != firstCount)
+                        mismatch.store(true, std::memory_order_relaxed);
+            });
+            uniform = !mismatch;
+        }
+
+        const size_t base = mesh.indices.size();
+        if (uniform) {
+            const size_t perFace = (corners - 2) * 3;
+            mesh.indices.resize(base + element.count * perFace);
+            withType(list.type, [&](auto type) {
+                using T = decltype(type);
+                ThreadPool::shared().parallelFor(element.count, [&](size_t begin, size_t end) {
+                    for (size_t f = begin; f < end; ++f) {
+                        const char *record = p + f * stride + countSize;
+                        uint32_t *out = &mesh.indices[base + f * perFace];
+                        const uint32_t first = static_cast<uint32_t>(load<T>(record, swap));
+                        for (size_t c = 2; c < corners; ++c, out += 3) {
+                            out[0] = first;
+                            out[1] = static_cast<uint32_t>(load<T>(record + (c - 1) * sizeof(T), swap));
+                            out[2] = static_cast<uint32_t>(load<T>(record + c * sizeof(T), swap));
+                        }
+                    }
+                });
+            });
+            return p + element.count * stride;
+        }
+
+        // Mixed polygons or extra properties, walk the records one by one
+        std::vector<int64_t> polygon;
+        for (size_t f = 0; f < element.count; ++f) {
+            for (const PlyProperty &property : element.properties) {
+                if (!property.isList) {
+                    require(p, typeSize(property.type));
+                    p += typeSize(property.type);
+                    continue;
+                }
+                require(p, typeSize(property.countType));
+                const double count = loadScalar(p, property.countType, swap);
+                if (count < 0)
+                    throw std::runtime_error("Negative PLY list length");
+                p += typeSize(property.countType);
+                const size_t n = static_cast<size_t>(count);
+                require(p, n * typeSize(property.type));
+                if (&property == &list) {
+                    polygon.resize(n);
+                    for (size_t c = 0; c < n; ++c)
+                        polygon[c] = static_cast<int64_t>(loadScalar(p + c * indexSize, property.type, swap));
+                    appendFan(mesh.indices, polygon.data(), n);
+                }
+                p += n * typeSize(property.type);
+            }
+        }
+        return p;
+    }
+};
+
+/*
+-------------------------------------------------------------------
+  ASCII  ----------------------------------------------------------
+-------------------------------------------------------------------
+*/
+
+const char *skipLines(const char *p, const char *end, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (p >= end)
+            throw std::runtime_error("PLY file is truncated");
+        p = skipLine(p, end);
+    }
+    return p;
+}
+
+template <typename T>
+void concatenate(std::vector<T> &destination, std::vector<std::vector<T>> &parts) {
+    std::vector<size_t> offsets{destination.size()};
+    for (const std::vector<T> &part : parts)
+        offsets.push_back(offsets.back() + part.size());
+    destination.resize(offsets.back());
+    ThreadPool::shared().parallelFor(parts.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            std::copy(parts[i].begin(), parts[i].end(), destination.begin() + offsets[i]);
+            parts[i] = {};
+        }
+    });
+}
+
+const char *readAsciiVertices(Mesh &mesh, const PlyElement &element, const char *p, const char *end) {
+    if (!element.stride)
+        throw std::runtime_error("PLY vertices with list properties are not supported");
+    const char *regionEnd = skipLines(p, end, element.count);
+    const VertexProperties vertex(element);
+
+    const std::vector<const char *> bounds =
+        splitLines(p, regionEnd, chunkCountFor(static_cast<size_t>(regionEnd - p), ThreadPool::shared().size()));
+    const size_t chunkCount = bounds.size() - 1;
+    std::vector<Mesh> chunks(chunkCount);
+    ThreadPool::shared().parallelFor(chunkCount, 1, [&](size_t begin, size_t last) {
+        std::vector<float> values(element.properties.size());
+        for (size_t c = begin; c < last; ++c) {
+            Mesh &chunk = chunks[c];
+            for (const char *line = bounds[c]; line < bounds[c + 1]; line = skipLine(line, bounds[c + 1])) {
+                const char *q = line;
+                for (float &value : values) {
+                    q = parseFloat(skipSpaces(q, bounds[c + 1]), bounds[c + 1], value);
+                    if (!q)
+                        throw std::runtime_error("Malformed PLY vertex");
+                }
+                const size_t v = chunk.vertexCount();
+                allocateVertices(chunk, vertex, v + 1);
+                vertex.store(chunk, v, [&](int i) { return values[i]; });
+            }
+        }
+    });
+
+    std::vector<std::vector<float>> positions, normals, colors;
+    for (Mesh &chunk : chunks) {
+        positions.push_back(std::move(chunk.positions));
+        normals.push_back(std::move(chunk.normals));
+        colors.push_back(std::move(chunk.colors));
+    }
+    concatenate(mesh.positions, positions);
+    concatenate(mesh.normals, normals);
+    concatenate(mesh.colors, colors);
+    if (mesh.vertexCount() != element.count)
+        throw std::runtime_error("PLY vertex count doesn't match the header");
+    return regionEnd;
+}
+
+const char *readAsciiFaces(Mesh &mesh, const PlyElement &element, const char *p, const char *end) {
+    const char *regionEnd = skipLines(p, end, element.count);
+    const int list = faceIndexProperty(element);
+
+    const std::vector<const char *> bounds =
+        splitLines(p, regionEnd, chunkCountFor(static_cast<size_t>(regionEnd - p), ThreadPool::shared().size()));
+    const size_t chunkCount = bounds.size() - 1;
+    std::vector<std::vector<uint32_t>> chunks(chunkCount);
+    ThreadPool::shared().parallelFor(chunkCount, 1, [&](size_t begin, size_t last) {
+        std::vector<int64_t> polygon;
+        for (size_t c = begin; c < last; ++c) {
+            const char *chunkEnd = bounds[c + 1];
+            for (const char *line = bounds[c]; line < chunkEnd; line = skipLine(line, chunkEnd)) {
+                const char *q = line;
+                for (size_t i = 0; i < element.properties.size() && q; ++i) {
+                    int64_t count = 1;
+                    if (element.properties[i].isList)
+                        q = parseInt(skipSpaces(q, chunkEnd), chunkEnd, count);
+                    polygon.resize(q && count > 0 ? static_cast<size_t>(count) : 0);
+                    for (size_t n = 0; n < polygon.size() && q; ++n) {
+                        float value;
+                        q = skipSpaces(q, chunkEnd);
+                        q = static_cast<int>(i) == list ? parseInt(q, chunkEnd, polygon[n]) : parseFloat(q, chunkEnd, value);
+                    }
+                    if (q && static_cast<int>(i) == list)
+                        appendFan(chunks[c], polygon.data(), polygon.size());
+                }
+                if (!q)
+                    throw std::runtime_error("Malformed PLY face");
+            }
+        }
+    });
+    concatenate(mesh.indices, chunks);
+    return regionEnd;
+}
+
+} // namespace
+
+/**
+ * @brief Parses a PLY file held in memory.
+ *
+ * @throws std::runtime_error On a malformed header or body, or indices out of range.
+ */
+Mesh loadPly(const char *data, size_t size) {
+    const PlyHeader header = parseHeader(data, size);
+    const char *p = data + header.bodyOffset, *end = data + size;
+    const bool swap = (header.format == PlyFormat::BinaryBigEndian) != (std::endian::native == std::endian::big);
+    const BinaryReader reader{end, header.format != PlyFormat::Ascii && swap};
+
+    Mesh mesh;
+    bool sawVertices = false;
+    for (const PlyElement &element : header.elements) {
+        const bool isVertex = element.name == "vertex", isFace = element.name == "face";
+        if (isVertex && sawVertices)
+            throw std::runtime_error("PLY file with more than one vertex element");
+        sawVertices |= isVertex;
+
+        if (header.format == PlyFormat::Ascii) {
+            if (isVertex)
+                p = readAsciiVertices(mesh, element, p, end);
+            else if (isFace)
+                p = readAsciiFaces(mesh, element, p, end);
+            else
+                p = skipLines(p, end, element.count);
+        } else {
+            if (isVertex)
+                p = reader.readVertices(mesh, element, p);
+            else if (isFace)
+                p = reader.readFaces(mesh, element, p);
+            else
+                p = reader.skip(element, p);
+        }
+    }
+
+    const size_t vertexCount = mesh.vertexCount();
+    if (!std::all_of(mesh.indices.begin(), mesh.indices.end(), [&](uint32_t i) { return i < vertexCount; }))
+        throw std::runtime_error("PLY face index out of range");
+    return mesh;
+}
@@ -0,0 +1,221 @@
+#include "streamCodec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+constexpr size_t blockElements = 256;
+
+enum PlaneMode : uint8_t { Zero = 0, Nibbles = 1, Raw = 2 };
+
+uint32_t zigzag(uint32_t delta) {
+    return delta << 1 ^ static_cast<uint32_t>(static_cast<int32_t>(delta) >> 31);
+}
+
+uint32_t unzigzag(uint32_t value) {
+    return value >> 1 ^ (0u - (value & 1u));
+}
+
+/*
+    Turns count byte-plane values into words, undoes the zigzag and accumulates the deltas
+    starting from previous. Returns the last word.
+*/
+uint32_t reconstructScalar(uint32_t *out, const uint8_t *const planes[4], size_t begin, size_t count,
+                           uint32_t previous) {
+    for (size_t i = begin; i < count; ++i) {
+        const uint32_t value = planes[0][i] | planes[1][i] << 8 | planes[2][i] << 16 | uint32_t(planes[3][i]) << 24;
+        previous += unzigzag(value);
+        out[i] = previous;
+    }
+    return previous;
+}
+
+#if defined(__SSE2__)
+
+uint32_t reconstruct(uint32_t *out, const uint8_t *const planes[4], size_t count, uint32_t previous) {
+    const size_t vectorCount = count / 16 * 16;
+    const __m128i one = _mm_set1_epi32(1);
+    __m128i carry = _mm_set1_epi32(static_cast<int>(previous));
+    for (size_t i = 0; i < vectorCount; i += 16) {
+        const __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(planes[0] + i));
+        const __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(planes[1] + i));
+        const __m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(planes[2] + i));
+        const __m128i p3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(planes[3] + i));
+
+        // Interleave planes back into little endian words
+        const __m128i low01 = _mm_unpacklo_epi8(p0, p1), high01 = _mm_unpackhi_epi8(p0, p1);
+        const __m128i low23 = _mm_unpacklo_epi8(p2, p3), high23 = _mm_unpackhi_epi8(p2, p3);
+        __m128i words[4] = {_mm_unpacklo_epi16(low01, low23), _mm_unpackhi_epi16(low01, low23),
+                            _mm_unpacklo_epi16(high01, high23), _mm_unpackhi_epi16(high01, high23)};
+
+        for (__m128i &x : words) {
+            x = _mm_xor_si128(_mm_srli_epi32(x, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(x, one)));
+            // Inclusive prefix sum of the four lanes, then add everything before them
+            x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+            x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+            x = _mm_add_epi32(x, carry);
+            carry = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+        for (int k = 0; k < 4; ++k)
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + k * 4), words[k]);
+    }
+    return reconstructScalar(out, planes, vectorCount, count, static_cast<uint32_t>(_mm_cvtsi128_si32(carry)));
+}
+
+void expandNibbles(uint8_t *out, const uint8_t *packed, size_t count) {
+    const size_t vectorCount = count / 16 * 16;
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    for (size_t i = 0; i < vectorCount; i += 16) {
+        const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(packed + i / 2));
+        const __m128i low = _mm_and_si128(bytes, mask);
+        const __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_unpacklo_epi8(low, high));
+    }
+    for (size_t i = vectorCount; i < count; ++i)
+        out[i] = packed[i / 2] >> (i % 2 * 4) & 0x0f;
+}
+
+#elif defined(__ARM_NEON)
+
+uint32_t reconstruct(uint32_t *out, const uint8_t *const planes[4], size_t count, uint32_t previous) {
+    const size_t vectorCount = count / 16 * 16;
+    const uint32x4_t zero = vdupq_n_u32(0), one = vdupq_n_u32(1);
+    uint32x4_t carry = vdupq_n_u32(previous);
+    for (size_t i = 0; i < vectorCount; i += 16) {
+        const uint8x16x2_t p01 = vzipq_u8(vld1q_u8(planes[0] + i), vld1q_u8(planes[1] + i));
+        const uint8x16x2_t p23 = vzipq_u8(vld1q_u8(planes[2] + i), vld1q_u8(planes[3] + i));
+        const uint16x8x2_t low = vzipq_u16(vreinterpretq_u16_u8(p01.val[0]), vreinterpretq_u16_u8(p23.val[0]));
+        const uint16x8x2_t high = vzipq_u16(vreinterpretq_u16_u8(p01.val[1]), vreinterpretq_u16_u8(p23.val[1]));
+        uint32x4_t words[4] = {vreinterpretq_u32_u16(low.val[0]), vreinterpretq_u32_u16(low.val[1]),
+                               vreinterpretq_u32_u16(high.val[0]), vreinterpretq_u32_u16(high.val[1])};
+
+        for (uint32x4_t &x : words) {
+            x = veorq_u32(vshrq_n_u32(x, 1), vsubq_u32(zero, vandq_u32(x, one)));
+            x = vaddq_u32(x, vextq_u32(zero, x, 3));
+            x = vaddq_u32(x, vextq_u32(zero, x, 2));
+            x = vaddq_u32(x, carry);
+            carry = vdupq_n_u32(vgetq_lane_u32(x, 3));
+        }
+        for (int k = 0; k < 4; ++k)
+            vst1q_u32(out + i + k * 4, words[k]);
+    }
+    return reconstructScalar(out, planes, vectorCount, count, vgetq_lane_u32(carry, 0));
+}
+
+void expandNibbles(uint8_t *out, const uint8_t *packed, size_t count) {
+    const size_t vectorCount = count / 16 * 16;
+    const uint8x8_t mask = vdup_n_u8(0x0f);
+    for (size_t i = 0; i < vectorCount; i += 16) {
+        const uint8x8_t bytes = vld1_u8(packed + i / 2);
+        const uint8x8x2_t nibbles = vzip_u8(vand_u8(bytes, mask), vshr_n_u8(bytes, 4));
+        vst1q_u8(out + i, vcombine_u8(nibbles.val[0], nibbles.val[1]));
+    }
+    for (size_t i = vectorCount; i < count; ++i)
+        out[i] = packed[i / 2] >> (i % 2 * 4) & 0x0f;
+}
+
+#else
+
+uint32_t reconstruct(uint32_t *out, const uint8_t *const planes[4], size_t count, uint32_t previous) {
+    return reconstructScalar(out, planes, 0, count, previous);
+}
+
+void expandNibbles(uint8_t *out, const uint8_t *packed, size_t count) {
+    for (size_t i = 0; i < count; ++i)
+        out[i] = packed[i / 2] >> (i % 2 * 4) & 0x0f;
+}
+
+#endif
+
+} // namespace
+
+/**
+ * @brief Encodes @p elementCount elements of @p lanes words each, see streamCodec.h.
+ */
+std::vector<uint8_t> encodeWordStream(const uint32_t *words, size_t elementCount, uint32_t lanes) {
+    std::vector<uint8_t> encoded;
+    std::vector<uint32_t> previous(lanes, 0);
+    uint8_t planes[4][blockElements];
+
+    for (size_t block = 0; block < elementCount; block += blockElements) {
+        const size_t count = std::min(blockElements, elementCount - block);
+        for (uint32_t lane = 0; lane < lanes; ++lane) {
+            for (size_t i = 0; i < count; ++i) {
+                const uint32_t word = words[(block + i) * lanes + lane];
+                const uint32_t value = zigzag(word - previous[lane]);
+                previous[lane] = word;
+                for (int plane = 0; plane < 4; ++plane)
+                    planes[plane][i] = static_cast<uint8_t>(value >> plane * 8);
+            }
+
+            for (const uint8_t *plane : planes) {
+                const uint8_t largest = *std::max_element(plane, plane + count);
+                if (largest == 0) {
+                    encoded.push_back(PlaneMode::Zero);
+                } else if (largest < 16) {
+                    encoded.push_back(PlaneMode::Nibbles);
+                    for (size_t i = 0; i < count; i += 2)
+                        encoded.push_back(static_cast<uint8_t>(plane[i] | (i + 1 < count ? plane[i + 1] << 4 : 0)));
+                } else {
+                    encoded.push_back(PlaneMode::Raw);
+                    encoded.insert(encoded.end(), plane, plane + count);
+                }
+            }
+        }
+    }
+    return encoded;
+}
+
+/**
+ * @brief Decodes a stream written by encodeWordStream() into @p destination.
+ *
+ * Raw planes are read in place, only nibble planes are expanded into a small scratch buffer.
+ */
+void decodeWordStream(uint32_t *destination, size_t elementCount, uint32_t lanes, const uint8_t *data, size_t size) {
+    static const uint8_t zeros[blockElements] = {};
+    const uint8_t *p = data, *end = data + size;
+    std::vector<uint32_t> previous(lanes, 0);
+    uint8_t nibbles[4][blockElements];
+    uint32_t laneWords[blockElements];
+
+    for (size_t block = 0; block < elementCount; block += blockElements) {
+        const size_t count = std::min(blockElements, elementCount - block);
+        for (uint32_t lane = 0; lane < lanes; ++lane) {
+            const uint8_t *planes[4];
+            for (int plane = 0; plane < 4; ++plane) {
+                if (p >= end)
+                    throw std::runtime_error("Compressed mesh stream is truncated");
+                const uint8_t mode = *p++;
+                const size_t bytes = mode == PlaneMode::Zero ? 0 : mode == PlaneMode::Nibbles ? (count + 1) / 2 : count;
+                if (mode > PlaneMode::Raw || static_cast<size_t>(end - p) < bytes)
+                    throw std::runtime_error("Compressed mesh stream is malformed");
+                if (mode == PlaneMode::Zero) {
+                    planes[plane] = zeros;
+                } else if (mode == PlaneMode::Nibbles) {
+                    expandNibbles(nibbles[plane], p, count);
+                    planes[plane] = nibbles[plane];
+                } else {
+                    planes[plane] = p;
+                }
+                p += bytes;
+            }
+
+            // Single lane streams (indices) decode straight into the destination
+            if (lanes == 1) {
+                previous[0] = reconstruct(destination + block, planes, count, previous[0]);
+                continue;
+            }
+            previous[lane] = reconstruct(laneWords, planes, count, previous[lane]);
+            for (size_t i = 0; i < count; ++i)
+                destination[(block + i) * lanes + lane] = laneWords[i];
+        }
+    }
+}
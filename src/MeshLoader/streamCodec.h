@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+    Delta / byte-plane coding of 32-bit word streams, used for the compressed sections of
+    .mesh files (meshFile.h).
+
+    A stream is elementCount elements of `lanes` words each, e.g. 3 lanes for xyz positions.
+    Each lane is coded as the difference to the same lane of the previous element, zigzag
+    mapped so small negative differences become small numbers too. Blocks of 256 elements are
+    then split into four byte planes per lane. A plane is stored as all zero (no bytes),
+    4-bit nibbles or raw bytes, whichever is smallest. For float data neighbouring vertices
+    share sign and exponent, so the high planes mostly vanish. For indices two or three planes
+    usually do.
+
+    Decoding is plane interleaving and a prefix sum, which vectorize with SSE2 and NEON.
+*/
+
+std::vector<uint8_t> encodeWordStream(const uint32_t *words, size_t elementCount, uint32_t lanes);
+
+// Throws std::runtime_error if the data is truncated or malformed
+void decodeWordStream(uint32_t *destination, size_t elementCount, uint32_t lanes, const uint8_t *data, size_t size);
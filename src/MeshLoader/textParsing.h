@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+/*
+    Number parsing for the text formats. Floats take the exact fast path whenever the
+    decimal mantissa fits in 53 bits and the power of ten is exactly representable
+    (Clinger 1990), which covers practically every coordinate written by exporters, and fall
+    back to strtof otherwise. The fast path neither allocates nor depends on the locale.
+*/
+namespace textParsing {
+
+inline bool isDigit(char c) {
+    return static_cast<unsigned char>(c - '0') < 10;
+}
+
+inline const char *skipSpaces(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        ++p;
+    return p;
+}
+
+inline const char *skipLine(const char *p, const char *end) {
+    const void *newline = std::memchr(p, '\n', static_cast<size_t>(end - p));
+    return newline ? static_cast<const char *>(newline) + 1 : end;
+}
+
+inline bool atLineEnd(const char *p, const char *end) {
+    return p >= end || *p == '\n' || *p == '#';
+}
+
+/*
+    Returns the first character after the number, or nullptr if there is no number at p
+*/
+inline const char *parseFloat(const char *p, const char *end, float &value) {
+    static constexpr double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char *start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    uint64_t mantissa = 0;
+    int exponent = 0, significantDigits = 0;
+    bool anyDigits = false;
+    for (; p < end && isDigit(*p); ++p, anyDigits = true) {
+        if (significantDigits < 19) {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+            significantDigits += mantissa != 0;
+        } else {
+            ++exponent;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && isDigit(*p); ++p, anyDigits = true) {
+            if (significantDigits < 19) {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                significantDigits += mantissa != 0;
+                --exponent;
+            }
+        }
+    }
+    if (!anyDigits) {
+        // nan, inf and friends
+        char buffer[32];
+        const size_t length = std::min<size_t>(static_cast<size_t>(end - start), sizeof(buffer) - 1);
+        std::memcpy(buffer, start, length);
+        buffer[length] = '\0';
+        char *stop = nullptr;
+        value = std::strtof(buffer, &stop);
+        return stop == buffer ? nullptr : start + (stop - buffer);
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *mark = p++;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negativeExponent = *p++ == '-';
+        if (p < end && isDigit(*p)) {
+            int e = 0;
+            for (; p < end && isDigit(*p); ++p)
+                e = e < 10000 ? e * 10 + (*p - '0') : e;
+            exponent += negativeExponent ? -e : e;
+        } else {
+            p = mark;   // "1e" is the number 1 followed by junk
+        }
+    }
+
+    double result;
+    if (mantissa < (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+        result = static_cast<double>(mantissa);
+        result = exponent < 0 ? result / powers[-exponent] : result * powers[exponent];
+    } else {
+        char buffer[64];
+        const size_t length = static_cast<size_t>(p - start);
+        if (length >= sizeof(buffer)) {
+            std::vector<char> copy(start, p);
+            copy.push_back('\0');
+            value = std::strtof(copy.data(), nullptr);
+            return p;
+        }
+        std::memcpy(buffer, start, length);
+        buffer[length] = '\0';
+        value = std::strtof(buffer, nullptr);
+        return p;
+    }
+    value = static_cast<float>(negative ? -result : result);
+    return p;
+}
+
+inline const char *parseInt(const char *p, const char *end, int64_t &value) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    if (p >= end || !isDigit(*p))
+        return nullptr;
+
+    int64_t result = 0;
+    for (; p < end && isDigit(*p); ++p)
+        result = result * 10 + (*p - '0');
+    value = negative ? -result : result;
+    return p;
+}
+
+/*
+    Enough chunks to keep every thread busy, none smaller than 1 MB
+*/
+inline size_t chunkCountFor(size_t bytes, size_t threads) {
+    constexpr size_t minChunkBytes = size_t(1) << 20;
+    return std::max<size_t>(1, std::min(bytes / minChunkBytes, threads * 4));
+}
+
+/*
+    Line-aligned chunk boundaries, each chunk starts right after a newline
+*/
+inline std::vector<const char *> splitLines(const char *begin, const char *end, size_t chunkCount) {
+    std::vector<const char *> bounds{begin};
+    const size_t size = static_cast<size_t>(end - begin);
+    for (size_t i = 1; i < chunkCount; ++i) {
+        const char *p = std::max(begin + size * i / chunkCount, bounds.back());
+        p = p == begin ? p : skipLine(p - 1, end);
+        if (p > bounds.back() && p < end)
+            bounds.push_back(p);
+    }
+    bounds.push_back(end);
+    return bounds;
+}
+
+} // namespace textParsing
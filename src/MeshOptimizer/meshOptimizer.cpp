@@ -0,0 +1,407 @@
+#include "meshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+constexpr uint32_t invalidIndex = ~0u;
+
+/*
+    Triangle adjacency - for every vertex, the triangles that use it (CSR layout)
+*/
+struct Adjacency {
+    std::vector<uint32_t> counts;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+};
+
+void buildAdjacency(Adjacency &adjacency, const uint32_t *indices, size_t indexCount, size_t vertexCount) {
+    adjacency.counts.assign(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; ++i) {
+        if (indices[i] >= vertexCount)
+            throw std::runtime_error("Index out of range");
+        adjacency.counts[indices[i]]++;
+    }
+
+    adjacency.offsets.resize(vertexCount);
+    uint32_t offset = 0;
+    for (size_t v = 0; v < vertexCount; ++v) {
+        adjacency.offsets[v] = offset;
+        offset += adjacency.counts[v];
+    }
+
+    adjacency.triangles.resize(indexCount);
+    std::vector<uint32_t> fill(adjacency.offsets);
+    for (size_t i = 0; i < indexCount; ++i)
+        adjacency.triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+}
+
+/*
+    Tipsify - Sander, Nehab, Barczak, "Fast Triangle Reordering for Vertex Locality and
+    Reduced Overdraw", SIGGRAPH 2007. Runs in linear time.
+
+    If clusters is given it receives the first triangle of every hard cluster, i.e. each
+    place where the walk hit a dead end and the cache contents stopped mattering.
+*/
+void tipsify(uint32_t *destination, const uint32_t *indices, size_t indexCount, size_t vertexCount,
+             uint32_t cacheSize, std::vector<uint32_t> *clusters) {
+    Adjacency adjacency;
+    buildAdjacency(adjacency, indices, indexCount, vertexCount);
+
+    std::vector<uint32_t> live(adjacency.counts);
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<char> emitted(indexCount / 3, 0);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    deadEnd.reserve(indexCount);
+
+    uint32_t time = cacheSize + 1;
+    size_t cursor = 0;
+    size_t written = 0;
+
+    auto skipDeadEnd = [&]() -> uint32_t {
+        // Most recently used vertices first, they may still be in the cache
+        while (!deadEnd.empty()) {
+            const uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0)
+                return v;
+        }
+        // Otherwise any vertex with triangles left, in input order
+        while (cursor < vertexCount) {
+            if (live[cursor] > 0)
+                return static_cast<uint32_t>(cursor++);
+            ++cursor;
+        }
+        return invalidIndex;
+    };
+
+    uint32_t fan = skipDeadEnd();
+    if (clusters && fan != invalidIndex)
+        clusters->push_back(0);
+
+    while (fan != invalidIndex) {
+        candidates.clear();
+
+        // Emit every remaining triangle around the fan vertex
+        const uint32_t begin = adjacency.offsets[fan];
+        const uint32_t end = begin + adjacency.counts[fan];
+        for (uint32_t a = begin; a < end; ++a) {
+            const uint32_t triangle = adjacency.triangles[a];
+            if (emitted[triangle])
+                continue;
+
+            for (int k = 0; k < 3; ++k) {
+                const uint32_t v = indices[triangle * 3 + k];
+                destination[written++] = v;
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cacheTime[v] > cacheSize)
+                    cacheTime[v] = time++;
+            }
+            emitted[triangle] = 1;
+        }
+
+        // Next fan: the candidate that will still be in the cache after its own triangles
+        // are emitted, preferring the one that entered the cache earliest
+        uint32_t best = invalidIndex;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (live[v] == 0)
+                continue;
+            int64_t priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+                priority = time - cacheTime[v];
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                best = v;
+            }
+        }
+
+        if (best == invalidIndex) {
+            best = skipDeadEnd();
+            if (clusters && best != invalidIndex)
+                clusters->push_back(static_cast<uint32_t>(written / 3));
+        }
+        fan = best;
+    }
+}
+
+/*
+    FIFO post-transform cache, timestamps instead of a queue. A vertex is cached while fewer
+    than cacheSize other vertices have been inserted after it.
+*/
+struct FifoCache {
+    std::vector<uint32_t> insertedAt;
+    uint32_t time;
+    uint32_t size;
+
+    FifoCache(size_t vertexCount, uint32_t cacheSize)
+        : insertedAt(vertexCount, 0), time(cacheSize + 1), size(cacheSize) {}
+
+    // Returns 1 on a miss
+    uint32_t access(uint32_t v) {
+        if (time - insertedAt[v] <= size)
+            return 0;
+        insertedAt[v] = time++;
+        return 1;
+    }
+
+    void flush() { time += size + 1; }
+};
+
+void triangleCentroidNormal(const float *positions, const uint32_t *triangle, float centroid[3], float normal[3]) {
+    const float *a = positions + triangle[0] * 3;
+    const float *b = positions + triangle[1] * 3;
+    const float *c = positions + triangle[2] * 3;
+
+    const float ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    const float ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+
+    // Unnormalized, its length is twice the triangle's area
+    normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+    normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+    normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+
+    for (int k = 0; k < 3; ++k)
+        centroid[k] = (a[k] + b[k] + c[k]) / 3.0f;
+}
+
+} // namespace
+
+/**
+ * @brief Simulates a FIFO post-transform cache over a triangle list.
+ *
+ * @param indices Triangle list.
+ * @param indexCount Number of indices, a multiple of 3.
+ * @param vertexCount Number of vertices the indices refer to.
+ * @param cacheSize Number of cache entries, 16 matches most current GPUs closely enough.
+ */
+VertexCacheStats analyzeVertexCache(const uint32_t *indices, size_t indexCount, size_t vertexCount,
+                                    uint32_t cacheSize) {
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<char> used(vertexCount, 0);
+
+    uint32_t transforms = 0;
+    size_t unique = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        const uint32_t v = indices[i];
+        if (v >= vertexCount)
+            throw std::runtime_error("Index out of range");
+        transforms += cache.access(v);
+        if (!used[v]) {
+            used[v] = 1;
+            ++unique;
+        }
+    }
+
+    VertexCacheStats stats{};
+    stats.vertexTransforms = transforms;
+    stats.acmr = indexCount ? static_cast<float>(transforms) / static_cast<float>(indexCount / 3) : 0.0f;
+    stats.atvr = unique ? static_cast<float>(transforms) / static_cast<float>(unique) : 0.0f;
+    return stats;
+}
+
+/**
+ * @brief Reorders triangles for the post-transform vertex cache (Tipsify).
+ *
+ * @param destination Receives the reordered triangle list, may alias @p indices.
+ */
+void optimizeVertexCache(uint32_t *destination, const uint32_t *indices, size_t indexCount, size_t vertexCount,
+                         uint32_t cacheSize) {
+    if (indexCount % 3 != 0)
+        throw std::runtime_error("Index count is not a multiple of 3");
+
+    std::vector<uint32_t> input;
+    if (destination == indices) {
+        input.assign(indices, indices + indexCount);
+        indices = input.data();
+    }
+    tipsify(destination, indices, indexCount, vertexCount, cacheSize, nullptr);
+}
+
+/**
+ * @brief Reorders triangles for the vertex cache, then orders clusters of them to reduce overdraw.
+ *
+ * Runs Tipsify to get hard cluster boundaries, splits those further wherever a cluster's own
+ * ACMR is within @p threshold of its parent's, then draws clusters facing away from the mesh
+ * center first: those are the ones most likely to occlude the rest.
+ *
+ * @param destination Receives the reordered triangle list, may alias @p indices.
+ * @param positions xyz per vertex.
+ * @param threshold How much ACMR may grow in exchange for overdraw, 1.05 allows 5%.
+ */
+void optimizeOverdraw(uint32_t *destination, const uint32_t *indices, size_t indexCount, const float *positions,
+                      size_t vertexCount, float threshold, uint32_t cacheSize) {
+    if (indexCount % 3 != 0)
+        throw std::runtime_error("Index count is not a multiple of 3");
+    if (indexCount == 0)
+        return;
+
+    std::vector<uint32_t> ordered(indexCount);
+    std::vector<uint32_t> hardClusters;
+    tipsify(ordered.data(), indices, indexCount, vertexCount, cacheSize, &hardClusters);
+
+    const size_t triangleCount = indexCount / 3;
+    hardClusters.push_back(static_cast<uint32_t>(triangleCount));
+
+    // Soft boundaries - only split where the cache does not suffer for it
+    std::vector<uint32_t> clusters;
+    FifoCache cache(vertexCount, cacheSize);
+    for (size_t c = 0; c + 1 < hardClusters.size(); ++c) {
+        const uint32_t begin = hardClusters[c];
+        const uint32_t end = hardClusters[c + 1];
+
+        cache.flush();
+        uint32_t misses = 0;
+        for (uint32_t t = begin; t < end; ++t)
+            for (int k = 0; k < 3; ++k)
+                misses += cache.access(ordered[t * 3 + k]);
+        const float limit = threshold * static_cast<float>(misses) / static_cast<float>(end - begin);
+
+        clusters.push_back(begin);
+        cache.flush();
+        uint32_t start = begin;
+        uint32_t running = 0;
+        for (uint32_t t = begin; t < end; ++t) {
+            for (int k = 0; k < 3; ++k)
+                running += cache.access(ordered[t * 3 + k]);
+
+            const uint32_t size = t + 1 - start;
+            if (t + 1 < end && size >= 8 && static_cast<float>(running) <= limit * static_cast<float>(size)) {
+                clusters.push_back(t + 1);
+                cache.flush();
+                start = t + 1;
+                running = 0;
+            }
+        }
+    }
+    clusters.push_back(static_cast<uint32_t>(triangleCount));
+
+    // Area weighted mesh centroid
+    double meshCentroid[3] = {0.0, 0.0, 0.0};
+    double meshArea = 0.0;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        float centroid[3], normal[3];
+        triangleCentroidNormal(positions, &ordered[t * 3], centroid, normal);
+        const double area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        for (int k = 0; k < 3; ++k)
+            meshCentroid[k] += centroid[k] * area;
+        meshArea += area;
+    }
+    if (meshArea > 0.0)
+        for (double &component : meshCentroid)
+            component /= meshArea;
+
+    // Sort key - how far a cluster faces away from the mesh center
+    const size_t clusterCount = clusters.size() - 1;
+    std::vector<float> sortKey(clusterCount, 0.0f);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        double centroidSum[3] = {0.0, 0.0, 0.0};
+        double normalSum[3] = {0.0, 0.0, 0.0};
+        double area = 0.0;
+        for (uint32_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+            float centroid[3], normal[3];
+            triangleCentroidNormal(positions, &ordered[t * 3], centroid, normal);
+            const double a = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            for (int k = 0; k < 3; ++k) {
+                centroidSum[k] += centroid[k] * a;
+                normalSum[k] += normal[k];
+            }
+            area += a;
+        }
+
+        const double normalLength = std::sqrt(normalSum[0] * normalSum[0] + normalSum[1] * normalSum[1] +
+                                              normalSum[2] * normalSum[2]);
+        if (area <= 0.0 || normalLength <= 0.0)
+            continue;
+
+        double key = 0.0;
+        for (int k = 0; k < 3; ++k)
+            key += (centroidSum[k] / area - meshCentroid[k]) * (normalSum[k] / normalLength);
+        sortKey[c] = static_cast<float>(key);
+    }
+
+    std::vector<uint32_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+    size_t written = 0;
+    for (uint32_t c : order) {
+        const size_t begin = clusters[c] * 3;
+        const size_t end = clusters[c + 1] * 3;
+        std::copy(ordered.begin() + begin, ordered.begin() + end, destination + written);
+        written += end - begin;
+    }
+}
+
+/**
+ * @brief Builds a remap table that renumbers vertices in the order the indices first use them.
+ *
+ * @param remap Receives one entry per vertex: the new index, or ~0 for unreferenced vertices.
+ * @return The number of vertices left after remapping.
+ */
+size_t optimizeVertexFetchRemap(uint32_t *remap, const uint32_t *indices, size_t indexCount, size_t vertexCount) {
+    std::fill(remap, remap + vertexCount, invalidIndex);
+
+    uint32_t next = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        const uint32_t v = indices[i];
+        if (v >= vertexCount)
+            throw std::runtime_error("Index out of range");
+        if (remap[v] == invalidIndex)
+            remap[v] = next++;
+    }
+    return next;
+}
+
+/**
+ * @brief Rewrites a triangle list through a remap table, @p destination may alias @p indices.
+ */
+void remapIndices(uint32_t *destination, const uint32_t *indices, size_t indexCount, const uint32_t *remap) {
+    for (size_t i = 0; i < indexCount; ++i)
+        destination[i] = remap[indices[i]];
+}
+
+/**
+ * @brief Moves one vertex attribute array through a remap table, dropping unreferenced vertices.
+ *
+ * @param attribute Tightly packed attribute, @p components floats per vertex. Empty arrays are left alone.
+ */
+void remapVertices(std::vector<float> &attribute, size_t components, const uint32_t *remap, size_t newVertexCount) {
+    if (attribute.empty())
+        return;
+
+    const size_t oldVertexCount = attribute.size() / components;
+    std::vector<float> result(newVertexCount * components);
+    for (size_t v = 0; v < oldVertexCount; ++v) {
+        if (remap[v] == invalidIndex)
+            continue;
+        std::copy_n(attribute.begin() + v * components, components, result.begin() + remap[v] * components);
+    }
+    attribute.swap(result);
+}
+
+/**
+ * @brief Runs all passes on a mesh: vertex cache and overdraw order, then vertex fetch order.
+ */
+void optimizeMesh(Mesh &mesh, float overdrawThreshold) {
+    const size_t vertexCount = mesh.vertexCount();
+    if (mesh.indices.empty() || vertexCount == 0)
+        return;
+
+    optimizeOverdraw(mesh.indices.data(), mesh.indices.data(), mesh.indices.size(), mesh.positions.data(),
+                     vertexCount, overdrawThreshold);
+
+    std::vector<uint32_t> remap(vertexCount);
+    const size_t newVertexCount = optimizeVertexFetchRemap(remap.data(), mesh.indices.data(), mesh.indices.size(),
+                                                           vertexCount);
+    remapIndices(mesh.indices.data(), mesh.indices.data(), mesh.indices.size(), remap.data());
+    remapVertices(mesh.positions, 3, remap.data(), newVertexCount);
+    remapVertices(mesh.normals, 3, remap.data(), newVertexCount);
+    remapVertices(mesh.colors, 4, remap.data(), newVertexCount);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../common/Mesh.h"
+
+/*
+-------------------------------------------------------------------
+  MESH OPTIMIZER  ---------------------------------------------------
+
+  Reorders triangle lists and vertex buffers so the GPU does less work:
+    1. Vertex cache  - Tipsify (Sander et al. 2007) reorders triangles so recently
+                       transformed vertices are reused from the post-transform cache.
+    2. Overdraw      - Splits the cache-optimized order into clusters and sorts them
+                       outside-in, without giving up more than a threshold of cache hits.
+    3. Vertex fetch  - Renumbers vertices in first-use order so vertex fetches stream.
+    4. Welding       - Merges duplicate vertices with a parallel spatial hash and drops
+                       the triangles that collapse as a result.
+    5. Simplifying   - Quadric error edge collapses (Garland & Heckbert 1997) onto existing
+                       vertices, so levels of detail are just alternate index ranges.
+    6. Meshlets      - Cuts a (cache-optimized) triangle list into clusters of at most 64
+                       vertices and 124 triangles, with bounding spheres.
+
+  Everything works on plain uint32 triangle lists and runs on any platform.
+-------------------------------------------------------------------
+*/
+
+/**
+ * @brief Post-transform cache statistics for a triangle list.
+ *
+ * ACMR (average cache miss ratio) is transformed vertices per triangle, 0.5 is the ideal
+ * for a large regular grid and 3 is the worst case. ATVR (average transform to vertex ratio)
+ * is transformed vertices per unique vertex, 1 is ideal.
+ */
+struct VertexCacheStats {
+    uint32_t vertexTransforms;
+    float acmr;
+    float atvr;
+};
+
+constexpr uint32_t defaultCacheSize = 16;
+
+VertexCacheStats analyzeVertexCache(const uint32_t *indices, size_t indexCount, size_t vertexCount,
+                                    uint32_t cacheSize = defaultCacheSize);
+
+void optimizeVertexCache(uint32_t *destination, const uint32_t *indices, size_t indexCount, size_t vertexCount,
+                         uint32_t cacheSize = defaultCacheSize);
+
+void optimizeOverdraw(uint32_t *destination, const uint32_t *indices, size_t indexCount, const float *positions,
+                      size_t vertexCount, float threshold = 1.05f, uint32_t cacheSize = defaultCacheSize);
+
+size_t optimizeVertexFetchRemap(uint32_t *remap, const uint32_t *indices, size_t indexCount, size_t vertexCount);
+
+void remapIndices(uint32_t *destination, const uint32_t *indices, size_t indexCount, const uint32_t *remap);
+
+void remapVertices(std::vector<float> &attribute, size_t components, const uint32_t *remap, size_t newVertexCount);
+
+void optimizeMesh(Mesh &mesh, float overdrawThreshold = 1.05f);
+
+/**
+ * @brief Tolerances for weldVertices().
+ *
+ * With positionEpsilon at 0 only bit-identical vertices (all attributes) are merged and
+ * attributeEpsilon is ignored.
+ */
+struct WeldOptions {
+    float positionEpsilon{0.0f};    // Max distance between merged positions
+    float attributeEpsilon{0.0f};   // Max per-component difference of normals and colors
+    bool removeDegenerates{true};   // Drop triangles that reference a vertex twice afterwards
+};
+
+struct WeldResult {
+    size_t verticesBefore;
+    size_t verticesAfter;
+    size_t trianglesRemoved;
+};
+
+WeldResult weldVertices(Mesh &mesh, const WeldOptions &options = {});
+
+/**
+ * @brief Settings for simplifyMesh() and generateLodChain().
+ */
+struct SimplifyOptions {
+    float maxError{FLT_MAX};            // Stop before any collapse with a larger error, object units
+    float attributeWeight{0.01f};       // Normal/color difference of 1 costs this fraction of the mesh size
+    bool lockBorder{false};             // Keep open borders fixed instead of simplifying along them
+    size_t partitionTriangles{32768};   // Triangles per independently simplified partition
+};
+
+size_t simplifyMesh(uint32_t *destination, const Mesh &mesh, const uint32_t *indices, size_t indexCount,
+                    size_t targetIndexCount, const SimplifyOptions &options = {}, float *resultError = nullptr);
+
+LodChain generateLodChain(const Mesh &mesh, const std::vector<float> &triangleRatios,
+                          const SimplifyOptions &options = {});
+
+constexpr uint32_t maxMeshletVertices = 64;
+constexpr uint32_t maxMeshletTriangles = 124;
+
+MeshletSet buildMeshlets(const Mesh &mesh, const uint32_t *indices, size_t indexCount,
+                         uint32_t maxVertices = maxMeshletVertices, uint32_t maxTriangles = maxMeshletTriangles);
@@ -0,0 +1,88 @@
+#include "meshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+constexpr uint8_t notInMeshlet = 0xff;
+
+void computeBounds(Meshlet &meshlet, const MeshletSet &set, const float *positions) {
+    float lower[3] = {INFINITY, INFINITY, INFINITY}, upper[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (uint32_t i = 0; i < meshlet.vertexCount; ++i) {
+        const float *p = &positions[set.vertices[meshlet.vertexOffset + i] * 3];
+        for (int c = 0; c < 3; ++c) {
+            lower[c] = std::min(lower[c], p[c]);
+            upper[c] = std::max(upper[c], p[c]);
+        }
+    }
+    float radiusSquared = 0.0f;
+    for (int c = 0; c < 3; ++c)
+        meshlet.center[c] = 0.5f * (lower[c] + upper[c]);
+    for (uint32_t i = 0; i < meshlet.vertexCount; ++i) {
+        const float *p = &positions[set.vertices[meshlet.vertexOffset + i] * 3];
+        const float dx = p[0] - meshlet.center[0], dy = p[1] - meshlet.center[1], dz = p[2] - meshlet.center[2];
+        radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+    }
+    meshlet.radius = std::sqrt(radiusSquared);
+}
+
+} // namespace
+
+/**
+ * @brief Cuts a triangle list into meshlets, in order.
+ *
+ * Triangles are added to the current meshlet until one would exceed either limit. A
+ * cache-optimized order keeps neighbouring triangles together, so this greedy pass already
+ * gives compact clusters without any spatial search.
+ *
+ * @param maxVertices At most 255, local vertex indices are bytes.
+ * @throws std::runtime_error On invalid limits or indices out of range.
+ */
+MeshletSet buildMeshlets(const Mesh &mesh, const uint32_t *indices, size_t indexCount, uint32_t maxVertices,
+                         uint32_t maxTriangles) {
+    if (maxVertices < 3 || maxVertices >= notInMeshlet || maxTriangles < 1)
+        throw std::runtime_error("Meshlets need 3 to 254 vertices and at least one triangle");
+    const size_t vertexCount = mesh.vertexCount();
+
+    MeshletSet set;
+    std::vector<uint8_t> local(vertexCount, notInMeshlet);     // Position in the current meshlet
+    Meshlet current{0, 0, 0, 0, {0, 0, 0}, 0};
+
+    auto finish = [&]() {
+        if (current.triangleCount == 0)
+            return;
+        for (uint32_t i = 0; i < current.vertexCount; ++i)
+            local[set.vertices[current.vertexOffset + i]] = notInMeshlet;
+        computeBounds(current, set, mesh.positions.data());
+        set.meshlets.push_back(current);
+        current = {static_cast<uint32_t>(set.vertices.size()), static_cast<uint32_t>(set.triangles.size()), 0, 0,
+                   {0, 0, 0}, 0};
+    };
+
+    for (size_t t = 0; t + 2 < indexCount; t += 3) {
+        const uint32_t *triangle = indices + t;
+        if (triangle[0] >= vertexCount || triangle[1] >= vertexCount || triangle[2] >= vertexCount)
+            throw std::runtime_error("Index out of range in buildMeshlets");
+
+        uint32_t newVertices = 0;
+        for (int c = 0; c < 3; ++c)
+            newVertices += local[triangle[c]] == notInMeshlet &&
+                           (c == 0 || triangle[c] != triangle[0]) && (c < 2 || triangle[c] != triangle[1]);
+        if (current.vertexCount + newVertices > maxVertices || current.triangleCount == maxTriangles)
+            finish();
+
+        for (int c = 0; c < 3; ++c) {
+            uint8_t &slot = local[triangle[c]];
+            if (slot == notInMeshlet) {
+                slot = static_cast<uint8_t>(current.vertexCount++);
+                set.vertices.push_back(triangle[c]);
+            }
+            set.triangles.push_back(slot);
+        }
+        ++current.triangleCount;
+    }
+    finish();
+    return set;
+}
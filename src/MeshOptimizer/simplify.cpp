@@ -0,0 +1,619 @@
+#include "meshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "../common/ThreadPool.h"
+
+/*
+-------------------------------------------------------------------
+  SIMPLIFICATION  ---------------------------------------------------
+
+  Edge collapse driven by quadric error metrics (Garland & Heckbert 1997). A collapse
+  u -> v always moves u onto the existing vertex v, so the vertex buffer never changes and
+  every level of detail is only a new index list.
+
+  Large meshes are cut into spatially coherent partitions (Morton order of triangle
+  centroids) that are simplified in parallel with their shared vertices locked. A final
+  pass over the whole mesh, with those vertices free again, closes the remaining gap to
+  the target and smooths the seams between partitions.
+
+  Each pass picks the cheapest collapse for every vertex, then applies the cheapest ones
+  that don't touch each other's neighbourhoods, so no collapse works on stale topology.
+-------------------------------------------------------------------
+*/
+
+namespace {
+
+constexpr uint32_t invalidIndex = ~0u;
+constexpr double borderWeight = 10.0;   // Keeps open borders in place against interior planes
+constexpr float maxFlipCosine = 0.25f;  // Reject collapses that turn a triangle by more than ~75 degrees
+
+/*
+    Symmetric 4x4 plane quadric, weighted by area so evaluate() / weight is a squared distance
+*/
+struct Quadric {
+    double a2{0}, ab{0}, ac{0}, ad{0}, b2{0}, bc{0}, bd{0}, c2{0}, cd{0}, d2{0};
+    double weight{0};
+
+    void addPlane(double a, double b, double c, double d, double w) {
+        a2 += w * a * a; ab += w * a * b; ac += w * a * c; ad += w * a * d;
+        b2 += w * b * b; bc += w * b * c; bd += w * b * d;
+        c2 += w * c * c; cd += w * c * d;
+        d2 += w * d * d;
+        weight += w;
+    }
+
+    void add(const Quadric &q) {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+        b2 += q.b2; bc += q.bc; bd += q.bd;
+        c2 += q.c2; cd += q.cd;
+        d2 += q.d2;
+        weight += q.weight;
+    }
+
+    double evaluate(const float *p) const {
+        const double x = p[0], y = p[1], z = p[2];
+        return a2 * x * x + b2 * y * y + c2 * z * z + 2.0 * (ab * x * y + ac * x * z + bc * y * z) +
+               2.0 * (ad * x + bd * y + cd * z) + d2;
+    }
+};
+
+enum class VertexKind : uint8_t { Interior, Border, Locked };
+
+/*
+    Read-only data shared by every partition
+*/
+struct SimplifyContext {
+    const float *positions{nullptr};
+    size_t vertexCount{0};
+    std::vector<float> attributes;  // Normals then colors, per vertex
+    size_t attributeCount{0};
+    double attributeScale{0};       // Squared distance one unit of attribute difference costs
+    std::vector<uint8_t> seam;      // Vertex shares its position with another vertex
+    double maxErrorSquared{0};
+    bool lockBorder{false};
+};
+
+SimplifyContext makeContext(const Mesh &mesh, const SimplifyOptions &options) {
+    const size_t vertexCount = mesh.vertexCount();
+    SimplifyContext context;
+    context.positions = mesh.positions.data();
+    context.vertexCount = vertexCount;
+    context.maxErrorSquared = options.maxError >= FLT_MAX
+                                  ? static_cast<double>(FLT_MAX)
+                                  : static_cast<double>(options.maxError) * options.maxError;
+    context.lockBorder = options.lockBorder;
+
+    float lower[3] = {FLT_MAX, FLT_MAX, FLT_MAX}, upper[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (size_t v = 0; v < vertexCount; ++v) {
+        for (int k = 0; k < 3; ++k) {
+            lower[k] = std::min(lower[k], mesh.positions[v * 3 + k]);
+            upper[k] = std::max(upper[k], mesh.positions[v * 3 + k]);
+        }
+    }
+    double extent = 0;
+    for (int k = 0; vertexCount && k < 3; ++k)
+        extent = std::max(extent, static_cast<double>(upper[k]) - lower[k]);
+
+    const bool hasNormals = !mesh.normals.empty(), hasColors = !mesh.colors.empty();
+    context.attributeCount = (hasNormals ? 3 : 0) + (hasColors ? 4 : 0);
+    if (context.attributeCount) {
+        context.attributes.resize(vertexCount * context.attributeCount);
+        for (size_t v = 0; v < vertexCount; ++v) {
+            float *attribute = &context.attributes[v * context.attributeCount];
+            if (hasNormals)
+                attribute = std::copy_n(&mesh.normals[v * 3], 3, attribute);
+            if (hasColors)
+                std::copy_n(&mesh.colors[v * 4], 4, attribute);
+        }
+        context.attributeScale = std::pow(options.attributeWeight * extent, 2.0);
+    }
+
+    // Vertices split for a normal or color seam must stay put, or the two sides drift apart
+    std::vector<uint32_t> order(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        order[v] = static_cast<uint32_t>(v);
+    auto less = [&](uint32_t a, uint32_t b) {
+        return std::memcmp(&mesh.positions[a * 3], &mesh.positions[b * 3], 3 * sizeof(float)) < 0;
+    };
+    std::sort(order.begin(), order.end(), less);
+    context.seam.assign(vertexCount, 0);
+    for (size_t i = 1; i < vertexCount; ++i) {
+        if (!less(order[i - 1], order[i])) {
+            context.seam[order[i - 1]] = 1;
+            context.seam[order[i]] = 1;
+        }
+    }
+    return context;
+}
+
+void cross(const float *a, const float *b, const float *c, double normal[3]) {
+    const double e1[3] = {double(b[0]) - a[0], double(b[1]) - a[1], double(b[2]) - a[2]};
+    const double e2[3] = {double(c[0]) - a[0], double(c[1]) - a[1], double(c[2]) - a[2]};
+    normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+/*
+    One partition (or the whole mesh), simplified in place. Vertex ids are renumbered
+    locally so memory stays proportional to the partition. Returns the squared error.
+*/
+class PartitionSimplifier {
+public:
+    PartitionSimplifier(const SimplifyContext &context, const std::vector<uint8_t> *sharedVertices)
+        : context(context), sharedVertices(sharedVertices) {}
+
+    double run(std::vector<uint32_t> &triangles, size_t targetTriangles) {
+        // Local numbering
+        vertices.assign(triangles.begin(), triangles.end());
+        std::sort(vertices.begin(), vertices.end());
+        vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+        for (uint32_t &index : triangles)
+            index = static_cast<uint32_t>(std::lower_bound(vertices.begin(), vertices.end(), index) - vertices.begin());
+
+        const size_t localCount = vertices.size();
+        quadrics.assign(localCount, Quadric{});
+        remap.resize(localCount);
+        for (size_t v = 0; v < localCount; ++v)
+            remap[v] = static_cast<uint32_t>(v);
+
+        buildAdjacency(triangles);
+        classify(triangles);
+        computeQuadrics(triangles);
+
+        double error = 0;
+        while (triangles.size() / 3 > targetTriangles) {
+            const size_t collapsed = collapsePass(triangles, triangles.size() / 3 - targetTriangles, error);
+            if (collapsed == 0)
+                break;
+            compact(triangles);
+            buildAdjacency(triangles);
+            classify(triangles);
+        }
+
+        for (uint32_t &index : triangles)
+            index = vertices[index];
+        return error;
+    }
+
+private:
+    const SimplifyContext &context;
+    const std::vector<uint8_t> *sharedVertices;
+
+    std::vector<uint32_t> vertices;         // Local -> mesh vertex
+    std::vector<Quadric> quadrics;
+    std::vector<VertexKind> kinds;
+    std::vector<uint32_t> borderNeighbours; // Two per border vertex
+    std::vector<uint32_t> remap;
+
+    // Vertex -> triangles, CSR
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> adjacent;
+
+    const float *position(uint32_t local) const { return &context.positions[vertices[local] * 3]; }
+
+    /*
+        Border edges belong to one triangle. Non-manifold edges, corners with more than two
+        border edges and vertices the caller marked as shared are locked. Needs the adjacency.
+    */
+    void classify(const std::vector<uint32_t> &triangles) {
+        const size_t localCount = vertices.size();
+        kinds.assign(localCount, VertexKind::Interior);
+        borderNeighbours.assign(localCount * 2, invalidIndex);
+
+        struct Link {
+            uint32_t vertex;
+            uint8_t outgoing, incoming;    // Edges u -> vertex and vertex -> u as the triangles wind
+        };
+        std::vector<Link> links;
+        for (uint32_t u = 0; u < localCount; ++u) {
+            links.clear();
+            auto addLink = [&](uint32_t vertex, bool outgoing) {
+                auto it = std::find_if(links.begin(), links.end(), [&](const Link &l) { return l.vertex == vertex; });
+                if (it == links.end())
+                    it = links.insert(links.end(), {vertex, 0, 0});
+                (outgoing ? it->outgoing : it->incoming)++;
+            };
+            for (uint32_t i = offsets[u]; i < offsets[u + 1]; ++i) {
+                const uint32_t *triangle = &triangles[adjacent[i] * 3];
+                const int k = triangle[0] == u ? 0 : triangle[1] == u ? 1 : 2;
+                addLink(triangle[(k + 1) % 3], true);
+                addLink(triangle[(k + 2) % 3], false);
+            }
+
+            size_t borderEdges = 0;
+            bool manifold = true;
+            for (const Link &link : links) {
+                if (link.outgoing + link.incoming == 1) {
+                    if (borderEdges < 2)
+                        borderNeighbours[u * 2 + borderEdges] = link.vertex;
+                    ++borderEdges;
+                } else if (link.outgoing != 1 || link.incoming != 1) {
+                    manifold = false;
+                }
+            }
+
+            const uint32_t global = vertices[u];
+            if (!manifold || context.seam[global] || (sharedVertices && (*sharedVertices)[global]))
+                kinds[u] = VertexKind::Locked;
+            else if (borderEdges)
+                kinds[u] = borderEdges == 2 && !context.lockBorder ? VertexKind::Border : VertexKind::Locked;
+        }
+    }
+
+    void computeQuadrics(const std::vector<uint32_t> &triangles) {
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            const uint32_t *triangle = &triangles[i];
+            double normal[3];
+            cross(position(triangle[0]), position(triangle[1]), position(triangle[2]), normal);
+            const double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            if (length == 0.0)
+                continue;
+            for (double &n : normal)
+                n /= length;
+
+            const float *p0 = position(triangle[0]);
+            const double d = -(normal[0] * p0[0] + normal[1] * p0[1] + normal[2] * p0[2]);
+            for (int k = 0; k < 3; ++k)
+                quadrics[triangle[k]].addPlane(normal[0], normal[1], normal[2], d, length * 0.5);
+
+            // Border edges also get a plane perpendicular to the triangle, so collapses keep the outline
+            for (int k = 0; k < 3; ++k) {
+                const uint32_t from = triangle[k], to = triangle[(k + 1) % 3];
+                if (!isBorderEdge(from, to))
+                    continue;
+
+                const float *a = position(from), *b = position(to);
+                const double edge[3] = {double(b[0]) - a[0], double(b[1]) - a[1], double(b[2]) - a[2]};
+                double side[3] = {edge[1] * normal[2] - edge[2] * normal[1], edge[2] * normal[0] - edge[0] * normal[2],
+                                  edge[0] * normal[1] - edge[1] * normal[0]};
+                const double sideLength = std::sqrt(side[0] * side[0] + side[1] * side[1] + side[2] * side[2]);
+                if (sideLength == 0.0)
+                    continue;
+                for (double &s : side)
+                    s /= sideLength;
+
+                const double sideD = -(side[0] * a[0] + side[1] * a[1] + side[2] * a[2]);
+                const double weight = borderWeight * sideLength * sideLength;   // |edge|^2, same units as area
+                quadrics[from].addPlane(side[0], side[1], side[2], sideD, weight);
+                quadrics[to].addPlane(side[0], side[1], side[2], sideD, weight);
+            }
+        }
+    }
+
+    bool isBorderEdge(uint32_t a, uint32_t b) const {
+        return (borderNeighbours[a * 2] == b || borderNeighbours[a * 2 + 1] == b) &&
+               (borderNeighbours[b * 2] == a || borderNeighbours[b * 2 + 1] == a);
+    }
+
+    void buildAdjacency(const std::vector<uint32_t> &triangles) {
+        offsets.assign(vertices.size() + 1, 0);
+        for (const uint32_t v : triangles)
+            offsets[v + 1]++;
+        for (size_t v = 0; v < vertices.size(); ++v)
+            offsets[v + 1] += offsets[v];
+
+        adjacent.resize(triangles.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < triangles.size(); ++i)
+            adjacent[fill[triangles[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    double collapseCost(uint32_t u, uint32_t v) const {
+        Quadric merged = quadrics[u];
+        merged.add(quadrics[v]);
+        double cost = merged.weight > 0.0 ? std::max(0.0, merged.evaluate(position(v)) / merged.weight) : 0.0;
+
+        if (context.attributeCount) {
+            const float *a = &context.attributes[vertices[u] * context.attributeCount];
+            const float *b = &context.attributes[vertices[v] * context.attributeCount];
+            double difference = 0;
+            for (size_t k = 0; k < context.attributeCount; ++k)
+                difference += double(a[k] - b[k]) * (a[k] - b[k]);
+            cost += context.attributeScale * difference;
+        }
+        return cost;
+    }
+
+    /*
+        Collapsing u onto v must keep the mesh manifold (u and v share exactly the
+        neighbours of the triangles on their edge) and must not fold any triangle over.
+    */
+    bool collapseIsValid(const std::vector<uint32_t> &triangles, uint32_t u, uint32_t v,
+                         std::vector<uint32_t> &neighboursU, std::vector<uint32_t> &neighboursV) const {
+        auto gather = [&](uint32_t vertex, std::vector<uint32_t> &out) {
+            out.clear();
+            for (uint32_t i = offsets[vertex]; i < offsets[vertex + 1]; ++i)
+                for (int k = 0; k < 3; ++k)
+                    if (triangles[adjacent[i] * 3 + k] != vertex)
+                        out.push_back(triangles[adjacent[i] * 3 + k]);
+            std::sort(out.begin(), out.end());
+            out.erase(std::unique(out.begin(), out.end()), out.end());
+        };
+        gather(u, neighboursU);
+        gather(v, neighboursV);
+
+        size_t shared = 0, edgeTriangles = 0;
+        for (size_t i = 0, j = 0; i < neighboursU.size() && j < neighboursV.size();) {
+            if (neighboursU[i] < neighboursV[j]) {
+                ++i;
+            } else if (neighboursV[j] < neighboursU[i]) {
+                ++j;
+            } else {
+                ++shared, ++i, ++j;
+            }
+        }
+
+        for (uint32_t i = offsets[u]; i < offsets[u + 1]; ++i) {
+            const uint32_t *triangle = &triangles[adjacent[i] * 3];
+            if (triangle[0] == v || triangle[1] == v || triangle[2] == v) {
+                ++edgeTriangles;
+                continue;
+            }
+
+            const float *corners[3], *moved[3];
+            for (int k = 0; k < 3; ++k) {
+                corners[k] = position(triangle[k]);
+                moved[k] = triangle[k] == u ? position(v) : corners[k];
+            }
+            double before[3], after[3];
+            cross(corners[0], corners[1], corners[2], before);
+            cross(moved[0], moved[1], moved[2], after);
+            const double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+            const double lengths = std::sqrt((before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) *
+                                             (after[0] * after[0] + after[1] * after[1] + after[2] * after[2]));
+            if (lengths == 0.0 || dot < maxFlipCosine * lengths)
+                return false;
+        }
+        return shared == edgeTriangles;
+    }
+
+    size_t collapsePass(const std::vector<uint32_t> &triangles, size_t excessTriangles, double &error) {
+        struct Candidate {
+            double cost;
+            uint32_t from, to;
+        };
+        std::vector<Candidate> candidates;
+
+        for (uint32_t u = 0; u < vertices.size(); ++u) {
+            if (kinds[u] == VertexKind::Locked)
+                continue;
+
+            Candidate best{DBL_MAX, u, invalidIndex};
+            for (uint32_t i = offsets[u]; i < offsets[u + 1]; ++i) {
+                for (int k = 0; k < 3; ++k) {
+                    const uint32_t v = triangles[adjacent[i] * 3 + k];
+                    if (v == u || (kinds[u] == VertexKind::Border && !isBorderEdge(u, v)))
+                        continue;
+                    const double cost = collapseCost(u, v);
+                    if (cost < best.cost || (cost == best.cost && v < best.to))
+                        best = {cost, u, v};
+                }
+            }
+            if (best.to != invalidIndex && best.cost <= context.maxErrorSquared)
+                candidates.push_back(best);
+        }
+        if (candidates.empty())
+            return 0;
+
+        std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+            return a.cost < b.cost || (a.cost == b.cost && a.from < b.from);
+        });
+
+        // Only collapses up to 1.5x the cost of the one that would reach the goal, so expensive
+        // collapses wait for later passes where cheaper ones may have opened up
+        const size_t goal = std::min(candidates.size(), std::max<size_t>(1, (excessTriangles + 1) / 2));
+        const double passLimit = candidates[goal - 1].cost * 1.5;
+
+        std::vector<uint8_t> touched(vertices.size(), 0);
+        std::vector<uint32_t> neighboursU, neighboursV;
+        size_t removed = 0, collapsed = 0;
+        for (const Candidate &candidate : candidates) {
+            if (removed >= excessTriangles || candidate.cost > passLimit)
+                break;
+            const uint32_t u = candidate.from, v = candidate.to;
+            if (touched[u] || touched[v] || !collapseIsValid(triangles, u, v, neighboursU, neighboursV))
+                continue;
+
+            remap[u] = v;
+            quadrics[v].add(quadrics[u]);
+            error = std::max(error, candidate.cost);
+            removed += kinds[u] == VertexKind::Border ? 1 : 2;
+            ++collapsed;
+
+            for (const uint32_t n : neighboursU)
+                touched[n] = 1;
+            touched[u] = 1;
+        }
+        return collapsed;
+    }
+
+    void compact(std::vector<uint32_t> &triangles) {
+        size_t write = 0;
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            const uint32_t a = remap[triangles[i]], b = remap[triangles[i + 1]], c = remap[triangles[i + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            triangles[write++] = a;
+            triangles[write++] = b;
+            triangles[write++] = c;
+        }
+        triangles.resize(write);
+        for (size_t v = 0; v < remap.size(); ++v)
+            remap[v] = static_cast<uint32_t>(v);
+    }
+};
+
+uint32_t spreadBits(uint32_t x) {
+    // 10 bits -> every third bit of 30
+    x &= 0x3ff;
+    x = (x | (x << 16)) & 0x030000ff;
+    x = (x | (x << 8)) & 0x0300f00f;
+    x = (x | (x << 4)) & 0x030c30c3;
+    x = (x | (x << 2)) & 0x09249249;
+    return x;
+}
+
+/*
+    Triangles in Morton order of their centroids, cut into equal runs
+*/
+std::vector<std::vector<uint32_t>> partitionTriangles(const float *positions, const std::vector<uint32_t> &indices,
+                                                      size_t partitionCount) {
+    const size_t triangleCount = indices.size() / 3;
+    float lower[3] = {FLT_MAX, FLT_MAX, FLT_MAX}, upper[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    std::vector<float> centroids(triangleCount * 3);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            const float c = (positions[indices[t * 3] * 3 + k] + positions[indices[t * 3 + 1] * 3 + k] +
+                             positions[indices[t * 3 + 2] * 3 + k]) / 3.0f;
+            centroids[t * 3 + k] = c;
+            lower[k] = std::min(lower[k], c);
+            upper[k] = std::max(upper[k], c);
+        }
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t>> order(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        uint32_t code = 0;
+        for (int k = 0; k < 3; ++k) {
+            const float range = upper[k] - lower[k];
+            const float unit = range > 0.0f ? (centroids[t * 3 + k] - lower[k]) / range : 0.0f;
+            code |= spreadBits(static_cast<uint32_t>(unit * 1023.0f)) << k;
+        }
+        order[t] = {code, static_cast<uint32_t>(t)};
+    }
+    std::sort(order.begin(), order.end());
+
+    std::vector<std::vector<uint32_t>> partitions(partitionCount);
+    for (size_t p = 0; p < partitionCount; ++p) {
+        const size_t begin = triangleCount * p / partitionCount, end = triangleCount * (p + 1) / partitionCount;
+        partitions[p].reserve((end - begin) * 3);
+        for (size_t i = begin; i < end; ++i)
+            partitions[p].insert(partitions[p].end(), &indices[order[i].second * 3], &indices[order[i].second * 3 + 3]);
+    }
+    return partitions;
+}
+
+} // namespace
+
+/**
+ * @brief Reduces a triangle list to about @p targetIndexCount indices with quadric error edge collapses.
+ *
+ * Collapses move a vertex onto a neighbouring vertex, so the result indexes the unchanged
+ * vertices of @p mesh. Normals and colors, when present, add to the cost of a collapse that
+ * would smear them. Open borders only collapse along themselves (or stay fixed with
+ * SimplifyOptions::lockBorder). Vertices split for a normal/color seam never move.
+ *
+ * Simplification stops early when no collapse under SimplifyOptions::maxError is left.
+ *
+ * @param destination Receives the simplified triangle list, room for @p indexCount indices.
+ * @param indices Triangle list over the vertices of @p mesh, the mesh's own indices are ignored.
+ * @param resultError Receives the largest collapse error, in object units.
+ * @return Number of indices written.
+ * @throws std::runtime_error If the index count is not a multiple of 3 or an index is out of range.
+ */
+size_t simplifyMesh(uint32_t *destination, const Mesh &mesh, const uint32_t *indices, size_t indexCount,
+                    size_t targetIndexCount, const SimplifyOptions &options, float *resultError) {
+    if (indexCount % 3 != 0)
+        throw std::runtime_error("Index count is not a multiple of 3");
+    const size_t vertexCount = mesh.vertexCount();
+    if (std::any_of(indices, indices + indexCount, [&](uint32_t i) { return i >= vertexCount; }))
+        throw std::runtime_error("Index out of range");
+
+    std::vector<uint32_t> result(indices, indices + indexCount);
+    const size_t targetTriangles = targetIndexCount / 3;
+    double error = 0;
+
+    if (result.size() / 3 > targetTriangles) {
+        const SimplifyContext context = makeContext(mesh, options);
+        const size_t partitionSize = std::max<size_t>(options.partitionTriangles, 1);
+        const size_t partitionCount = (result.size() / 3 + partitionSize - 1) / partitionSize;
+
+        if (partitionCount > 1) {
+            std::vector<std::vector<uint32_t>> partitions = partitionTriangles(mesh.positions.data(), result,
+                                                                               partitionCount);
+
+            // Vertices used by more than one partition are locked until the final pass
+            std::vector<uint32_t> owner(vertexCount, invalidIndex);
+            std::vector<uint8_t> shared(vertexCount, 0);
+            for (size_t p = 0; p < partitionCount; ++p) {
+                for (const uint32_t v : partitions[p]) {
+                    if (owner[v] == invalidIndex)
+                        owner[v] = static_cast<uint32_t>(p);
+                    else if (owner[v] != p)
+                        shared[v] = 1;
+                }
+            }
+
+            // Partitions stop a little short of their share, leaving the final pass collapses
+            // to spend on the seams between them
+            const double ratio = std::min(1.0, 1.25 * targetTriangles / static_cast<double>(result.size() / 3));
+            std::vector<double> errors(partitionCount, 0.0);
+            ThreadPool::shared().parallelFor(partitionCount, 1, [&](size_t begin, size_t end) {
+                for (size_t p = begin; p < end; ++p) {
+                    PartitionSimplifier simplifier(context, &shared);
+                    const size_t target = static_cast<size_t>(ratio * (partitions[p].size() / 3));
+                    errors[p] = simplifier.run(partitions[p], target);
+                }
+            });
+
+            result.clear();
+            for (size_t p = 0; p < partitionCount; ++p) {
+                result.insert(result.end(), partitions[p].begin(), partitions[p].end());
+                error = std::max(error, errors[p]);
+            }
+        }
+
+        if (result.size() / 3 > targetTriangles) {
+            PartitionSimplifier simplifier(context, nullptr);
+            error = std::max(error, simplifier.run(result, targetTriangles));
+        }
+    }
+
+    std::copy(result.begin(), result.end(), destination);
+    if (resultError)
+        *resultError = static_cast<float>(std::sqrt(error));
+    return result.size();
+}
+
+/**
+ * @brief Builds levels of detail at the given fractions of the mesh's triangle count.
+ *
+ * Level 0 is the mesh's own index list. Each further level is simplified from the previous
+ * one and reordered for the vertex cache, its error is the sum of the errors so far. The
+ * chain ends early once simplification stalls, e.g. when SimplifyOptions::maxError is reached.
+ *
+ * @param triangleRatios Decreasing fractions, e.g. {0.5, 0.25, 0.125}.
+ */
+LodChain generateLodChain(const Mesh &mesh, const std::vector<float> &triangleRatios, const SimplifyOptions &options) {
+    LodChain chain;
+    chain.indices = mesh.indices;
+    chain.levels.push_back({0, static_cast<uint32_t>(mesh.indices.size()), 0.0f});
+
+    std::vector<uint32_t> current = mesh.indices;
+    float error = 0.0f;
+    for (const float ratio : triangleRatios) {
+        const size_t target = static_cast<size_t>(ratio * mesh.triangleCount()) * 3;
+        if (target >= current.size())
+            continue;
+
+        std::vector<uint32_t> next(current.size());
+        float levelError = 0.0f;
+        const size_t count = simplifyMesh(next.data(), mesh, current.data(), current.size(), target, options,
+                                          &levelError);
+        if (count >= current.size())
+            break;
+        next.resize(count);
+        optimizeVertexCache(next.data(), next.data(), next.size(), mesh.vertexCount());
+
+        error += levelError;
+        chain.levels.push_back({static_cast<uint32_t>(chain.indices.size()), static_cast<uint32_t>(count), error});
+        chain.indices.insert(chain.indices.end(), next.begin(), next.end());
+        current.swap(next);
+    }
+    return chain;
+}
@@ -0,0 +1,370 @@
+#include "meshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "../common/ThreadPool.h"
+
+/*
+-------------------------------------------------------------------
+  VERTEX WELDING  ---------------------------------------------------
+
+  1. Every vertex gets a 64 bit key - a hash of all its attribute bits (exact mode)
+     or of the grid cell its position falls in (epsilon mode, cells are 2 * epsilon).
+  2. Entries are radix-partitioned by the key's top bits into buckets and each bucket
+     is sorted, giving a read-only spatial hash that every thread can query.
+  3. Each vertex scans its run of equal keys (exact) or looks up the 2x2x2 cells around
+     it (epsilon) and picks the lowest-numbered matching vertex as its representative.
+  4. Representatives are compacted and indices rewritten, all in parallel.
+-------------------------------------------------------------------
+*/
+
+namespace {
+
+struct Entry {
+    uint64_t key;
+    uint32_t vertex;
+};
+
+uint64_t mix(uint64_t h) {
+    // splitmix64 finalizer
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return h;
+}
+
+uint64_t hashFloats(uint64_t h, const float *values, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t bits;
+        std::memcpy(&bits, &values[i], sizeof(bits));
+        h = mix(h ^ (bits + 0x9e3779b97f4a7c15ull));
+    }
+    return h;
+}
+
+uint64_t hashCell(int64_t x, int64_t y, int64_t z) {
+    return mix(mix(mix(static_cast<uint64_t>(x)) ^ static_cast<uint64_t>(y)) ^ static_cast<uint64_t>(z));
+}
+
+class WeldContext {
+public:
+    WeldContext(const Mesh &mesh, const WeldOptions &options)
+        : mesh(mesh), options(options), exact(options.positionEpsilon <= 0.0f),
+          cellSize(2.0f * options.positionEpsilon) {}
+
+    uint64_t key(uint32_t v) const {
+        const float *p = &mesh.positions[v * 3];
+        if (!exact)
+            return hashCell(cellOf(p[0]), cellOf(p[1]), cellOf(p[2]));
+
+        uint64_t h = hashFloats(0, p, 3);
+        if (!mesh.normals.empty())
+            h = hashFloats(h, &mesh.normals[v * 3], 3);
+        if (!mesh.colors.empty())
+            h = hashFloats(h, &mesh.colors[v * 4], 4);
+        return h;
+    }
+
+    bool matches(uint32_t a, uint32_t b) const {
+        if (exact) {
+            if (std::memcmp(&mesh.positions[a * 3], &mesh.positions[b * 3], 3 * sizeof(float)) != 0)
+                return false;
+            if (!mesh.normals.empty() &&
+                std::memcmp(&mesh.normals[a * 3], &mesh.normals[b * 3], 3 * sizeof(float)) != 0)
+                return false;
+            return mesh.colors.empty() ||
+                   std::memcmp(&mesh.colors[a * 4], &mesh.colors[b * 4], 4 * sizeof(float)) == 0;
+        }
+
+        const float *pa = &mesh.positions[a * 3];
+        const float *pb = &mesh.positions[b * 3];
+        const float dx = pa[0] - pb[0], dy = pa[1] - pb[1], dz = pa[2] - pb[2];
+        const float epsilon = options.positionEpsilon;
+        if (dx * dx + dy * dy + dz * dz > epsilon * epsilon)
+            return false;
+        if (!mesh.normals.empty() && !close(&mesh.normals[a * 3], &mesh.normals[b * 3], 3))
+            return false;
+        return mesh.colors.empty() || close(&mesh.colors[a * 4], &mesh.colors[b * 4], 4);
+    }
+
+    bool isExact() const { return exact; }
+
+    // Keys of the 8 cells that can hold a match for v, epsilon mode only
+    void neighbourKeys(uint32_t v, uint64_t keys[8]) const {
+        // Cells are 2 * epsilon wide, so anything within epsilon is in this cell or the
+        // neighbour on the side of the cell the point is closest to, per axis
+        const float *p = &mesh.positions[v * 3];
+        int64_t base[3], step[3];
+        for (int k = 0; k < 3; ++k) {
+            const double scaled = p[k] / static_cast<double>(cellSize);
+            base[k] = static_cast<int64_t>(std::floor(scaled));
+            step[k] = (scaled - static_cast<double>(base[k])) < 0.5 ? -1 : 1;
+        }
+        for (int i = 0; i < 8; ++i)
+            keys[i] = hashCell(base[0] + ((i & 1) ? step[0] : 0), base[1] + ((i & 2) ? step[1] : 0),
+                               base[2] + ((i & 4) ? step[2] : 0));
+    }
+
+private:
+    int64_t cellOf(float value) const {
+        return static_cast<int64_t>(std::floor(value / static_cast<double>(cellSize)));
+    }
+
+    bool close(const float *a, const float *b, size_t count) const {
+        for (size_t i = 0; i < count; ++i)
+            if (std::fabs(a[i] - b[i]) > options.attributeEpsilon)
+                return false;
+        return true;
+    }
+
+    const Mesh &mesh;
+    const WeldOptions &options;
+    bool exact;
+    float cellSize;
+};
+
+} // namespace
+
+/**
+ * @brief Merges duplicate vertices, rewrites the indices and drops degenerate triangles.
+ *
+ * With positionEpsilon == 0 vertices merge only when every attribute is bit-identical.
+ * Otherwise positions within positionEpsilon and normals/colors within attributeEpsilon
+ * merge. Each vertex is merged into the lowest-numbered vertex it matches, directly or
+ * through a chain of matches, so the result does not depend on the thread count.
+ *
+ * Vertex attributes keep their relative order. Unreferenced vertices are kept.
+ *
+ * @throws std::runtime_error If the mesh's attribute arrays or indices are inconsistent.
+ */
+WeldResult weldVertices(Mesh &mesh, const WeldOptions &options) {
+    const size_t vertexCount = mesh.vertexCount();
+    if (mesh.positions.size() != vertexCount * 3 ||
+        (!mesh.normals.empty() && mesh.normals.size() != vertexCount * 3) ||
+        (!mesh.colors.empty() && mesh.colors.size() != vertexCount * 4))
+        throw std::runtime_error("Mesh attribute arrays differ in length");
+    if (mesh.indices.size() % 3 != 0)
+        throw std::runtime_error("Index count is not a multiple of 3");
+    if (vertexCount >= UINT32_MAX)
+        throw std::runtime_error("Too many vertices to weld");
+    if (std::any_of(mesh.indices.begin(), mesh.indices.end(), [&](uint32_t i) { return i >= vertexCount; }))
+        throw std::runtime_error("Index out of range");
+
+    WeldResult result{vertexCount, vertexCount, 0};
+    if (vertexCount == 0)
+        return result;
+
+    ThreadPool &pool = ThreadPool::shared();
+    const WeldContext context(mesh, options);
+
+    /*
+     * 1. Keys
+     */
+    std::vector<uint64_t> keys(vertexCount);
+    pool.parallelFor(vertexCount, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v)
+            keys[v] = context.key(static_cast<uint32_t>(v));
+    });
+
+    /*
+     * 2. Radix partition by the top key bits, then sort each bucket
+     */
+    int bucketBits = 4;
+    while (bucketBits < 16 && (vertexCount >> bucketBits) > 1024)
+        ++bucketBits;
+    const size_t bucketCount = size_t(1) << bucketBits;
+    const int shift = 64 - bucketBits;
+
+    const size_t chunkSize = std::max<size_t>(4096, vertexCount / (pool.size() * 4));
+    const size_t chunkCount = (vertexCount + chunkSize - 1) / chunkSize;
+    std::vector<uint32_t> histogram(chunkCount * bucketCount, 0);
+    pool.parallelFor(chunkCount, 1, [&](size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk < end; ++chunk) {
+            uint32_t *counts = &histogram[chunk * bucketCount];
+            const size_t last = std::min(vertexCount, (chunk + 1) * chunkSize);
+            for (size_t v = chunk * chunkSize; v < last; ++v)
+                counts[keys[v] >> shift]++;
+        }
+    });
+
+    // Exclusive prefix sum, bucket-major so each bucket ends up contiguous
+    std::vector<size_t> bucketStart(bucketCount + 1, 0);
+    std::vector<size_t> writeOffset(chunkCount * bucketCount);
+    size_t running = 0;
+    for (size_t bucket = 0; bucket < bucketCount; ++bucket) {
+        bucketStart[bucket] = running;
+        for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+            writeOffset[chunk * bucketCount + bucket] = running;
+            running += histogram[chunk * bucketCount + bucket];
+        }
+    }
+    bucketStart[bucketCount] = running;
+
+    std::vector<Entry> entries(vertexCount);
+    pool.parallelFor(chunkCount, 1, [&](size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk < end; ++chunk) {
+            size_t *offsets = &writeOffset[chunk * bucketCount];
+            const size_t last = std::min(vertexCount, (chunk + 1) * chunkSize);
+            for (size_t v = chunk * chunkSize; v < last; ++v)
+                entries[offsets[keys[v] >> shift]++] = {keys[v], static_cast<uint32_t>(v)};
+        }
+    });
+
+    pool.parallelFor(bucketCount, [&](size_t begin, size_t end) {
+        for (size_t bucket = begin; bucket < end; ++bucket)
+            std::sort(entries.begin() + bucketStart[bucket], entries.begin() + bucketStart[bucket + 1],
+                      [](const Entry &a, const Entry &b) {
+                          return a.key < b.key || (a.key == b.key && a.vertex < b.vertex);
+                      });
+    });
+
+    /*
+     * 3. Representative - the lowest-numbered matching vertex in any candidate cell
+     */
+    std::vector<uint32_t> representative(vertexCount);
+    pool.parallelFor(bucketCount, [&](size_t begin, size_t end) {
+        for (size_t bucket = begin; bucket < end; ++bucket) {
+            const auto bucketBegin = entries.begin() + bucketStart[bucket];
+            const auto bucketEnd = entries.begin() + bucketStart[bucket + 1];
+
+            if (context.isExact()) {
+                // Matches share a key, and runs of one key are sorted by vertex
+                for (auto run = bucketBegin; run != bucketEnd;) {
+                    auto runEnd = run;
+                    while (runEnd != bucketEnd && runEnd->key == run->key)
+                        ++runEnd;
+                    for (auto it = run; it != runEnd; ++it) {
+                        uint32_t best = it->vertex;
+                        for (auto earlier = run; earlier != it; ++earlier) {
+                            if (context.matches(it->vertex, earlier->vertex)) {
+                                best = earlier->vertex;
+                                break;
+                            }
+                        }
+                        representative[it->vertex] = best;
+                    }
+                    run = runEnd;
+                }
+                continue;
+            }
+
+            // Walking the bucket in key order keeps the vertex's own cell hot in cache
+            uint64_t candidates[8];
+            for (auto it = bucketBegin; it != bucketEnd; ++it) {
+                const uint32_t v = it->vertex;
+                uint32_t best = v;
+                context.neighbourKeys(v, candidates);
+                for (const uint64_t key : candidates) {
+                    const size_t candidateBucket = key >> shift;
+                    const auto candidateEnd = entries.begin() + bucketStart[candidateBucket + 1];
+                    auto first = std::lower_bound(entries.begin() + bucketStart[candidateBucket], candidateEnd, key,
+                                                  [](const Entry &e, uint64_t k) { return e.key < k; });
+                    // Entries with the same key are sorted by vertex, stop at the current best
+                    for (; first != candidateEnd && first->key == key && first->vertex < best; ++first) {
+                        if (context.matches(v, first->vertex)) {
+                            best = first->vertex;
+                            break;
+                        }
+                    }
+                }
+                representative[v] = best;
+            }
+        }
+    });
+
+    // Follow chains, representatives always point backwards so one ascending pass settles them
+    for (size_t v = 0; v < vertexCount; ++v)
+        representative[v] = representative[representative[v]];
+
+    /*
+     * 4. Compact vertices and rewrite indices
+     */
+    std::vector<uint32_t> chunkKept(chunkCount, 0);
+    pool.parallelFor(chunkCount, 1, [&](size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk < end; ++chunk) {
+            const size_t last = std::min(vertexCount, (chunk + 1) * chunkSize);
+            for (size_t v = chunk * chunkSize; v < last; ++v)
+                chunkKept[chunk] += representative[v] == v;
+        }
+    });
+    std::vector<uint32_t> chunkBase(chunkCount, 0);
+    uint32_t kept = 0;
+    for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+        chunkBase[chunk] = kept;
+        kept += chunkKept[chunk];
+    }
+
+    std::vector<uint32_t> remap(vertexCount);
+    pool.parallelFor(chunkCount, 1, [&](size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk < end; ++chunk) {
+            uint32_t next = chunkBase[chunk];
+            const size_t last = std::min(vertexCount, (chunk + 1) * chunkSize);
+            for (size_t v = chunk * chunkSize; v < last; ++v)
+                if (representative[v] == v)
+                    remap[v] = next++;
+        }
+    });
+    // Duplicates take their representative's new slot, which is final by now
+    pool.parallelFor(vertexCount, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v)
+            if (representative[v] != v)
+                remap[v] = remap[representative[v]];
+    });
+
+    auto compact = [&](std::vector<float> &attribute, size_t components) {
+        if (attribute.empty())
+            return;
+        std::vector<float> result(static_cast<size_t>(kept) * components);
+        pool.parallelFor(vertexCount, [&](size_t begin, size_t end) {
+            for (size_t v = begin; v < end; ++v)
+                if (representative[v] == v)
+                    std::copy_n(&attribute[v * components], components, &result[remap[v] * components]);
+        });
+        attribute.swap(result);
+    };
+    compact(mesh.positions, 3);
+    compact(mesh.normals, 3);
+    compact(mesh.colors, 4);
+
+    // Rewrite and filter triangles, compacting per chunk to keep the output order
+    const size_t triangleCount = mesh.triangleCount();
+    const size_t triangleChunk = std::max<size_t>(4096, triangleCount / (pool.size() * 4));
+    const size_t triangleChunks = (triangleCount + triangleChunk - 1) / triangleChunk;
+    std::vector<size_t> trianglesKept(triangleChunks, 0);
+    pool.parallelFor(triangleChunks, 1, [&](size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk < end; ++chunk) {
+            size_t write = chunk * triangleChunk * 3;
+            const size_t last = std::min(triangleCount, (chunk + 1) * triangleChunk);
+            for (size_t t = chunk * triangleChunk; t < last; ++t) {
+                const uint32_t ra = remap[mesh.indices[t * 3]];
+                const uint32_t rb = remap[mesh.indices[t * 3 + 1]];
+                const uint32_t rc = remap[mesh.indices[t * 3 + 2]];
+                if (options.removeDegenerates && (ra == rb || rb == rc || ra == rc))
+                    continue;
+                mesh.indices[write++] = ra;
+                mesh.indices[write++] = rb;
+                mesh.indices[write++] = rc;
+            }
+            trianglesKept[chunk] = write / 3 - chunk * triangleChunk;
+        }
+    });
+
+    size_t write = 0;
+    for (size_t chunk = 0; chunk < triangleChunks; ++chunk) {
+        const size_t read = chunk * triangleChunk * 3;
+        const size_t count = trianglesKept[chunk] * 3;
+        if (read != write)
+            std::copy(mesh.indices.begin() + read, mesh.indices.begin() + read + count, mesh.indices.begin() + write);
+        write += count;
+    }
+    mesh.indices.resize(write);
+
+    result.verticesAfter = kept;
+    result.trianglesRemoved = triangleCount - write / 3;
+    return result;
+}
@@ -1,5 +1,4 @@
 #include "primitive.h"
-#include "../shaders/readShaderFile.h"
 
 /*
 -------------------------------------------------------------------
@@ -10,7 +9,8 @@
     Quad
 -------------------------------------------------------------------
 */
-Primitive::Primitive(MTL::Device *device) : device(device)
+Primitive::Primitive(GfxDevice *device, VertexLayout layout, VertexFormat format)
+    : device(device), layout(layout), format(format)
 {
     // Transform
     //transform = Transform();
@@ -18,21 +18,51 @@ Primitive::Primitive(MTL::Device *device) : device(device)
 
 /*
     Destructor
+      The base class owns every GPU resource, subclasses must not release them again.
+      Anything still held here was never retired, so it is released immediately.
 */
 Primitive::~Primitive()
 {
 
-  if (vertexBuffer)
-  {
-    vertexBuffer->release();
-    vertexBuffer = nullptr;
-  }
+  delete vertexBuffer;
+  vertexBuffer = nullptr;
 
-  if (pipelineState)
-  {
-    pipelineState->release();
-    pipelineState = nullptr;
-  }
+  delete colorBuffer;
+  colorBuffer = nullptr;
+
+  delete positionBuffer;
+  positionBuffer = nullptr;
+
+  delete indexBuffer;
+  indexBuffer = nullptr;
+}
+
+/**
+ * @brief Moves this primitive's GPU resources into a destruction queue.
+ *
+ * The resources are released once the GPU has finished @p lastUsedFrame, so the primitive
+ * itself can be deleted right away without waiting on (or crashing) in-flight command buffers.
+ *
+ * @param queue The renderer's destruction queue.
+ * @param lastUsedFrame Index of the last frame this primitive was encoded into.
+ */
+void Primitive::retireResources(DestructionQueue &queue, uint64_t lastUsedFrame)
+{
+  queue.retireOwned(lastUsedFrame, vertexBuffer);
+  queue.retireOwned(lastUsedFrame, colorBuffer);
+  queue.retireOwned(lastUsedFrame, positionBuffer);
+  queue.retireOwned(lastUsedFrame, indexBuffer);
+
+  vertexBuffer = nullptr;
+  colorBuffer = nullptr;
+  positionBuffer = nullptr;
+  indexBuffer = nullptr;
+  pipelineState = nullptr;
+
+  // The records point at the resources just retired, every level is left empty
+  drawRecords.clear();
+  std::fill(levelRecords.begin(), levelRecords.end(), 0);
+  drawsChanged = true;
 }
 
 /*
@@ -43,7 +73,7 @@ void Primitive::createVertexBuffer(const std::vector<float4> &vertices)
   if (vertices.empty())
     throw std::runtime_error("No vertices defined");
 
-  vertexBuffer = device->newBuffer(vertices.data(), vertices.size() * sizeof(float4), MTL::ResourceStorageModeManaged);
+  vertexBuffer = device->newBuffer(vertices.data(), vertices.size() * sizeof(float4));
 
   if (!vertexBuffer)
     throw std::runtime_error("Failed to create vertex buffer");
@@ -58,156 +88,222 @@ void Primitive::createColorBuffer(const std::vector<float4> &color)
   if (color.empty())
     throw std::runtime_error("No color defined");
 
-  colorBuffer = device->newBuffer(color.data(), color.size() * sizeof(float4), MTL::ResourceStorageModeManaged);
+  colorBuffer = device->newBuffer(color.data(), color.size() * sizeof(float4));
 
   if (!colorBuffer)
     throw std::runtime_error("Failed to create vertex buffer");
 }
 
 /*
-    CREATE INDEX BUFFER
-*/
-void Primitive::createIndexBuffer(const std::vector<uint16_t> &indices)
-{
-  indexBuffer = device->newBuffer(indices.data(), indices.size() * sizeof(uint16_t), MTL::ResourceStorageModeManaged);
-  if (indexBuffer)
-    std::cout << "Index buffer created" << std::endl;
-}
+    CREATE VERTEX STREAMS
+      Split:       vertexBuffer = positions, colorBuffer = colors
+      Interleaved: vertexBuffer = Vertex {position, color}
+      Hybrid:      vertexBuffer = Vertex {position, color}, positionBuffer = positions
 
-/*
-  CREATE RENDER PIPELINE STATE
+    Quantized formats use the same arrangement with QuantizedVertex, 8 byte positions and RGBA8 colors.
 */
-void Primitive::createRenderPipelineState()
+void Primitive::createVertexStreams(const std::vector<float4> &positions, const std::vector<float4> &colors)
 {
-  // Uses helper function to load the shaders - using pre-compiled shaders is another approach
-  const std::string fileName = "shaders.metal";
-  NS::Error *error{nullptr}; // Used to catch errors when creating the library
-  MTL::Library *library{nullptr};
-
-  try
+  if (format != VertexFormat::Float32)
   {
-    loadShaderFromFile(library, device, fileName);
-  }
-  catch (const std::exception &e)
-  {
-    std::cerr << "Error loading shader: " << e.what() << std::endl;
-  }
-
-  // Create library
-  if (!library)
-    throw std::runtime_error("Failed to create triangle shader library");
-
-  // Get both vertex and fragment functions
-  MTL::Function *vertexFunction = library->newFunction(NS::String::string("vertex_main", NS::UTF8StringEncoding));
-  if (!vertexFunction)
-  {
-    std::cerr << "Vertex function not found" << std::endl;
+    createQuantizedStreams(positions, colors);
     return;
   }
 
-  MTL::Function *fragmentFunction = library->newFunction(NS::String::string("fragment_main", NS::UTF8StringEncoding));
-  if (!fragmentFunction)
+  if (layout == VertexLayout::Split)
   {
-    std::cerr << "Fragment function not found" << std::endl;
+    createVertexBuffer(positions);
+    createColorBuffer(colors);
     return;
   }
 
-  // Create render pipeline descriptor
-  MTL::RenderPipelineDescriptor *pipelineDescriptor = MTL::RenderPipelineDescriptor::alloc()->init();
-  // Set the functions
-  pipelineDescriptor->setVertexFunction(vertexFunction);
-  pipelineDescriptor->setFragmentFunction(fragmentFunction);
-
-  // Configure color attachment - NOTE: The color attachment represents the output target for the fragment shader.
-  MTL::RenderPipelineColorAttachmentDescriptor *colorAttachment = pipelineDescriptor->colorAttachments()->object(0);
-  colorAttachment->setPixelFormat(MTL::PixelFormat::PixelFormatBGRA8Unorm);
-  colorAttachment->setBlendingEnabled(false); // This overwrites the entire color buffer, keep this in mind when rendering fog etc...
-
-  /*
-    OLD - no longer need the vertex descriptor
-        For anything more complicated than a primitive. Use a vertex descriptor.
-
-  // Create and configure the vertex descriptor
-  MTL::VertexDescriptor *vertexDescriptor = MTL::VertexDescriptor::alloc()->init();
-
-  // Position
-  vertexDescriptor->layouts()->object(0)->setStride(sizeof(Vertex));                           // Each vertex is a float4 (x, y, z, w)
-  vertexDescriptor->attributes()->object(0)->setFormat(MTL::VertexFormat::VertexFormatFloat4); // float4 for position
-  vertexDescriptor->attributes()->object(0)->setOffset(offsetof(Vertex, position));            // Position starts at offset 0
-  vertexDescriptor->attributes()->object(0)->setBufferIndex(0);                                // Use buffer index 0
-
-  // Set color attribute
-  vertexDescriptor->attributes()->object(1)->setFormat(MTL::VertexFormat::VertexFormatFloat4); // float4 for position
-  vertexDescriptor->attributes()->object(1)->setOffset(offsetof(Vertex, color));
-  vertexDescriptor->attributes()->object(1)->setBufferIndex(0); // Use buffer index 0
+  const std::vector<Vertex> vertices = interleaveVertices(positions, colors);
+  vertexBuffer = device->newBuffer(vertices.data(), vertices.size() * sizeof(Vertex));
+  if (!vertexBuffer)
+    throw std::runtime_error("Failed to create vertex buffer");
 
-  pipelineDescriptor->setVertexDescriptor(vertexDescriptor);
-  */
+  if (layout == VertexLayout::Hybrid)
+  {
+    positionBuffer = device->newBuffer(positions.data(), positions.size() * sizeof(float4));
+    if (!positionBuffer)
+      throw std::runtime_error("Failed to create position buffer");
+  }
+}
 
-  // Now create the renderPipelineState with the descriptor
-  pipelineState = device->newRenderPipelineState(pipelineDescriptor, &error);
+/*
+    CREATE QUANTIZED STREAMS
+*/
+void Primitive::createQuantizedStreams(const std::vector<float4> &positions, const std::vector<float4> &colors)
+{
+  const QuantizedStreams streams = quantizeVertices(positions, colors, format);
+  dequantization = streams.params;
 
-  if (error)
+  const size_t positionBytes = streams.positions.size() * sizeof(uint16_t);
+  if (layout == VertexLayout::Split)
   {
-    std::cerr << "ERROR: " << error->localizedDescription()->utf8String() << std::endl;
+    vertexBuffer = device->newBuffer(streams.positions.data(), positionBytes);
+    colorBuffer = device->newBuffer(streams.colors.data(), streams.colors.size() * sizeof(uint32_t));
+    if (!vertexBuffer || !colorBuffer)
+      throw std::runtime_error("Failed to create quantized vertex buffers");
     return;
   }
 
-  if (!pipelineState)
+  const std::vector<QuantizedVertex> vertices = interleaveQuantized(streams);
+  vertexBuffer = device->newBuffer(vertices.data(), vertices.size() * sizeof(QuantizedVertex));
+  if (!vertexBuffer)
+    throw std::runtime_error("Failed to create quantized vertex buffer");
+
+  if (layout == VertexLayout::Hybrid)
   {
-    std::cerr << "Invalid pipelineState" << std::endl;
-    return;
+    positionBuffer = device->newBuffer(streams.positions.data(), positionBytes);
+    if (!positionBuffer)
+      throw std::runtime_error("Failed to create quantized position buffer");
   }
+}
+
+/*
+    CREATE INDEX BUFFER
+*/
+void Primitive::createIndexBuffer(const std::vector<uint16_t> &indices)
+{
+  indexFormat = IndexFormat::UInt16;
+  indexBuffer = device->newBuffer(indices.data(), indices.size() * sizeof(uint16_t));
+  if (indexBuffer)
+    std::cout << "Index buffer created" << std::endl;
+}
+
+/*
+    CREATE INDEX BUFFER
+      Packed by packIndices(), uint16 or uint32
+*/
+void Primitive::createIndexBuffer(const PackedIndices &indices)
+{
+  indexFormat = indices.format;
+  indexBuffer = device->newBuffer(indices.bytes.data(), indices.bytes.size());
+}
 
-  // clean up
-  pipelineDescriptor->release();
-  // vertexDescriptor->release();
-  vertexFunction->release();
-  fragmentFunction->release();
-  library->release();
+/*
+  CREATE RENDER PIPELINE STATE
+    Default - the vertex function matching the layout/format, opaque output
+*/
+void Primitive::createRenderPipelineState()
+{
+  createRenderPipelineState(vertexFunctionName(layout, format), "fragment_main", false);
+}
+
+/*
+  CREATE RENDER PIPELINE STATE
+    Named shader functions, optionally alpha blended (source over)
+*/
+void Primitive::createRenderPipelineState(const char *vertexName, const char *fragmentName, bool blending)
+{
+  // Shaders are compiled once by the device, this only picks the functions. The pipeline is
+  // the device's, shared with every primitive drawn the same way
+  pipelineState = device->getPipeline({vertexName, fragmentName, blending});
 }
 
 /*
     ENCODE RENDER COMMANDS
 */
-void Primitive::encodeRenderCommands(MTL::RenderCommandEncoder *encoder) const
+/**
+ * @brief Appends the draw records of the current level to this frame's list.
+ *
+ * Records were validated when they were compiled, so this only copies a few PODs.
+ *
+ * @param records The renderer's draw list.
+ */
+void Primitive::appendDraws(std::vector<DrawRecord> &records)
+{
+  drawsChanged = false;
+  if (currentLevel == culledLevel)
+    return;
+  records.insert(records.end(), drawRecords.begin() + levelRecords[currentLevel],
+                 drawRecords.begin() + levelRecords[currentLevel + 1]);
+}
+
+bool Primitive::hasChangedDraws() const
+{
+  return drawsChanged;
+}
+
+void Primitive::setCurrentLevel(int32_t level)
 {
+  drawsChanged |= level != currentLevel;
+  currentLevel = level;
+}
 
-  /*
-      To encode, you need:
-      1: A valid encoder
-      2: Complete render pipeline state
-      3: Compete Vertex buffer
-  */
+/**
+ * @brief Fills in the parts of a draw record every draw of this primitive shares.
+ *
+ * The transform and dequantization are referenced rather than copied, so later changes to
+ * either are picked up without compiling the records again.
+ *
+ * @param topology Triangle list or strip.
+ * @param count Indices to draw from the start of indexBuffer, or vertices if there is none.
+ * @throws std::runtime_error If the pipeline state or vertex buffer is missing.
+ */
+DrawRecord Primitive::makeDrawRecord(DrawTopology topology, uint32_t count) const
+{
   if (!pipelineState)
     throw std::runtime_error("No Pipeline State");
   if (!vertexBuffer)
     throw std::runtime_error("No Vertex Buffer");
 
-  if (!encoder)
+  DrawRecord record{};
+  record.pipeline = pipelineState;
+  record.vertexBuffer = vertexBuffer;
+  record.colorBuffer = colorBuffer;
+  record.indexBuffer = indexBuffer;
+  record.transform = transform.getAffine().data(); // Always sent, even without transformations
+  record.transformSlot = transformSlot;
+  if (format != VertexFormat::Float32)
   {
-    std::cerr << "Invalid encoder" << std::endl;
-    return;
+    record.constants = &dequantization;
+    record.constantsSize = sizeof(QuantizationParams);
+    record.constantsIndex = dequantizationIndex;
   }
+  record.count = count;
+  record.instanceCount = 1;
+  record.indexFormat = indexFormat;
+  record.topology = topology;
+  return record;
+}
 
-  // encoder->setTriangleFillMode(MTL::TriangleFillMode::TriangleFillModeLines);
-  //  set renderpipeline state using encoder
-  encoder->setRenderPipelineState(pipelineState);
+void Primitive::addDrawLevel(const std::vector<DrawRecord> &records)
+{
+  drawRecords.insert(drawRecords.end(), records.begin(), records.end());
+  levelRecords.push_back(static_cast<uint32_t>(drawRecords.size()));
+}
 
-  // Set vertex buffer
-  encoder->setVertexBuffer(vertexBuffer, 0, 0); // Set vertexBuffer to buffer(0)
-  encoder->setVertexBuffer(colorBuffer, 0, 1);  // Set colorBuffer to buffer(1)
+Transform &Primitive::getTransform() {
+    return transform;
+}
 
-    /*
-     *  Always send transform matrix to GPU, even if there are not transformations.
-     */
+void Primitive::setTransform(const AffineMatrix &matrix) {
+    if (matrix != transform.getAffine()) {
+        transform.setMatrix(matrix);
+        drawsChanged |= transformSlot == noTransformSlot;   // Otherwise the records don't hold it
+    }
+}
 
-    const Eigen::Matrix4f& transformMatrix = transform.getMatrix();
-    encoder->setVertexBytes(transformMatrix.data(), sizeof(Eigen::Matrix4f), 11);
+void Primitive::setTransformSlot(uint32_t slot) {
+    transformSlot = slot;
+    for (DrawRecord &record : drawRecords)
+        record.transformSlot = slot;
+    drawsChanged = true;
 }
 
-Transform &Primitive::getTransform() {
-    return transform;
+VertexLayout Primitive::getVertexLayout() const {
+    return layout;
+}
+
+VertexFormat Primitive::getVertexFormat() const {
+    return format;
+}
+
+GfxBuffer *Primitive::getPositionStream() const {
+    // Split meshes already have a packed position stream, interleaved ones have none
+    return positionBuffer ? positionBuffer : vertexBuffer;
 }
 
 /*
@@ -216,9 +312,10 @@ Transform &Primitive::getTransform() {
 -------------------------------------------------------------------
 */
 // Standard constructor
-Triangle::Triangle(MTL::Device *device) : Primitive(device) {
+Triangle::Triangle(GfxDevice *device, VertexLayout layout, VertexFormat format) : Primitive(device, layout, format) {
     createDefaultBuffers();
     createRenderPipelineState();
+    addDrawLevel({makeDrawRecord(DrawTopology::Triangle, 3)});
 }
 /**
  * @brief Constructs a triangle with custom vertices and colors.
@@ -227,49 +324,30 @@ Triangle::Triangle(MTL::Device *device) : Primitive(device) {
  * The constructor automatically generates the appropriate indices (0,1,2) for the triangle
  * and creates all necessary GPU buffers and render pipeline state.
  *
- * @param device The Metal device used to create buffers and pipeline state
+ * @param device The device used to create buffers and pipeline state
  * @param vertices A vector of float4 values representing the triangle's vertex positions
  * @param color A vector of float4 values representing the color of each vertex
+ * @param layout How the vertex attributes are laid out in GPU buffers
+ * @param format Full float or quantized vertex attributes
  * @throws std::runtime_error If vertices or color vectors are empty
  * @throws std::runtime_error If buffer creation fails
  */
-Triangle::Triangle(MTL::Device *device, const std::vector<float4> &vertices,
-                   const std::vector<float4> &color): Primitive(device) {
+Triangle::Triangle(GfxDevice *device, const std::vector<float4> &vertices,
+                   const std::vector<float4> &color, VertexLayout layout, VertexFormat format)
+    : Primitive(device, layout, format) {
     if (vertices.empty())
         throw std::runtime_error("No vertices defined");
     if (color.empty())
         throw std::runtime_error("No color defined");
-    createVertexBuffer(vertices);
-    createColorBuffer(color);
+    createVertexStreams(vertices, color);
     // define indices
     std::vector<uint16_t> indices = {0, 1, 2};
     Primitive::createIndexBuffer(indices);
 
     createRenderPipelineState();
+    addDrawLevel({makeDrawRecord(DrawTopology::Triangle, 3)});
 }
-Triangle::~Triangle()
-{
-
-    if (indexBuffer)
-    {
-        indexBuffer->release();
-        indexBuffer = nullptr;
-    }
-}
-/*
-      Draw ------
-*/
-void Triangle::draw(MTL::RenderCommandEncoder *encoder)
-{
-
-
-  encoder->drawIndexedPrimitives(MTL::PrimitiveType::PrimitiveTypeTriangle,
-                                 3, // Number of indices
-                                 MTL::IndexType::IndexTypeUInt16,
-                                 indexBuffer,
-                                 0); //
-}
-
+Triangle::~Triangle() = default;
 void Triangle::createDefaultBuffers()
 {
   // Positions
@@ -277,14 +355,13 @@ void Triangle::createDefaultBuffers()
       {0.0, 0.5, 0.0, 1.0},
       {-0.5, -0.5, 0.0, 1.0},
       {0.5, -0.5, 0.0, 1.0}};
-  Primitive::createVertexBuffer(positions);
 
   // Colors
   std::vector<float4> color = {
       {0.5, 0.5, 0.5, 1.0}, // Gray color
       {0.5, 0.5, 0.5, 1.0}, // Gray color
       {0.5, 0.5, 0.5, 1.0}}; // Gray color
-  Primitive::createColorBuffer(color);
+  Primitive::createVertexStreams(positions, color);
 
   // Indexing
   std::vector<uint16_t> indices = {0, 1, 2};
@@ -304,13 +381,16 @@ void Triangle::createDefaultBuffers()
  * This constructor initializes a Quad object with default vertex, color, and index buffers.
  * It also creates the render pipeline state required for rendering the Quad.
  *
- * @param device The Metal device used to create buffers and pipeline state.
+ * @param device The device used to create buffers and pipeline state.
+ * @param layout How the vertex attributes are laid out in GPU buffers.
+ * @param format Full float or quantized vertex attributes.
  */
-Quad::Quad(MTL::Device *device) : Primitive(device), indexBuffer(nullptr)
+Quad::Quad(GfxDevice *device, VertexLayout layout, VertexFormat format) : Primitive(device, layout, format)
 {
     // default
   createDefaultBuffers();
   Primitive::createRenderPipelineState();
+  addDrawLevel({makeDrawRecord(DrawTopology::Triangle, 6)});
 }
 
 /**
@@ -319,44 +399,37 @@ Quad::Quad(MTL::Device *device) : Primitive(device), indexBuffer(nullptr)
  * This constructor initializes a Quad object with user-defined vertex positions and colors.
  * It creates the necessary GPU buffers (vertex, color, and index buffers) and sets up the render pipeline state.
  *
- * @param device The Metal device used to create buffers and pipeline state.
+ * @param device The device used to create buffers and pipeline state.
  * @param vertices A vector of float4 values representing the positions of the quad's vertices.
  * @param color A vector of float4 values representing the color of each vertex.
+ * @param layout How the vertex attributes are laid out in GPU buffers.
+ * @param format Full float or quantized vertex attributes.
  * @throws std::runtime_error If the vertices or color vectors are empty.
  * @throws std::runtime_error If buffer creation fails.
  */
-Quad::Quad(MTL::Device * device, const std::vector<float4> &vertices, const std::vector<float4> &color): Primitive(device) {
+Quad::Quad(GfxDevice *device, const std::vector<float4> &vertices, const std::vector<float4> &color, VertexLayout layout,
+           VertexFormat format)
+    : Primitive(device, layout, format) {
     // custom
     if (vertices.empty())
         throw std::runtime_error("No vertices defined");
     if (color.empty())
         throw std::runtime_error("No color defined");
 
-    createVertexBuffer(vertices);
-
-    createColorBuffer(color);
+    createVertexStreams(vertices, color);
   // Indexing
   std::vector<uint16_t> indices = {
       // First tringle
       0, 2, 3,
       // Second triangle
       0, 1, 2};
-  //Primative::createIndexBuffer(indices);
-    indexBuffer = device->newBuffer(indices.data(), indices.size() * sizeof(float4), MTL::ResourceStorageModeManaged);
-    //Primitive::createIndexBuffer(indices);        // FIXME: I cannot call this method with a quad????
+  Primitive::createIndexBuffer(indices);
 
     createRenderPipelineState();
+    addDrawLevel({makeDrawRecord(DrawTopology::Triangle, 6)});
 }
 
-Quad::~Quad()
-{
-
-  if (indexBuffer)
-  {
-    indexBuffer->release();
-    indexBuffer = nullptr;
-  }
-}
+Quad::~Quad() = default;
 
 void Quad::createDefaultBuffers()
 {
@@ -367,9 +440,6 @@ void Quad::createDefaultBuffers()
       {0.5, -0.5, 0.0, 1.0}, // Bottom Right
       {-0.5, -0.5, 0.0, 1.0} // Bottom Left
   };
-  Primitive::createVertexBuffer(vertices);
-  if (!vertexBuffer)
-    throw std::runtime_error("Vertex buffer failed to create");
 
   // Colors
   std::vector<float4> color = {
@@ -378,9 +448,9 @@ void Quad::createDefaultBuffers()
       {0.0, 0.0, 1.0, 1.0},
       {0.0, 0.0, 1.0, 1.0}};
 
-  Primitive::createColorBuffer(color);
-  if (!colorBuffer)
-    throw std::runtime_error("Color buffer failed to create");
+  Primitive::createVertexStreams(vertices, color);
+  if (!vertexBuffer)
+    throw std::runtime_error("Vertex buffer failed to create");
 
   // Indexing
   std::vector<uint16_t> indices = {
@@ -388,8 +458,7 @@ void Quad::createDefaultBuffers()
       0, 2, 3,
       // Second triangle
       0, 1, 2};
-  //Primative::createIndexBuffer(indices);
-  indexBuffer = device->newBuffer(indices.data(), indices.size() * sizeof(float4), MTL::ResourceStorageModeManaged);
+  Primitive::createIndexBuffer(indices);
   if (!indexBuffer)
     throw std::runtime_error("Index buffer failed to create");
 
@@ -397,116 +466,301 @@ void Quad::createDefaultBuffers()
   std::cout << "SUCCESS in creating Quad buffers" << std::endl;
 }
 
-void Quad::draw(MTL::RenderCommandEncoder *encoder)
-{
-
-  if (!indexBuffer)
-    throw std::runtime_error("Index buffer failed to create");
-
-  // Draw the quad using the index buffer
-  encoder->drawIndexedPrimitives(MTL::PrimitiveType::PrimitiveTypeTriangle,
-                                 6, // Number of indices
-                                 MTL::IndexType::IndexTypeUInt16,
-                                 indexBuffer,
-                                 0); //
-}
-
 //-------------------------------------------------------------------
 //    Circle  ---------------------------------------------------------
 //-------------------------------------------------------------------
 
-Circle::Circle(MTL::Device *device): Primitive(device) {
+Circle::Circle(GfxDevice *device, VertexLayout layout, VertexFormat format): Primitive(device, layout, format) {
     // Create the vertex buffer for the circle
     createDefaultBuffers();
     Primitive::createRenderPipelineState();
-}
-/*
-    Destructor
-*/
-Circle::~Circle()
-{
-
-
-    if (vertexBuffer)
-    {
-        vertexBuffer->release();
-        vertexBuffer = nullptr;
-    }
 
-    if (pipelineState)
-    {
-        pipelineState->release();
-        pipelineState = nullptr;
+    // One draw per level, a range of the shared index buffer
+    for (const TessellationLevel &level : levels) {
+        DrawRecord record = makeDrawRecord(DrawTopology::Triangle, level.indexCount);
+        record.start = static_cast<uint32_t>(level.indexOffset * indexSize(indexFormat)); // Byte offset of this level
+        addDrawLevel({record});
     }
-
 }
+/*
+    Destructor - resources are owned and released by Primitive
+*/
+Circle::~Circle() = default;
 
+/*
+    Builds one vertex ring at the highest level of detail and an index buffer holding a fan
+    for every power-of-two segment count. Lower levels skip rim vertices, so they share the ring.
+*/
 void Circle::createDefaultBuffers() {
    /*
     * Position
     */
    std::vector<float4> positions;
-   unsigned int vertexCount {100};
-   float angle = (2 * M_PI) / vertexCount;
+   const float angle = (2 * M_PI) / maxSegments;
    positions.emplace_back(0.0, 0.0, 0.0, 1.0);
-   for(int i {1}; i <= vertexCount; ++i){
+   for (uint32_t i {0}; i < maxSegments; ++i) {
        float x = radius * cos(i * angle);
        float y = radius * sin(i * angle);
        positions.emplace_back(x, y, 0.0, 1.0);
    }
 
-   Primitive::createVertexBuffer(positions);
-   if (!vertexBuffer) {
-       throw std::runtime_error("Failed to create circles vertexBuffer");
-   }
-
    /*
     * Color
     */
    std::vector<float4> color;
-   for (int i {0}; i <= vertexCount; ++i){
+   for (size_t i {0}; i < positions.size(); ++i) {
        color.emplace_back(0.4, 0.2, 0.3, 1.0);
    }
-   Primitive::createColorBuffer(color);
-    if (!colorBuffer)
-        throw std::runtime_error("Color buffer failed to create");
+   Primitive::createVertexStreams(positions, color);
+   if (!vertexBuffer) {
+       throw std::runtime_error("Failed to create circles vertexBuffer");
+   }
 
     /*
-     * Indices
+     * Indices - one fan per level, one triangle per segment
      */
     std::vector<uint16_t> indices;
-    const uint16_t centerIdx = 0;
-    for (uint16_t i = 1; i <= vertexCount; ++i) {
-        // Create two triangles for each segment of the circle
-        indices.push_back(centerIdx); // Center vertex
-        indices.push_back(i);
-        if (i == vertexCount) {
-            indices.push_back(1); // Connect back to the first vertex
-        } else {
-            indices.push_back(i + 1);
-        }
-    }
-
-    // Add the last triangle to close the circle
-    for (uint16_t i = 1; i < vertexCount; ++i) {
-        indices.push_back(0); // Center vertex
-        indices.push_back(i);
-        indices.push_back(i + 1);
+    levels.clear();
+    for (uint32_t segments = minSegments; segments <= maxSegments; segments <<= 1) {
+        const uint32_t offset = static_cast<uint32_t>(indices.size());
+        appendFanIndices(indices, segments, maxSegments);
+        levels.push_back({segments, offset, segments * 3});
     }
+    currentLevel = static_cast<int32_t>(levels.size()) - 1;
 
-    indexBuffer = device->newBuffer(indices.data(), indices.size() * sizeof(uint16_t), MTL::ResourceStorageModeManaged );
+    Primitive::createIndexBuffer(indices);
     if (!indexBuffer)
         throw std::runtime_error("Index buffer failed to create");
 }
 
-void Circle::draw(MTL::RenderCommandEncoder *encoder) {
-    // This is the draw call
-    std::cout << "Drawing circle" << std::endl;
+/**
+ * @brief Picks the cheapest level whose chord error stays under the pixel budget.
+ *
+ * @param viewProjection World to clip space, applied after the transform.
+ * @param viewportWidth Drawable width in pixels.
+ * @param viewportHeight Drawable height in pixels.
+ */
+void Circle::updateLod(const Matrix4f &viewProjection, float viewportWidth, float viewportHeight) {
+    const Matrix4f matrix = viewProjection * expandAffine(transform.getAffine());
+    const float radiusPixels = projectedRadiusPixels(matrix, radius, viewportWidth, viewportHeight);
+    const uint32_t segments = segmentsForChordError(radiusPixels, maxChordErrorPixels, minSegments, maxSegments);
+
+    // Levels are consecutive powers of two starting at minSegments
+    size_t level = 0;
+    while (level + 1 < levels.size() && levels[level].segments < segments)
+        ++level;
+    setCurrentLevel(static_cast<int32_t>(level));
+}
 
-    encoder->drawIndexedPrimitives(MTL::PrimitiveType::PrimitiveTypeTriangle,
-                                   indexBuffer->length() / sizeof(uint16_t), // Number of indices
-                                   MTL::IndexType::IndexTypeUInt16,
-                                   indexBuffer,
-                                   0); //
+void Circle::setMaxChordError(float pixels) {
+    maxChordErrorPixels = pixels;
 }
 
+uint32_t Circle::getSegmentCount() const {
+    return levels.empty() ? 0 : levels[currentLevel].segments;
+}
+
+//-------------------------------------------------------------------
+//    ShapeBatch  -----------------------------------------------------
+//-------------------------------------------------------------------
+
+/**
+ * @brief Constructs a batch of analytic shapes drawn as one instanced quad each.
+ *
+ * The instances are uploaded once to vertexBuffer (read by vertex_sdf as buffer(0)). The whole
+ * batch shares one transform, and the cost per shape is 4 vertices regardless of its size.
+ *
+ * @param device The device used to create buffers and pipeline state.
+ * @param instances The shapes to draw, see packSdfInstance().
+ * @throws std::runtime_error If there are no instances or buffer creation fails.
+ */
+ShapeBatch::ShapeBatch(GfxDevice *device, const std::vector<SdfInstance> &instances)
+    : Primitive(device, VertexLayout::Interleaved), instanceCount(static_cast<uint32_t>(instances.size()))
+{
+  if (instances.empty())
+    throw std::runtime_error("No shapes defined");
+
+  vertexBuffer = device->newBuffer(instances.data(), instances.size() * sizeof(SdfInstance));
+  if (!vertexBuffer)
+    throw std::runtime_error("Failed to create shape instance buffer");
+
+  // Coverage goes out through alpha, so the SDF pipeline blends
+  Primitive::createRenderPipelineState("vertex_sdf", "fragment_sdf", true);
+
+  // One quad, one instance per shape
+  DrawRecord record = makeDrawRecord(DrawTopology::TriangleStrip, 4);
+  record.instanceCount = instanceCount;
+  record.constants = &pixelPadding;
+  record.constantsSize = sizeof(float);
+  record.constantsIndex = pixelPaddingIndex;
+  addDrawLevel({record});
+}
+
+ShapeBatch::~ShapeBatch() = default;
+
+void ShapeBatch::createDefaultBuffers()
+{
+  // Instances are always supplied by the caller
+}
+
+/**
+ * @brief Works out how big one pixel is in object units, used to pad each quad for antialiasing.
+ */
+void ShapeBatch::updateLod(const Matrix4f &viewProjection, float viewportWidth, float viewportHeight)
+{
+  const Matrix4f matrix = viewProjection * expandAffine(transform.getAffine());
+  const float pixelsPerUnit = projectedRadiusPixels(matrix, 1.0f, viewportWidth, viewportHeight);
+  const float padding = pixelsPerUnit > 0.0f ? 1.0f / pixelsPerUnit : 0.0f;
+  drawsChanged |= padding != pixelPadding;    // Baked into draw packets
+  pixelPadding = padding;
+}
+
+
+//-------------------------------------------------------------------
+//    MeshPrimitive  --------------------------------------------------
+//-------------------------------------------------------------------
+
+/**
+ * @brief Uploads a Mesh and, optionally, its levels of detail.
+ *
+ * Every level indexes the same vertices, so all of them live back to back in one index
+ * buffer and switching level only changes the range passed to the draw call.
+ *
+ * @param device The device used to create buffers and pipeline state.
+ * @param mesh Positions, optional colors (gray otherwise) and the full detail indices.
+ * @param lods Levels of detail from generateLodChain(), empty to draw mesh.indices only. Levels
+ *             with no indices of their own are ranges of mesh.indices, as in a BakedMesh.
+ * @param layout How the vertex attributes are laid out in GPU buffers.
+ * @param format Full float or quantized vertex attributes.
+ * @throws std::runtime_error If the mesh is empty, an index is out of range or buffer creation fails.
+ */
+MeshPrimitive::MeshPrimitive(GfxDevice *device, const Mesh &mesh, const LodChain &lods, VertexLayout layout,
+                             VertexFormat format)
+    : Primitive(device, layout, format)
+{
+  const size_t vertexCount = mesh.vertexCount();
+  if (vertexCount == 0 || mesh.indices.empty())
+    throw std::runtime_error("No mesh defined");
+
+  std::vector<float4> positions;
+  std::vector<float4> color;
+  positions.reserve(vertexCount);
+  color.reserve(vertexCount);
+  for (size_t v = 0; v < vertexCount; ++v)
+  {
+    positions.emplace_back(mesh.positions[v * 3], mesh.positions[v * 3 + 1], mesh.positions[v * 3 + 2], 1.0);
+    if (mesh.colors.empty())
+      color.emplace_back(0.5, 0.5, 0.5, 1.0);
+    else
+      color.emplace_back(mesh.colors[v * 4], mesh.colors[v * 4 + 1], mesh.colors[v * 4 + 2], mesh.colors[v * 4 + 3]);
+  }
+  createVertexStreams(positions, color);
+
+  // Bounding sphere around the box center, loose but cheap
+  float lower[3] = {mesh.positions[0], mesh.positions[1], mesh.positions[2]};
+  float upper[3] = {lower[0], lower[1], lower[2]};
+  for (size_t v = 1; v < vertexCount; ++v)
+  {
+    for (int k = 0; k < 3; ++k)
+    {
+      lower[k] = std::min(lower[k], mesh.positions[v * 3 + k]);
+      upper[k] = std::max(upper[k], mesh.positions[v * 3 + k]);
+    }
+  }
+  float radiusSquared = 0.0;
+  for (int k = 0; k < 3; ++k)
+    boundingSphere[k] = 0.5f * (lower[k] + upper[k]);
+  for (size_t v = 0; v < vertexCount; ++v)
+  {
+    float distanceSquared = 0.0;
+    for (int k = 0; k < 3; ++k)
+      distanceSquared += (mesh.positions[v * 3 + k] - boundingSphere[k]) * (mesh.positions[v * 3 + k] - boundingSphere[k]);
+    radiusSquared = std::max(radiusSquared, distanceSquared);
+  }
+  boundingSphere[3] = std::sqrt(radiusSquared);
+
+  // One level covering mesh.indices when no chain was given. Levels without their own
+  // indices (baked .mesh files) are ranges of mesh.indices.
+  const std::vector<uint32_t> &source = lods.indices.empty() ? mesh.indices : lods.indices;
+  levels = lods.levels;
+  if (levels.empty())
+    levels.push_back({0, static_cast<uint32_t>(mesh.indices.size()), 0.0f});
+
+  // uint16 when the vertex count or locality allows it, see IndexPacking.h
+  const PackedIndices indices = packIndices(source.data(), source.size(), vertexCount, levels);
+  Primitive::createIndexBuffer(indices);
+  if (!indexBuffer)
+    throw std::runtime_error("Index buffer failed to create");
+
+  createRenderPipelineState();
+
+  // More than one draw per level when a large mesh is split into uint16 windows
+  for (size_t level = 0; level < levels.size(); ++level)
+  {
+    std::vector<DrawRecord> records;
+    for (uint32_t d = indices.rangeDraws[level]; d < indices.rangeDraws[level + 1]; ++d)
+    {
+      const IndexDraw &range = indices.draws[d];
+      DrawRecord record = makeDrawRecord(DrawTopology::Triangle, range.indexCount);
+      record.start = range.byteOffset;     // Byte offset of this range
+      record.baseVertex = range.baseVertex; // Added to every index
+      record.indexFormat = range.format;
+      records.push_back(record);
+    }
+    addDrawLevel(records);
+  }
+}
+
+MeshPrimitive::~MeshPrimitive() = default;
+
+void MeshPrimitive::createDefaultBuffers()
+{
+  // Meshes are always supplied by the caller
+}
+
+/**
+ * @brief Picks the coarsest level whose error projects to no more than the pixel budget.
+ *
+ * @param viewProjection World to clip space, applied after the transform.
+ * @param viewportWidth Drawable width in pixels.
+ * @param viewportHeight Drawable height in pixels.
+ */
+void MeshPrimitive::updateLod(const Matrix4f &viewProjection, float viewportWidth, float viewportHeight)
+{
+  const Matrix4f matrix = viewProjection * expandAffine(transform.getAffine());
+  int32_t level = static_cast<int32_t>(levels.size()) - 1;
+  while (level > 0 &&
+         projectedRadiusPixels(matrix, levels[level].error, viewportWidth, viewportHeight) > maxScreenErrorPixels)
+    --level;
+  setCurrentLevel(level);
+}
+
+void MeshPrimitive::setMaxScreenError(float pixels)
+{
+  maxScreenErrorPixels = pixels;
+}
+
+void MeshPrimitive::setLodLevel(int32_t level)
+{
+  setCurrentLevel(std::min(level, static_cast<int32_t>(levels.size()) - 1));
+}
+
+int32_t MeshPrimitive::getLodLevel() const
+{
+  return currentLevel;
+}
+
+uint32_t MeshPrimitive::getTriangleCount() const
+{
+  return currentLevel == culledLevel ? 0 : levels[currentLevel].indexCount / 3;
+}
+
+const std::vector<MeshLod> &MeshPrimitive::getLevels() const
+{
+  return levels;
+}
+
+const std::array<float, 4> &MeshPrimitive::getBoundingSphere() const
+{
+  return boundingSphere;
+}
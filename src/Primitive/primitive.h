@@ -1,43 +1,108 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <iostream>
 #include <math.h>
 #include <cstdlib>
 
-#include <Metal/Metal.hpp>
+#include "../backend/GfxDevice.h"
 #include "../common/vec4.h"
 #include "../common/Transform.h"
+#include "../common/DestructionQueue.h"
+#include "../common/VertexLayout.h"
+#include "../common/VertexQuantization.h"
+#include "../common/Tessellation.h"
+#include "../common/SdfShapes.h"
+#include "../common/Mesh.h"
+#include "../common/IndexPacking.h"
+#include "../common/DrawList.h"
+#include "../common/LodSelection.h"
 
 
 class Primitive {
 public:
-    explicit Primitive(MTL::Device *device);
+    Primitive(GfxDevice *device, VertexLayout layout, VertexFormat format = VertexFormat::Float32);
 
     virtual ~Primitive() = 0; // Special case for each deallocation
 
-    void encodeRenderCommands(MTL::RenderCommandEncoder *encoder) const;
+    // Copies the current level's draw records, none when culled. See DrawList.h
+    void appendDraws(std::vector<DrawRecord> &records);
 
-    virtual void draw(MTL::RenderCommandEncoder *encoder) = 0;
+    // True if the current level, the transform (unless it's read from a transform slot) or
+    // draw constants changed since the last appendDraws(), a draw packet baked from the
+    // records is stale then
+    bool hasChangedDraws() const;
+
+    // Called once per frame before drawing, shapes with levels of detail pick one here. The
+    // view-projection is the pass's (world to clip space), applied after the transform
+    virtual void updateLod(const Matrix4f & /*viewProjection*/, float /*viewportWidth*/, float /*viewportHeight*/) {}
 
     Transform &getTransform();
 
+    // Replaces the transform's matrix, a different one bumps its version
+    void setTransform(const AffineMatrix &matrix);
+
+    // Draws read the transform from this slot of the pass's transform buffer (TransformBuffer)
+    // instead of sending it, noTransformSlot goes back to sending it
+    void setTransformSlot(uint32_t slot);
+
+    VertexLayout getVertexLayout() const;
+
+    VertexFormat getVertexFormat() const;
+
+    // Stream a position-only pass binds to buffer(0), see positionOnlyFunctionName()
+    GfxBuffer *getPositionStream() const;
+
+    // Hand GPU resources to the queue instead of releasing them while a frame may still use them
+    void retireResources(DestructionQueue &queue, uint64_t lastUsedFrame);
+
 protected:
-    MTL::Device *device{nullptr};
-    MTL::Buffer *vertexBuffer{nullptr};
-    MTL::Buffer *indexBuffer{nullptr};
-    MTL::Buffer *colorBuffer{nullptr};
-    MTL::RenderPipelineState *pipelineState{nullptr};
+    GfxDevice *device{nullptr};
+    GfxBuffer *vertexBuffer{nullptr};
+    GfxBuffer *indexBuffer{nullptr};
+    GfxBuffer *colorBuffer{nullptr};
+    GfxBuffer *positionBuffer{nullptr};   // Hybrid layout only
+    GfxPipeline *pipelineState{nullptr};  // Shared, owned by the device
+    IndexFormat indexFormat{IndexFormat::UInt16};   // Of indexBuffer, widest used if packed
 
     Transform transform;            // Each primitive 'has a' Transform obj
+    VertexLayout layout;
+    VertexFormat format;
+    QuantizationParams dequantization{};    // Sent to buffer(12) for quantized formats
+
+    // Compiled once the buffers and pipeline exist, level l is [levelRecords[l], levelRecords[l + 1])
+    std::vector<DrawRecord> drawRecords;
+    std::vector<uint32_t> levelRecords{0};
+    int32_t currentLevel{0};                // culledLevel draws nothing
+    uint32_t transformSlot{noTransformSlot};
+    bool drawsChanged{true};
 
     void createRenderPipelineState();
 
+    void createRenderPipelineState(const char *vertexName, const char *fragmentName, bool blending);
+
     void createVertexBuffer(const std::vector<float4> &vertices);
 
     void createColorBuffer(const std::vector<float4> &vertices);
 
     void createIndexBuffer(const std::vector<uint16_t> &indices);
 
+    void createIndexBuffer(const PackedIndices &indices);
+
+    // A single instance draw of this primitive's buffers, transform and dequantization.
+    // Throws std::runtime_error if the pipeline or vertex buffer is missing.
+    DrawRecord makeDrawRecord(DrawTopology topology, uint32_t count) const;
+
+    void addDrawLevel(const std::vector<DrawRecord> &records);
+
+    void setCurrentLevel(int32_t level);
+
+    // Builds vertexBuffer/colorBuffer/positionBuffer according to the layout
+    void createVertexStreams(const std::vector<float4> &positions, const std::vector<float4> &colors);
+
+    void createQuantizedStreams(const std::vector<float4> &positions, const std::vector<float4> &colors);
+
     virtual void createDefaultBuffers() = 0;
 };
 
@@ -46,12 +111,12 @@ protected:
 */
 class Triangle final : public Primitive {
 public:
-    explicit Triangle(MTL::Device *device);
-    Triangle(MTL::Device *device, const std::vector<float4> & vertices, const std::vector<float4> & color);
+    explicit Triangle(GfxDevice *device, VertexLayout layout = defaultVertexLayout(VertexUsage::Shading),
+                      VertexFormat format = VertexFormat::Float32);
+    Triangle(GfxDevice *device, const std::vector<float4> & vertices, const std::vector<float4> & color,
+             VertexLayout layout = defaultVertexLayout(VertexUsage::Shading), VertexFormat format = VertexFormat::Float32);
     ~Triangle() override;
 
-    void draw(MTL::RenderCommandEncoder *encoder) override;
-
 protected:
     void createDefaultBuffers() override;
 };
@@ -61,17 +126,15 @@ protected:
 */
 class Quad final : public Primitive {
 public:
-    explicit Quad(MTL::Device *device);
-    Quad(MTL::Device *device, const std::vector<float4> & vertices, const std::vector<float4> & color);
+    explicit Quad(GfxDevice *device, VertexLayout layout = defaultVertexLayout(VertexUsage::Shading),
+                  VertexFormat format = VertexFormat::Float32);
+    Quad(GfxDevice *device, const std::vector<float4> & vertices, const std::vector<float4> & color,
+         VertexLayout layout = defaultVertexLayout(VertexUsage::Shading), VertexFormat format = VertexFormat::Float32);
 
     ~Quad() override;
 
-    void draw(MTL::RenderCommandEncoder *encoder) override;
-
 private:
     void createDefaultBuffers() override;
-
-    MTL::Buffer *indexBuffer;
 };
 
 /*
@@ -80,16 +143,82 @@ private:
 
 class Circle final : public Primitive {
 public:
-    explicit Circle(MTL::Device *device);
+    explicit Circle(GfxDevice *device, VertexLayout layout = defaultVertexLayout(VertexUsage::Shading),
+                    VertexFormat format = VertexFormat::Float32);
 
     ~Circle() override;
 
-    void draw(MTL::RenderCommandEncoder *encoder) override;
+    void updateLod(const Matrix4f &viewProjection, float viewportWidth, float viewportHeight) override;
+
+    void setMaxChordError(float pixels);
+
+    uint32_t getSegmentCount() const;
 
 private:
     // Members
     float radius{0.5};
 
+    // Levels of detail - every power of two from min to max segments, baked into one index buffer
+    static constexpr uint32_t minSegments{4};
+    static constexpr uint32_t maxSegments{256};
+    float maxChordErrorPixels{0.5};
+    std::vector<TessellationLevel> levels;
+
     // Methods
     void createDefaultBuffers() override;
 };
+
+/*
+ *    SHAPE BATCH - circles, rings, rounded rects and capsules as SDF quads
+ */
+
+class ShapeBatch final : public Primitive {
+public:
+    ShapeBatch(GfxDevice *device, const std::vector<SdfInstance> &instances);
+
+    ~ShapeBatch() override;
+
+    void updateLod(const Matrix4f &viewProjection, float viewportWidth, float viewportHeight) override;
+
+private:
+    uint32_t instanceCount{0};
+    float pixelPadding{0.0};        // One pixel in object units
+
+    void createDefaultBuffers() override;
+};
+
+/*
+ *    MESH PRIMITIVE - an indexed Mesh, with levels of detail as alternate index ranges
+ */
+
+class MeshPrimitive final : public Primitive {
+public:
+    MeshPrimitive(GfxDevice *device, const Mesh &mesh, const LodChain &lods = {},
+                  VertexLayout layout = defaultVertexLayout(VertexUsage::Shading),
+                  VertexFormat format = VertexFormat::Float32);
+
+    ~MeshPrimitive() override;
+
+    void updateLod(const Matrix4f &viewProjection, float viewportWidth, float viewportHeight) override;
+
+    void setMaxScreenError(float pixels);
+
+    // Set by the renderer's batched LodSelector instead of updateLod(), culledLevel skips drawing
+    void setLodLevel(int32_t level);
+
+    int32_t getLodLevel() const;
+
+    uint32_t getTriangleCount() const;
+
+    const std::vector<MeshLod> &getLevels() const;
+
+    // Object space bounding sphere, xyz center and radius
+    const std::array<float, 4> &getBoundingSphere() const;
+
+private:
+    std::vector<MeshLod> levels;    // Level 0 is full detail, ranges are the source mesh's
+    float maxScreenErrorPixels{1.0};
+    std::array<float, 4> boundingSphere{};
+
+    void createDefaultBuffers() override;
+};
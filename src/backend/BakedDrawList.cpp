@@ -0,0 +1,84 @@
+#include "BakedDrawList.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+constexpr size_t constantsAlignment = 16;
+
+/*
+    Rejects what would otherwise only fail, or read out of bounds, once the packet runs
+*/
+void validateRecord(const DrawRecord &record, size_t index) {
+    const std::string which = "Draw record " + std::to_string(index);
+    if (!record.pipeline)
+        throw std::runtime_error(which + " has no pipeline");
+    if (!record.vertexBuffer)
+        throw std::runtime_error(which + " has no vertex buffer");
+    if (!record.transform && record.transformSlot == noTransformSlot)
+        throw std::runtime_error(which + " has no transform");
+    if (record.constants && record.constantsSize == 0)
+        throw std::runtime_error(which + " has empty constants");
+    if (record.indexBuffer) {
+        const uint64_t end = uint64_t(record.start) + uint64_t(record.count) * indexSize(record.indexFormat);
+        if (end > static_cast<const GfxBuffer *>(record.indexBuffer)->getSize())
+            throw std::runtime_error(which + " reads past the end of its index buffer");
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Checks every record and copies it with the transform and constants it points to.
+ *
+ * @throws std::runtime_error For a record missing its pipeline, vertex buffer or transform, or drawing past the end of
+ *         its index buffer.
+ */
+BakedDrawList::BakedDrawList(const DrawRecord *records, size_t count) : records(records, records + count) {
+    // Copy first, the pointers are set once the vectors stop growing
+    std::vector<size_t> transformOf(count);
+    std::vector<size_t> constantsOf(count, SIZE_MAX);
+    const float *transform = nullptr;
+    const void *constant = nullptr;
+    size_t constantsOffset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const DrawRecord &record = records[i];
+        validateRecord(record, i);
+
+        if (record.transformSlot != noTransformSlot)
+            transformOf[i] = SIZE_MAX;
+        else {
+            if (record.transform != transform) {
+                transform = record.transform;
+                std::memcpy(transforms.emplace_back().data(), transform, transformSlotSize);
+            }
+            transformOf[i] = transforms.size() - 1;
+        }
+
+        if (record.constants) {
+            if (record.constants != constant) {
+                constant = record.constants;
+                constantsOffset = (constants.size() + constantsAlignment - 1) & ~(constantsAlignment - 1);
+                constants.resize(constantsOffset + record.constantsSize);
+                std::memcpy(constants.data() + constantsOffset, constant, record.constantsSize);
+            }
+            constantsOf[i] = constantsOffset;
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        this->records[i].transform = transformOf[i] != SIZE_MAX ? transforms[transformOf[i]].data() : nullptr;
+        if (constantsOf[i] != SIZE_MAX)
+            this->records[i].constants = constants.data() + constantsOf[i];
+    }
+}
+
+const DrawRecord *BakedDrawList::data() const {
+    return records.data();
+}
+
+size_t BakedDrawList::size() const {
+    return records.size();
+}
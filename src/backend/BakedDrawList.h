@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "GfxDevice.h"
+
+/*
+-------------------------------------------------------------------
+  BAKED DRAW LIST  --------------------------------------------------
+
+  The portable half of a GfxDrawPacket: draw records checked once and frozen with their own
+  copies of the transforms and constants they point to, so later changes to the objects don't
+  reach the packet. Records that shared a transform or constants still share the copy, binds
+  are skipped in the same places submitDrawList() skipped them for the originals. Records with
+  a transform slot keep it, their transform is whatever the slot holds when the packet runs.
+-------------------------------------------------------------------
+*/
+
+class BakedDrawList final {
+public:
+    // Throws std::runtime_error as GfxDevice::newDrawPacket() does
+    BakedDrawList(const DrawRecord *records, size_t count);
+
+    // The records point into this object
+    BakedDrawList(const BakedDrawList &) = delete;
+    BakedDrawList &operator=(const BakedDrawList &) = delete;
+
+    const DrawRecord *data() const;
+
+    size_t size() const;
+
+private:
+    std::vector<DrawRecord> records;
+    std::vector<std::array<float, 12>> transforms;
+    std::vector<uint8_t> constants;     // Each copy 16 byte aligned
+};
@@ -0,0 +1,509 @@
+#include "CaptureDevice.h"
+
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "../common/MappedFile.h"
+
+namespace {
+
+constexpr char captureMagic[6] = {'G', 'F', 'X', 'C', 'A', 'P'};
+constexpr uint16_t captureVersion = 4;
+constexpr size_t payloadAlignment = 16;     // Matrices in the payload are used in place by replays
+
+static_assert(std::endian::native == std::endian::little, "Captures are written in host byte order");
+
+template <typename T>
+void writeValue(std::ofstream &file, const T &value) {
+    file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+void writeString(std::ofstream &file, const std::string &text) {
+    if (text.size() > UINT16_MAX)
+        throw std::runtime_error("Shader function name too long to capture: " + text);
+    writeValue(file, static_cast<uint16_t>(text.size()));
+    file.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+// Reads a mapped capture front to back, throwing once it runs past the end
+class Reader {
+public:
+    Reader(const MappedFile &file, const std::string &fileName)
+        : data(file.data()), size(file.size()), fileName(fileName) {}
+
+    const char *take(uint64_t bytes) {
+        if (bytes > size - offset)
+            throw std::runtime_error("Truncated capture: " + fileName);
+        const char *at = data + offset;
+        offset += static_cast<size_t>(bytes);
+        return at;
+    }
+
+    template <typename T>
+    T value() {
+        T result;
+        std::memcpy(&result, take(sizeof(T)), sizeof(T));
+        return result;
+    }
+
+    std::string string() {
+        const uint16_t length = value<uint16_t>();
+        return std::string(take(length), length);
+    }
+
+    // Guards a count read from the file against allocating more than the file could hold
+    uint64_t count(uint64_t elementBytes) {
+        const uint64_t elements = value<uint64_t>();
+        if (elements > (size - offset) / elementBytes)
+            throw std::runtime_error("Corrupt capture: " + fileName);
+        return elements;
+    }
+
+    size_t remaining() const {
+        return size - offset;
+    }
+
+private:
+    const char *data;
+    size_t size;
+    size_t offset{0};
+    const std::string &fileName;
+};
+
+// Buffer offsets are captured in 32 bits
+uint32_t captureOffset(size_t offset) {
+    if (offset > UINT32_MAX)
+        throw std::runtime_error("Buffer offset too large to capture: " + std::to_string(offset));
+    return static_cast<uint32_t>(offset);
+}
+
+} // namespace
+
+uint64_t hashBytes(const void *bytes, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    const uint8_t *data = static_cast<const uint8_t *>(bytes);
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    return hash;
+}
+
+/**
+ * @throws std::runtime_error If the file can't be written.
+ */
+void GfxCapture::save(const std::string &fileName) const {
+    std::ofstream file(fileName, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to write capture: " + fileName);
+
+    file.write(captureMagic, sizeof(captureMagic));
+    writeValue(file, captureVersion);
+    writeValue(file, width);
+    writeValue(file, height);
+    writeValue(file, frames);
+    writeValue(file, static_cast<uint32_t>(pipelines.size()));
+    writeValue(file, static_cast<uint32_t>(buffers.size()));
+    writeValue(file, static_cast<uint64_t>(commands.size()));
+    writeValue(file, static_cast<uint64_t>(payload.size()));
+
+    for (const GfxPipelineDesc &pipeline : pipelines) {
+        writeValue(file, static_cast<uint8_t>(pipeline.blending));
+        writeString(file, pipeline.vertexFunction);
+        writeString(file, pipeline.fragmentFunction);
+    }
+    for (const CapturedBuffer &buffer : buffers) {
+        writeValue(file, buffer.size);
+        writeValue(file, buffer.hash);
+        writeValue(file, static_cast<uint8_t>(!buffer.contents.empty()));
+        file.write(reinterpret_cast<const char *>(buffer.contents.data()),
+                   static_cast<std::streamsize>(buffer.contents.size()));
+    }
+    file.write(reinterpret_cast<const char *>(commands.data()),
+               static_cast<std::streamsize>(commands.size() * sizeof(CapturedCommand)));
+    file.write(reinterpret_cast<const char *>(payload.data()), static_cast<std::streamsize>(payload.size()));
+    if (!file)
+        throw std::runtime_error("Failed to write capture: " + fileName);
+}
+
+/**
+ * @brief Reads a capture saved by save(), commands are checked by CaptureReplayer.
+ *
+ * @throws std::runtime_error If the file is missing, not a capture of this version, or truncated.
+ */
+GfxCapture GfxCapture::load(const std::string &fileName) {
+    MappedFile file(fileName);
+    Reader reader(file, fileName);
+    if (file.size() < sizeof(captureMagic) || std::memcmp(reader.take(sizeof(captureMagic)), captureMagic,
+                                                          sizeof(captureMagic)) != 0)
+        throw std::runtime_error("Not a capture: " + fileName);
+    const uint16_t version = reader.value<uint16_t>();
+    if (version != captureVersion)
+        throw std::runtime_error(fileName + " is capture version " + std::to_string(version) + ", expected " +
+                                 std::to_string(captureVersion));
+
+    GfxCapture capture;
+    capture.width = reader.value<uint32_t>();
+    capture.height = reader.value<uint32_t>();
+    capture.frames = reader.value<uint32_t>();
+    const uint32_t pipelineCount = reader.value<uint32_t>();
+    const uint32_t bufferCount = reader.value<uint32_t>();
+    const uint64_t commandCount = reader.count(sizeof(CapturedCommand));
+    const uint64_t payloadSize = reader.value<uint64_t>();
+    if (pipelineCount > reader.remaining() / 5 || bufferCount > reader.remaining() / 17)
+        throw std::runtime_error("Corrupt capture: " + fileName);
+
+    capture.pipelines.resize(pipelineCount);
+    for (GfxPipelineDesc &pipeline : capture.pipelines) {
+        pipeline.blending = reader.value<uint8_t>() != 0;
+        pipeline.vertexFunction = reader.string();
+        pipeline.fragmentFunction = reader.string();
+    }
+    capture.buffers.resize(bufferCount);
+    for (CapturedBuffer &buffer : capture.buffers) {
+        buffer.size = reader.value<uint64_t>();
+        buffer.hash = reader.value<uint64_t>();
+        if (reader.value<uint8_t>()) {
+            const char *contents = reader.take(buffer.size);
+            buffer.contents.assign(contents, contents + buffer.size);
+        }
+    }
+    capture.commands.resize(commandCount);
+    std::memcpy(capture.commands.data(), reader.take(commandCount * sizeof(CapturedCommand)),
+                commandCount * sizeof(CapturedCommand));
+    const char *payload = reader.take(payloadSize);
+    capture.payload.assign(payload, payload + payloadSize);
+    return capture;
+}
+
+/*
+    BUFFER, PIPELINE
+*/
+CaptureBuffer::CaptureBuffer(CaptureDevice &device, GfxBuffer *buffer, const void *bytes, size_t size,
+                             bool keepContents)
+    : device(device), buffer(buffer), captured{size, bytes ? hashBytes(bytes, size) : 0, {}} {
+    if (keepContents && bytes)
+        captured.contents.assign(static_cast<const uint8_t *>(bytes), static_cast<const uint8_t *>(bytes) + size);
+}
+
+CaptureBuffer::~CaptureBuffer() {
+    delete buffer;
+}
+
+size_t CaptureBuffer::getSize() const {
+    return buffer->getSize();
+}
+
+void *CaptureBuffer::map() {
+    return buffer->map();
+}
+
+/**
+ * @throws std::runtime_error For offsets past 4 GB while capturing.
+ */
+void CaptureBuffer::didModifyRange(size_t offset, size_t size) {
+    buffer->didModifyRange(offset, size);
+    modified = true;
+    if (device.recording) {
+        const uint32_t index = device.captureBuffer(static_cast<const GfxBuffer *>(this));
+        const uint64_t payloadOffset = device.appendPayload(static_cast<const uint8_t *>(map()) + offset, size);
+        CapturedCommand &command = device.record(GfxCommandType::UpdateBuffer);
+        command.object = index;
+        command.start = captureOffset(offset);
+        command.bytes = static_cast<uint32_t>(size);
+        command.payloadOffset = payloadOffset;
+    }
+}
+
+const GfxBuffer *CaptureBuffer::getBuffer() const {
+    return buffer;
+}
+
+CapturePipeline::CapturePipeline(GfxPipeline *pipeline, const GfxPipelineDesc &desc) : pipeline(pipeline), desc(desc) {}
+
+CapturePipeline::~CapturePipeline() {
+    delete pipeline;
+}
+
+const GfxPipeline *CapturePipeline::getPipeline() const {
+    return pipeline;
+}
+
+CaptureDrawPacket::CaptureDrawPacket(const DrawRecord *records, size_t count) : draws(records, count) {}
+
+CaptureDrawPacket::~CaptureDrawPacket() {
+    delete packet;
+}
+
+size_t CaptureDrawPacket::getDrawCount() const {
+    return draws.size();
+}
+
+/*
+    ENCODER
+*/
+namespace {
+
+const void *unwrapPipeline(const void *pipeline) {
+    return static_cast<const GfxPipeline *>(
+        static_cast<const CapturePipeline *>(static_cast<const GfxPipeline *>(pipeline))->getPipeline());
+}
+
+const void *unwrapBuffer(const void *buffer) {
+    if (!buffer)
+        return nullptr;
+    return static_cast<const GfxBuffer *>(
+        static_cast<const CaptureBuffer *>(static_cast<const GfxBuffer *>(buffer))->getBuffer());
+}
+
+} // namespace
+
+CaptureEncoder::CaptureEncoder(CaptureDevice &device) : device(device) {}
+
+void CaptureEncoder::setPipeline(const void *pipeline) {
+    encoder->setPipeline(unwrapPipeline(pipeline));
+    if (device.recording)
+        device.record(GfxCommandType::SetPipeline).object = device.capturePipeline(pipeline);
+}
+
+void CaptureEncoder::setVertexBuffer(const void *buffer, uint32_t index) {
+    encoder->setVertexBuffer(unwrapBuffer(buffer), index);
+    if (device.recording) {
+        CapturedCommand &command = device.record(GfxCommandType::SetVertexBuffer);
+        command.object = device.captureBuffer(buffer);
+        command.index = index;
+    }
+}
+
+void CaptureEncoder::setVertexBufferOffset(size_t offset, uint32_t index) {
+    encoder->setVertexBufferOffset(offset, index);
+    if (device.recording) {
+        CapturedCommand &command = device.record(GfxCommandType::SetVertexBufferOffset);
+        command.index = index;
+        command.start = captureOffset(offset);
+    }
+}
+
+void CaptureEncoder::setVertexBytes(const void *bytes, size_t size, uint32_t index) {
+    encoder->setVertexBytes(bytes, size, index);
+    if (device.recording) {
+        const uint64_t offset = device.appendPayload(bytes, size);
+        CapturedCommand &command = device.record(GfxCommandType::SetVertexBytes);
+        command.index = index;
+        command.bytes = static_cast<uint32_t>(size);
+        command.payloadOffset = offset;
+    }
+}
+
+void CaptureEncoder::draw(const DrawRecord &record) {
+    encoder->draw(unwrap(record));
+    if (device.recording)
+        recordDraw(GfxCommandType::Draw, record);
+}
+
+void CaptureEncoder::drawIndexed(const DrawRecord &record) {
+    encoder->drawIndexed(unwrap(record));
+    if (device.recording)
+        recordDraw(GfxCommandType::DrawIndexed, record);
+}
+
+/**
+ * @brief Runs the draw list through this encoder, so every bind and draw is forwarded and recorded.
+ *
+ * The first command recorded is marked as the start of a submit, a replay submits the same
+ * draws together so it skips the same repeated binds.
+ */
+void CaptureEncoder::submit(const DrawRecord *records, size_t count) {
+    const size_t first = device.capture.commands.size();
+    submitDrawList(records, count, *this);
+    if (device.recording && first < device.capture.commands.size())
+        device.capture.commands[first].submitStart = 1;
+}
+
+/**
+ * @brief Runs the wrapped packet, or while capturing submits its frozen records so every command is recorded.
+ */
+void CaptureEncoder::execute(const GfxDrawPacket *packet) {
+    const CaptureDrawPacket *capture = static_cast<const CaptureDrawPacket *>(packet);
+    if (device.recording)
+        submit(capture->draws.data(), capture->draws.size());
+    else
+        encoder->execute(capture->packet);
+}
+
+void CaptureEncoder::endEncoding() {
+    encoder->endEncoding();
+    encoder = nullptr;
+    if (device.recording)
+        device.record(GfxCommandType::EndPass);
+}
+
+// The record with the wrapped device's objects, for backends that read them from the record
+DrawRecord CaptureEncoder::unwrap(const DrawRecord &record) const {
+    DrawRecord unwrapped = record;
+    unwrapped.pipeline = unwrapPipeline(record.pipeline);
+    unwrapped.vertexBuffer = unwrapBuffer(record.vertexBuffer);
+    unwrapped.colorBuffer = unwrapBuffer(record.colorBuffer);
+    unwrapped.indexBuffer = unwrapBuffer(record.indexBuffer);
+    return unwrapped;
+}
+
+void CaptureEncoder::recordDraw(GfxCommandType type, const DrawRecord &record) {
+    const uint32_t indexBuffer = type == GfxCommandType::DrawIndexed ? device.captureBuffer(record.indexBuffer) : 0;
+    CapturedCommand &command = device.record(type);
+    command.object = indexBuffer;
+    command.indexFormat = static_cast<uint8_t>(record.indexFormat);
+    command.topology = static_cast<uint8_t>(record.topology);
+    command.start = record.start;
+    command.count = record.count;
+    command.instanceCount = record.instanceCount;
+    command.baseVertex = record.baseVertex;
+}
+
+/*
+    DEVICE
+*/
+CaptureDevice::CaptureDevice(GfxDevice &device, bool keepContents)
+    : device(device), keepContents(keepContents), encoder(*this) {}
+
+const char *CaptureDevice::getName() const {
+    return device.getName();
+}
+
+GfxBuffer *CaptureDevice::newBuffer(const void *bytes, size_t size) {
+    GfxBuffer *buffer = device.newBuffer(bytes, size);
+    try {
+        return new CaptureBuffer(*this, buffer, bytes, size, keepContents);
+    }
+    catch (...) {
+        delete buffer;
+        throw;
+    }
+}
+
+GfxPipeline *CaptureDevice::newPipeline(const GfxPipelineDesc &desc) {
+    GfxPipeline *pipeline = device.newPipeline(desc);
+    try {
+        return new CapturePipeline(pipeline, desc);
+    }
+    catch (...) {
+        delete pipeline;
+        throw;
+    }
+}
+
+/**
+ * @throws std::runtime_error For invalid records, see GfxDevice::newDrawPacket().
+ */
+GfxDrawPacket *CaptureDevice::newDrawPacket(const DrawRecord *records, size_t count) {
+    CaptureDrawPacket *packet = new CaptureDrawPacket(records, count);     // Checks the records
+    try {
+        std::vector<DrawRecord> unwrapped(records, records + count);
+        for (DrawRecord &record : unwrapped)
+            record = encoder.unwrap(record);
+        packet->packet = device.newDrawPacket(unwrapped.data(), unwrapped.size());
+        return packet;
+    }
+    catch (...) {
+        delete packet;
+        throw;
+    }
+}
+
+GfxDrawable *CaptureDevice::beginFrame() {
+    GfxDrawable *drawable = device.beginFrame();
+    recording = drawable && framesLeft > 0;
+    if (recording) {
+        if (capture.frames++ == 0) {
+            capture.width = drawable->getWidth();
+            capture.height = drawable->getHeight();
+        }
+        record(GfxCommandType::BeginFrame);
+    }
+    return drawable;
+}
+
+GfxEncoder *CaptureDevice::beginPass(const std::array<double, 4> &clearColor) {
+    encoder.encoder = device.beginPass(clearColor);
+    if (recording) {
+        const uint64_t offset = appendPayload(clearColor.data(), sizeof(clearColor));
+        record(GfxCommandType::BeginPass).payloadOffset = offset;
+    }
+    return &encoder;
+}
+
+void CaptureDevice::endFrame(std::function<void()> completed) {
+    device.endFrame(std::move(completed));
+    if (recording) {
+        record(GfxCommandType::EndFrame);
+        recording = false;
+        --framesLeft;
+    }
+}
+
+void CaptureDevice::waitIdle() {
+    device.waitIdle();
+}
+
+void CaptureDevice::startCapture(uint32_t frames) {
+    capture = {};
+    ++captureId;
+    framesLeft = frames;
+}
+
+bool CaptureDevice::isCapturing() const {
+    return framesLeft > 0;
+}
+
+const GfxCapture &CaptureDevice::getCapture() const {
+    return capture;
+}
+
+GfxDevice &CaptureDevice::getDevice() {
+    return device;
+}
+
+CapturedCommand &CaptureDevice::record(GfxCommandType type) {
+    CapturedCommand &command = capture.commands.emplace_back();
+    command = {};
+    command.type = type;
+    return command;
+}
+
+uint64_t CaptureDevice::appendPayload(const void *bytes, size_t size) {
+    const size_t offset = (capture.payload.size() + payloadAlignment - 1) & ~(payloadAlignment - 1);
+    capture.payload.resize(offset + size);
+    std::memcpy(capture.payload.data() + offset, bytes, size);
+    return offset;
+}
+
+// The buffer's index in this capture, added the first time it's used. Buffers written through map() are added with
+// what they hold now
+uint32_t CaptureDevice::captureBuffer(const void *buffer) {
+    CaptureBuffer *captured = const_cast<CaptureBuffer *>(
+        static_cast<const CaptureBuffer *>(static_cast<const GfxBuffer *>(buffer)));
+    if (captured->captureId != captureId) {
+        captured->captureId = captureId;
+        captured->captureIndex = static_cast<uint32_t>(capture.buffers.size());
+        if (captured->modified) {
+            const uint8_t *contents = static_cast<const uint8_t *>(captured->map());
+            captured->captured.hash = hashBytes(contents, captured->captured.size);
+            if (keepContents)
+                captured->captured.contents.assign(contents, contents + captured->captured.size);
+            captured->modified = false;
+        }
+        capture.buffers.push_back(captured->captured);
+    }
+    return captured->captureIndex;
+}
+
+uint32_t CaptureDevice::capturePipeline(const void *pipeline) {
+    CapturePipeline *captured = const_cast<CapturePipeline *>(
+        static_cast<const CapturePipeline *>(static_cast<const GfxPipeline *>(pipeline)));
+    if (captured->captureId != captureId) {
+        captured->captureId = captureId;
+        captured->captureIndex = static_cast<uint32_t>(capture.pipelines.size());
+        capture.pipelines.push_back(captured->desc);
+    }
+    return captured->captureIndex;
+}
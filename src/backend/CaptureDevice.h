@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "BakedDrawList.h"
+#include "GfxDevice.h"
+#include "RecordingDevice.h"
+
+/*
+-------------------------------------------------------------------
+  COMMAND CAPTURE  --------------------------------------------------
+
+  CaptureDevice wraps another device and forwards every call to it. After startCapture(n) it
+  also records the next n frames' submissions into a GfxCapture: pipeline and buffer binds,
+  the bytes set with setVertexBytes() (the matrices sent to buffer(11)), offsets moved with
+  setVertexBufferOffset() (slots of a transform buffer), the bytes written to mapped buffers,
+  and every draw with its index range, together with the pipelines and buffers those frames
+  use. Captures save to a compact binary file and replay headless with CaptureReplayer
+  (CaptureReplayer.h), a scene independent benchmark of submission cost (tools/replay.cpp).
+
+  Buffers are captured with their contents, or with keepContents off only their size and a
+  hash, replays then draw zero filled buffers of the same size (enough to time submission,
+  not to render). Contents are copied when a buffer is created, or for a buffer written
+  through map() when a capture first uses it, wrapped objects are freed with their copies.
+  Draw packets executed while capturing are recorded as the binds and draws they hold. Each
+  submit() and packet marks its first command, replays submit the same draws together.
+
+  File, little endian:
+
+    "GFXCAP", uint16 version (4)
+    uint32 width, height, frames, pipelines, buffers, uint64 commands, payload bytes
+    pipelines   uint8 blending, vertex and fragment function names (uint16 length, chars)
+    buffers     uint64 size, uint64 hash, uint8 has contents, the contents
+    commands    CapturedCommand each
+    payload     setVertexBytes() and buffer update bytes and clear colors, each 16 byte aligned
+-------------------------------------------------------------------
+*/
+
+/**
+ * @brief One captured call, objects are indices into GfxCapture's tables.
+ */
+struct CapturedCommand {
+    GfxCommandType type;        // BeginFrame to EndFrame, never NewBuffer or NewPipeline
+    uint8_t indexFormat;        // Draws, IndexFormat
+    uint8_t topology;           // Draws, DrawTopology
+    uint8_t submitStart;        // 1 on the first command of each submit() or executed packet
+    uint32_t index;             // Buffer index of SetVertexBuffer(Offset) and SetVertexBytes
+    uint32_t object;            // Pipeline or buffer bound or updated, the index buffer of DrawIndexed
+    uint32_t start;             // Draws, as in DrawRecord, the byte offset of SetVertexBufferOffset and UpdateBuffer
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t baseVertex;
+    uint32_t bytes;             // SetVertexBytes and UpdateBuffer size
+    uint64_t payloadOffset;     // SetVertexBytes and UpdateBuffer bytes, BeginPass clear color (4 doubles)
+};
+
+static_assert(std::is_trivially_copyable_v<CapturedCommand> && sizeof(CapturedCommand) == 40,
+              "Captured commands are written as plain bytes");
+
+struct CapturedBuffer {
+    uint64_t size;
+    uint64_t hash;                  // hashBytes() of the contents at creation, or when first captured once mapped
+    std::vector<uint8_t> contents;  // Empty unless contents were kept
+};
+
+struct GfxCapture {
+    uint32_t width{0};              // Of the first captured frame's drawable
+    uint32_t height{0};
+    uint32_t frames{0};
+    std::vector<GfxPipelineDesc> pipelines;
+    std::vector<CapturedBuffer> buffers;
+    std::vector<CapturedCommand> commands;
+    std::vector<uint8_t> payload;
+
+    // Both throw std::runtime_error on I/O errors, load() also for files that aren't captures
+    void save(const std::string &fileName) const;
+
+    static GfxCapture load(const std::string &fileName);
+};
+
+// 64 bit FNV-1a
+uint64_t hashBytes(const void *bytes, size_t size);
+
+class CaptureDevice;
+
+class CaptureBuffer final : public GfxBuffer {
+public:
+    CaptureBuffer(CaptureDevice &device, GfxBuffer *buffer, const void *bytes, size_t size, bool keepContents);
+    ~CaptureBuffer() override;
+
+    size_t getSize() const override;
+
+    void *map() override;
+
+    // Forwarded, and recorded with the bytes written while capturing
+    void didModifyRange(size_t offset, size_t size) override;
+
+    const GfxBuffer *getBuffer() const;
+
+private:
+    friend class CaptureDevice;
+
+    CaptureDevice &device;
+    GfxBuffer *buffer;              // Owned, the wrapped device's
+    CapturedBuffer captured;
+    bool modified{false};           // Written through map(), captured is stale
+    uint64_t captureId{0};          // Capture this buffer was added to, and where
+    uint32_t captureIndex{0};
+};
+
+class CapturePipeline final : public GfxPipeline {
+public:
+    CapturePipeline(GfxPipeline *pipeline, const GfxPipelineDesc &desc);
+    ~CapturePipeline() override;
+
+    const GfxPipeline *getPipeline() const;
+
+private:
+    friend class CaptureDevice;
+
+    GfxPipeline *pipeline;          // Owned, the wrapped device's
+    GfxPipelineDesc desc;
+    uint64_t captureId{0};
+    uint32_t captureIndex{0};
+};
+
+// The wrapped device's packet, and the records to capture when it runs during a capture
+class CaptureDrawPacket final : public GfxDrawPacket {
+public:
+    CaptureDrawPacket(const DrawRecord *records, size_t count);
+    ~CaptureDrawPacket() override;
+
+    size_t getDrawCount() const override;
+
+private:
+    friend class CaptureDevice;
+    friend class CaptureEncoder;
+
+    GfxDrawPacket *packet{nullptr}; // Owned, the wrapped device's
+    BakedDrawList draws;            // With this device's objects
+};
+
+// Forwards to the wrapped device's encoder with its objects, recording while capturing
+class CaptureEncoder final : public GfxEncoder {
+public:
+    explicit CaptureEncoder(CaptureDevice &device);
+
+    void setPipeline(const void *pipeline) override;
+
+    void setVertexBuffer(const void *buffer, uint32_t index) override;
+
+    // Throws std::runtime_error for offsets past 4 GB while capturing
+    void setVertexBufferOffset(size_t offset, uint32_t index) override;
+
+    void setVertexBytes(const void *bytes, size_t size, uint32_t index) override;
+
+    void draw(const DrawRecord &record) override;
+
+    void drawIndexed(const DrawRecord &record) override;
+
+    void submit(const DrawRecord *records, size_t count) override;
+
+    void execute(const GfxDrawPacket *packet) override;
+
+    void endEncoding() override;
+
+private:
+    friend class CaptureDevice;
+
+    CaptureDevice &device;
+    GfxEncoder *encoder{nullptr};   // The wrapped device's, for the current pass
+
+    DrawRecord unwrap(const DrawRecord &record) const;
+    void recordDraw(GfxCommandType type, const DrawRecord &record);
+};
+
+class CaptureDevice final : public GfxDevice {
+public:
+    explicit CaptureDevice(GfxDevice &device, bool keepContents = true);
+
+    CaptureDevice(const CaptureDevice &) = delete;
+    CaptureDevice &operator=(const CaptureDevice &) = delete;
+
+    const char *getName() const override;
+
+    GfxBuffer *newBuffer(const void *bytes, size_t size) override;
+
+    GfxPipeline *newPipeline(const GfxPipelineDesc &desc) override;
+
+    GfxDrawPacket *newDrawPacket(const DrawRecord *records, size_t count) override;
+
+    GfxDrawable *beginFrame() override;
+
+    GfxEncoder *beginPass(const std::array<double, 4> &clearColor) override;
+
+    void endFrame(std::function<void()> completed) override;
+
+    void waitIdle() override;
+
+    // Drops the last capture and captures the next frames that have a drawable
+    void startCapture(uint32_t frames);
+
+    // True until every frame asked for has ended
+    bool isCapturing() const;
+
+    const GfxCapture &getCapture() const;
+
+    GfxDevice &getDevice();
+
+private:
+    friend class CaptureBuffer;
+    friend class CaptureEncoder;
+
+    GfxDevice &device;
+    bool keepContents;
+    CaptureEncoder encoder;
+    GfxCapture capture;
+    uint64_t captureId{0};          // Objects remember the capture they were added to
+    uint32_t framesLeft{0};
+    bool recording{false};          // Inside a captured frame
+
+    CapturedCommand &record(GfxCommandType type);
+    uint64_t appendPayload(const void *bytes, size_t size);
+    uint32_t captureBuffer(const void *buffer);
+    uint32_t capturePipeline(const void *pipeline);
+};
@@ -0,0 +1,246 @@
+#include "CaptureReplayer.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+void check(bool valid, size_t command, const char *problem) {
+    if (!valid)
+        throw std::runtime_error("Capture command " + std::to_string(command) + ": " + problem);
+}
+
+} // namespace
+
+/**
+ * @brief Creates the capture's objects on @p device and rebuilds its draw lists.
+ *
+ * Every draw gets the pipeline, buffers and bytes bound before it, or the slot of the pass's
+ * transform buffer. Draws are split where the capture marks a new submit, whose first draw had
+ * everything it uses bound again. Buffers without captured contents are created zero filled.
+ *
+ * @throws std::runtime_error If a command refers to a missing object or bytes, a draw reads past
+ *         its index buffer, an update or transform slot lies outside its buffer, a pass binds two
+ *         transform buffers or view-projections, kept contents don't match their hash, or the
+ *         device rejects a pipeline.
+ */
+CaptureReplayer::CaptureReplayer(const GfxCapture &capture, GfxDevice &device)
+    : device(device), payload(capture.payload) {
+    try {
+        for (const GfxPipelineDesc &desc : capture.pipelines)
+            pipelines.push_back(device.newPipeline(desc));
+        std::vector<uint8_t> zeros;
+        for (const CapturedBuffer &buffer : capture.buffers) {
+            const void *bytes = buffer.contents.data();
+            if (buffer.contents.empty()) {
+                zeros.assign(buffer.size, 0);
+                bytes = zeros.data();
+            }
+            else if (buffer.contents.size() != buffer.size || hashBytes(bytes, buffer.contents.size()) != buffer.hash)
+                throw std::runtime_error("Capture buffer " + std::to_string(buffers.size()) + " doesn't match its hash");
+            buffers.push_back(device.newBuffer(bytes, buffer.size));
+        }
+
+        // Bound state, as the encoder sees it since the current submit began
+        DrawRecord state{};
+        uint32_t transformBuffer = UINT32_MAX;      // Capture buffer bound at buffer(11)
+        size_t submitFirst = 0;                     // The current submit's first record
+        bool inFrame = false, inPass = false;
+        for (size_t i = 0; i < capture.commands.size(); ++i) {
+            const CapturedCommand &command = capture.commands[i];
+            if (command.submitStart) {
+                check(inPass, i, "submit outside a pass");
+                if (records.size() > submitFirst)
+                    submitEnds.push_back(records.size());
+                submitFirst = records.size();
+                state = {};
+            }
+            switch (command.type) {
+                case GfxCommandType::BeginFrame:
+                    check(!inFrame, i, "frame begins twice");
+                    inFrame = true;
+                    break;
+                case GfxCommandType::UpdateBuffer:
+                    check(inFrame && command.object < buffers.size(), i, "unknown buffer updated");
+                    check(uint64_t(command.start) + command.bytes <= capture.buffers[command.object].size, i,
+                          "update past the end of its buffer");
+                    check(command.payloadOffset <= payload.size() &&
+                              command.bytes <= payload.size() - command.payloadOffset, i, "bytes out of range");
+                    updates.push_back({buffers[command.object], command.start, command.bytes,
+                                       static_cast<size_t>(command.payloadOffset)});
+                    break;
+                case GfxCommandType::BeginPass: {
+                    check(inFrame && !inPass, i, "pass outside a frame");
+                    check(command.payloadOffset + sizeof(Pass::clearColor) <= payload.size(), i, "clear color out of range");
+                    Pass pass{};
+                    std::memcpy(pass.clearColor.data(), payload.data() + command.payloadOffset, sizeof(pass.clearColor));
+                    pass.first = records.size();
+                    submitFirst = records.size();
+                    pass.updatesEnd = updates.size();
+                    passes.push_back(pass);
+                    state = {};
+                    transformBuffer = UINT32_MAX;
+                    inPass = true;
+                    break;
+                }
+                case GfxCommandType::SetPipeline:
+                    check(inPass && command.object < pipelines.size(), i, "unknown pipeline");
+                    state.pipeline = static_cast<const GfxPipeline *>(pipelines[command.object]);
+                    break;
+                case GfxCommandType::SetVertexBuffer:
+                    check(inPass && command.object < buffers.size(), i, "unknown buffer");
+                    if (command.index == vertexStreamIndex)
+                        state.vertexBuffer = static_cast<const GfxBuffer *>(buffers[command.object]);
+                    else if (command.index == colorStreamIndex)
+                        state.colorBuffer = static_cast<const GfxBuffer *>(buffers[command.object]);
+                    else if (command.index == transformIndex) {
+                        check(!passes.back().transformBuffer || passes.back().transformBuffer == buffers[command.object],
+                              i, "second transform buffer in a pass");
+                        passes.back().transformBuffer = buffers[command.object];
+                        transformBuffer = command.object;
+                        state.transform = nullptr;
+                        state.transformSlot = 0;
+                    }
+                    break;
+                case GfxCommandType::SetVertexBufferOffset:
+                    check(inPass, i, "offset outside a pass");
+                    if (command.index == transformIndex) {
+                        check(transformBuffer != UINT32_MAX && command.start % transformSlotSize == 0 &&
+                                  uint64_t(command.start) + transformSlotSize <= capture.buffers[transformBuffer].size,
+                              i, "transform slot outside the transform buffer");
+                        state.transform = nullptr;
+                        state.transformSlot = command.start / transformSlotSize;
+                    }
+                    break;
+                case GfxCommandType::SetVertexBytes: {
+                    check(inPass && command.payloadOffset <= payload.size() &&
+                              command.bytes <= payload.size() - command.payloadOffset, i, "bytes out of range");
+                    const uint8_t *bytes = payload.data() + command.payloadOffset;
+                    if (command.index == transformIndex) {
+                        check(command.bytes == transformSlotSize && command.payloadOffset % alignof(float) == 0, i,
+                              "transform isn't a 3x4 affine matrix");
+                        state.transform = reinterpret_cast<const float *>(bytes);
+                        state.transformSlot = noTransformSlot;
+                        transformBuffer = UINT32_MAX;
+                    }
+                    else if (command.index == viewProjectionIndex) {
+                        check(command.bytes == viewProjectionSize && command.payloadOffset % alignof(float) == 0, i,
+                              "view-projection isn't a 4x4 matrix");
+                        check(!passes.back().viewProjection, i, "second view-projection in a pass");
+                        passes.back().viewProjection = reinterpret_cast<const float *>(bytes);
+                    }
+                    else {
+                        state.constants = bytes;
+                        state.constantsSize = command.bytes;
+                        state.constantsIndex = command.index;
+                    }
+                    break;
+                }
+                case GfxCommandType::Draw:
+                case GfxCommandType::DrawIndexed: {
+                    check(inPass && state.pipeline && state.vertexBuffer &&
+                              (state.transform || state.transformSlot != noTransformSlot), i,
+                          "draw without a pipeline, vertex buffer or transform");
+                    DrawRecord record = state;
+                    record.start = command.start;
+                    record.count = command.count;
+                    record.instanceCount = command.instanceCount;
+                    record.baseVertex = command.baseVertex;
+                    record.topology = static_cast<DrawTopology>(command.topology);
+                    check(command.topology <= static_cast<uint8_t>(DrawTopology::TriangleStrip), i, "unknown topology");
+                    if (command.type == GfxCommandType::DrawIndexed) {
+                        check(command.object < buffers.size(), i, "unknown index buffer");
+                        check(command.indexFormat <= static_cast<uint8_t>(IndexFormat::UInt32), i, "unknown index format");
+                        record.indexBuffer = static_cast<const GfxBuffer *>(buffers[command.object]);
+                        record.indexFormat = static_cast<IndexFormat>(command.indexFormat);
+                        check(uint64_t(record.start) + uint64_t(record.count) * indexSize(record.indexFormat) <=
+                                  capture.buffers[command.object].size, i, "indices past the end of the index buffer");
+                    }
+                    records.push_back(record);
+                    break;
+                }
+                case GfxCommandType::EndPass:
+                    check(inPass, i, "pass ends outside a pass");
+                    if (records.size() > submitFirst)
+                        submitEnds.push_back(records.size());
+                    passes.back().submitsEnd = submitEnds.size();
+                    inPass = false;
+                    break;
+                case GfxCommandType::EndFrame:
+                    check(inFrame && !inPass, i, "frame ends inside a pass");
+                    frames.push_back({passes.size(), updates.size()});
+                    inFrame = false;
+                    break;
+                default:
+                    check(false, i, "unknown command");
+            }
+        }
+        check(!inFrame, capture.commands.size(), "last frame doesn't end");
+    }
+    catch (...) {
+        for (GfxPipeline *pipeline : pipelines)
+            delete pipeline;
+        for (GfxBuffer *buffer : buffers)
+            delete buffer;
+        throw;
+    }
+}
+
+CaptureReplayer::~CaptureReplayer() {
+    device.waitIdle();
+    for (GfxPipeline *pipeline : pipelines)
+        delete pipeline;
+    for (GfxBuffer *buffer : buffers)
+        delete buffer;
+}
+
+/**
+ * @brief Replays every frame, frames without a drawable still write their buffer updates.
+ */
+void CaptureReplayer::replay() {
+    size_t pass = 0, submit = 0, update = 0;
+    for (const Frame &frame : frames) {
+        if (!device.beginFrame()) {
+            pass = frame.passesEnd;
+            submit = pass ? passes[pass - 1].submitsEnd : 0;
+            writeUpdates(update, frame.updatesEnd);
+            continue;
+        }
+        for (; pass < frame.passesEnd; ++pass) {
+            writeUpdates(update, passes[pass].updatesEnd);
+            GfxEncoder *encoder = device.beginPass(passes[pass].clearColor);
+            if (passes[pass].transformBuffer)
+                encoder->setVertexBuffer(static_cast<const GfxBuffer *>(passes[pass].transformBuffer), transformIndex);
+            if (passes[pass].viewProjection)
+                encoder->setVertexBytes(passes[pass].viewProjection, viewProjectionSize, viewProjectionIndex);
+            for (size_t first = passes[pass].first; submit < passes[pass].submitsEnd; first = submitEnds[submit++])
+                encoder->submit(records.data() + first, submitEnds[submit] - first);
+            encoder->endEncoding();
+        }
+        writeUpdates(update, frame.updatesEnd);
+        device.endFrame(nullptr);
+    }
+}
+
+// Writes the captured updates [update, end) into the replay's buffers
+void CaptureReplayer::writeUpdates(size_t &update, size_t end) {
+    for (; update < end; ++update) {
+        const Update &write = updates[update];
+        std::memcpy(static_cast<uint8_t *>(write.buffer->map()) + write.offset, payload.data() + write.payloadOffset,
+                    write.size);
+        write.buffer->didModifyRange(write.offset, write.size);
+    }
+}
+
+uint32_t CaptureReplayer::getFrameCount() const {
+    return static_cast<uint32_t>(frames.size());
+}
+
+size_t CaptureReplayer::getPassCount() const {
+    return passes.size();
+}
+
+size_t CaptureReplayer::getDrawCount() const {
+    return records.size();
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "CaptureDevice.h"
+
+/*
+-------------------------------------------------------------------
+  CAPTURE REPLAYER  -------------------------------------------------
+
+  Plays a GfxCapture (CaptureDevice.h) back on any device. The capture's pipelines and buffers
+  are created once by the constructor and its commands rebuilt into the draw lists it was
+  submitted as, one per captured submit() or packet, each draw pointing at the bytes its binds
+  set. replay() then submits every captured frame through the same encoder->submit() path the
+  renderer uses, which skips the same repeated binds and so emits the captured binds and draws
+  again, and the replay loop times submission and the backend without any scene. Buffer
+  updates are written again where they were captured, and a pass's transform buffer and
+  view-projection are bound before its draws (a pass may bind only one of each).
+-------------------------------------------------------------------
+*/
+
+class CaptureReplayer final {
+public:
+    // Throws std::runtime_error for malformed commands, draws outside their buffers and
+    // pipelines the device can't create
+    CaptureReplayer(const GfxCapture &capture, GfxDevice &device);
+
+    // Waits for the device and deletes the objects
+    ~CaptureReplayer();
+
+    CaptureReplayer(const CaptureReplayer &) = delete;
+    CaptureReplayer &operator=(const CaptureReplayer &) = delete;
+
+    // Submits every captured frame once, frames the device has no drawable for are skipped
+    void replay();
+
+    uint32_t getFrameCount() const;
+
+    size_t getPassCount() const;
+
+    size_t getDrawCount() const;
+
+private:
+    struct Pass {
+        std::array<double, 4> clearColor;
+        size_t first;           // Into records
+        size_t submitsEnd;      // One past the pass's last submit
+        size_t updatesEnd;      // One past the last update written before the pass
+        GfxBuffer *transformBuffer;
+        const float *viewProjection;    // Into payload, null if the pass sets none
+    };
+    struct Update {
+        GfxBuffer *buffer;
+        size_t offset;
+        size_t size;
+        size_t payloadOffset;
+    };
+    struct Frame {
+        size_t passesEnd;       // One past the frame's last pass
+        size_t updatesEnd;      // And its last update
+    };
+
+    GfxDevice &device;
+    std::vector<GfxPipeline *> pipelines;
+    std::vector<GfxBuffer *> buffers;
+    std::vector<uint8_t> payload;           // Records point into it
+    std::vector<DrawRecord> records;
+    std::vector<size_t> submitEnds;         // One past each submit's last record
+    std::vector<Pass> passes;
+    std::vector<Update> updates;
+    std::vector<Frame> frames;
+
+    void writeUpdates(size_t &update, size_t end);
+};
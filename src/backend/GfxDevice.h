@@ -0,0 +1,164 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "../common/DrawList.h"
+
+/*
+-------------------------------------------------------------------
+  GFX DEVICE  -------------------------------------------------------
+
+  The renderer reaches the GPU only through these interfaces, so everything above them
+  (primitives, the scene, levels of detail, draw lists) builds and runs without Metal:
+
+    MetalDevice       macOS, draws into a CAMetalLayer (backend/MetalDevice.h)
+    RecordingDevice   anywhere, executes nothing, optionally captures every command with its
+                      arguments and byte counts (backend/RecordingDevice.h)
+    SoftwareDevice    anywhere, rasterizes on the CPU into memory (backend/SoftwareDevice.h)
+    CaptureDevice     wraps another device and saves frames' commands for replay
+                      (backend/CaptureDevice.h)
+
+  Buffers and pipelines are created by a device and owned by the caller, who deletes them
+  (through DestructionQueue::retireOwned() once a frame may have used them). Pipelines from
+  getPipeline() are the exception: one per description, shared by every caller and owned by the
+  device until it is destroyed, so objects drawn with the same shaders bind it once. The
+  drawable and encoder belong to the device and are only valid between beginFrame() and
+  endFrame().
+
+  A frame:
+
+    GfxDrawable *drawable = device.beginFrame();      null when there is nothing to draw into
+    GfxEncoder *encoder = device.beginPass(clearColor);
+    encoder->submit(drawList.data(), drawList.size());
+    encoder->endEncoding();
+    device.endFrame(completed);                       completed() runs once the GPU is done
+
+  The encoder takes the opaque pointers DrawRecords hold, which must be this device's
+  GfxPipeline and GfxBuffer objects.
+
+  Draws that stay the same frame after frame can be baked into a GfxDrawPacket, checked once
+  and frozen with copies of their transforms and constants, then run with execute() in place
+  of submitting their records again. Packets are owned by the caller like buffers, and keep
+  pointers to the buffers and pipelines they draw with, which must outlive them. Records with
+  a transform slot keep reading it from the transform buffer bound when the packet runs.
+
+  Every buffer stays mapped for its lifetime: the CPU writes through map() and reports the
+  bytes it wrote with didModifyRange() (Metal's managed storage copies only those to the GPU).
+  Contents a committed frame may still read must not be written, TransformBuffer
+  (backend/TransformBuffer.h) cycles through one buffer per frame in flight for that.
+-------------------------------------------------------------------
+*/
+
+class GfxBuffer {
+public:
+    virtual ~GfxBuffer() = default;
+
+    virtual size_t getSize() const = 0;
+
+    // The contents, writable by the CPU
+    virtual void *map() = 0;
+
+    // Makes bytes written through map() visible to frames committed from now on
+    virtual void didModifyRange(size_t offset, size_t size) = 0;
+};
+
+struct GfxPipelineDesc {
+    std::string vertexFunction;     // Names in shaders.metal
+    std::string fragmentFunction;
+    bool blending{false};           // Source over, otherwise opaque
+
+    auto operator<=>(const GfxPipelineDesc &) const = default;
+};
+
+class GfxPipeline {
+public:
+    virtual ~GfxPipeline() = default;
+};
+
+// Draw records baked by GfxDevice::newDrawPacket(), in the device's own form
+class GfxDrawPacket {
+public:
+    virtual ~GfxDrawPacket() = default;
+
+    virtual size_t getDrawCount() const = 0;
+};
+
+// The image a frame renders into
+class GfxDrawable {
+public:
+    virtual ~GfxDrawable() = default;
+
+    virtual uint32_t getWidth() const = 0;
+
+    virtual uint32_t getHeight() const = 0;
+};
+
+// Records one render pass, the interface submitDrawList() expects
+class GfxEncoder {
+public:
+    virtual ~GfxEncoder() = default;
+
+    virtual void setPipeline(const void *pipeline) = 0;
+
+    virtual void setVertexBuffer(const void *buffer, uint32_t index) = 0;
+
+    // Moves the binding of the buffer last bound at index
+    virtual void setVertexBufferOffset(size_t offset, uint32_t index) = 0;
+
+    virtual void setVertexBytes(const void *bytes, size_t size, uint32_t index) = 0;
+
+    virtual void draw(const DrawRecord &record) = 0;
+
+    virtual void drawIndexed(const DrawRecord &record) = 0;
+
+    // A whole draw list in one call, backends run submitDrawList() on their final encoder type
+    // so the per-record calls are not virtual
+    virtual void submit(const DrawRecord *records, size_t count) = 0;
+
+    // The packet's draws as they were baked, binds before and after it are unknown
+    virtual void execute(const GfxDrawPacket *packet) = 0;
+
+    virtual void endEncoding() = 0;
+};
+
+class GfxDevice {
+public:
+    virtual ~GfxDevice() = default;
+
+    virtual const char *getName() const = 0;
+
+    // Both throw std::runtime_error on failure, a buffer without bytes starts out zero filled
+    virtual GfxBuffer *newBuffer(const void *bytes, size_t size) = 0;
+
+    virtual GfxPipeline *newPipeline(const GfxPipelineDesc &desc) = 0;
+
+    // The device's shared pipeline for desc, created by newPipeline() on first use
+    GfxPipeline *getPipeline(const GfxPipelineDesc &desc) {
+        std::unique_ptr<GfxPipeline> &pipeline = pipelines[desc];
+        if (!pipeline)
+            pipeline.reset(newPipeline(desc));
+        return pipeline.get();
+    }
+
+    // Bakes records for execute(), throws std::runtime_error for a record missing its pipeline,
+    // vertex buffer or transform, or drawing past the end of its index buffer
+    virtual GfxDrawPacket *newDrawPacket(const DrawRecord *records, size_t count) = 0;
+
+    virtual GfxDrawable *beginFrame() = 0;
+
+    virtual GfxEncoder *beginPass(const std::array<double, 4> &clearColor) = 0;
+
+    virtual void endFrame(std::function<void()> completed) = 0;
+
+    // Blocks until every committed frame has completed
+    virtual void waitIdle() = 0;
+
+private:
+    std::map<GfxPipelineDesc, std::unique_ptr<GfxPipeline>> pipelines;
+};
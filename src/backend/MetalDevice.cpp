@@ -0,0 +1,279 @@
+#include "MetalDevice.h"
+
+#include <iostream>
+#include <stdexcept>
+
+#include "../shaders/readShaderFile.h"
+
+namespace {
+
+MTL::PrimitiveType primitiveType(DrawTopology topology) {
+    return topology == DrawTopology::Triangle ? MTL::PrimitiveType::PrimitiveTypeTriangle
+                                              : MTL::PrimitiveType::PrimitiveTypeTriangleStrip;
+}
+
+} // namespace
+
+/*
+    BUFFER, PIPELINE, DRAWABLE
+*/
+MetalBuffer::MetalBuffer(MTL::Buffer *buffer) : buffer(buffer) {}
+
+MetalBuffer::~MetalBuffer() {
+    buffer->release();
+}
+
+size_t MetalBuffer::getSize() const {
+    return buffer->length();
+}
+
+void *MetalBuffer::map() {
+    return buffer->contents();
+}
+
+void MetalBuffer::didModifyRange(size_t offset, size_t size) {
+    buffer->didModifyRange(NS::Range::Make(offset, size));
+}
+
+MetalPipeline::MetalPipeline(MTL::RenderPipelineState *state) : state(state) {}
+
+MetalPipeline::~MetalPipeline() {
+    state->release();
+}
+
+MetalDrawPacket::MetalDrawPacket(const DrawRecord *records, size_t count) : draws(records, count) {}
+
+size_t MetalDrawPacket::getDrawCount() const {
+    return draws.size();
+}
+
+uint32_t MetalDrawable::getWidth() const {
+    return static_cast<uint32_t>(drawable->texture()->width());
+}
+
+uint32_t MetalDrawable::getHeight() const {
+    return static_cast<uint32_t>(drawable->texture()->height());
+}
+
+/*
+    ENCODER
+*/
+void MetalEncoder::setPipeline(const void *pipeline) {
+    encoder->setRenderPipelineState(
+        static_cast<const MetalPipeline *>(static_cast<const GfxPipeline *>(pipeline))->state);
+}
+
+void MetalEncoder::setVertexBuffer(const void *buffer, uint32_t index) {
+    encoder->setVertexBuffer(static_cast<const MetalBuffer *>(static_cast<const GfxBuffer *>(buffer))->buffer, 0,
+                             index);
+}
+
+void MetalEncoder::setVertexBufferOffset(size_t offset, uint32_t index) {
+    encoder->setVertexBufferOffset(offset, index);
+}
+
+void MetalEncoder::setVertexBytes(const void *bytes, size_t size, uint32_t index) {
+    encoder->setVertexBytes(bytes, size, index);
+}
+
+void MetalEncoder::draw(const DrawRecord &record) {
+    encoder->drawPrimitives(primitiveType(record.topology), record.start, record.count, record.instanceCount);
+}
+
+void MetalEncoder::drawIndexed(const DrawRecord &record) {
+    const GfxBuffer *indexBuffer = static_cast<const GfxBuffer *>(record.indexBuffer);
+    encoder->drawIndexedPrimitives(primitiveType(record.topology), record.count,
+                                   record.indexFormat == IndexFormat::UInt16 ? MTL::IndexType::IndexTypeUInt16
+                                                                             : MTL::IndexType::IndexTypeUInt32,
+                                   static_cast<const MetalBuffer *>(indexBuffer)->buffer,
+                                   record.start,            // Byte offset
+                                   record.instanceCount,
+                                   record.baseVertex,       // Added to every index
+                                   0);                      // Base instance
+}
+
+void MetalEncoder::submit(const DrawRecord *records, size_t count) {
+    submitDrawList(records, count, *this);
+}
+
+void MetalEncoder::execute(const GfxDrawPacket *packet) {
+    const BakedDrawList &draws = static_cast<const MetalDrawPacket *>(packet)->draws;
+    submitDrawList(draws.data(), draws.size(), *this);
+}
+
+void MetalEncoder::endEncoding() {
+    encoder->endEncoding();
+    encoder = nullptr;
+}
+
+/*
+    DEVICE
+*/
+/**
+ * @brief Creates the command queue and compiles shaders.metal for the layer's device.
+ *
+ * @throws std::runtime_error If the shader library can't be built.
+ */
+MetalDevice::MetalDevice(CA::MetalLayer *layer) : layer(layer), device(layer->device()) {
+    // Uses helper function to load the shaders - using pre-compiled shaders is another approach
+    try {
+        loadShaderFromFile(library, device, "shaders.metal");
+    }
+    catch (const std::exception &e) {
+        std::cerr << "Error loading shader: " << e.what() << std::endl;
+    }
+    if (!library)
+        throw std::runtime_error("Failed to create shader library");
+
+    commandQueue = device->newCommandQueue();
+}
+
+MetalDevice::~MetalDevice() {
+    if (commandQueue) {
+        waitIdle();
+        commandQueue->release();
+    }
+    if (library)
+        library->release();
+}
+
+const char *MetalDevice::getName() const {
+    return "metal";
+}
+
+MTL::Device *MetalDevice::getDevice() const {
+    return device;
+}
+
+GfxBuffer *MetalDevice::newBuffer(const void *bytes, size_t size) {
+    MTL::Buffer *buffer = bytes ? device->newBuffer(bytes, size, MTL::ResourceStorageModeManaged)
+                                : device->newBuffer(size, MTL::ResourceStorageModeManaged);     // Zero filled
+    if (!buffer)
+        throw std::runtime_error("Failed to create buffer");
+    return new MetalBuffer(buffer);
+}
+
+/**
+ * @brief Builds a render pipeline from two functions of the shader library.
+ *
+ * Renders to BGRA8Unorm, optionally alpha blended (source over).
+ *
+ * @throws std::runtime_error If a function is missing or the pipeline doesn't compile.
+ */
+GfxPipeline *MetalDevice::newPipeline(const GfxPipelineDesc &desc) {
+    // Get both vertex and fragment functions
+    MTL::Function *vertexFunction =
+        library->newFunction(NS::String::string(desc.vertexFunction.c_str(), NS::UTF8StringEncoding));
+    if (!vertexFunction)
+        throw std::runtime_error("Vertex function not found: " + desc.vertexFunction);
+
+    MTL::Function *fragmentFunction =
+        library->newFunction(NS::String::string(desc.fragmentFunction.c_str(), NS::UTF8StringEncoding));
+    if (!fragmentFunction) {
+        vertexFunction->release();
+        throw std::runtime_error("Fragment function not found: " + desc.fragmentFunction);
+    }
+
+    // Create render pipeline descriptor
+    MTL::RenderPipelineDescriptor *pipelineDescriptor = MTL::RenderPipelineDescriptor::alloc()->init();
+    pipelineDescriptor->setVertexFunction(vertexFunction);
+    pipelineDescriptor->setFragmentFunction(fragmentFunction);
+
+    // Configure color attachment - NOTE: The color attachment represents the output target for the fragment shader.
+    MTL::RenderPipelineColorAttachmentDescriptor *colorAttachment = pipelineDescriptor->colorAttachments()->object(0);
+    colorAttachment->setPixelFormat(MTL::PixelFormat::PixelFormatBGRA8Unorm);
+    colorAttachment->setBlendingEnabled(desc.blending); // Without blending this overwrites the entire color buffer
+    if (desc.blending) {
+        colorAttachment->setRgbBlendOperation(MTL::BlendOperationAdd);
+        colorAttachment->setAlphaBlendOperation(MTL::BlendOperationAdd);
+        colorAttachment->setSourceRGBBlendFactor(MTL::BlendFactorSourceAlpha);
+        colorAttachment->setSourceAlphaBlendFactor(MTL::BlendFactorOne);
+        colorAttachment->setDestinationRGBBlendFactor(MTL::BlendFactorOneMinusSourceAlpha);
+        colorAttachment->setDestinationAlphaBlendFactor(MTL::BlendFactorOneMinusSourceAlpha);
+    }
+
+    NS::Error *error{nullptr};
+    MTL::RenderPipelineState *state = device->newRenderPipelineState(pipelineDescriptor, &error);
+
+    pipelineDescriptor->release();
+    vertexFunction->release();
+    fragmentFunction->release();
+
+    if (!state) {
+        if (error)
+            std::cerr << "ERROR: " << error->localizedDescription()->utf8String() << std::endl;
+        throw std::runtime_error("Invalid pipelineState");
+    }
+    return new MetalPipeline(state);
+}
+
+GfxDrawPacket *MetalDevice::newDrawPacket(const DrawRecord *records, size_t count) {
+    return new MetalDrawPacket(records, count);
+}
+
+/**
+ * @brief Takes the layer's next drawable and starts a command buffer.
+ *
+ * @return Null if the layer has no drawable, nothing is recorded for that frame.
+ */
+GfxDrawable *MetalDevice::beginFrame() {
+    pool = NS::AutoreleasePool::alloc()->init();
+    frameDrawable.drawable = layer->nextDrawable();
+    if (!frameDrawable.drawable) {
+        std::cerr << "Drawable is null!" << std::endl;
+        pool->release();
+        pool = nullptr;
+        return nullptr;
+    }
+
+    // Create command buffer per frame
+    commandBuffer = commandQueue->commandBuffer();
+    return &frameDrawable;
+}
+
+GfxEncoder *MetalDevice::beginPass(const std::array<double, 4> &clearColor) {
+    // Create render pass descriptor
+    renderPass = MTL::RenderPassDescriptor::alloc()->init();
+    MTL::RenderPassColorAttachmentDescriptor *colorAttachment = renderPass->colorAttachments()->object(0);
+    colorAttachment->setTexture(frameDrawable.drawable->texture());
+    colorAttachment->setLoadAction(MTL::LoadActionClear);
+    colorAttachment->setClearColor(MTL::ClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]));
+    colorAttachment->setStoreAction(MTL::StoreActionStore);
+
+    frameEncoder.encoder = commandBuffer->renderCommandEncoder(renderPass);
+    return &frameEncoder;
+}
+
+/**
+ * @brief Presents the drawable and commits the frame.
+ *
+ * @param completed Runs on a Metal thread once the GPU has finished the frame.
+ */
+void MetalDevice::endFrame(std::function<void()> completed) {
+    if (completed)
+        commandBuffer->addCompletedHandler([completed](MTL::CommandBuffer *) { completed(); });
+
+    // Present
+    commandBuffer->presentDrawable(frameDrawable.drawable);
+    commandBuffer->commit();
+
+    if (renderPass) {
+        renderPass->release();
+        renderPass = nullptr;
+    }
+    commandBuffer = nullptr;
+    frameDrawable.drawable = nullptr;
+    pool->release();
+    pool = nullptr;
+}
+
+/**
+ * @brief Commits an empty command buffer and waits for it, queues run in order.
+ */
+void MetalDevice::waitIdle() {
+    NS::AutoreleasePool *fencePool = NS::AutoreleasePool::alloc()->init();
+    MTL::CommandBuffer *fence = commandQueue->commandBuffer();
+    fence->commit();
+    fence->waitUntilCompleted();
+    fencePool->release();
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <Metal/Metal.hpp>
+#include <QuartzCore/QuartzCore.hpp>
+
+#include "BakedDrawList.h"
+#include "GfxDevice.h"
+
+/*
+-------------------------------------------------------------------
+  METAL DEVICE  -----------------------------------------------------
+
+  The macOS backend, draws into a window's CAMetalLayer. shaders.metal is compiled once, when
+  the device is created, and every pipeline takes its functions from that library.
+-------------------------------------------------------------------
+*/
+
+class MetalBuffer final : public GfxBuffer {
+public:
+    explicit MetalBuffer(MTL::Buffer *buffer);
+    ~MetalBuffer() override;
+
+    size_t getSize() const override;
+
+    void *map() override;
+
+    // Managed storage, copies the range to the GPU's copy
+    void didModifyRange(size_t offset, size_t size) override;
+
+    MTL::Buffer *buffer;
+};
+
+class MetalPipeline final : public GfxPipeline {
+public:
+    explicit MetalPipeline(MTL::RenderPipelineState *state);
+    ~MetalPipeline() override;
+
+    MTL::RenderPipelineState *state;
+};
+
+class MetalDrawable final : public GfxDrawable {
+public:
+    uint32_t getWidth() const override;
+
+    uint32_t getHeight() const override;
+
+    CA::MetalDrawable *drawable{nullptr};
+};
+
+// Records checked and frozen once, encoded again by every execute(). An indirect command
+// buffer could hold them on the GPU, but those can't take setVertexBytes() transforms or
+// move a buffer binding's offset
+class MetalDrawPacket final : public GfxDrawPacket {
+public:
+    MetalDrawPacket(const DrawRecord *records, size_t count);
+
+    size_t getDrawCount() const override;
+
+    BakedDrawList draws;
+};
+
+// submitDrawList() target, casts the records' opaque pointers back
+class MetalEncoder final : public GfxEncoder {
+public:
+    void setPipeline(const void *pipeline) override;
+
+    void setVertexBuffer(const void *buffer, uint32_t index) override;
+
+    void setVertexBufferOffset(size_t offset, uint32_t index) override;
+
+    void setVertexBytes(const void *bytes, size_t size, uint32_t index) override;
+
+    void draw(const DrawRecord &record) override;
+
+    void drawIndexed(const DrawRecord &record) override;
+
+    void submit(const DrawRecord *records, size_t count) override;
+
+    void execute(const GfxDrawPacket *packet) override;
+
+    void endEncoding() override;
+
+    MTL::RenderCommandEncoder *encoder{nullptr};    // Needs a RenderCommandEncoder, NOT CommandEncoder
+};
+
+class MetalDevice final : public GfxDevice {
+public:
+    explicit MetalDevice(CA::MetalLayer *layer);
+    ~MetalDevice() override;
+
+    MetalDevice(const MetalDevice &) = delete;
+    MetalDevice &operator=(const MetalDevice &) = delete;
+
+    const char *getName() const override;
+
+    GfxBuffer *newBuffer(const void *bytes, size_t size) override;
+
+    GfxPipeline *newPipeline(const GfxPipelineDesc &desc) override;
+
+    GfxDrawPacket *newDrawPacket(const DrawRecord *records, size_t count) override;
+
+    GfxDrawable *beginFrame() override;
+
+    GfxEncoder *beginPass(const std::array<double, 4> &clearColor) override;
+
+    void endFrame(std::function<void()> completed) override;
+
+    void waitIdle() override;
+
+    MTL::Device *getDevice() const;
+
+private:
+    CA::MetalLayer *layer;
+    MTL::Device *device;
+    MTL::CommandQueue *commandQueue{nullptr};
+    MTL::Library *library{nullptr};
+
+    // The frame being recorded
+    NS::AutoreleasePool *pool{nullptr};
+    MTL::CommandBuffer *commandBuffer{nullptr};
+    MTL::RenderPassDescriptor *renderPass{nullptr};
+    MetalDrawable frameDrawable;
+    MetalEncoder frameEncoder;
+};
@@ -0,0 +1,314 @@
+#include "RecordingDevice.h"
+
+#include <cstring>
+#include <ostream>
+
+const char *gfxCommandName(GfxCommandType type) {
+    switch (type) {
+        case GfxCommandType::NewBuffer: return "newBuffer";
+        case GfxCommandType::NewPipeline: return "newPipeline";
+        case GfxCommandType::BeginFrame: return "beginFrame";
+        case GfxCommandType::UpdateBuffer: return "updateBuffer";
+        case GfxCommandType::BeginPass: return "beginPass";
+        case GfxCommandType::SetPipeline: return "setPipeline";
+        case GfxCommandType::SetVertexBuffer: return "setVertexBuffer";
+        case GfxCommandType::SetVertexBufferOffset: return "setVertexBufferOffset";
+        case GfxCommandType::SetVertexBytes: return "setVertexBytes";
+        case GfxCommandType::Draw: return "draw";
+        case GfxCommandType::DrawIndexed: return "drawIndexed";
+        case GfxCommandType::EndPass: return "endPass";
+        case GfxCommandType::EndFrame: return "endFrame";
+    }
+    return "unknown";
+}
+
+/*
+    BUFFER, PIPELINE, DRAWABLE
+*/
+RecordingBuffer::RecordingBuffer(RecordingDevice &device, const void *bytes, size_t size, bool keepContents)
+    : device(device), size(size) {
+    if (keepContents && bytes)
+        contents.assign(static_cast<const uint8_t *>(bytes), static_cast<const uint8_t *>(bytes) + size);
+}
+
+size_t RecordingBuffer::getSize() const {
+    return size;
+}
+
+/**
+ * @brief The kept contents, allocated zero filled on first use by a null device.
+ */
+void *RecordingBuffer::map() {
+    if (contents.size() != size)
+        contents.assign(size, 0);
+    return contents.data();
+}
+
+void RecordingBuffer::didModifyRange(size_t offset, size_t size) {
+    if (GfxCommand *command = device.record(GfxCommandType::UpdateBuffer, size)) {
+        command->object = static_cast<const GfxBuffer *>(this);
+        command->offset = offset;
+        if (contents.size() == this->size && offset <= this->size && size <= this->size - offset)
+            command->payloadOffset = device.appendPayload(contents.data() + offset, size);
+    }
+}
+
+const std::vector<uint8_t> &RecordingBuffer::getContents() const {
+    return contents;
+}
+
+RecordingPipeline::RecordingPipeline(const GfxPipelineDesc &desc) : desc(desc) {}
+
+const GfxPipelineDesc &RecordingPipeline::getDesc() const {
+    return desc;
+}
+
+RecordingDrawPacket::RecordingDrawPacket(const DrawRecord *records, size_t count) : draws(records, count) {
+    // Counted once on a null device of its own
+    RecordingDevice counter(0, 0, false);
+    GfxEncoder *encoder = counter.beginPass({});
+    counter.resetStats();
+    submitDrawList(draws.data(), draws.size(), *encoder);
+    stats = counter.getStats();
+}
+
+size_t RecordingDrawPacket::getDrawCount() const {
+    return draws.size();
+}
+
+const BakedDrawList &RecordingDrawPacket::getDraws() const {
+    return draws;
+}
+
+const GfxCommandStats &RecordingDrawPacket::getStats() const {
+    return stats;
+}
+
+RecordingDrawable::RecordingDrawable(uint32_t width, uint32_t height) : width(width), height(height) {}
+
+uint32_t RecordingDrawable::getWidth() const {
+    return width;
+}
+
+uint32_t RecordingDrawable::getHeight() const {
+    return height;
+}
+
+/*
+    ENCODER
+*/
+RecordingEncoder::RecordingEncoder(RecordingDevice &device) : device(device) {}
+
+void RecordingEncoder::setPipeline(const void *pipeline) {
+    if (GfxCommand *command = device.record(GfxCommandType::SetPipeline, 0))
+        command->object = pipeline;
+}
+
+void RecordingEncoder::setVertexBuffer(const void *buffer, uint32_t index) {
+    if (GfxCommand *command = device.record(GfxCommandType::SetVertexBuffer, 0)) {
+        command->object = buffer;
+        command->index = index;
+    }
+}
+
+void RecordingEncoder::setVertexBufferOffset(size_t offset, uint32_t index) {
+    if (GfxCommand *command = device.record(GfxCommandType::SetVertexBufferOffset, 0)) {
+        command->index = index;
+        command->offset = offset;
+    }
+}
+
+void RecordingEncoder::setVertexBytes(const void *bytes, size_t size, uint32_t index) {
+    if (GfxCommand *command = device.record(GfxCommandType::SetVertexBytes, size)) {
+        command->index = index;
+        command->payloadOffset = device.appendPayload(bytes, size);
+    }
+}
+
+void RecordingEncoder::draw(const DrawRecord &record) {
+    device.stats.vertices += uint64_t(record.count) * record.instanceCount;
+    if (GfxCommand *command = device.record(GfxCommandType::Draw, 0))
+        command->draw = record;
+}
+
+void RecordingEncoder::drawIndexed(const DrawRecord &record) {
+    device.stats.vertices += uint64_t(record.count) * record.instanceCount;
+    const uint64_t indexBytes = uint64_t(record.count) * (record.indexFormat == IndexFormat::UInt16 ? 2 : 4);
+    if (GfxCommand *command = device.record(GfxCommandType::DrawIndexed, indexBytes))
+        command->draw = record;
+}
+
+void RecordingEncoder::submit(const DrawRecord *records, size_t count) {
+    submitDrawList(records, count, *this);
+}
+
+/**
+ * @brief Records the packet's commands when capturing, otherwise only adds the counts it was baked with.
+ */
+void RecordingEncoder::execute(const GfxDrawPacket *packet) {
+    const RecordingDrawPacket *recording = static_cast<const RecordingDrawPacket *>(packet);
+    ++device.stats.packets;
+    if (device.capture) {
+        submitDrawList(recording->getDraws().data(), recording->getDraws().size(), *this);
+        return;
+    }
+
+    const GfxCommandStats &stats = recording->getStats();
+    for (size_t type = 0; type < gfxCommandTypeCount; ++type) {
+        device.stats.counts[type] += stats.counts[type];
+        device.stats.bytes[type] += stats.bytes[type];
+    }
+    device.stats.vertices += stats.vertices;
+}
+
+void RecordingEncoder::endEncoding() {
+    device.record(GfxCommandType::EndPass, 0);
+}
+
+/*
+    DEVICE
+*/
+RecordingDevice::RecordingDevice(uint32_t width, uint32_t height, bool capture)
+    : capture(capture), drawable(width, height), encoder(*this) {}
+
+const char *RecordingDevice::getName() const {
+    return capture ? "recording" : "null";
+}
+
+GfxBuffer *RecordingDevice::newBuffer(const void *bytes, size_t size) {
+    RecordingBuffer *buffer = new RecordingBuffer(*this, bytes, size, capture);
+    if (GfxCommand *command = record(GfxCommandType::NewBuffer, size))
+        command->object = static_cast<const GfxBuffer *>(buffer);
+    return buffer;
+}
+
+GfxPipeline *RecordingDevice::newPipeline(const GfxPipelineDesc &desc) {
+    RecordingPipeline *pipeline = new RecordingPipeline(desc);
+    if (GfxCommand *command = record(GfxCommandType::NewPipeline, 0))
+        command->object = static_cast<const GfxPipeline *>(pipeline);
+    return pipeline;
+}
+
+GfxDrawPacket *RecordingDevice::newDrawPacket(const DrawRecord *records, size_t count) {
+    return new RecordingDrawPacket(records, count);
+}
+
+GfxDrawable *RecordingDevice::beginFrame() {
+    ++frame;
+    record(GfxCommandType::BeginFrame, 0);
+    return &drawable;
+}
+
+GfxEncoder *RecordingDevice::beginPass(const std::array<double, 4> &) {
+    record(GfxCommandType::BeginPass, 0);
+    return &encoder;
+}
+
+void RecordingDevice::endFrame(std::function<void()> completed) {
+    record(GfxCommandType::EndFrame, 0);
+    if (completed)
+        completed();
+}
+
+void RecordingDevice::waitIdle() {}
+
+bool RecordingDevice::isCapturing() const {
+    return capture;
+}
+
+const std::vector<GfxCommand> &RecordingDevice::getCommands() const {
+    return commands;
+}
+
+const std::vector<uint8_t> &RecordingDevice::getPayload() const {
+    return payload;
+}
+
+const GfxCommandStats &RecordingDevice::getStats() const {
+    return stats;
+}
+
+uint64_t RecordingDevice::getFrameCount() const {
+    return frame;
+}
+
+void RecordingDevice::clearCommands() {
+    commands.clear();
+    payload.clear();
+}
+
+void RecordingDevice::resetStats() {
+    stats = {};
+}
+
+void RecordingDevice::printCommands(std::ostream &out) const {
+    for (const GfxCommand &command : commands) {
+        out << command.frame << ' ' << gfxCommandName(command.type);
+        switch (command.type) {
+            case GfxCommandType::NewBuffer:
+                out << ' ' << command.object << ", " << command.bytes << " bytes";
+                break;
+            case GfxCommandType::NewPipeline:
+            case GfxCommandType::SetPipeline: {
+                const auto *pipeline = static_cast<const RecordingPipeline *>(
+                    static_cast<const GfxPipeline *>(command.object));
+                out << ' ' << command.object << ' ' << pipeline->getDesc().vertexFunction << '/'
+                    << pipeline->getDesc().fragmentFunction;
+                break;
+            }
+            case GfxCommandType::UpdateBuffer:
+                out << ' ' << command.object << ", " << command.bytes << " bytes at " << command.offset;
+                break;
+            case GfxCommandType::SetVertexBuffer:
+                out << ' ' << command.object << " at " << command.index;
+                break;
+            case GfxCommandType::SetVertexBufferOffset:
+                out << " at " << command.index << " to " << command.offset;
+                break;
+            case GfxCommandType::SetVertexBytes:
+                out << ' ' << command.bytes << " bytes at " << command.index;
+                break;
+            case GfxCommandType::Draw:
+                out << ' ' << command.draw.count << " vertices from " << command.draw.start << " x"
+                    << command.draw.instanceCount;
+                break;
+            case GfxCommandType::DrawIndexed:
+                out << ' ' << command.draw.count << (command.draw.indexFormat == IndexFormat::UInt16 ? " uint16" : " uint32")
+                    << " indices at byte " << command.draw.start << ", base vertex " << command.draw.baseVertex << " x"
+                    << command.draw.instanceCount;
+                break;
+            default:
+                break;
+        }
+        out << '\n';
+    }
+}
+
+/*
+    Counts a command, and appends it when capturing. Null when not capturing
+*/
+GfxCommand *RecordingDevice::record(GfxCommandType type, uint64_t bytes) {
+    const size_t slot = static_cast<size_t>(type);
+    ++stats.counts[slot];
+    stats.bytes[slot] += bytes;
+    if (!capture)
+        return nullptr;
+
+    GfxCommand &command = commands.emplace_back();
+    command = {};
+    command.type = type;
+    command.frame = frame;
+    command.bytes = bytes;
+    return &command;
+}
+
+/*
+    Copies bytes to the end of the payload, returns where they start
+*/
+size_t RecordingDevice::appendPayload(const void *bytes, size_t size) {
+    const size_t offset = payload.size();
+    payload.resize(offset + size);
+    if (size)
+        std::memcpy(payload.data() + offset, bytes, size);
+    return offset;
+}
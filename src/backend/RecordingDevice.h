@@ -0,0 +1,219 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "BakedDrawList.h"
+#include "GfxDevice.h"
+
+/*
+-------------------------------------------------------------------
+  RECORDING DEVICE  -------------------------------------------------
+
+  A GfxDevice that executes nothing, so the whole CPU side of a frame runs headless on any
+  platform, for correctness tests and CPU overhead benchmarks.
+
+    capture on      every command is appended to getCommands() with its arguments, bytes set
+                    with setVertexBytes() or written to a buffer are copied into getPayload()
+                    and buffers keep a copy of their contents
+    capture off     a null device, only the per command counts and byte totals are kept,
+                    buffers only hold contents once they are mapped
+
+  Writes to mapped buffers are recorded as UpdateBuffer commands when didModifyRange() reports
+  them, their bytes are what the upload would cost a GPU with separate memory.
+
+  Draw packets count as the commands they hold. Captured, they are expanded into those
+  commands, on a null device they only add counts worked out when they were baked, the way a
+  GPU runs a prebuilt command list without the CPU encoding it again.
+
+  Frames complete as soon as they end, the completion callback runs inside endFrame().
+-------------------------------------------------------------------
+*/
+
+enum class GfxCommandType : uint8_t {
+    NewBuffer,
+    NewPipeline,
+    BeginFrame,
+    UpdateBuffer,
+    BeginPass,
+    SetPipeline,
+    SetVertexBuffer,
+    SetVertexBufferOffset,
+    SetVertexBytes,
+    Draw,
+    DrawIndexed,
+    EndPass,
+    EndFrame,
+};
+
+constexpr size_t gfxCommandTypeCount = static_cast<size_t>(GfxCommandType::EndFrame) + 1;
+
+const char *gfxCommandName(GfxCommandType type);
+
+/**
+ * @brief One recorded call, fields a command doesn't use are zero.
+ */
+struct GfxCommand {
+    GfxCommandType type;
+    uint32_t index;             // Buffer index of SetVertexBuffer(Offset) and SetVertexBytes
+    uint64_t frame;             // Frames are numbered from 1 by beginFrame()
+    const void *object;         // Buffer or pipeline created, bound or updated
+    uint64_t bytes;             // Buffer size, bytes set or updated, or index bytes a draw reads
+    uint64_t offset;            // SetVertexBufferOffset and UpdateBuffer, into the buffer
+    size_t payloadOffset;       // SetVertexBytes and UpdateBuffer, where the copy starts in getPayload()
+    DrawRecord draw;            // Draw and DrawIndexed
+};
+
+struct GfxCommandStats {
+    std::array<uint64_t, gfxCommandTypeCount> counts{};
+    std::array<uint64_t, gfxCommandTypeCount> bytes{};
+    uint64_t vertices{0};       // Vertices or indices drawn, times instances
+    uint64_t packets{0};        // Draw packets executed, their commands are counted above too
+};
+
+class RecordingDevice;
+
+class RecordingBuffer final : public GfxBuffer {
+public:
+    RecordingBuffer(RecordingDevice &device, const void *bytes, size_t size, bool keepContents);
+
+    size_t getSize() const override;
+
+    void *map() override;
+
+    // Records an UpdateBuffer command
+    void didModifyRange(size_t offset, size_t size) override;
+
+    // Empty unless the device captures or the buffer was mapped
+    const std::vector<uint8_t> &getContents() const;
+
+private:
+    RecordingDevice &device;
+    size_t size;
+    std::vector<uint8_t> contents;
+};
+
+class RecordingPipeline final : public GfxPipeline {
+public:
+    explicit RecordingPipeline(const GfxPipelineDesc &desc);
+
+    const GfxPipelineDesc &getDesc() const;
+
+private:
+    GfxPipelineDesc desc;
+};
+
+class RecordingDrawPacket final : public GfxDrawPacket {
+public:
+    RecordingDrawPacket(const DrawRecord *records, size_t count);
+
+    size_t getDrawCount() const override;
+
+    const BakedDrawList &getDraws() const;
+
+    // What executing the packet adds to the stats, packets aside
+    const GfxCommandStats &getStats() const;
+
+private:
+    BakedDrawList draws;
+    GfxCommandStats stats;
+};
+
+class RecordingEncoder final : public GfxEncoder {
+public:
+    explicit RecordingEncoder(RecordingDevice &device);
+
+    void setPipeline(const void *pipeline) override;
+
+    void setVertexBuffer(const void *buffer, uint32_t index) override;
+
+    void setVertexBufferOffset(size_t offset, uint32_t index) override;
+
+    void setVertexBytes(const void *bytes, size_t size, uint32_t index) override;
+
+    void draw(const DrawRecord &record) override;
+
+    void drawIndexed(const DrawRecord &record) override;
+
+    void submit(const DrawRecord *records, size_t count) override;
+
+    void execute(const GfxDrawPacket *packet) override;
+
+    void endEncoding() override;
+
+private:
+    RecordingDevice &device;
+};
+
+class RecordingDrawable final : public GfxDrawable {
+public:
+    RecordingDrawable(uint32_t width, uint32_t height);
+
+    uint32_t getWidth() const override;
+
+    uint32_t getHeight() const override;
+
+private:
+    uint32_t width;
+    uint32_t height;
+};
+
+class RecordingDevice final : public GfxDevice {
+public:
+    explicit RecordingDevice(uint32_t width = 800, uint32_t height = 600, bool capture = true);
+
+    RecordingDevice(const RecordingDevice &) = delete;
+    RecordingDevice &operator=(const RecordingDevice &) = delete;
+
+    const char *getName() const override;
+
+    GfxBuffer *newBuffer(const void *bytes, size_t size) override;
+
+    GfxPipeline *newPipeline(const GfxPipelineDesc &desc) override;
+
+    GfxDrawPacket *newDrawPacket(const DrawRecord *records, size_t count) override;
+
+    GfxDrawable *beginFrame() override;
+
+    GfxEncoder *beginPass(const std::array<double, 4> &clearColor) override;
+
+    void endFrame(std::function<void()> completed) override;
+
+    void waitIdle() override;
+
+    bool isCapturing() const;
+
+    const std::vector<GfxCommand> &getCommands() const;
+
+    const std::vector<uint8_t> &getPayload() const;
+
+    const GfxCommandStats &getStats() const;
+
+    uint64_t getFrameCount() const;
+
+    // Drops captured commands and payload, e.g. after checking a frame, stats are kept
+    void clearCommands();
+
+    void resetStats();
+
+    // One line per captured command, the pipelines bound must not have been deleted yet
+    void printCommands(std::ostream &out) const;
+
+private:
+    friend class RecordingBuffer;
+    friend class RecordingEncoder;
+
+    bool capture;
+    RecordingDrawable drawable;
+    RecordingEncoder encoder;
+    uint64_t frame{0};
+    std::vector<GfxCommand> commands;
+    std::vector<uint8_t> payload;
+    GfxCommandStats stats;
+
+    GfxCommand *record(GfxCommandType type, uint64_t bytes);
+    size_t appendPayload(const void *bytes, size_t size);
+};
@@ -0,0 +1,334 @@
+#include "SoftwareDevice.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "BakedDrawList.h"
+
+namespace {
+
+constexpr float identityMatrix[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+
+// The vertex functions of shaders.metal SoftwareRasterizer runs, see RasterVertexStage
+bool findVertexStage(const std::string &name, RasterVertexStage &stage) {
+    if (name == "vertex_main")
+        stage = RasterVertexStage::Split;
+    else if (name == "vertex_interleaved")
+        stage = RasterVertexStage::Interleaved;
+    else if (name == "vertex_quantized")
+        stage = RasterVertexStage::Quantized;
+    else if (name == "vertex_quantized_interleaved")
+        stage = RasterVertexStage::QuantizedInterleaved;
+    else
+        return false;
+    return true;
+}
+
+uint32_t packClearColor(const std::array<double, 4> &color) {
+    uint32_t packed = 0;
+    for (int c = 0; c < 4; ++c)
+        packed |= static_cast<uint32_t>(std::lrint(std::clamp(color[c], 0.0, 1.0) * 255.0)) << (8 * c);
+    return packed;
+}
+
+} // namespace
+
+/*
+    BUFFER, PIPELINE, DRAWABLE
+*/
+SoftwareBuffer::SoftwareBuffer(const void *bytes, size_t size) : bytes(size) {
+    if (bytes && size)
+        std::memcpy(this->bytes.data(), bytes, size);
+}
+
+size_t SoftwareBuffer::getSize() const {
+    return bytes.size();
+}
+
+void *SoftwareBuffer::map() {
+    return bytes.data();
+}
+
+void SoftwareBuffer::didModifyRange(size_t, size_t) {}
+
+const uint8_t *SoftwareBuffer::getBytes() const {
+    return bytes.data();
+}
+
+SoftwarePipeline::SoftwarePipeline(RasterVertexStage stage, bool blending) : stage(stage), blending(blending) {}
+
+SoftwareDrawPacket::SoftwareDrawPacket(std::vector<RasterDraw> draws, std::vector<size_t> transformOffsets)
+    : draws(std::move(draws)), transformOffsets(std::move(transformOffsets)) {}
+
+size_t SoftwareDrawPacket::getDrawCount() const {
+    return draws.size();
+}
+
+const std::vector<RasterDraw> &SoftwareDrawPacket::getDraws() const {
+    return draws;
+}
+
+const std::vector<size_t> &SoftwareDrawPacket::getTransformOffsets() const {
+    return transformOffsets;
+}
+
+SoftwareDrawable::SoftwareDrawable(uint32_t width, uint32_t height) : width(width), height(height) {}
+
+uint32_t SoftwareDrawable::getWidth() const {
+    return width;
+}
+
+uint32_t SoftwareDrawable::getHeight() const {
+    return height;
+}
+
+/*
+    ENCODER
+*/
+SoftwareEncoder::SoftwareEncoder(SoftwareDevice &device) : device(device) {}
+
+void SoftwareEncoder::setPipeline(const void *pipeline) {
+    this->pipeline = static_cast<const SoftwarePipeline *>(static_cast<const GfxPipeline *>(pipeline));
+}
+
+void SoftwareEncoder::setVertexBuffer(const void *buffer, uint32_t index) {
+    const SoftwareBuffer *software = static_cast<const SoftwareBuffer *>(static_cast<const GfxBuffer *>(buffer));
+    if (index == vertexStreamIndex)
+        vertexBuffer = software;
+    else if (index == colorStreamIndex)
+        colorBuffer = software;
+    else if (index == transformIndex) {
+        transformBuffer = software;
+        setVertexBufferOffset(0, index);
+    }
+}
+
+void SoftwareEncoder::setVertexBufferOffset(size_t offset, uint32_t index) {
+    if (index != transformIndex)
+        return;
+    transformOffset = offset;
+    if (transformBuffer)
+        readTransform(offset, transform);
+}
+
+void SoftwareEncoder::setVertexBytes(const void *bytes, size_t size, uint32_t index) {
+    // Other indices only feed shaders the rasterizer doesn't run
+    if (index == transformIndex) {
+        std::memcpy(transform, bytes, std::min(size, sizeof(transform)));
+        transformBuffer = nullptr;
+        transformOffset = SIZE_MAX;
+    }
+    else if (index == dequantizationIndex)
+        std::memcpy(&dequantization, bytes, std::min(size, sizeof(dequantization)));
+    else if (index == viewProjectionIndex)
+        std::memcpy(viewProjection, bytes, std::min(size, sizeof(viewProjection)));
+}
+
+void SoftwareEncoder::draw(const DrawRecord &record) {
+    draws.push_back(makeDraw(record));
+}
+
+void SoftwareEncoder::drawIndexed(const DrawRecord &record) {
+    RasterDraw draw = makeDraw(record);
+    const SoftwareBuffer *indices = static_cast<const SoftwareBuffer *>(static_cast<const GfxBuffer *>(record.indexBuffer));
+    draw.indices = indices->getBytes();
+    draw.indexBytes = indices->getSize();
+    draws.push_back(draw);
+}
+
+void SoftwareEncoder::submit(const DrawRecord *records, size_t count) {
+    submitDrawList(records, count, *this);
+}
+
+/**
+ * @brief Appends the packet's draws, those with a transform slot read it from the bound transform buffer.
+ *
+ * Every draw takes the view-projection bound now, not the one bound when the packet was baked.
+ *
+ * @throws std::runtime_error If one of those reads falls outside the buffer, or none is bound.
+ */
+void SoftwareEncoder::execute(const GfxDrawPacket *packet) {
+    const SoftwareDrawPacket *software = static_cast<const SoftwareDrawPacket *>(packet);
+    const std::vector<RasterDraw> &baked = software->getDraws();
+    const std::vector<size_t> &offsets = software->getTransformOffsets();
+    const size_t first = draws.size();
+    draws.insert(draws.end(), baked.begin(), baked.end());
+    drawTransformOffsets.insert(drawTransformOffsets.end(), offsets.begin(), offsets.end());
+    for (size_t i = 0; i < offsets.size(); ++i) {
+        if (offsets[i] != SIZE_MAX)
+            readTransform(offsets[i], draws[first + i].transform);
+        std::memcpy(draws[first + i].viewProjection, viewProjection, sizeof(viewProjection));
+    }
+}
+
+/**
+ * @brief Rasterizes every draw of the pass.
+ */
+void SoftwareEncoder::endEncoding() {
+    device.rasterizer.render(draws, device.target);
+    reset();
+}
+
+void SoftwareEncoder::reset() {
+    pipeline = nullptr;
+    vertexBuffer = nullptr;
+    colorBuffer = nullptr;
+    transformBuffer = nullptr;
+    transformOffset = SIZE_MAX;
+    std::memcpy(viewProjection, identityMatrix, sizeof(viewProjection));
+    draws.clear();
+    drawTransformOffsets.clear();
+}
+
+/*
+    Snapshots the bound state, like a command buffer would
+*/
+RasterDraw SoftwareEncoder::makeDraw(const DrawRecord &record) {
+    if (!pipeline)
+        throw std::runtime_error("No Pipeline State");
+    if (!vertexBuffer)
+        throw std::runtime_error("No Vertex Buffer");
+
+    RasterDraw draw{};
+    draw.stage = pipeline->stage;
+    draw.vertices = vertexBuffer->getBytes();
+    draw.vertexBytes = vertexBuffer->getSize();
+    if (colorBuffer) {
+        draw.colors = colorBuffer->getBytes();
+        draw.colorBytes = colorBuffer->getSize();
+    }
+    draw.indexFormat = record.indexFormat;
+    draw.topology = record.topology;
+    draw.start = record.start;
+    draw.count = record.count;
+    draw.instanceCount = record.instanceCount;
+    draw.baseVertex = record.baseVertex;
+    std::memcpy(draw.transform, transform, sizeof(transform));
+    std::memcpy(draw.viewProjection, viewProjection, sizeof(viewProjection));
+    draw.dequantization = dequantization;
+    draw.blending = pipeline->blending;
+    drawTransformOffsets.push_back(transformOffset);
+    return draw;
+}
+
+/*
+    The affine matrix at offset in the bound transform buffer
+*/
+void SoftwareEncoder::readTransform(size_t offset, float *out) const {
+    if (!transformBuffer || offset > transformBuffer->getSize() ||
+        transformBuffer->getSize() - offset < transformSlotSize)
+        throw std::runtime_error("Transform read outside the bound transform buffer");
+    std::memcpy(out, transformBuffer->getBytes() + offset, transformSlotSize);
+}
+
+/*
+    DEVICE
+*/
+SoftwareDevice::SoftwareDevice(uint32_t width, uint32_t height, bool depthTest, ThreadPool &pool)
+    : drawable(width, height), rasterizer(pool), encoder(*this) {
+    if (width == 0 || height == 0 || width > SoftwareRasterizer::maxTargetSize ||
+        height > SoftwareRasterizer::maxTargetSize)
+        throw std::runtime_error("Unsupported software render target size");
+
+    // Rows padded to whole 4 pixel blocks, see SoftwareRasterizer
+    const uint32_t stride = (width + 3) & ~3u;
+    color.assign(size_t(stride) * height, 0);
+    if (depthTest)
+        depth.assign(size_t(stride) * height, 1.0f);
+    target = {width, height, stride, color.data(), depthTest ? depth.data() : nullptr};
+}
+
+const char *SoftwareDevice::getName() const {
+    return "software";
+}
+
+GfxBuffer *SoftwareDevice::newBuffer(const void *bytes, size_t size) {
+    return new SoftwareBuffer(bytes, size);
+}
+
+/**
+ * @throws std::runtime_error If the rasterizer can't run the functions.
+ */
+GfxPipeline *SoftwareDevice::newPipeline(const GfxPipelineDesc &desc) {
+    RasterVertexStage stage;
+    if (!findVertexStage(desc.vertexFunction, stage))
+        throw std::runtime_error("The software backend has no " + desc.vertexFunction);
+    if (desc.fragmentFunction != "fragment_main")
+        throw std::runtime_error("The software backend has no " + desc.fragmentFunction);
+    return new SoftwarePipeline(stage, desc.blending);
+}
+
+/**
+ * @brief Snapshots the records' draws with the state each one binds, as a pass would.
+ *
+ * @throws std::runtime_error For invalid records, see GfxDevice::newDrawPacket().
+ */
+GfxDrawPacket *SoftwareDevice::newDrawPacket(const DrawRecord *records, size_t count) {
+    const BakedDrawList baked(records, count);
+    SoftwareEncoder baker(*this);
+    submitDrawList(baked.data(), baked.size(), baker);
+    return new SoftwareDrawPacket(std::move(baker.draws), std::move(baker.drawTransformOffsets));
+}
+
+GfxDrawable *SoftwareDevice::beginFrame() {
+    return &drawable;
+}
+
+GfxEncoder *SoftwareDevice::beginPass(const std::array<double, 4> &clearColor) {
+    rasterizer.clear(target, packClearColor(clearColor));
+    encoder.reset();
+    return &encoder;
+}
+
+void SoftwareDevice::endFrame(std::function<void()> completed) {
+    if (completed)
+        completed();
+}
+
+void SoftwareDevice::waitIdle() {}
+
+uint32_t SoftwareDevice::getWidth() const {
+    return target.width;
+}
+
+uint32_t SoftwareDevice::getHeight() const {
+    return target.height;
+}
+
+std::vector<uint32_t> SoftwareDevice::readPixels() const {
+    std::vector<uint32_t> pixels(size_t(target.width) * target.height);
+    readPixels(pixels.data());
+    return pixels;
+}
+
+void SoftwareDevice::readPixels(uint32_t *out) const {
+    readPixels(out, target.width, target.width, target.height);
+}
+
+void SoftwareDevice::readPixels(uint32_t *out, size_t stride, uint32_t columns, uint32_t rows) const {
+    columns = std::min(columns, target.width);
+    for (uint32_t y = 0; y < std::min(rows, target.height); ++y)
+        std::copy_n(color.data() + size_t(y) * target.stride, columns, out + y * stride);
+}
+
+std::vector<float> SoftwareDevice::readDepth() const {
+    std::vector<float> values;
+    if (depth.empty())
+        return values;
+    values.resize(size_t(target.width) * target.height);
+    for (uint32_t y = 0; y < target.height; ++y)
+        std::copy_n(depth.data() + size_t(y) * target.stride, target.width, values.data() + size_t(y) * target.width);
+    return values;
+}
+
+const RasterStats &SoftwareDevice::getStats() const {
+    return rasterizer.getStats();
+}
+
+void SoftwareDevice::resetStats() {
+    rasterizer.resetStats();
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "GfxDevice.h"
+#include "SoftwareRasterizer.h"
+
+/*
+-------------------------------------------------------------------
+  SOFTWARE DEVICE  --------------------------------------------------
+
+  A GfxDevice that draws on the CPU with SoftwareRasterizer, into an image of its own
+  instead of a window. Frames are rendered when their pass ends and complete inside
+  endFrame(), readPixels() then returns the image.
+
+  Transforms read from a bound transform buffer are copied when a draw is recorded, or when a
+  packet runs for the draws it holds, so the buffer may be rewritten after the pass ends. The
+  view-projection sent to buffer(14) is copied the same way, identity until a pass sets one.
+
+  Pipelines may use the vertex functions of the opaque and quantized layouts
+  (vertex_main, vertex_interleaved, vertex_quantized, vertex_quantized_interleaved) with
+  fragment_main, anything else throws std::runtime_error when the pipeline is created.
+-------------------------------------------------------------------
+*/
+
+class SoftwareBuffer final : public GfxBuffer {
+public:
+    SoftwareBuffer(const void *bytes, size_t size);
+
+    size_t getSize() const override;
+
+    void *map() override;
+
+    void didModifyRange(size_t offset, size_t size) override;
+
+    const uint8_t *getBytes() const;
+
+private:
+    std::vector<uint8_t> bytes;
+};
+
+class SoftwarePipeline final : public GfxPipeline {
+public:
+    SoftwarePipeline(RasterVertexStage stage, bool blending);
+
+    RasterVertexStage stage;
+    bool blending;
+};
+
+// Draws snapshotted when the packet is baked, executing it only appends them to the pass
+// (with the transforms of draws that use a transform slot read again, and the pass's view-projection)
+class SoftwareDrawPacket final : public GfxDrawPacket {
+public:
+    SoftwareDrawPacket(std::vector<RasterDraw> draws, std::vector<size_t> transformOffsets);
+
+    size_t getDrawCount() const override;
+
+    const std::vector<RasterDraw> &getDraws() const;
+
+    // Per draw, into the bound transform buffer, SIZE_MAX for transforms baked in
+    const std::vector<size_t> &getTransformOffsets() const;
+
+private:
+    std::vector<RasterDraw> draws;
+    std::vector<size_t> transformOffsets;
+};
+
+class SoftwareDevice;
+
+// Collects draws with the state bound at the time, the pass is rasterized by endEncoding()
+class SoftwareEncoder final : public GfxEncoder {
+public:
+    explicit SoftwareEncoder(SoftwareDevice &device);
+
+    void setPipeline(const void *pipeline) override;
+
+    void setVertexBuffer(const void *buffer, uint32_t index) override;
+
+    // Reads the transform at offset when a transform buffer is bound, packets being baked have none
+    void setVertexBufferOffset(size_t offset, uint32_t index) override;
+
+    void setVertexBytes(const void *bytes, size_t size, uint32_t index) override;
+
+    void draw(const DrawRecord &record) override;
+
+    void drawIndexed(const DrawRecord &record) override;
+
+    void submit(const DrawRecord *records, size_t count) override;
+
+    void execute(const GfxDrawPacket *packet) override;
+
+    void endEncoding() override;
+
+    void reset();
+
+private:
+    friend class SoftwareDevice;
+
+    SoftwareDevice &device;
+    const SoftwarePipeline *pipeline{nullptr};
+    const SoftwareBuffer *vertexBuffer{nullptr};
+    const SoftwareBuffer *colorBuffer{nullptr};
+    const SoftwareBuffer *transformBuffer{nullptr};
+    size_t transformOffset{SIZE_MAX};       // Of the transform, SIZE_MAX when it was sent as bytes
+    float transform[12]{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0};
+    float viewProjection[16]{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    QuantizationParams dequantization{};
+    std::vector<RasterDraw> draws;
+    std::vector<size_t> drawTransformOffsets;   // transformOffset of each draw
+
+    RasterDraw makeDraw(const DrawRecord &record);
+    void readTransform(size_t offset, float *out) const;
+};
+
+class SoftwareDrawable final : public GfxDrawable {
+public:
+    SoftwareDrawable(uint32_t width, uint32_t height);
+
+    uint32_t getWidth() const override;
+
+    uint32_t getHeight() const override;
+
+private:
+    uint32_t width;
+    uint32_t height;
+};
+
+class SoftwareDevice final : public GfxDevice {
+public:
+    // Throws std::runtime_error if the size is 0 or above SoftwareRasterizer::maxTargetSize
+    SoftwareDevice(uint32_t width, uint32_t height, bool depthTest = true, ThreadPool &pool = ThreadPool::shared());
+
+    SoftwareDevice(const SoftwareDevice &) = delete;
+    SoftwareDevice &operator=(const SoftwareDevice &) = delete;
+
+    const char *getName() const override;
+
+    GfxBuffer *newBuffer(const void *bytes, size_t size) override;
+
+    GfxPipeline *newPipeline(const GfxPipelineDesc &desc) override;
+
+    GfxDrawPacket *newDrawPacket(const DrawRecord *records, size_t count) override;
+
+    GfxDrawable *beginFrame() override;
+
+    GfxEncoder *beginPass(const std::array<double, 4> &clearColor) override;
+
+    void endFrame(std::function<void()> completed) override;
+
+    void waitIdle() override;
+
+    uint32_t getWidth() const;
+
+    uint32_t getHeight() const;
+
+    // The image so far, width * height RGBA8 pixels with red in the lowest byte, top row first
+    std::vector<uint32_t> readPixels() const;
+
+    // The same into width * height pixels at out
+    void readPixels(uint32_t *out) const;
+
+    // The top left columns x rows pixels (at most the size) into rows stride pixels apart
+    void readPixels(uint32_t *out, size_t stride, uint32_t columns, uint32_t rows) const;
+
+    // Empty without a depth test
+    std::vector<float> readDepth() const;
+
+    const RasterStats &getStats() const;
+
+    void resetStats();
+
+private:
+    friend class SoftwareEncoder;
+
+    SoftwareDrawable drawable;
+    SoftwareRasterizer rasterizer;
+    SoftwareEncoder encoder;
+    RasterTarget target;
+    std::vector<uint32_t> color;
+    std::vector<float> depth;
+};
@@ -0,0 +1,672 @@
+#include "SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+constexpr int32_t subpixels = 1 << SoftwareRasterizer::subpixelBits;
+constexpr float guardBandPixels = 8192.0f;      // Beyond the target on every side, see clipPlanes
+constexpr float minClipW = 1e-6f;
+constexpr size_t minChunkTriangles = 1024;
+
+// A vertex after the vertex stage: clip space position, then color
+using ClipVertex = std::array<float, 8>;
+
+/*
+    4 PIXEL LANES
+      Just what the tile loop needs, on SSE2, NEON or plain arrays
+*/
+#if defined(__SSE2__)
+using IntLanes = __m128i;
+using FloatLanes = __m128;
+
+inline IntLanes splatInt(int32_t v) { return _mm_set1_epi32(v); }
+inline IntLanes setInt(int32_t a, int32_t b, int32_t c, int32_t d) { return _mm_setr_epi32(a, b, c, d); }
+inline IntLanes addInt(IntLanes a, IntLanes b) { return _mm_add_epi32(a, b); }
+inline IntLanes andInt(IntLanes a, IntLanes b) { return _mm_and_si128(a, b); }
+inline IntLanes orInt(IntLanes a, IntLanes b) { return _mm_or_si128(a, b); }
+inline IntLanes positive(IntLanes a) { return _mm_cmpgt_epi32(a, _mm_setzero_si128()); }
+inline IntLanes shiftLeft(IntLanes a, int bits) { return _mm_sll_epi32(a, _mm_cvtsi32_si128(bits)); }
+inline IntLanes loadInt(const uint32_t *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+inline void storeInt(uint32_t *p, IntLanes v) { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v); }
+inline IntLanes selectInt(IntLanes mask, IntLanes a, IntLanes b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+inline int laneBits(IntLanes mask) { return _mm_movemask_ps(_mm_castsi128_ps(mask)); }
+
+inline FloatLanes splat(float v) { return _mm_set1_ps(v); }
+inline FloatLanes setFloat(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+inline FloatLanes add(FloatLanes a, FloatLanes b) { return _mm_add_ps(a, b); }
+inline FloatLanes mul(FloatLanes a, FloatLanes b) { return _mm_mul_ps(a, b); }
+inline FloatLanes div(FloatLanes a, FloatLanes b) { return _mm_div_ps(a, b); }
+inline FloatLanes clamp01(FloatLanes a) { return _mm_min_ps(_mm_max_ps(a, _mm_setzero_ps()), _mm_set1_ps(1.0f)); }
+inline IntLanes less(FloatLanes a, FloatLanes b) { return _mm_castps_si128(_mm_cmplt_ps(a, b)); }
+inline FloatLanes load(const float *p) { return _mm_loadu_ps(p); }
+inline void store(float *p, FloatLanes v) { _mm_storeu_ps(p, v); }
+inline FloatLanes select(IntLanes mask, FloatLanes a, FloatLanes b) {
+    const __m128 m = _mm_castsi128_ps(mask);
+    return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+inline IntLanes roundToInt(FloatLanes a) { return _mm_cvtps_epi32(a); }     // Nearest even
+#elif defined(__ARM_NEON)
+using IntLanes = int32x4_t;
+using FloatLanes = float32x4_t;
+
+inline IntLanes splatInt(int32_t v) { return vdupq_n_s32(v); }
+inline IntLanes setInt(int32_t a, int32_t b, int32_t c, int32_t d) {
+    const int32_t v[4] = {a, b, c, d};
+    return vld1q_s32(v);
+}
+inline IntLanes addInt(IntLanes a, IntLanes b) { return vaddq_s32(a, b); }
+inline IntLanes andInt(IntLanes a, IntLanes b) { return vandq_s32(a, b); }
+inline IntLanes orInt(IntLanes a, IntLanes b) { return vorrq_s32(a, b); }
+inline IntLanes positive(IntLanes a) { return vreinterpretq_s32_u32(vcgtq_s32(a, vdupq_n_s32(0))); }
+inline IntLanes shiftLeft(IntLanes a, int bits) { return vshlq_s32(a, vdupq_n_s32(bits)); }
+inline IntLanes loadInt(const uint32_t *p) { return vreinterpretq_s32_u32(vld1q_u32(p)); }
+inline void storeInt(uint32_t *p, IntLanes v) { vst1q_u32(p, vreinterpretq_u32_s32(v)); }
+inline IntLanes selectInt(IntLanes mask, IntLanes a, IntLanes b) {
+    return vbslq_s32(vreinterpretq_u32_s32(mask), a, b);
+}
+inline int laneBits(IntLanes mask) {
+    const uint32x4_t bits = vandq_u32(vreinterpretq_u32_s32(mask), uint32x4_t{1, 2, 4, 8});
+    return static_cast<int>(vgetq_lane_u32(bits, 0) | vgetq_lane_u32(bits, 1) | vgetq_lane_u32(bits, 2) |
+                            vgetq_lane_u32(bits, 3));
+}
+
+inline FloatLanes splat(float v) { return vdupq_n_f32(v); }
+inline FloatLanes setFloat(float a, float b, float c, float d) {
+    const float v[4] = {a, b, c, d};
+    return vld1q_f32(v);
+}
+inline FloatLanes add(FloatLanes a, FloatLanes b) { return vaddq_f32(a, b); }
+inline FloatLanes mul(FloatLanes a, FloatLanes b) { return vmulq_f32(a, b); }
+inline FloatLanes div(FloatLanes a, FloatLanes b) {
+    // vdivq_f32 is aarch64 only, two Newton steps on the estimate are as good for colors
+    float32x4_t r = vrecpeq_f32(b);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    return vmulq_f32(a, r);
+}
+inline FloatLanes clamp01(FloatLanes a) { return vminq_f32(vmaxq_f32(a, vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f)); }
+inline IntLanes less(FloatLanes a, FloatLanes b) { return vreinterpretq_s32_u32(vcltq_f32(a, b)); }
+inline FloatLanes load(const float *p) { return vld1q_f32(p); }
+inline void store(float *p, FloatLanes v) { vst1q_f32(p, v); }
+inline FloatLanes select(IntLanes mask, FloatLanes a, FloatLanes b) {
+    return vbslq_f32(vreinterpretq_u32_s32(mask), a, b);
+}
+inline IntLanes roundToInt(FloatLanes a) {
+#if defined(__aarch64__)
+    return vcvtnq_s32_f32(a);       // Nearest even, like SSE2
+#else
+    // Inputs are in [0, 255], adding one half and truncating rounds them (ties up)
+    return vcvtq_s32_f32(vaddq_f32(a, vdupq_n_f32(0.5f)));
+#endif
+}
+#else
+struct IntLanes {
+    int32_t v[4];
+};
+struct FloatLanes {
+    float v[4];
+};
+
+template <typename Lanes, typename F>
+inline Lanes lanewise(F f) {
+    Lanes out;
+    for (int i = 0; i < 4; ++i)
+        out.v[i] = f(i);
+    return out;
+}
+
+inline IntLanes splatInt(int32_t v) { return {{v, v, v, v}}; }
+inline IntLanes setInt(int32_t a, int32_t b, int32_t c, int32_t d) { return {{a, b, c, d}}; }
+inline IntLanes addInt(IntLanes a, IntLanes b) {
+    return lanewise<IntLanes>([&](int i) { return int32_t(uint32_t(a.v[i]) + uint32_t(b.v[i])); });
+}
+inline IntLanes andInt(IntLanes a, IntLanes b) { return lanewise<IntLanes>([&](int i) { return a.v[i] & b.v[i]; }); }
+inline IntLanes orInt(IntLanes a, IntLanes b) { return lanewise<IntLanes>([&](int i) { return a.v[i] | b.v[i]; }); }
+inline IntLanes positive(IntLanes a) { return lanewise<IntLanes>([&](int i) { return a.v[i] > 0 ? -1 : 0; }); }
+inline IntLanes shiftLeft(IntLanes a, int bits) {
+    return lanewise<IntLanes>([&](int i) { return int32_t(uint32_t(a.v[i]) << bits); });
+}
+inline IntLanes loadInt(const uint32_t *p) { return lanewise<IntLanes>([&](int i) { return int32_t(p[i]); }); }
+inline void storeInt(uint32_t *p, IntLanes v) {
+    for (int i = 0; i < 4; ++i)
+        p[i] = uint32_t(v.v[i]);
+}
+inline IntLanes selectInt(IntLanes mask, IntLanes a, IntLanes b) {
+    return lanewise<IntLanes>([&](int i) { return mask.v[i] ? a.v[i] : b.v[i]; });
+}
+inline int laneBits(IntLanes mask) {
+    return (mask.v[0] ? 1 : 0) | (mask.v[1] ? 2 : 0) | (mask.v[2] ? 4 : 0) | (mask.v[3] ? 8 : 0);
+}
+
+inline FloatLanes splat(float v) { return {{v, v, v, v}}; }
+inline FloatLanes setFloat(float a, float b, float c, float d) { return {{a, b, c, d}}; }
+inline FloatLanes add(FloatLanes a, FloatLanes b) { return lanewise<FloatLanes>([&](int i) { return a.v[i] + b.v[i]; }); }
+inline FloatLanes mul(FloatLanes a, FloatLanes b) { return lanewise<FloatLanes>([&](int i) { return a.v[i] * b.v[i]; }); }
+inline FloatLanes div(FloatLanes a, FloatLanes b) { return lanewise<FloatLanes>([&](int i) { return a.v[i] / b.v[i]; }); }
+inline FloatLanes clamp01(FloatLanes a) {
+    return lanewise<FloatLanes>([&](int i) { return std::min(std::max(a.v[i], 0.0f), 1.0f); });
+}
+inline IntLanes less(FloatLanes a, FloatLanes b) {
+    return lanewise<IntLanes>([&](int i) { return a.v[i] < b.v[i] ? -1 : 0; });
+}
+inline FloatLanes load(const float *p) { return lanewise<FloatLanes>([&](int i) { return p[i]; }); }
+inline void store(float *p, FloatLanes v) {
+    for (int i = 0; i < 4; ++i)
+        p[i] = v.v[i];
+}
+inline FloatLanes select(IntLanes mask, FloatLanes a, FloatLanes b) {
+    return lanewise<FloatLanes>([&](int i) { return mask.v[i] ? a.v[i] : b.v[i]; });
+}
+inline IntLanes roundToInt(FloatLanes a) {
+    return lanewise<IntLanes>([&](int i) { return int32_t(std::nearbyint(a.v[i])); });
+}
+#endif
+
+/*
+    VERTEX STAGE
+*/
+size_t vertexStride(RasterVertexStage stage) {
+    switch (stage) {
+        case RasterVertexStage::Split: return 4 * sizeof(float);
+        case RasterVertexStage::Interleaved: return 8 * sizeof(float);
+        case RasterVertexStage::Quantized: return 4 * sizeof(uint16_t);
+        case RasterVertexStage::QuantizedInterleaved: return sizeof(QuantizedVertex);
+    }
+    return 0;
+}
+
+void unpackColor(uint32_t rgba, float *out) {
+    for (int c = 0; c < 4; ++c)
+        out[c] = static_cast<float>((rgba >> (8 * c)) & 0xffu) / 255.0f;
+}
+
+/*
+    Fetches a vertex and runs the draw's vertex function on it
+*/
+ClipVertex shadeVertex(const RasterDraw &draw, uint32_t vertex) {
+    const size_t stride = vertexStride(draw.stage);
+    if ((size_t(vertex) + 1) * stride > draw.vertexBytes)
+        throw std::runtime_error("Vertex outside of buffer(0)");
+    const bool split = draw.stage == RasterVertexStage::Split || draw.stage == RasterVertexStage::Quantized;
+    const size_t colorStride = draw.stage == RasterVertexStage::Split ? 4 * sizeof(float) : sizeof(uint32_t);
+    if (split && (size_t(vertex) + 1) * colorStride > draw.colorBytes)
+        throw std::runtime_error("Vertex outside of buffer(1)");
+
+    const uint8_t *source = draw.vertices + size_t(vertex) * stride;
+    float position[4];
+    ClipVertex out;
+    switch (draw.stage) {
+        case RasterVertexStage::Split:
+            std::memcpy(position, source, sizeof(position));
+            std::memcpy(&out[4], draw.colors + size_t(vertex) * colorStride, 4 * sizeof(float));
+            break;
+        case RasterVertexStage::Interleaved:
+            std::memcpy(position, source, sizeof(position));
+            std::memcpy(&out[4], source + sizeof(position), 4 * sizeof(float));
+            break;
+        case RasterVertexStage::Quantized:
+        case RasterVertexStage::QuantizedInterleaved: {
+            uint16_t bits[3];
+            uint32_t color;
+            std::memcpy(bits, source, sizeof(bits));
+            if (split)
+                std::memcpy(&color, draw.colors + size_t(vertex) * colorStride, sizeof(color));
+            else
+                std::memcpy(&color, source + offsetof(QuantizedVertex, color), sizeof(color));
+            decodePosition(bits, draw.dequantization, position);
+            unpackColor(color, &out[4]);
+            break;
+        }
+    }
+
+    // matrix * position, the rows of an affine matrix, w passes through
+    const float *m = draw.transform;
+    float world[4];
+    for (int r = 0; r < 3; ++r)
+        world[r] = m[4 * r] * position[0] + m[4 * r + 1] * position[1] + m[4 * r + 2] * position[2] +
+                   m[4 * r + 3] * position[3];
+    world[3] = position[3];
+
+    // Then viewProjection * world, column-major
+    const float *v = draw.viewProjection;
+    for (int r = 0; r < 4; ++r)
+        out[r] = v[r] * world[0] + v[4 + r] * world[1] + v[8 + r] * world[2] + v[12 + r] * world[3];
+    return out;
+}
+
+uint32_t fetchIndex(const RasterDraw &draw, uint32_t i) {
+    if (!draw.indices)
+        return draw.start + i;
+    const size_t size = indexSize(draw.indexFormat);
+    const size_t offset = draw.start + size_t(i) * size;
+    if (offset + size > draw.indexBytes)
+        throw std::runtime_error("Index outside of the index buffer");
+    if (draw.indexFormat == IndexFormat::UInt16) {
+        uint16_t index;
+        std::memcpy(&index, draw.indices + offset, sizeof(index));
+        return index + draw.baseVertex;
+    }
+    uint32_t index;
+    std::memcpy(&index, draw.indices + offset, sizeof(index));
+    return index + draw.baseVertex;
+}
+
+size_t trianglesPerInstance(const RasterDraw &draw) {
+    if (draw.topology == DrawTopology::Triangle)
+        return draw.count / 3;
+    return draw.count >= 3 ? draw.count - 2 : 0;
+}
+
+/*
+    CLIPPING
+      Near (z >= 0) and far (z <= w) as Metal clips, a guard band instead of the side planes
+      so snapped positions stay small enough for 32 bit edge functions, and w > 0
+*/
+constexpr int clipPlaneCount = 7;
+
+// Inside where x, y, z, w dotted with the first 4 is at least the 5th
+struct ClipPlanes {
+    float planes[clipPlaneCount][5];
+};
+
+ClipPlanes clipPlanes(uint32_t width, uint32_t height) {
+    const float gx = 1.0f + 2.0f * guardBandPixels / static_cast<float>(width);
+    const float gy = 1.0f + 2.0f * guardBandPixels / static_cast<float>(height);
+    return {{{0, 0, 1, 0, 0},
+             {0, 0, -1, 1, 0},
+             {1, 0, 0, gx, 0},
+             {-1, 0, 0, gx, 0},
+             {0, 1, 0, gy, 0},
+             {0, -1, 0, gy, 0},
+             {0, 0, 0, 1, minClipW}}};
+}
+
+inline float planeDistance(const float *plane, const ClipVertex &v) {
+    return plane[0] * v[0] + plane[1] * v[1] + plane[2] * v[2] + plane[3] * v[3] - plane[4];
+}
+
+/*
+    Sutherland-Hodgman against every plane, the result is a convex polygon (maybe empty)
+*/
+size_t clipPolygon(const ClipPlanes &planes, ClipVertex *polygon, size_t count, ClipVertex *scratch) {
+    for (int p = 0; p < clipPlaneCount && count >= 3; ++p) {
+        const float *plane = planes.planes[p];
+        size_t out = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const ClipVertex &a = polygon[i];
+            const ClipVertex &b = polygon[(i + 1) % count];
+            const float da = planeDistance(plane, a);
+            const float db = planeDistance(plane, b);
+            if (da >= 0.0f)
+                scratch[out++] = a;
+            if ((da >= 0.0f) != (db >= 0.0f)) {
+                const float t = da / (da - db);
+                for (int c = 0; c < 8; ++c)
+                    scratch[out][c] = a[c] + t * (b[c] - a[c]);
+                ++out;
+            }
+        }
+        std::copy(scratch, scratch + out, polygon);
+        count = out;
+    }
+    return count;
+}
+
+/*
+    SETUP
+*/
+inline int32_t floorDivide(int32_t a, int32_t b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+/*
+    Projects, snaps and builds the edge functions and attribute planes of one triangle.
+    False for degenerate and offscreen triangles
+*/
+bool setupTriangle(const ClipVertex *const v[3], const RasterTarget &target, bool blending,
+                   SoftwareRasterizer::Triangle &out) {
+    float window[3][2];
+    float attributes[3][6];
+    for (int i = 0; i < 3; ++i) {
+        const ClipVertex &c = *v[i];
+        const float invW = 1.0f / c[3];
+        window[i][0] = (c[0] * invW * 0.5f + 0.5f) * static_cast<float>(target.width);
+        window[i][1] = (0.5f - c[1] * invW * 0.5f) * static_cast<float>(target.height);   // Window y is down
+        attributes[i][0] = c[2] * invW;
+        attributes[i][1] = invW;
+        for (int k = 0; k < 4; ++k)
+            attributes[i][2 + k] = c[4 + k] * invW;
+        out.x[i] = static_cast<int32_t>(std::lrint(window[i][0] * subpixels));
+        out.y[i] = static_cast<int32_t>(std::lrint(window[i][1] * subpixels));
+    }
+
+    const int64_t area = int64_t(out.x[1] - out.x[0]) * (out.y[2] - out.y[0]) -
+                         int64_t(out.y[1] - out.y[0]) * (out.x[2] - out.x[0]);
+    if (area == 0)
+        return false;
+    int order[3] = {0, 1, 2};
+    if (area < 0)
+        std::swap(order[1], order[2]);      // Counter-clockwise in window space, so inside is positive
+    const int32_t x[3] = {out.x[order[0]], out.x[order[1]], out.x[order[2]]};
+    const int32_t y[3] = {out.y[order[0]], out.y[order[1]], out.y[order[2]]};
+
+    // Bounds of the pixel centers inside, (p * 16 + 8) between the extremes
+    const int32_t half = subpixels / 2;
+    const int32_t minX = std::max(0, -floorDivide(-(std::min({x[0], x[1], x[2]}) - half), subpixels));
+    const int32_t minY = std::max(0, -floorDivide(-(std::min({y[0], y[1], y[2]}) - half), subpixels));
+    const int32_t maxX = std::min(int32_t(target.width) - 1, floorDivide(std::max({x[0], x[1], x[2]}) - half, subpixels));
+    const int32_t maxY = std::min(int32_t(target.height) - 1, floorDivide(std::max({y[0], y[1], y[2]}) - half, subpixels));
+    if (minX > maxX || minY > maxY)
+        return false;
+
+    for (int k = 0; k < 3; ++k) {
+        // Edge opposite vertex k, from a to b
+        const int a = (k + 1) % 3, b = (k + 2) % 3;
+        const int32_t edgeA = y[a] - y[b];
+        const int32_t edgeB = x[b] - x[a];
+        const bool topLeft = edgeA > 0 || (edgeA == 0 && edgeB > 0);
+        out.edgeA[k] = edgeA;
+        out.edgeB[k] = edgeB;
+        out.edgeC[k] = -(int64_t(edgeA) * x[a] + int64_t(edgeB) * y[a]) + (topLeft ? 1 : 0);
+    }
+    for (int i = 0; i < 3; ++i) {
+        out.x[i] = x[i];
+        out.y[i] = y[i];
+    }
+    out.minX = minX;
+    out.minY = minY;
+    out.maxX = maxX;
+    out.maxY = maxY;
+
+    // Attribute planes from the snapped positions, relative to vertex 0
+    const double x0 = double(x[0]) / subpixels, y0 = double(y[0]) / subpixels;
+    const double x1 = double(x[1]) / subpixels - x0, y1 = double(y[1]) / subpixels - y0;
+    const double x2 = double(x[2]) / subpixels - x0, y2 = double(y[2]) / subpixels - y0;
+    const double det = x1 * y2 - x2 * y1;
+    out.originX = static_cast<float>(x0);
+    out.originY = static_cast<float>(y0);
+    for (int p = 0; p < 6; ++p) {
+        const double a0 = attributes[order[0]][p];
+        const double d1 = attributes[order[1]][p] - a0;
+        const double d2 = attributes[order[2]][p] - a0;
+        out.planes[p][0] = static_cast<float>(a0);
+        out.planes[p][1] = static_cast<float>((d1 * y2 - d2 * y1) / det);
+        out.planes[p][2] = static_cast<float>((d2 * x1 - d1 * x2) / det);
+    }
+    out.blending = blending;
+    return true;
+}
+
+/*
+    FRAGMENT STAGE
+*/
+uint32_t blendSourceOver(const float *source, uint32_t destination) {
+    float d[4];
+    unpackColor(destination, d);
+    const float a = source[3];
+    uint32_t packed = 0;
+    for (int c = 0; c < 4; ++c) {
+        const float out = c < 3 ? source[c] * a + d[c] * (1.0f - a) : a + d[3] * (1.0f - a);
+        packed |= static_cast<uint32_t>(std::nearbyint(std::min(std::max(out, 0.0f), 1.0f) * 255.0f)) << (8 * c);
+    }
+    return packed;
+}
+
+/*
+    Rasterizes one triangle's part of a tile, 4 pixels at a time. Returns the pixels written
+*/
+uint64_t rasterizeTile(const SoftwareRasterizer::Triangle &tri, const RasterTarget &target, int32_t tileX,
+                       int32_t tileY) {
+    const int32_t x0 = std::max(tileX, tri.minX) & ~3;
+    const int32_t x1 = std::min(tileX + int32_t(SoftwareRasterizer::tileSize) - 1, tri.maxX);
+    const int32_t xLast = (x1 | 3);                     // Lanes run to the end of the last block
+    const int32_t y0 = std::max(tileY, tri.minY);
+    const int32_t y1 = std::min(tileY + int32_t(SoftwareRasterizer::tileSize) - 1, tri.maxY);
+    if (x0 > x1 || y0 > y1)
+        return 0;
+
+    // Edges either reject the block, contain it, or cross it and are tested per pixel
+    IntLanes edgeRow[3], edgeStep[3], rowStep[3];
+    int active = 0;
+    for (int k = 0; k < 3; ++k) {
+        const int64_t a = tri.edgeA[k], b = tri.edgeB[k];
+        auto edgeAt = [&](int32_t px, int32_t py) {
+            return a * (int64_t(px) * subpixels + subpixels / 2) + b * (int64_t(py) * subpixels + subpixels / 2) +
+                   tri.edgeC[k];
+        };
+        const int64_t maxValue = edgeAt(a > 0 ? xLast : x0, b > 0 ? y1 : y0);
+        if (maxValue <= 0)
+            return 0;
+        const int64_t minValue = edgeAt(a > 0 ? x0 : xLast, b > 0 ? y0 : y1);
+        if (minValue > 0)
+            continue;
+        // Within the block the value is between minValue and maxValue, well inside 32 bits
+        const int32_t origin = static_cast<int32_t>(edgeAt(x0, y0));
+        const int32_t dx = tri.edgeA[k] * subpixels;
+        edgeRow[active] = setInt(origin, origin + dx, origin + 2 * dx, origin + 3 * dx);
+        edgeStep[active] = splatInt(4 * dx);
+        rowStep[active] = splatInt(tri.edgeB[k] * subpixels);
+        ++active;
+    }
+
+    const FloatLanes laneOffsets = setFloat(0.0f, 1.0f, 2.0f, 3.0f);
+    const int32_t width = static_cast<int32_t>(target.width);
+    uint64_t written = 0;
+    for (int32_t y = y0; y <= y1; ++y) {
+        IntLanes edges[3] = {edgeRow[0], edgeRow[1], edgeRow[2]};
+        const float py = static_cast<float>(y) + 0.5f - tri.originY;
+        uint32_t *colorRow = target.color + size_t(y) * target.stride;
+        float *depthRow = target.depth ? target.depth + size_t(y) * target.stride : nullptr;
+
+        for (int32_t x = x0; x <= x1; x += 4) {
+            IntLanes mask = positive(addInt(splatInt(width - x), setInt(0, -1, -2, -3)));   // Inside the target
+            for (int k = 0; k < active; ++k) {
+                mask = andInt(mask, positive(edges[k]));
+                edges[k] = addInt(edges[k], edgeStep[k]);
+            }
+            if (!laneBits(mask))
+                continue;
+
+            const FloatLanes px = add(splat(static_cast<float>(x) + 0.5f - tri.originX), laneOffsets);
+            auto plane = [&](int p) {
+                return add(splat(tri.planes[p][0] + tri.planes[p][2] * py), mul(splat(tri.planes[p][1]), px));
+            };
+
+            const FloatLanes z = clamp01(plane(0));
+            if (depthRow) {
+                const FloatLanes stored = load(depthRow + x);
+                mask = andInt(mask, less(z, stored));
+                if (!laneBits(mask))
+                    continue;
+                store(depthRow + x, select(mask, z, stored));
+            }
+
+            // Perspective correct color, as the interpolated stage_in of fragment_main
+            const FloatLanes w = div(splat(1.0f), plane(1));
+            FloatLanes rgba[4];
+            for (int c = 0; c < 4; ++c)
+                rgba[c] = clamp01(mul(plane(2 + c), w));
+
+            const IntLanes stored = loadInt(colorRow + x);
+            IntLanes color;
+            if (!tri.blending) {
+                color = splatInt(0);
+                for (int c = 0; c < 4; ++c)
+                    color = orInt(color, shiftLeft(roundToInt(mul(rgba[c], splat(255.0f))), 8 * c));
+            } else {
+                alignas(16) float lanes[4][4];
+                alignas(16) uint32_t old[4], blended[4];
+                for (int c = 0; c < 4; ++c)
+                    store(lanes[c], rgba[c]);
+                storeInt(old, stored);
+                for (int i = 0; i < 4; ++i) {
+                    const float source[4] = {lanes[0][i], lanes[1][i], lanes[2][i], lanes[3][i]};
+                    blended[i] = blendSourceOver(source, old[i]);
+                }
+                color = loadInt(blended);
+            }
+            storeInt(colorRow + x, selectInt(mask, color, stored));
+
+            const int bits = laneBits(mask);
+            written += (bits & 1) + ((bits >> 1) & 1) + ((bits >> 2) & 1) + ((bits >> 3) & 1);
+        }
+        for (int k = 0; k < active; ++k)
+            edgeRow[k] = addInt(edgeRow[k], rowStep[k]);
+    }
+    return written;
+}
+
+} // namespace
+
+SoftwareRasterizer::SoftwareRasterizer(ThreadPool &pool) : pool(pool) {}
+
+/**
+ * @brief Fills the target, rows spread over the pool.
+ */
+void SoftwareRasterizer::clear(const RasterTarget &target, uint32_t color, float depth) {
+    pool.parallelFor(target.height, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y) {
+            std::fill_n(target.color + y * target.stride, target.stride, color);
+            if (target.depth)
+                std::fill_n(target.depth + y * target.stride, target.stride, depth);
+        }
+    });
+}
+
+/**
+ * @brief Renders the draws into the target, in submission order.
+ *
+ * Geometry runs in chunks of consecutive triangles, each binning into its own tile lists.
+ * Tiles then walk the chunks in order, so every pixel sees its triangles in the order they
+ * were submitted whatever the thread count.
+ *
+ * @throws std::runtime_error If a draw reads outside its buffers or the target is too large.
+ */
+void SoftwareRasterizer::render(const std::vector<RasterDraw> &draws, const RasterTarget &target) {
+    if (target.width == 0 || target.height == 0)
+        return;
+    if (target.width > maxTargetSize || target.height > maxTargetSize)
+        throw std::runtime_error("Render target is too large for the software rasterizer");
+    if (target.stride < target.width || target.stride % 4 != 0)
+        throw std::runtime_error("Render target rows must be padded to 4 pixels");
+
+    // Triangles of every draw and instance, numbered in submission order
+    std::vector<size_t> firstTriangle(draws.size() + 1, 0);
+    for (size_t d = 0; d < draws.size(); ++d)
+        firstTriangle[d + 1] = firstTriangle[d] + trianglesPerInstance(draws[d]) * draws[d].instanceCount;
+    const size_t triangleCount = firstTriangle.back();
+    if (triangleCount == 0)
+        return;
+
+    const uint32_t tilesX = (target.width + tileSize - 1) / tileSize;
+    const uint32_t tilesY = (target.height + tileSize - 1) / tileSize;
+    const size_t tileCount = size_t(tilesX) * tilesY;
+    const size_t grain = std::max(minChunkTriangles, (triangleCount + pool.size() * 4 - 1) / (pool.size() * 4));
+    const size_t chunkCount = (triangleCount + grain - 1) / grain;
+    if (chunks.size() < chunkCount)
+        chunks.resize(chunkCount);
+
+    const ClipPlanes planes = clipPlanes(target.width, target.height);
+    pool.parallelFor(chunkCount, 1, [&](size_t chunkBegin, size_t chunkEnd) {
+        for (size_t c = chunkBegin; c < chunkEnd; ++c) {
+            Chunk &chunk = chunks[c];
+            chunk.triangles.clear();
+            chunk.bins.resize(tileCount);
+            for (std::vector<uint32_t> &bin : chunk.bins)
+                bin.clear();
+            chunk.stats = {};
+
+            const size_t begin = c * grain, end = std::min(triangleCount, begin + grain);
+            size_t d = std::upper_bound(firstTriangle.begin(), firstTriangle.end(), begin) - firstTriangle.begin() - 1;
+            for (size_t t = begin; t < end; ++t) {
+                while (t >= firstTriangle[d + 1])
+                    ++d;
+                const RasterDraw &draw = draws[d];
+                const uint32_t local = static_cast<uint32_t>((t - firstTriangle[d]) % trianglesPerInstance(draw));
+                const uint32_t first = draw.topology == DrawTopology::Triangle ? 3 * local : local;
+
+                ClipVertex polygon[3 + clipPlaneCount], scratch[3 + clipPlaneCount];
+                for (uint32_t i = 0; i < 3; ++i)
+                    polygon[i] = shadeVertex(draw, fetchIndex(draw, first + i));
+                ++chunk.stats.triangles;
+
+                // Only triangles that cross a plane are clipped, those behind one are dropped
+                bool inside = true, outside = false;
+                for (const float *plane : planes.planes) {
+                    const float d0 = planeDistance(plane, polygon[0]), d1 = planeDistance(plane, polygon[1]),
+                                d2 = planeDistance(plane, polygon[2]);
+                    inside &= d0 >= 0.0f && d1 >= 0.0f && d2 >= 0.0f;
+                    outside |= d0 < 0.0f && d1 < 0.0f && d2 < 0.0f;
+                }
+                if (outside)
+                    continue;
+                size_t vertexCount = 3;
+                if (!inside) {
+                    ++chunk.stats.clipped;
+                    vertexCount = clipPolygon(planes, polygon, 3, scratch);
+                }
+
+                for (size_t i = 2; i < vertexCount; ++i) {
+                    const ClipVertex *fan[3] = {&polygon[0], &polygon[i - 1], &polygon[i]};
+                    Triangle triangle;
+                    if (!setupTriangle(fan, target, draw.blending, triangle))
+                        continue;
+                    const uint32_t index = static_cast<uint32_t>(chunk.triangles.size());
+                    chunk.triangles.push_back(triangle);
+                    ++chunk.stats.rasterized;
+                    for (int32_t ty = triangle.minY / int32_t(tileSize); ty <= triangle.maxY / int32_t(tileSize); ++ty)
+                        for (int32_t tx = triangle.minX / int32_t(tileSize); tx <= triangle.maxX / int32_t(tileSize); ++tx) {
+                            chunk.bins[size_t(ty) * tilesX + tx].push_back(index);
+                            ++chunk.stats.binned;
+                        }
+                }
+            }
+        }
+    });
+
+    // Tiles own their pixels, so they run in parallel without locks
+    std::vector<uint64_t> tilePixels(tileCount, 0);
+    pool.parallelFor(tileCount, 1, [&](size_t tileBegin, size_t tileEnd) {
+        for (size_t tile = tileBegin; tile < tileEnd; ++tile) {
+            const int32_t tileX = static_cast<int32_t>(tile % tilesX * tileSize);
+            const int32_t tileY = static_cast<int32_t>(tile / tilesX * tileSize);
+            for (size_t c = 0; c < chunkCount; ++c)
+                for (uint32_t index : chunks[c].bins[tile])
+                    tilePixels[tile] += rasterizeTile(chunks[c].triangles[index], target, tileX, tileY);
+        }
+    });
+
+    for (size_t c = 0; c < chunkCount; ++c) {
+        stats.triangles += chunks[c].stats.triangles;
+        stats.clipped += chunks[c].stats.clipped;
+        stats.rasterized += chunks[c].stats.rasterized;
+        stats.binned += chunks[c].stats.binned;
+    }
+    for (uint64_t pixels : tilePixels)
+        stats.pixels += pixels;
+}
+
+const RasterStats &SoftwareRasterizer::getStats() const {
+    return stats;
+}
+
+void SoftwareRasterizer::resetStats() {
+    stats = {};
+}
+
+ThreadPool &SoftwareRasterizer::getPool() const {
+    return pool;
+}
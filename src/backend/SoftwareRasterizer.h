@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../common/DrawList.h"
+#include "../common/ThreadPool.h"
+#include "../common/VertexQuantization.h"
+
+/*
+-------------------------------------------------------------------
+  SOFTWARE RASTERIZER  ----------------------------------------------
+
+  Runs the vertex_* and fragment_main functions of shaders.metal on the CPU: each vertex is
+  transformed by the affine 3x4 matrix in buffer(11) and then the view-projection in buffer(14),
+  colors are interpolated perspective correct and
+  written as RGBA8, with an optional depth buffer (less, cleared to 1).
+
+  A pass is rendered in three stages, each spread over a ThreadPool:
+
+    geometry    vertices are fetched and transformed, triangles clipped against the near and
+                far planes and a guard band, then snapped to 1/16 pixel
+    binning     every triangle is added to the list of each screen tile its bounds touch
+    raster      tiles run in parallel, each walks its triangles in submission order with
+                integer half-space edge functions, 4 pixels at a time (SSE2, NEON or scalar)
+
+  Fixed point edges and the top-left fill rule make shared edges watertight, every pixel is
+  covered by exactly one of the triangles on either side. Results don't depend on the number
+  of threads. Triangles are never culled by facing, like the Metal pipelines.
+
+  Targets may be at most maxTargetSize pixels on a side.
+-------------------------------------------------------------------
+*/
+
+// The vertex functions of shaders.metal the rasterizer can run
+enum class RasterVertexStage : uint32_t {
+    Split,                  // vertex_main
+    Interleaved,            // vertex_interleaved
+    Quantized,              // vertex_quantized
+    QuantizedInterleaved,   // vertex_quantized_interleaved
+};
+
+/**
+ * @brief One draw with its state resolved, the bytes must stay valid until render() returns.
+ */
+struct RasterDraw {
+    RasterVertexStage stage;
+    const uint8_t *vertices;            // buffer(0)
+    size_t vertexBytes;
+    const uint8_t *colors;              // buffer(1), split layouts only
+    size_t colorBytes;
+    const uint8_t *indices;             // Null draws vertices [start, start + count)
+    size_t indexBytes;
+    IndexFormat indexFormat;
+    DrawTopology topology;
+    uint32_t start;                     // Byte offset into indices, or first vertex
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t baseVertex;
+    float transform[12];                // Row-major 3x4 affine, buffer(11)
+    float viewProjection[16];           // Column-major 4x4, buffer(14)
+    QuantizationParams dequantization;  // buffer(12), quantized stages only
+    bool blending;                      // Source over, otherwise opaque
+};
+
+/**
+ * @brief Where a pass renders, rows of stride pixels with stride a multiple of 4.
+ */
+struct RasterTarget {
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    uint32_t *color;                    // RGBA8, red in the lowest byte
+    float *depth;                       // Null disables the depth test
+};
+
+struct RasterStats {
+    uint64_t triangles{0};              // Submitted, instances included
+    uint64_t clipped{0};                // Sent through the clipper
+    uint64_t rasterized{0};             // Set up and binned, after clipping and offscreen rejects
+    uint64_t binned{0};                 // Tile and triangle pairs
+    uint64_t pixels{0};                 // Passed coverage and depth, written
+};
+
+class SoftwareRasterizer final {
+public:
+    static constexpr uint32_t tileSize = 64;            // Pixels, a multiple of 4
+    static constexpr uint32_t maxTargetSize = 8192;
+    static constexpr uint32_t subpixelBits = 4;
+
+    explicit SoftwareRasterizer(ThreadPool &pool = ThreadPool::shared());
+
+    // Fills color and, if the target has one, depth
+    void clear(const RasterTarget &target, uint32_t color, float depth = 1.0f);
+
+    // Renders the draws in order. Throws std::runtime_error for indices or vertices outside
+    // their buffers and targets larger than maxTargetSize
+    void render(const std::vector<RasterDraw> &draws, const RasterTarget &target);
+
+    // Summed over every render() since the last reset
+    const RasterStats &getStats() const;
+
+    void resetStats();
+
+    ThreadPool &getPool() const;
+
+    // A triangle ready to rasterize, positions in subpixels and attribute planes in pixels
+    struct Triangle {
+        int32_t x[3];
+        int32_t y[3];
+        int32_t edgeA[3];               // E(p) = A * p.x + B * p.y + C, in subpixels, inside > 0
+        int32_t edgeB[3];
+        int64_t edgeC[3];               // Includes the fill rule bias
+        int32_t minX, minY, maxX, maxY; // Pixel bounds, clamped to the target
+        float originX, originY;         // Vertex 0 in pixels, planes are relative to it
+        float planes[6][3];             // z, 1/w, r/w, g/w, b/w, a/w: value, d/dx, d/dy
+        bool blending;
+    };
+
+private:
+    // Triangles one geometry task produced, and the tiles each one touches
+    struct Chunk {
+        std::vector<Triangle> triangles;
+        std::vector<std::vector<uint32_t>> bins;    // By tile, indices into triangles
+        RasterStats stats;
+    };
+
+    ThreadPool &pool;
+    std::vector<Chunk> chunks;
+    RasterStats stats;
+};
@@ -0,0 +1,145 @@
+#include "TransformBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr uint8_t allBuffers = (1u << TransformBuffer::framesInFlight) - 1;
+constexpr uint32_t initialCapacity = 64;
+
+} // namespace
+
+TransformBuffer::TransformBuffer(GfxDevice &device) : device(device) {}
+
+TransformBuffer::~TransformBuffer() {
+    for (GfxBuffer *buffer : buffers)
+        delete buffer;
+}
+
+/**
+ * @brief Points a slot at an object's transform, which is written to every buffer by the next uploads.
+ */
+void TransformBuffer::setSource(uint32_t slot, const Transform *transform) {
+    if (slot >= sources.size()) {
+        sources.resize(slot + 1, nullptr);
+        queued.resize(slot + 1, 0);
+    }
+    sources[slot] = transform;
+    for (std::vector<uint64_t> &held : versions)
+        if (slot < held.size())
+            held[slot] = UINT64_MAX;
+    if (transform)
+        markDirty(slot);
+}
+
+void TransformBuffer::markDirty(uint32_t slot) {
+    uint8_t &bits = queued[slot];
+    if (bits == allBuffers)
+        return;
+    for (uint32_t buffer = 0; buffer < framesInFlight; ++buffer)
+        if (!(bits & (1u << buffer)))
+            dirty[buffer].push_back(slot);
+    bits = allBuffers;
+}
+
+/**
+ * @brief Brings frame's buffer up to date with the transforms, writing only the slots that changed.
+ *
+ * Slots are written in order and each run of nearby slots is flushed with one didModifyRange().
+ *
+ * @param frame The frame about to be encoded, frame - framesInFlight must have completed.
+ * @param queue Takes the old buffers when they grow.
+ * @return The buffer to bind at buffer(11), null if there is nothing to draw.
+ * @throws std::runtime_error If the device can't create larger buffers.
+ */
+GfxBuffer *TransformBuffer::upload(uint64_t frame, DestructionQueue &queue) {
+    stats = {};
+    if (sources.empty())
+        return nullptr;
+    if (capacity < sources.size())
+        grow(frame, queue);
+
+    const uint32_t index = static_cast<uint32_t>(frame % framesInFlight);
+    GfxBuffer *buffer = buffers[index];
+    std::vector<uint64_t> &held = versions[index];
+    std::vector<uint32_t> &slots = dirty[index];
+    std::sort(slots.begin(), slots.end());
+
+    uint8_t *mapped = static_cast<uint8_t *>(buffer->map());
+    uint32_t first = UINT32_MAX, last = 0;     // The run being gathered
+    for (uint32_t slot : slots) {
+        queued[slot] &= ~(1u << index);
+        const Transform *source = sources[slot];
+        if (!source || held[slot] == source->getVersion())
+            continue;
+        held[slot] = source->getVersion();
+        std::memcpy(mapped + size_t(slot) * transformSlotSize, source->getAffine().data(), transformSlotSize);
+        ++stats.slots;
+
+        if (first != UINT32_MAX && slot - last > mergeGap) {
+            flush(buffer, first, last);
+            first = UINT32_MAX;
+        }
+        if (first == UINT32_MAX)
+            first = slot;
+        last = slot;
+    }
+    if (first != UINT32_MAX)
+        flush(buffer, first, last);
+    slots.clear();
+    return buffer;
+}
+
+void TransformBuffer::retire(DestructionQueue &queue, uint64_t lastUsedFrame) {
+    for (GfxBuffer *&buffer : buffers) {
+        queue.retireOwned(lastUsedFrame, buffer);
+        buffer = nullptr;
+    }
+    capacity = 0;
+}
+
+const TransformUploadStats &TransformBuffer::getStats() const {
+    return stats;
+}
+
+/*
+    Replaces the buffers with ones of at least twice the slots, every slot is written again
+*/
+void TransformBuffer::grow(uint64_t frame, DestructionQueue &queue) {
+    uint32_t slots = std::max(capacity, initialCapacity);
+    while (slots < sources.size())
+        slots *= 2;
+
+    std::array<GfxBuffer *, framesInFlight> grown{};
+    try {
+        for (GfxBuffer *&buffer : grown)
+            buffer = device.newBuffer(nullptr, size_t(slots) * transformSlotSize);
+    }
+    catch (...) {
+        for (GfxBuffer *buffer : grown)
+            delete buffer;
+        throw;
+    }
+
+    for (uint32_t index = 0; index < framesInFlight; ++index) {
+        queue.retireOwned(frame, buffers[index]);
+        buffers[index] = grown[index];
+        versions[index].assign(slots, UINT64_MAX);
+        dirty[index].clear();
+    }
+    capacity = slots;
+
+    std::fill(queued.begin(), queued.end(), 0);
+    for (uint32_t slot = 0; slot < sources.size(); ++slot)
+        if (sources[slot])
+            markDirty(slot);
+}
+
+// Slots [first, last] were written
+void TransformBuffer::flush(GfxBuffer *buffer, uint32_t first, uint32_t last) {
+    const size_t size = size_t(last - first + 1) * transformSlotSize;
+    buffer->didModifyRange(size_t(first) * transformSlotSize, size);
+    ++stats.ranges;
+    stats.bytes += size;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../common/DestructionQueue.h"
+#include "../common/Transform.h"
+#include "GfxDevice.h"
+
+/*
+-------------------------------------------------------------------
+  TRANSFORM BUFFER  -------------------------------------------------
+
+  Every object's matrix in a slot of one persistently mapped GPU buffer. The pass binds the
+  buffer at buffer(11) once and each draw only moves the binding's offset to its slot
+  (DrawRecord::transformSlot), instead of sending its 48 bytes with setVertexBytes().
+
+  Only matrices that changed are written. Objects mark their slot dirty when their Transform
+  moves, and the slot is queued for each of the framesInFlight buffers: frame n writes buffer
+  n % framesInFlight while the GPU may still read the others, so frame n must not begin
+  before frame n - framesInFlight has completed. upload() copies the queued slots whose
+  Transform version differs from the one that buffer holds, then flushes them with one
+  didModifyRange() per run of slots, runs fewer than mergeGap slots apart merged into one.
+  A frame in which nothing moved writes and flushes nothing.
+
+  Buffers grow by doubling, the old ones are retired through the DestructionQueue and every
+  slot is written again.
+-------------------------------------------------------------------
+*/
+
+// What the last upload() wrote
+struct TransformUploadStats {
+    uint32_t slots{0};          // Matrices written
+    uint32_t ranges{0};         // didModifyRange() calls
+    uint64_t bytes{0};          // Flushed, including the unchanged slots inside merged runs
+};
+
+class TransformBuffer final {
+public:
+    static constexpr uint32_t framesInFlight = 3;
+    static constexpr uint32_t mergeGap = 4;     // Slots
+
+    explicit TransformBuffer(GfxDevice &device);
+
+    // Deletes the buffers not retired yet, the GPU must be done with them
+    ~TransformBuffer();
+
+    TransformBuffer(const TransformBuffer &) = delete;
+    TransformBuffer &operator=(const TransformBuffer &) = delete;
+
+    // The slot reads transform until it is given another one, null frees the slot
+    void setSource(uint32_t slot, const Transform *transform);
+
+    // The slot's transform changed, every buffer takes it again
+    void markDirty(uint32_t slot);
+
+    // Writes the dirty slots of frame's buffer and returns it, null while no slot has a source.
+    // Throws std::runtime_error if a larger buffer can't be created
+    GfxBuffer *upload(uint64_t frame, DestructionQueue &queue);
+
+    // Hands the buffers to the queue, the next upload() makes new ones
+    void retire(DestructionQueue &queue, uint64_t lastUsedFrame);
+
+    const TransformUploadStats &getStats() const;
+
+private:
+    GfxDevice &device;
+    std::vector<const Transform *> sources;
+    std::vector<uint8_t> queued;                // Per slot, bit b set while dirty[b] holds it
+    std::array<GfxBuffer *, framesInFlight> buffers{};
+    std::array<std::vector<uint64_t>, framesInFlight> versions;    // Held by each slot, UINT64_MAX for none
+    std::array<std::vector<uint32_t>, framesInFlight> dirty;
+    uint32_t capacity{0};                       // Slots per buffer
+    TransformUploadStats stats;
+
+    void grow(uint64_t frame, DestructionQueue &queue);
+    void flush(GfxBuffer *buffer, uint32_t first, uint32_t last);
+};
@@ -0,0 +1,167 @@
+#include "AffineBatch.h"
+
+#include <cstring>
+
+#include "AffineBatchKernels.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+/*
+    The baseline lanes, AVX2 lives in AffineBatchAvx2.cpp
+*/
+#if defined(__SSE2__)
+struct BaselineLanes {
+    using Type = __m128;
+    static constexpr size_t width = 4;
+    static Type load(const float *p) { return _mm_loadu_ps(p); }
+    static void store(float *p, Type v) { _mm_storeu_ps(p, v); }
+    static Type splat(float v) { return _mm_set1_ps(v); }
+    static Type add(Type a, Type b) { return _mm_add_ps(a, b); }
+    static Type sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+    static Type mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+    static Type div(Type a, Type b) { return _mm_div_ps(a, b); }
+};
+constexpr const char *baselineName = "SSE2";
+#elif defined(__ARM_NEON)
+struct BaselineLanes {
+    using Type = float32x4_t;
+    static constexpr size_t width = 4;
+    static Type load(const float *p) { return vld1q_f32(p); }
+    static void store(float *p, Type v) { vst1q_f32(p, v); }
+    static Type splat(float v) { return vdupq_n_f32(v); }
+    static Type add(Type a, Type b) { return vaddq_f32(a, b); }
+    static Type sub(Type a, Type b) { return vsubq_f32(a, b); }
+    static Type mul(Type a, Type b) { return vmulq_f32(a, b); }
+#if defined(__aarch64__)
+    static Type div(Type a, Type b) { return vdivq_f32(a, b); }
+#else
+    // No divide on 32 bit ARM, two Newton steps on the estimate are within an ulp or two
+    static Type div(Type a, Type b) {
+        float32x4_t r = vrecpeq_f32(b);
+        r = vmulq_f32(vrecpsq_f32(b, r), r);
+        r = vmulq_f32(vrecpsq_f32(b, r), r);
+        return vmulq_f32(a, r);
+    }
+#endif
+};
+constexpr const char *baselineName = "NEON";
+#else
+struct BaselineLanes {
+    using Type = float;
+    static constexpr size_t width = 1;
+    static Type load(const float *p) { return *p; }
+    static void store(float *p, Type v) { *p = v; }
+    static Type splat(float v) { return v; }
+    static Type add(Type a, Type b) { return a + b; }
+    static Type sub(Type a, Type b) { return a - b; }
+    static Type mul(Type a, Type b) { return a * b; }
+    static Type div(Type a, Type b) { return a / b; }
+};
+constexpr const char *baselineName = "scalar";
+#endif
+
+constexpr AffineBatchKernels baselineKernels = AffineLaneKernels<BaselineLanes>::kernels(baselineName);
+
+bool hasAvx2() {
+#if defined(__AVX2__)
+    return true;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+// AVX2 when it was built and the CPU has it, checked once
+const AffineBatchKernels &kernels() {
+    static const AffineBatchKernels &chosen =
+        avx2AffineBatchKernels() && hasAvx2() ? *avx2AffineBatchKernels() : baselineKernels;
+    return chosen;
+}
+
+template <uint32_t Rows, uint32_t Columns>
+std::array<const float *, Rows * Columns> streams(const MatrixBatch<Rows, Columns> &batch) {
+    std::array<const float *, Rows * Columns> elements;
+    for (uint32_t e = 0; e < Rows * Columns; ++e)
+        elements[e] = batch.elements(e / Columns, e % Columns);
+    return elements;
+}
+
+template <uint32_t Rows, uint32_t Columns>
+std::array<float *, Rows * Columns> streams(MatrixBatch<Rows, Columns> &batch) {
+    std::array<float *, Rows * Columns> elements;
+    for (uint32_t e = 0; e < Rows * Columns; ++e)
+        elements[e] = batch.elements(e / Columns, e % Columns);
+    return elements;
+}
+
+} // namespace
+
+const AffineBatchKernels &baselineAffineBatchKernels() {
+    return baselineKernels;
+}
+
+/**
+ * @brief Objects each batch kernel step handles on this CPU: 8 with AVX2, 4 with SSE2 or NEON, 1 otherwise.
+ */
+size_t affineBatchLanes() {
+    return kernels().lanes;
+}
+
+/**
+ * @brief The instruction set the batch kernels use on this CPU, for benchmarks and logs.
+ *
+ * @return "AVX2", "SSE2", "NEON" or "scalar".
+ */
+const char *affineBatchKernelName() {
+    return kernels().name;
+}
+
+/**
+ * @brief Checks whether a matrix is a rotation (or reflection) plus a translation.
+ *
+ * @param tolerance Largest difference allowed between A * A^T and identity.
+ */
+bool isRigid(const AffineMatrix &matrix, float tolerance) {
+    const Eigen::Matrix3f block = matrix.leftCols<3>();
+    return ((block * block.transpose()) - Eigen::Matrix3f::Identity()).cwiseAbs().maxCoeff() <= tolerance;
+}
+
+/**
+ * @brief Inverts every matrix of a batch.
+ *
+ * @param kind Rigid transposes the 3x3 parts instead of inverting them, only for matrices
+ * isRigid() accepts.
+ */
+void invertAffineBatch(const AffineBatch &matrices, AffineBatch &inverses, AffineKind kind) {
+    inverses.resize(matrices.size());
+    kernels().invert(streams(matrices).data(), streams(inverses).data(), matrices.paddedSize(), kind);
+}
+
+/**
+ * @brief Builds the matrix that transforms each object's normals, the inverse transpose of its 3x3 part.
+ *
+ * Normals stay perpendicular to their surfaces under non-uniform scale and shear. The rows are
+ * not normalized, normals need normalizing after the transform anyway.
+ *
+ * @param kind Rigid copies the 3x3 parts, an orthonormal matrix is its own inverse transpose.
+ */
+void normalMatrixBatch(const AffineBatch &matrices, NormalMatrixBatch &normals, AffineKind kind) {
+    normals.resize(matrices.size());
+    const size_t bytes = matrices.paddedSize() * sizeof(float);
+    if (kind == AffineKind::Rigid) {
+        for (uint32_t r = 0; r < 3; ++r)
+            for (uint32_t c = 0; c < 3; ++c)
+                std::memcpy(normals.elements(r, c), matrices.elements(r, c), bytes);
+        return;
+    }
+
+    kernels().normals(streams(matrices).data(), streams(normals).data(), matrices.paddedSize());
+}
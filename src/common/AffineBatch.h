@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Transform.h"
+
+/*
+-------------------------------------------------------------------
+  AFFINE BATCH  -----------------------------------------------------
+
+  Inverse and normal matrices (the inverse transpose of the 3x3 part) for every object at once,
+  for picking rays and lighting. The matrices are affine, so only the 3x3 part is inverted:
+  the inverse of [A t] is [A^-1  -A^-1 t], with A^-1 the adjugate of A over its determinant.
+  Rigid matrices (rotation and translation only, A orthonormal) skip even that: A^-1 is A
+  transposed and the normal matrix is A itself.
+
+  Matrices are stored as a structure of arrays, one stream per element, so each kernel step
+  handles affineBatchLanes() objects with plain loads, multiplies and adds: AVX2 8 at a time,
+  SSE2 or NEON 4, scalar elsewhere. The AVX2 kernels are built on x86 whatever the rest of the
+  build targets and picked at runtime on CPUs that have it (common/AffineBatchKernels.h).
+  Streams are padded to a multiple of 8 with identity matrices, the kernels run over the
+  padding instead of a scalar tail.
+
+  A singular 3x3 part gives non-finite results, like affineInverse().
+-------------------------------------------------------------------
+*/
+
+enum class AffineKind : uint32_t {
+    General,
+    Rigid,          // The 3x3 part is orthonormal, results are only valid if it is
+};
+
+/**
+ * @brief count row-major Rows x Columns matrices, element (r, c) of every matrix in one stream.
+ */
+template <uint32_t Rows, uint32_t Columns>
+class MatrixBatch final {
+public:
+    using Matrix = Eigen::Matrix<float, Rows, Columns, Eigen::RowMajor>;
+
+    static constexpr uint32_t elementCount = Rows * Columns;
+
+    // New matrices start out as identity
+    void resize(size_t count) {
+        const size_t padded = (count + 7) / 8 * 8;
+        for (uint32_t e = 0; e < elementCount; ++e)
+            streams[e].resize(padded, e / Columns == e % Columns ? 1.0f : 0.0f);
+        // Matrices dropped by shrinking become padding
+        for (size_t i = count; i < std::min(this->count, padded); ++i)
+            set(i, Matrix::Identity());
+        this->count = count;
+    }
+
+    size_t size() const { return count; }
+
+    // Including the padding, a multiple of 8
+    size_t paddedSize() const { return streams[0].size(); }
+
+    void set(size_t i, const Matrix &matrix) {
+        for (uint32_t e = 0; e < elementCount; ++e)
+            streams[e][i] = matrix(e / Columns, e % Columns);
+    }
+
+    Matrix get(size_t i) const {
+        Matrix matrix;
+        for (uint32_t e = 0; e < elementCount; ++e)
+            matrix(e / Columns, e % Columns) = streams[e][i];
+        return matrix;
+    }
+
+    // Element (row, column) of every matrix, paddedSize() floats
+    float *elements(uint32_t row, uint32_t column) { return streams[row * Columns + column].data(); }
+    const float *elements(uint32_t row, uint32_t column) const { return streams[row * Columns + column].data(); }
+
+private:
+    size_t count{0};
+    std::array<std::vector<float>, elementCount> streams;
+};
+
+using AffineBatch = MatrixBatch<3, 4>;
+using NormalMatrixBatch = MatrixBatch<3, 3>;
+
+// Objects per kernel step on this CPU
+size_t affineBatchLanes();
+
+// The instruction set the kernels use on this CPU, for benchmarks and logs
+const char *affineBatchKernelName();
+
+// True if the 3x3 part is orthonormal within tolerance, the matrix can use AffineKind::Rigid
+bool isRigid(const AffineMatrix &matrix, float tolerance = 1e-5f);
+
+// inverses is resized to match matrices
+void invertAffineBatch(const AffineBatch &matrices, AffineBatch &inverses, AffineKind kind = AffineKind::General);
+
+// The inverse transpose of each 3x3 part, normals is resized to match matrices
+void normalMatrixBatch(const AffineBatch &matrices, NormalMatrixBatch &normals,
+                       AffineKind kind = AffineKind::General);
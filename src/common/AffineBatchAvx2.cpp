@@ -0,0 +1,35 @@
+#include "AffineBatchKernels.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+namespace {
+
+/*
+    AVX2 - 8 objects a step. This file is built with -mavx2 on x86 (CMakeLists.txt), the rest of
+    the build keeps its baseline
+*/
+struct Avx2Lanes {
+    using Type = __m256;
+    static constexpr size_t width = 8;
+    static Type load(const float *p) { return _mm256_loadu_ps(p); }
+    static void store(float *p, Type v) { _mm256_storeu_ps(p, v); }
+    static Type splat(float v) { return _mm256_set1_ps(v); }
+    static Type add(Type a, Type b) { return _mm256_add_ps(a, b); }
+    static Type sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+    static Type mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+    static Type div(Type a, Type b) { return _mm256_div_ps(a, b); }
+};
+
+constexpr AffineBatchKernels avx2Kernels = AffineLaneKernels<Avx2Lanes>::kernels("AVX2");
+
+} // namespace
+
+const AffineBatchKernels *avx2AffineBatchKernels() {
+    return &avx2Kernels;
+}
+#else
+const AffineBatchKernels *avx2AffineBatchKernels() {
+    return nullptr;
+}
+#endif
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "AffineBatch.h"
+
+/*
+-------------------------------------------------------------------
+  AFFINE BATCH KERNELS  ---------------------------------------------
+
+  The loops behind invertAffineBatch() and normalMatrixBatch(), written once against a lane
+  type and built per instruction set: AffineBatch.cpp for the baseline (SSE2 on x86, NEON or
+  scalar), AffineBatchAvx2.cpp with -mavx2 on x86. The AVX2 kernels are only called on CPUs
+  that have it, AffineBatch.cpp checks at runtime.
+
+  A lane type provides Type (width floats), load/store (unaligned), splat, add, sub, mul and
+  div. The kernels take the raw element streams of a batch (MatrixBatch::elements(), row-major)
+  rather than the batch, so the AVX2 file doesn't compile inline code from Eigen or the standard
+  library that the linker could then pick for the rest of the build.
+-------------------------------------------------------------------
+*/
+
+struct AffineBatchKernels {
+    const char *name;       // "AVX2", "SSE2", "NEON" or "scalar"
+    size_t lanes;
+    // in: the 12 streams of a 3x4 batch, out: the 12 of the inverses
+    void (*invert)(const float *const *in, float *const *out, size_t paddedSize, AffineKind kind);
+    // in: the 12 streams of a 3x4 batch, out: the 9 of the normal matrices (general matrices only)
+    void (*normals)(const float *const *in, float *const *out, size_t paddedSize);
+};
+
+// SSE2, NEON or scalar, whatever this build targets
+const AffineBatchKernels &baselineAffineBatchKernels();
+
+// Null when AffineBatchAvx2.cpp wasn't built for AVX2, the CPU may not have it either way
+const AffineBatchKernels *avx2AffineBatchKernels();
+
+template <typename Lanes>
+struct AffineLaneKernels {
+    using Type = typename Lanes::Type;
+    using Block = Type[3][3];
+
+    // a * b - c * d
+    static Type crossTerm(Type a, Type b, Type c, Type d) { return Lanes::sub(Lanes::mul(a, b), Lanes::mul(c, d)); }
+
+    static void loadBlock(const float *const *in, size_t i, Block &a) {
+        for (uint32_t r = 0; r < 3; ++r)
+            for (uint32_t c = 0; c < 3; ++c)
+                a[r][c] = Lanes::load(in[r * 4 + c] + i);
+    }
+
+    /*
+        inverse = adjugate / determinant, the determinant expanded along the first column of the
+        adjugate so its cofactors are reused
+    */
+    static void invertBlock(const Block &a, Block &inverse) {
+        inverse[0][0] = crossTerm(a[1][1], a[2][2], a[1][2], a[2][1]);
+        inverse[1][0] = crossTerm(a[1][2], a[2][0], a[1][0], a[2][2]);
+        inverse[2][0] = crossTerm(a[1][0], a[2][1], a[1][1], a[2][0]);
+        const Type determinant = Lanes::add(Lanes::add(Lanes::mul(a[0][0], inverse[0][0]), Lanes::mul(a[0][1], inverse[1][0])),
+                                            Lanes::mul(a[0][2], inverse[2][0]));
+        const Type scale = Lanes::div(Lanes::splat(1.0f), determinant);
+
+        inverse[0][1] = crossTerm(a[0][2], a[2][1], a[0][1], a[2][2]);
+        inverse[0][2] = crossTerm(a[0][1], a[1][2], a[0][2], a[1][1]);
+        inverse[1][1] = crossTerm(a[0][0], a[2][2], a[0][2], a[2][0]);
+        inverse[1][2] = crossTerm(a[0][2], a[1][0], a[0][0], a[1][2]);
+        inverse[2][1] = crossTerm(a[0][1], a[2][0], a[0][0], a[2][1]);
+        inverse[2][2] = crossTerm(a[0][0], a[1][1], a[0][1], a[1][0]);
+        for (uint32_t r = 0; r < 3; ++r)
+            for (uint32_t c = 0; c < 3; ++c)
+                inverse[r][c] = Lanes::mul(inverse[r][c], scale);
+    }
+
+    template <AffineKind kind>
+    static void invertAll(const float *const *in, float *const *out, size_t paddedSize) {
+        const Type zero = Lanes::splat(0.0f);
+        for (size_t i = 0; i < paddedSize; i += Lanes::width) {
+            Block a, inverse;
+            loadBlock(in, i, a);
+            if constexpr (kind == AffineKind::Rigid) {
+                for (uint32_t r = 0; r < 3; ++r)
+                    for (uint32_t c = 0; c < 3; ++c)
+                        inverse[r][c] = a[c][r];
+            }
+            else
+                invertBlock(a, inverse);
+
+            const Type x = Lanes::load(in[3] + i);
+            const Type y = Lanes::load(in[7] + i);
+            const Type z = Lanes::load(in[11] + i);
+            for (uint32_t r = 0; r < 3; ++r) {
+                for (uint32_t c = 0; c < 3; ++c)
+                    Lanes::store(out[r * 4 + c] + i, inverse[r][c]);
+                const Type moved = Lanes::add(Lanes::add(Lanes::mul(inverse[r][0], x), Lanes::mul(inverse[r][1], y)),
+                                              Lanes::mul(inverse[r][2], z));
+                Lanes::store(out[r * 4 + 3] + i, Lanes::sub(zero, moved));
+            }
+        }
+    }
+
+    static void invert(const float *const *in, float *const *out, size_t paddedSize, AffineKind kind) {
+        if (kind == AffineKind::Rigid)
+            invertAll<AffineKind::Rigid>(in, out, paddedSize);
+        else
+            invertAll<AffineKind::General>(in, out, paddedSize);
+    }
+
+    static void normals(const float *const *in, float *const *out, size_t paddedSize) {
+        for (size_t i = 0; i < paddedSize; i += Lanes::width) {
+            Block a, inverse;
+            loadBlock(in, i, a);
+            invertBlock(a, inverse);
+            for (uint32_t r = 0; r < 3; ++r)
+                for (uint32_t c = 0; c < 3; ++c)
+                    Lanes::store(out[r * 3 + c] + i, inverse[c][r]);
+        }
+    }
+
+    static constexpr AffineBatchKernels kernels(const char *name) { return {name, Lanes::width, invert, normals}; }
+};
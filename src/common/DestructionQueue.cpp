@@ -0,0 +1,69 @@
+#include "DestructionQueue.h"
+
+#include <algorithm>
+#include <utility>
+
+/**
+ * @brief Releases whatever is still queued.
+ *
+ * The owner is expected to have waited for the GPU to go idle before the queue is destroyed.
+ */
+DestructionQueue::~DestructionQueue() {
+    flush();
+}
+
+/**
+ * @brief Queues a release to run once @p lastUsedFrame has completed on the GPU.
+ *
+ * Entries are kept ordered by frame. A resource retired with a frame older than the newest
+ * queued entry is held until that newer frame completes, which is later than necessary but
+ * never too early.
+ *
+ * @param lastUsedFrame Index of the last frame whose command buffer may reference the resource.
+ * @param release The function that actually frees the resource.
+ */
+void DestructionQueue::retire(uint64_t lastUsedFrame, Releaser release) {
+    if (!release)
+        return;
+
+    if (!entries.empty())
+        lastUsedFrame = std::max(lastUsedFrame, entries.back().frame);
+
+    entries.push_back({lastUsedFrame, std::move(release)});
+}
+
+/**
+ * @brief Frees every resource whose last frame is at or before @p completedFrame.
+ *
+ * @param completedFrame The newest frame index the GPU is known to have finished.
+ * @param budget Maximum number of releases to run this call, so unloading a large scene is
+ *               spread over several frames instead of stalling one.
+ * @return The number of resources released.
+ */
+size_t DestructionQueue::collect(uint64_t completedFrame, size_t budget) {
+    size_t released = 0;
+    while (released < budget && !entries.empty() && entries.front().frame <= completedFrame) {
+        // Pop before calling so a throwing releaser cannot be run twice
+        Releaser release = std::move(entries.front().release);
+        entries.pop_front();
+        release();
+        ++released;
+    }
+    return released;
+}
+
+/**
+ * @brief Frees everything regardless of frame. Only call when the GPU is idle.
+ *
+ * @return The number of resources released.
+ */
+size_t DestructionQueue::flush() {
+    return collect(std::numeric_limits<uint64_t>::max());
+}
+
+/**
+ * @brief Number of resources still waiting for their frame to complete.
+ */
+size_t DestructionQueue::pending() const {
+    return entries.size();
+}
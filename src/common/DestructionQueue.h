@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+
+/**
+ * @class DestructionQueue
+ * @brief Defers freeing GPU resources until the frame that last used them has completed.
+ *
+ * The GPU runs behind the CPU, so a buffer or pipeline state released right after it was
+ * encoded may still be read by an in-flight command buffer. Instead, resources are retired
+ * together with the index of the last frame that referenced them, and are only released once
+ * the renderer has observed that frame's command buffer completing.
+ *
+ * Usage:
+ * - Call retire() (or retireObject() for metal-cpp objects, retireOwned() for objects owned
+ *   through a plain pointer such as backend buffers) instead of releasing them.
+ * - Call collect() once per frame with the newest completed frame index.
+ * - Call flush() only when the GPU is known to be idle (e.g. at shutdown).
+ *
+ * The queue itself is not thread safe; it is meant to be owned by the render thread.
+ */
+class DestructionQueue final {
+public:
+    using Releaser = std::function<void()>;
+
+    DestructionQueue() = default;
+    ~DestructionQueue();
+
+    DestructionQueue(const DestructionQueue &) = delete;
+    DestructionQueue &operator=(const DestructionQueue &) = delete;
+
+    void retire(uint64_t lastUsedFrame, Releaser release);
+
+    // Convenience for anything with a release() method (NS::Object, MTL::Buffer, ...)
+    template <typename T>
+    void retireObject(uint64_t lastUsedFrame, T *object) {
+        if (object)
+            retire(lastUsedFrame, [object]() { object->release(); });
+    }
+
+    // Deletes the object, for GfxBuffer, GfxPipeline and anything else owned through a pointer
+    template <typename T>
+    void retireOwned(uint64_t lastUsedFrame, T *object) {
+        if (object)
+            retire(lastUsedFrame, [object]() { delete object; });
+    }
+
+    size_t collect(uint64_t completedFrame, size_t budget = std::numeric_limits<size_t>::max());
+    size_t flush();
+
+    size_t pending() const;
+
+private:
+    struct Entry {
+        uint64_t frame;
+        Releaser release;
+    };
+
+    std::deque<Entry> entries;      // Sorted by frame, oldest first
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "IndexPacking.h"
+
+/*
+-------------------------------------------------------------------
+  DRAW LIST  --------------------------------------------------------
+
+  Primitives compile their draw calls once, when their buffers and pipeline are created, into
+  plain DrawRecords. The renderer copies the records of every visible primitive's current level
+  into contiguous segments, again only when the scene, a level or a transform sent as bytes
+  changes, and submits them in a single loop: no virtual calls, no exceptions, and binds are
+  skipped when they repeat the previous record's. Segments that stop changing are baked into
+  draw packets (backend/GfxDevice.h) and no longer submitted record by record.
+
+  Records refer to GPU objects through opaque pointers so this header stays portable, they are
+  a backend's GfxPipeline and GfxBuffer objects (backend/GfxDevice.h) and its encoder casts
+  them back. Per-object data (the transform and the constants) is read through pointers into
+  the owning primitive, so moving an object or changing its padding doesn't recompile anything.
+
+  A record's transform is either sent with it (setVertexBytes() of *transform) or, with a
+  transformSlot, read from the transform buffer the pass bound at buffer(11) (TransformBuffer,
+  backend/TransformBuffer.h), where the record only moves the binding's offset. Those records
+  never change when their object moves, so packets baked from them stay valid. A pass uses one
+  or the other: bytes sent to buffer(11) replace the bound transform buffer. Either way the
+  transform is an AffineMatrix (common/Transform.h), three float4 rows: 48 bytes per object
+  instead of a float4x4's 64, the shaders supply the last row.
+
+  The view and projection are not part of any object's transform. A pass sends them once, as
+  a column-major float4x4 set with setVertexBytes() at buffer(14), and the shaders apply it
+  after the model matrix. It may be a perspective projection. Records never set it, packets
+  read the one bound when they run.
+
+  Encoder interface used by submitDrawList():
+
+    setPipeline(const void *pipeline)
+    setVertexBuffer(const void *buffer, uint32_t index)
+    setVertexBufferOffset(size_t offset, uint32_t index)    of the buffer bound at index
+    setVertexBytes(const void *bytes, size_t size, uint32_t index)
+    draw(const DrawRecord &record)              vertices [start, start + count)
+    drawIndexed(const DrawRecord &record)       count indices at byte offset start
+-------------------------------------------------------------------
+*/
+
+// Vertex buffer indices shared with shaders.metal
+constexpr uint32_t vertexStreamIndex = 0;
+constexpr uint32_t colorStreamIndex = 1;
+constexpr uint32_t transformIndex = 11;
+constexpr uint32_t dequantizationIndex = 12;
+constexpr uint32_t pixelPaddingIndex = 13;
+constexpr uint32_t viewProjectionIndex = 14;
+
+constexpr ptrdiff_t transformPrefetchDistance = 16;    // Records
+
+// Bytes of a transform, sent or in a transform buffer slot: a row-major 3x4 affine matrix
+constexpr uint32_t transformSlotSize = 12 * sizeof(float);
+constexpr uint32_t noTransformSlot = UINT32_MAX;
+
+// Bytes of the pass's view-projection matrix, a column-major 4x4
+constexpr uint32_t viewProjectionSize = 16 * sizeof(float);
+
+enum class DrawTopology : uint32_t {
+    Triangle,
+    TriangleStrip,
+};
+
+/**
+ * @brief Everything one draw call needs, with no ownership.
+ */
+struct DrawRecord {
+    const void *pipeline;
+    const void *vertexBuffer;       // buffer(0)
+    const void *colorBuffer;        // buffer(1), split layout only, may be null
+    const void *indexBuffer;        // Null draws vertices instead of indices
+    const float *transform;         // Row-major 3x4 affine, buffer(11), unless transformSlot is set
+    const void *constants;          // constantsSize bytes to buffer(constantsIndex), may be null
+    uint32_t constantsSize;
+    uint32_t constantsIndex;
+    uint32_t start;                 // Byte offset into indexBuffer, or first vertex
+    uint32_t count;                 // Indices, or vertices
+    uint32_t instanceCount;
+    uint32_t baseVertex;            // Added to every index
+    IndexFormat indexFormat;
+    DrawTopology topology;
+    uint32_t transformSlot{noTransformSlot};   // Into the transform buffer bound at buffer(11)
+};
+
+static_assert(std::is_trivially_copyable_v<DrawRecord>, "Draw records are copied as plain bytes");
+
+/**
+ * @brief Submits records in order, skipping binds that repeat the previous record's.
+ */
+template <typename Encoder>
+void submitDrawList(const DrawRecord *records, size_t count, Encoder &encoder) {
+    const void *pipeline = nullptr;
+    const void *vertexBuffer = nullptr;
+    const void *colorBuffer = nullptr;
+    const float *transform = nullptr;
+    uint32_t transformSlot = noTransformSlot;
+    const void *constants = nullptr;
+    for (const DrawRecord *record = records, *end = records + count; record != end; ++record) {
+#if defined(__GNUC__)
+        // Records are sequential but their transforms live in the primitives, fetch ahead
+        if (end - record > transformPrefetchDistance && record[transformPrefetchDistance].transformSlot == noTransformSlot)
+            __builtin_prefetch(record[transformPrefetchDistance].transform);
+#endif
+        if (record->pipeline != pipeline) {
+            pipeline = record->pipeline;
+            encoder.setPipeline(pipeline);
+        }
+        if (record->vertexBuffer != vertexBuffer) {
+            vertexBuffer = record->vertexBuffer;
+            encoder.setVertexBuffer(vertexBuffer, vertexStreamIndex);
+        }
+        if (record->colorBuffer && record->colorBuffer != colorBuffer) {
+            colorBuffer = record->colorBuffer;
+            encoder.setVertexBuffer(colorBuffer, colorStreamIndex);
+        }
+        if (record->transformSlot != noTransformSlot) {
+            if (record->transformSlot != transformSlot) {
+                transformSlot = record->transformSlot;
+                transform = nullptr;
+                encoder.setVertexBufferOffset(size_t(transformSlot) * transformSlotSize, transformIndex);
+            }
+        }
+        else if (record->transform != transform) {
+            transform = record->transform;
+            transformSlot = noTransformSlot;
+            encoder.setVertexBytes(transform, transformSlotSize, transformIndex);
+        }
+        if (record->constants && record->constants != constants) {
+            constants = record->constants;
+            encoder.setVertexBytes(record->constants, record->constantsSize, record->constantsIndex);
+        }
+
+        if (record->indexBuffer)
+            encoder.drawIndexed(*record);
+        else
+            encoder.draw(*record);
+    }
+}
+
+template <typename Encoder>
+void submitDrawList(const std::vector<DrawRecord> &records, Encoder &encoder) {
+    submitDrawList(records.data(), records.size(), encoder);
+}
@@ -0,0 +1,600 @@
+#include "FrameWriter.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+/*
+    Pixels - BT.601 limited range, the integer approximation most encoders use
+*/
+void splitChannels(uint32_t pixel, PixelOrder order, int &r, int &g, int &b) {
+    const int first = pixel & 0xff, third = (pixel >> 16) & 0xff;
+    r = order == PixelOrder::Rgba ? first : third;
+    g = (pixel >> 8) & 0xff;
+    b = order == PixelOrder::Rgba ? third : first;
+}
+
+uint8_t luma(int r, int g, int b) {
+    return static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+uint8_t chromaU(int r, int g, int b) {
+    return static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+uint8_t chromaV(int r, int g, int b) {
+    return static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+#if defined(__SSE2__)
+// 8 pixels as 16 bit channels
+void loadChannels(const uint32_t *pixels, PixelOrder order, __m128i &r, __m128i &g, __m128i &b) {
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels));
+    const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + 4));
+    const __m128i first = _mm_packs_epi32(_mm_and_si128(low, mask), _mm_and_si128(high, mask));
+    const __m128i third = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(low, 16), mask),
+                                          _mm_and_si128(_mm_srli_epi32(high, 16), mask));
+    g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(low, 8), mask), _mm_and_si128(_mm_srli_epi32(high, 8), mask));
+    r = order == PixelOrder::Rgba ? first : third;
+    b = order == PixelOrder::Rgba ? third : first;
+}
+
+void storeLuma(__m128i r, __m128i g, __m128i b, uint8_t *out) {
+    // At most 56228, the 16 bit products wrap but the unsigned sum doesn't
+    const __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)),
+                                                    _mm_mullo_epi16(g, _mm_set1_epi16(129))),
+                                      _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(25)), _mm_set1_epi16(128)));
+    const __m128i y = _mm_add_epi16(_mm_srli_epi16(sum, 8), _mm_set1_epi16(16));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(out), _mm_packus_epi16(y, y));
+}
+
+// Averages 2x2 blocks of two rows of 8, the 4 results in the low 16 bit lanes
+__m128i averageBlocks(__m128i top, __m128i bottom) {
+    const __m128i sums = _mm_madd_epi16(_mm_add_epi16(top, bottom), _mm_set1_epi16(1));
+    const __m128i average = _mm_srli_epi32(_mm_add_epi32(sums, _mm_set1_epi32(2)), 2);
+    return _mm_packs_epi32(average, average);
+}
+
+// a * x + b * y + c * z for 4 16 bit lanes, as 32 bit
+__m128i weigh(__m128i x, __m128i y, __m128i z, int16_t a, int16_t b, int16_t c) {
+    const auto pair = [](int16_t low, int16_t high) {
+        return _mm_set1_epi32(static_cast<int>(static_cast<uint16_t>(low) | (uint32_t(static_cast<uint16_t>(high)) << 16)));
+    };
+    return _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(x, y), pair(a, b)),
+                         _mm_madd_epi16(_mm_unpacklo_epi16(z, _mm_set1_epi16(1)), pair(c, 128)));
+}
+
+void storeChroma(__m128i weighed, uint8_t *out) {
+    const __m128i value = _mm_add_epi32(_mm_srai_epi32(weighed, 8), _mm_set1_epi32(128));
+    const __m128i packed = _mm_packs_epi32(value, value);
+    const int bytes = _mm_cvtsi128_si32(_mm_packus_epi16(packed, packed));
+    std::memcpy(out, &bytes, 4);
+}
+#elif defined(__ARM_NEON)
+void loadChannels(const uint32_t *pixels, PixelOrder order, uint8x8_t &r, uint8x8_t &g, uint8x8_t &b) {
+    const uint8x8x4_t channels = vld4_u8(reinterpret_cast<const uint8_t *>(pixels));
+    r = order == PixelOrder::Rgba ? channels.val[0] : channels.val[2];
+    g = channels.val[1];
+    b = order == PixelOrder::Rgba ? channels.val[2] : channels.val[0];
+}
+
+void storeLuma(uint8x8_t r, uint8x8_t g, uint8x8_t b, uint8_t *out) {
+    uint16x8_t sum = vmull_u8(r, vdup_n_u8(66));
+    sum = vmlal_u8(sum, g, vdup_n_u8(129));
+    sum = vmlal_u8(sum, b, vdup_n_u8(25));
+    sum = vaddq_u16(sum, vdupq_n_u16(128));
+    vst1_u8(out, vadd_u8(vshrn_n_u16(sum, 8), vdup_n_u8(16)));
+}
+
+// Averages 2x2 blocks of two rows of 8, rounding like the scalar (sum + 2) >> 2
+int16x4_t averageBlocks(uint8x8_t top, uint8x8_t bottom) {
+    const uint16x8_t sums = vaddl_u8(top, bottom);
+    return vreinterpret_s16_u16(vrshr_n_u16(vpadd_u16(vget_low_u16(sums), vget_high_u16(sums)), 2));
+}
+
+int16x4_t chroma(int16x4_t x, int16x4_t y, int16x4_t z, int16_t a, int16_t b, int16_t c) {
+    int32x4_t sum = vmlal_s16(vmlal_s16(vmull_s16(x, vdup_n_s16(a)), y, vdup_n_s16(b)), z, vdup_n_s16(c));
+    sum = vaddq_s32(vshrq_n_s32(vaddq_s32(sum, vdupq_n_s32(128)), 8), vdupq_n_s32(128));
+    return vmovn_s32(sum);
+}
+#endif
+
+/*
+    Files
+*/
+// The file of frame index: pattern's %d, %4d or %04d replaced, or the index put before the extension
+std::string framePath(const std::string &pattern, uint64_t index) {
+    size_t percent = pattern.find('%');
+    std::string format = pattern;
+    if (percent == std::string::npos) {
+        const size_t slash = pattern.find_last_of("/\\");
+        const size_t dot = pattern.find_last_of('.');
+        percent = dot != std::string::npos && (slash == std::string::npos || dot > slash) ? dot : pattern.size();
+        format.insert(percent, "%04d");
+    }
+
+    size_t end = percent + 1;
+    const bool zeros = end < format.size() && format[end] == '0';
+    end += zeros;
+    size_t width = 0;
+    while (end < format.size() && format[end] >= '0' && format[end] <= '9' && width < 20)
+        width = width * 10 + (format[end++] - '0');
+    if (end >= format.size() || format[end] != 'd' || format.find('%', end) != std::string::npos)
+        throw std::runtime_error("Frame file names need one %d, %4d or %04d: " + pattern);
+
+    std::string number = std::to_string(index);
+    if (number.size() < width)
+        number.insert(0, width - number.size(), zeros ? '0' : ' ');
+    return format.substr(0, percent) + number + format.substr(end + 1);
+}
+
+uint32_t crc32(const uint8_t *bytes, size_t size, uint32_t crc = 0) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> values{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int bit = 0; bit < 8; ++bit)
+                c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            values[i] = c;
+        }
+        return values;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+uint32_t adler32(const uint8_t *bytes, size_t size, uint32_t adler = 1) {
+    uint32_t a = adler & 0xffff, b = adler >> 16;
+    while (size) {
+        const size_t block = std::min<size_t>(size, 5552);   // Largest run that can't overflow b
+        for (size_t i = 0; i < block; ++i) {
+            a += bytes[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        bytes += block;
+        size -= block;
+    }
+    return (b << 16) | a;
+}
+
+void appendBigEndian(std::vector<uint8_t> &out, uint32_t value) {
+    const uint8_t bytes[4] = {uint8_t(value >> 24), uint8_t(value >> 16), uint8_t(value >> 8), uint8_t(value)};
+    out.insert(out.end(), bytes, bytes + 4);
+}
+
+void appendChunk(std::vector<uint8_t> &out, const char *type, const uint8_t *data, size_t size) {
+    appendBigEndian(out, static_cast<uint32_t>(size));
+    const size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + size);
+    appendBigEndian(out, crc32(out.data() + start, size + 4));
+}
+
+} // namespace
+
+/**
+ * @throws std::runtime_error If the extension isn't .ppm, .png or .y4m.
+ */
+FrameFormat frameFormatFromPath(const std::string &fileName) {
+    std::string extension = fileName.substr(std::min(fileName.find_last_of('.'), fileName.size()));
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (extension == ".ppm")
+        return FrameFormat::Ppm;
+    if (extension == ".png")
+        return FrameFormat::Png;
+    if (extension == ".y4m")
+        return FrameFormat::Y4m;
+    throw std::runtime_error("Unsupported frame format (expected .ppm, .png or .y4m): " + fileName);
+}
+
+void convertToRgb(const uint32_t *pixels, size_t count, PixelOrder order, uint8_t *rgb) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    // 4 pixels to two runs of 6 bytes, each store writes 2 bytes past its run, so stop 1 pixel early
+    const __m128i low = _mm_set_epi32(0, 0x00ffffff, 0, 0x00ffffff);
+    const __m128i high = _mm_set_epi32(0x0000ffff, static_cast<int>(0xff000000), 0x0000ffff, static_cast<int>(0xff000000));
+    for (; i + 4 < count; i += 4) {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+        if (order == PixelOrder::Bgra)
+            p = _mm_or_si128(_mm_and_si128(p, _mm_set1_epi32(static_cast<int>(0xff00ff00))),
+                             _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), _mm_set1_epi32(0xff)),
+                                          _mm_slli_epi32(_mm_and_si128(p, _mm_set1_epi32(0xff)), 16)));
+        const __m128i packed = _mm_or_si128(_mm_and_si128(p, low), _mm_and_si128(_mm_srli_epi64(p, 8), high));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(rgb + 3 * i), packed);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(rgb + 3 * i + 6), _mm_srli_si128(packed, 8));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 16 <= count; i += 16) {
+        const uint8x16x4_t p = vld4q_u8(reinterpret_cast<const uint8_t *>(pixels + i));
+        uint8x16x3_t out;
+        out.val[0] = order == PixelOrder::Rgba ? p.val[0] : p.val[2];
+        out.val[1] = p.val[1];
+        out.val[2] = order == PixelOrder::Rgba ? p.val[2] : p.val[0];
+        vst3q_u8(rgb + 3 * i, out);
+    }
+#endif
+    for (; i < count; ++i) {
+        int r, g, b;
+        splitChannels(pixels[i], order, r, g, b);
+        rgb[3 * i] = static_cast<uint8_t>(r);
+        rgb[3 * i + 1] = static_cast<uint8_t>(g);
+        rgb[3 * i + 2] = static_cast<uint8_t>(b);
+    }
+}
+
+void convertToI420(const uint32_t *pixels, uint32_t width, uint32_t height, PixelOrder order, uint8_t *y,
+                   uint8_t *u, uint8_t *v) {
+    const uint32_t chromaWidth = (width + 1) / 2;
+    for (uint32_t row = 0; row < height; row += 2) {
+        const bool pair = row + 1 < height;   // An odd last row is its own pair
+        const uint32_t *top = pixels + size_t(row) * width;
+        const uint32_t *bottom = pair ? top + width : top;
+        uint8_t *topLuma = y + size_t(row) * width;
+        uint8_t *bottomLuma = topLuma + width;
+        uint8_t *uRow = u + size_t(row / 2) * chromaWidth;
+        uint8_t *vRow = v + size_t(row / 2) * chromaWidth;
+
+        uint32_t x = 0;
+#if defined(__SSE2__)
+        for (; x + 8 <= width; x += 8) {
+            __m128i r0, g0, b0, r1, g1, b1;
+            loadChannels(top + x, order, r0, g0, b0);
+            loadChannels(bottom + x, order, r1, g1, b1);
+            storeLuma(r0, g0, b0, topLuma + x);
+            if (pair)
+                storeLuma(r1, g1, b1, bottomLuma + x);
+            const __m128i r = averageBlocks(r0, r1), g = averageBlocks(g0, g1), b = averageBlocks(b0, b1);
+            storeChroma(weigh(r, g, b, -38, -74, 112), uRow + x / 2);
+            storeChroma(weigh(r, g, b, 112, -94, -18), vRow + x / 2);
+        }
+#elif defined(__ARM_NEON)
+        for (; x + 8 <= width; x += 8) {
+            uint8x8_t r0, g0, b0, r1, g1, b1;
+            loadChannels(top + x, order, r0, g0, b0);
+            loadChannels(bottom + x, order, r1, g1, b1);
+            storeLuma(r0, g0, b0, topLuma + x);
+            if (pair)
+                storeLuma(r1, g1, b1, bottomLuma + x);
+            const int16x4_t r = averageBlocks(r0, r1), g = averageBlocks(g0, g1), b = averageBlocks(b0, b1);
+            uint8_t packed[8];
+            vst1_u8(packed, vqmovun_s16(vcombine_s16(chroma(r, g, b, -38, -74, 112), chroma(r, g, b, 112, -94, -18))));
+            std::memcpy(uRow + x / 2, packed, 4);
+            std::memcpy(vRow + x / 2, packed + 4, 4);
+        }
+#endif
+        for (; x < width; x += 2) {
+            const uint32_t right = std::min(x + 1, width - 1);   // An odd last column is its own pair
+            int sumR = 0, sumG = 0, sumB = 0;
+            for (const uint32_t *source : {top, bottom})
+                for (uint32_t column : {x, right}) {
+                    int r, g, b;
+                    splitChannels(source[column], order, r, g, b);
+                    sumR += r;
+                    sumG += g;
+                    sumB += b;
+                }
+            for (uint32_t column = x; column <= right; ++column) {
+                int r, g, b;
+                splitChannels(top[column], order, r, g, b);
+                topLuma[column] = luma(r, g, b);
+                if (pair) {
+                    splitChannels(bottom[column], order, r, g, b);
+                    bottomLuma[column] = luma(r, g, b);
+                }
+            }
+            const int r = (sumR + 2) >> 2, g = (sumG + 2) >> 2, b = (sumB + 2) >> 2;
+            uRow[x / 2] = chromaU(r, g, b);
+            vRow[x / 2] = chromaV(r, g, b);
+        }
+    }
+}
+
+/**
+ * @brief Creates the file and writes the header.
+ *
+ * @throws std::runtime_error If the format isn't PPM or PNG, the size is 0 or the file can't be created.
+ */
+ImageWriter::ImageWriter(const std::string &fileName, FrameFormat format, uint32_t width, uint32_t height)
+    : fileName(fileName), format(format), width(width), height(height) {
+    if (format == FrameFormat::Y4m)
+        throw std::runtime_error("Images are PPM or PNG: " + fileName);
+    if (width == 0 || height == 0)
+        throw std::runtime_error("Images must be at least 1x1");
+    file = std::fopen(fileName.c_str(), "wb");
+    if (!file)
+        throw std::runtime_error("Failed to create file: " + fileName);
+
+    if (format == FrameFormat::Ppm) {
+        const std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+        write(header.data(), header.size());
+    }
+    else {
+        static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+        std::vector<uint8_t> header(signature, signature + 8);
+        std::vector<uint8_t> fields;
+        appendBigEndian(fields, width);
+        appendBigEndian(fields, height);
+        fields.insert(fields.end(), {8, 2, 0, 0, 0});   // 8 bit RGB, deflate, adaptive filters, no interlace
+        appendChunk(header, "IHDR", fields.data(), fields.size());
+        write(header.data(), header.size());
+    }
+}
+
+ImageWriter::~ImageWriter() {
+    if (file)
+        std::fclose(file);
+}
+
+/**
+ * @brief Appends the next rows, a PNG gets one IDAT chunk of stored deflate blocks per call.
+ *
+ * @param stride Pixels from the start of one row to the next.
+ * @throws std::runtime_error If more rows than the height are written or the file can't be written.
+ */
+void ImageWriter::writeRows(const uint32_t *pixels, uint32_t rows, size_t stride, PixelOrder order) {
+    if (!file)
+        throw std::runtime_error("The image is closed: " + fileName);
+    if (rows > height - rowsWritten)
+        throw std::runtime_error("More rows than the image has: " + fileName);
+    if (rows == 0)
+        return;
+
+    const size_t rgbBytes = size_t(width) * 3;
+    if (format == FrameFormat::Ppm) {
+        scanlines.resize(rgbBytes * rows);
+        for (uint32_t row = 0; row < rows; ++row)
+            convertToRgb(pixels + row * stride, width, order, scanlines.data() + row * rgbBytes);
+        write(scanlines.data(), scanlines.size());
+    }
+    else {
+        scanlines.resize((rgbBytes + 1) * rows);
+        for (uint32_t row = 0; row < rows; ++row) {
+            uint8_t *scanline = scanlines.data() + row * (rgbBytes + 1);
+            scanline[0] = 0;    // No filter
+            convertToRgb(pixels + row * stride, width, order, scanline + 1);
+        }
+        adler = adler32(scanlines.data(), scanlines.size(), adler);
+
+        chunk.clear();
+        if (rowsWritten == 0)
+            chunk.insert(chunk.end(), {0x78, 0x01});    // zlib header, the stream spans every IDAT
+        for (size_t offset = 0; offset < scanlines.size();) {
+            const size_t size = std::min<size_t>(scanlines.size() - offset, 65535);
+            chunk.insert(chunk.end(), {0, uint8_t(size), uint8_t(size >> 8), uint8_t(~size), uint8_t(~size >> 8)});
+            chunk.insert(chunk.end(), scanlines.begin() + offset, scanlines.begin() + offset + size);
+            offset += size;
+        }
+        encoded.clear();
+        appendChunk(encoded, "IDAT", chunk.data(), chunk.size());
+        write(encoded.data(), encoded.size());
+    }
+    rowsWritten += rows;
+}
+
+/**
+ * @throws std::runtime_error If rows are missing or the file can't be written.
+ */
+void ImageWriter::close() {
+    if (!file)
+        return;
+    if (rowsWritten != height)
+        throw std::runtime_error("Missing rows: " + fileName);
+
+    if (format == FrameFormat::Png) {
+        // An empty final block ends the deflate stream
+        std::vector<uint8_t> end{1, 0, 0, 0xff, 0xff};
+        appendBigEndian(end, adler);
+        encoded.clear();
+        appendChunk(encoded, "IDAT", end.data(), end.size());
+        appendChunk(encoded, "IEND", nullptr, 0);
+        write(encoded.data(), encoded.size());
+    }
+    const int result = std::fclose(file);
+    file = nullptr;
+    if (result != 0)
+        throw std::runtime_error("Failed to write file: " + fileName);
+}
+
+void ImageWriter::write(const void *bytes, size_t size) {
+    if (std::fwrite(bytes, 1, size, file) != size)
+        throw std::runtime_error("Failed to write file: " + fileName);
+}
+
+/**
+ * @brief Starts the encoder thread, with Y4M creates the stream and writes its header.
+ *
+ * @param path The Y4M file, or the pattern of PPM and PNG file names (see framePath()).
+ * @param queueDepth Frames that may wait for the encoder before beginFrame() blocks.
+ *
+ * @throws std::runtime_error If the size is 0, the pattern is invalid or the stream can't be created.
+ */
+FrameWriter::FrameWriter(const std::string &path, FrameFormat format, uint32_t width, uint32_t height,
+                         PixelOrder order, uint32_t framesPerSecond, size_t queueDepth)
+    : path(path), format(format), width(width), height(height), order(order) {
+    if (width == 0 || height == 0)
+        throw std::runtime_error("Frames must be at least 1x1");
+
+    if (format == FrameFormat::Y4m) {
+        stream = std::fopen(path.c_str(), "wb");
+        if (!stream)
+            throw std::runtime_error("Failed to create file: " + path);
+        const std::string header = "YUV4MPEG2 W" + std::to_string(width) + " H" + std::to_string(height) + " F" +
+                                   std::to_string(std::max(framesPerSecond, 1u)) +
+                                   ":1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n";
+        if (std::fwrite(header.data(), 1, header.size(), stream) != header.size()) {
+            std::fclose(stream);
+            throw std::runtime_error("Failed to write file: " + path);
+        }
+    }
+    else {
+        framePath(path, 0);     // Throws for a bad pattern before any frame is rendered
+    }
+
+    buffers.resize(std::max<size_t>(queueDepth, 1) + 1);    // One more for the frame being rendered
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        buffers[i].resize(size_t(width) * height);
+        freeBuffers.push_back(i);
+    }
+    encoder = std::thread(&FrameWriter::encoderLoop, this);
+}
+
+FrameWriter::~FrameWriter() {
+    finish();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (error && !errorReported) {
+        try {
+            std::rethrow_exception(error);
+        }
+        catch (const std::exception &e) {
+            std::cerr << "Error from FrameWriter: " << e.what() << std::endl;
+        }
+    }
+}
+
+/**
+ * @brief Takes a free buffer, waiting while every other one is queued.
+ *
+ * @throws std::runtime_error If the writer is closed, or the encoder's error.
+ */
+uint32_t *FrameWriter::beginFrame() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (closing)
+        throw std::runtime_error("The frame writer is closed");
+    if (filling == SIZE_MAX) {
+        bufferFreed.wait(lock, [this]() { return error || !freeBuffers.empty(); });
+        rethrowError();
+        filling = freeBuffers.back();
+        freeBuffers.pop_back();
+    }
+    return buffers[filling].data();
+}
+
+void FrameWriter::endFrame() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (filling == SIZE_MAX)
+            throw std::runtime_error("endFrame() without beginFrame()");
+        queued.push_back(filling);
+        filling = SIZE_MAX;
+        ++framesQueued;
+    }
+    frameQueued.notify_one();
+}
+
+/**
+ * @throws std::runtime_error The first error writing a frame or closing the stream.
+ */
+void FrameWriter::close() {
+    finish();
+    std::lock_guard<std::mutex> lock(mutex);
+    rethrowError();
+}
+
+uint64_t FrameWriter::getFramesWritten() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return framesWritten;
+}
+
+void FrameWriter::encoderLoop() {
+    for (;;) {
+        size_t buffer;
+        uint64_t index;
+        bool failed;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            frameQueued.wait(lock, [this]() { return closing || !queued.empty(); });
+            if (queued.empty())
+                return;
+            buffer = queued.front();
+            queued.pop_front();
+            index = framesWritten;
+            failed = error != nullptr;
+        }
+
+        // After an error the remaining frames are dropped
+        std::exception_ptr encodeError;
+        if (!failed) {
+            try {
+                encode(buffers[buffer], index);
+            }
+            catch (...) {
+                encodeError = std::current_exception();
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (encodeError)
+                error = encodeError;
+            else if (!failed)
+                ++framesWritten;
+            freeBuffers.push_back(buffer);
+        }
+        bufferFreed.notify_one();
+    }
+}
+
+void FrameWriter::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    frameQueued.notify_one();
+    if (encoder.joinable())
+        encoder.join();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stream) {
+        if (std::fclose(stream) != 0 && !error)
+            error = std::make_exception_ptr(std::runtime_error("Failed to write file: " + path));
+        stream = nullptr;
+    }
+}
+
+void FrameWriter::encode(const std::vector<uint32_t> &pixels, uint64_t index) {
+    switch (format) {
+        case FrameFormat::Ppm:
+        case FrameFormat::Png: {
+            ImageWriter image(framePath(path, index), format, width, height);
+            image.writeRows(pixels.data(), height, width, order);
+            image.close();
+            break;
+        }
+        case FrameFormat::Y4m: {
+            const size_t lumaSize = size_t(width) * height;
+            const size_t chromaSize = size_t((width + 1) / 2) * ((height + 1) / 2);
+            converted.resize(lumaSize + 2 * chromaSize);
+            convertToI420(pixels.data(), width, height, order, converted.data(), converted.data() + lumaSize,
+                          converted.data() + lumaSize + chromaSize);
+            static const char frameHeader[] = "FRAME\n";
+            if (std::fwrite(frameHeader, 1, 6, stream) != 6 ||
+                std::fwrite(converted.data(), 1, converted.size(), stream) != converted.size())
+                throw std::runtime_error("Failed to write file: " + path);
+            break;
+        }
+    }
+}
+
+// Call with the mutex held
+void FrameWriter::rethrowError() {
+    if (error) {
+        errorReported = true;
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+-------------------------------------------------------------------
+  FRAME WRITER  -----------------------------------------------------
+
+  Streams rendered frames to disk from a background encoder thread, so the render loop only
+  copies pixels into a queued buffer and never waits on conversion or I/O:
+
+    PPM, PNG    one file per frame, named by a pattern with one %d conversion
+                ("frames/shot%04d.png"), or with the index put before the extension
+    Y4M         one raw 4:2:0 video stream (BT.601, limited range), playable by ffmpeg and mpv
+
+  PNGs are written with stored (uncompressed) deflate blocks, there's no zlib to link.
+
+  ImageWriter streams a single PPM or PNG a band of rows at a time, for images too large to
+  hold in memory.
+
+  Frames come in as 8 bit BGRA (Metal drawables) or RGBA (SoftwareDevice), top row first, and
+  are converted with SSE2 or NEON, or scalar code elsewhere. beginFrame() only blocks while all
+  queueDepth buffers are waiting to be written, an encoder error is rethrown by the next
+  beginFrame() or close().
+-------------------------------------------------------------------
+*/
+
+// Byte order of a pixel in memory
+enum class PixelOrder : uint32_t {
+    Bgra,   // MTLPixelFormatBGRA8Unorm
+    Rgba,
+};
+
+enum class FrameFormat : uint32_t {
+    Ppm,
+    Png,
+    Y4m,
+};
+
+// From the extension of fileName (.ppm, .png or .y4m), throws std::runtime_error otherwise
+FrameFormat frameFormatFromPath(const std::string &fileName);
+
+// Packs count pixels into 3 byte RGB
+void convertToRgb(const uint32_t *pixels, size_t count, PixelOrder order, uint8_t *rgb);
+
+// Full size luma and (width + 1) / 2 by (height + 1) / 2 chroma planes, each chroma sample
+// the average of a 2x2 block (edges repeat the last row and column)
+void convertToI420(const uint32_t *pixels, uint32_t width, uint32_t height, PixelOrder order,
+                   uint8_t *y, uint8_t *u, uint8_t *v);
+
+// Writes one PPM or PNG top row first, rows can be added as they are rendered
+class ImageWriter final {
+public:
+    // Throws std::runtime_error for Y4M, an empty size or if the file can't be created
+    ImageWriter(const std::string &fileName, FrameFormat format, uint32_t width, uint32_t height);
+
+    // Closes the file, an unfinished image is left as it is
+    ~ImageWriter();
+
+    ImageWriter(const ImageWriter &) = delete;
+    ImageWriter &operator=(const ImageWriter &) = delete;
+
+    // rows of width pixels, each stride pixels after the previous one
+    void writeRows(const uint32_t *pixels, uint32_t rows, size_t stride, PixelOrder order);
+
+    // Throws std::runtime_error unless every row was written
+    void close();
+
+private:
+    void write(const void *bytes, size_t size);
+
+    std::string fileName;
+    FrameFormat format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t rowsWritten{0};
+    uint32_t adler{1};                      // PNG, checksum of the scanlines so far
+    std::FILE *file{nullptr};
+    std::vector<uint8_t> scanlines;
+    std::vector<uint8_t> chunk;
+    std::vector<uint8_t> encoded;
+};
+
+class FrameWriter final {
+public:
+    // Throws std::runtime_error for an empty size, a bad file name pattern or, with Y4M, if
+    // the stream can't be created
+    FrameWriter(const std::string &path, FrameFormat format, uint32_t width, uint32_t height,
+                PixelOrder order, uint32_t framesPerSecond = 60, size_t queueDepth = 3);
+
+    // Finishes the queued frames, errors not thrown yet are reported on std::cerr
+    ~FrameWriter();
+
+    FrameWriter(const FrameWriter &) = delete;
+    FrameWriter &operator=(const FrameWriter &) = delete;
+
+    // A width * height buffer to render the next frame into, queued by endFrame()
+    uint32_t *beginFrame();
+
+    void endFrame();
+
+    // Waits until every queued frame is written, no frames may be added after
+    void close();
+
+    uint64_t getFramesWritten() const;
+
+private:
+    void encoderLoop();
+    void finish();
+    void encode(const std::vector<uint32_t> &pixels, uint64_t index);
+    void rethrowError();
+
+    std::string path;
+    FrameFormat format;
+    uint32_t width;
+    uint32_t height;
+    PixelOrder order;
+    std::FILE *stream{nullptr};             // Y4M only
+
+    // Buffers cycle free -> filling (render thread) -> queued -> encoding (encoder thread) -> free
+    std::vector<std::vector<uint32_t>> buffers;
+    std::vector<size_t> freeBuffers;
+    std::deque<size_t> queued;
+    size_t filling{SIZE_MAX};
+    uint64_t framesQueued{0};
+    uint64_t framesWritten{0};
+
+    // Conversion scratch, encoder thread only
+    std::vector<uint8_t> converted;
+
+    mutable std::mutex mutex;
+    std::condition_variable bufferFreed;    // The render thread waits here for a free buffer
+    std::condition_variable frameQueued;    // The encoder waits here for work
+    std::exception_ptr error;
+    bool errorReported{false};
+    bool closing{false};
+    std::thread encoder;
+};
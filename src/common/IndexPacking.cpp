@@ -0,0 +1,124 @@
+#include "IndexPacking.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+constexpr uint32_t windowStep = maxUInt16Vertices / 2;
+
+/*
+    The window of vertices [w * windowStep, w * windowStep + 65536) holding the triangle,
+    or wideWindow if its vertices are too far apart for any of them
+*/
+uint32_t windowOf(const uint32_t *triangle, uint32_t wideWindow) {
+    const uint32_t low = std::min({triangle[0], triangle[1], triangle[2]});
+    const uint32_t high = std::max({triangle[0], triangle[1], triangle[2]});
+    const uint32_t window = low / windowStep;
+    return high - window * windowStep < maxUInt16Vertices ? window : wideWindow;
+}
+
+} // namespace
+
+size_t indexSize(IndexFormat format) {
+    return format == IndexFormat::UInt16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+/**
+ * @brief Packs the index ranges into uint16 where the vertex count or locality allows, uint32 otherwise.
+ *
+ * Ranges are packed back to back in the given order, even if they overlap in @p indices.
+ */
+PackedIndices packIndices(const uint32_t *indices, size_t indexCount, size_t vertexCount,
+                          const std::vector<MeshLod> &ranges, size_t minTrianglesPerDraw) {
+    size_t totalIndices = 0;
+    for (const MeshLod &range : ranges) {
+        if (range.indexOffset > indexCount || range.indexCount > indexCount - range.indexOffset)
+            throw std::runtime_error("Index range is out of bounds");
+        if (range.indexCount % 3 != 0)
+            throw std::runtime_error("Index range doesn't hold whole triangles");
+        totalIndices += range.indexCount;
+    }
+    for (const MeshLod &range : ranges)
+        for (uint32_t i = range.indexOffset; i < range.indexOffset + range.indexCount; ++i)
+            if (indices[i] >= vertexCount)
+                throw std::runtime_error("Index " + std::to_string(indices[i]) + " is out of range for " +
+                                         std::to_string(vertexCount) + " vertices");
+
+    // Triangles per window and range, the last window is for wide triangles
+    const uint32_t wideWindow = static_cast<uint32_t>((vertexCount + windowStep - 1) / windowStep);
+    std::vector<std::vector<uint32_t>> windowTriangles;
+    bool split = vertexCount > maxUInt16Vertices;
+    if (split) {
+        size_t narrowIndices = 0, wideIndices = 0, drawCount = 0;
+        windowTriangles.assign(ranges.size(), std::vector<uint32_t>(wideWindow + 1, 0));
+        for (size_t r = 0; r < ranges.size(); ++r) {
+            for (uint32_t i = ranges[r].indexOffset; i < ranges[r].indexOffset + ranges[r].indexCount; i += 3)
+                ++windowTriangles[r][windowOf(indices + i, wideWindow)];
+            for (uint32_t w = 0; w <= wideWindow; ++w) {
+                drawCount += windowTriangles[r][w] > 0;
+                (w < wideWindow ? narrowIndices : wideIndices) += windowTriangles[r][w] * 3;
+            }
+        }
+        split = (narrowIndices * sizeof(uint16_t) + wideIndices * sizeof(uint32_t)) * 4 <=
+                    totalIndices * sizeof(uint32_t) * 3 &&
+                drawCount * minTrianglesPerDraw <= totalIndices / 3;
+    }
+
+    // Lay out the draws, uint16 windows first so the uint32 draw only needs 2 bytes of padding
+    PackedIndices packed;
+    const IndexFormat wholeFormat = vertexCount > maxUInt16Vertices ? IndexFormat::UInt32 : IndexFormat::UInt16;
+    packed.rangeDraws.assign(1, 0);
+    size_t byteSize = 0;
+    auto addDraw = [&](uint32_t count, uint32_t baseVertex, IndexFormat format) {
+        byteSize = (byteSize + indexSize(format) - 1) / indexSize(format) * indexSize(format);
+        if (byteSize + size_t(count) * indexSize(format) > UINT32_MAX)
+            throw std::runtime_error("Too many indices for one index buffer");
+        packed.draws.push_back({static_cast<uint32_t>(byteSize), count, baseVertex, format});
+        packed.format = std::max(packed.format, format);
+        byteSize += size_t(count) * indexSize(format);
+    };
+    for (size_t r = 0; r < ranges.size(); ++r) {
+        if (!split) {
+            addDraw(ranges[r].indexCount, 0, wholeFormat);
+        } else {
+            for (uint32_t w = 0; w <= wideWindow; ++w)
+                if (windowTriangles[r][w] > 0)
+                    addDraw(windowTriangles[r][w] * 3, w < wideWindow ? w * windowStep : 0,
+                            w < wideWindow ? IndexFormat::UInt16 : IndexFormat::UInt32);
+        }
+        packed.rangeDraws.push_back(static_cast<uint32_t>(packed.draws.size()));
+    }
+
+    packed.bytes.resize(byteSize);
+    auto store = [&](const IndexDraw &draw, uint32_t position, uint32_t index) {
+        uint8_t *destination = packed.bytes.data() + draw.byteOffset;
+        if (draw.format == IndexFormat::UInt16) {
+            const uint16_t narrow = static_cast<uint16_t>(index - draw.baseVertex);
+            std::memcpy(destination + size_t(position) * sizeof(narrow), &narrow, sizeof(narrow));
+        } else {
+            std::memcpy(destination + size_t(position) * sizeof(index), &index, sizeof(index));
+        }
+    };
+    std::vector<uint32_t> drawOfWindow(wideWindow + 1), written(wideWindow + 1);
+    for (size_t r = 0; r < ranges.size(); ++r) {
+        const uint32_t first = ranges[r].indexOffset, end = first + ranges[r].indexCount;
+        if (!split) {
+            for (uint32_t i = first; i < end; ++i)
+                store(packed.draws[packed.rangeDraws[r]], i - first, indices[i]);
+            continue;
+        }
+        for (uint32_t w = 0, d = packed.rangeDraws[r]; w <= wideWindow; ++w)
+            if (windowTriangles[r][w] > 0)
+                drawOfWindow[w] = d++;
+        std::fill(written.begin(), written.end(), 0);
+        for (uint32_t i = first; i < end; i += 3) {
+            const uint32_t w = windowOf(indices + i, wideWindow);
+            for (int k = 0; k < 3; ++k)
+                store(packed.draws[drawOfWindow[w]], written[w]++, indices[i + k]);
+        }
+    }
+    return packed;
+}
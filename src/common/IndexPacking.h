@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Mesh.h"
+
+/*
+-------------------------------------------------------------------
+  INDEX PACKING  ----------------------------------------------------
+
+  Turns 32-bit CPU indices into the smallest GPU index buffer that can draw them. Each draw
+  carries its own index type, so one buffer can mix both:
+
+    <= 65536 vertices       uint16, one draw per range
+    more                    triangles are bucketed into vertex windows of 65536 starting every
+                            32768 vertices, each window drawn as uint16 with a base vertex.
+                            Triangles spanning too far for any window go to one uint32 draw
+                            at the end of the range. Triangle order is kept within each draw.
+    more, scattered         plain uint32, one draw per range, in the original order
+
+  The split layout is used when it saves at least a quarter of the index bytes and its draws
+  average at least minTrianglesPerDraw triangles. Optimized meshes keep most triangles in one
+  window: the fetch remap numbers vertices in the order triangles first use them.
+-------------------------------------------------------------------
+*/
+
+enum class IndexFormat : uint32_t {
+    UInt16,
+    UInt32,
+};
+
+constexpr size_t maxUInt16Vertices = 65536;
+constexpr size_t defaultMinTrianglesPerDraw = 4096;
+
+size_t indexSize(IndexFormat format);
+
+/**
+ * @brief One draw call into a packed index buffer.
+ */
+struct IndexDraw {
+    uint32_t byteOffset;            // Aligned to the index size
+    uint32_t indexCount;
+    uint32_t baseVertex;            // Added to every index
+    IndexFormat format;
+};
+
+/**
+ * @brief A packed index buffer and the draws that cover each input range.
+ */
+struct PackedIndices {
+    IndexFormat format{IndexFormat::UInt16};    // UInt32 if any draw uses it
+    std::vector<uint8_t> bytes;                 // Ready to upload
+    std::vector<IndexDraw> draws;
+    std::vector<uint32_t> rangeDraws;           // Range r is draws [rangeDraws[r], rangeDraws[r + 1])
+};
+
+// ranges are indexOffset/indexCount pairs (e.g. levels of detail) into indices, error is ignored.
+// Throws std::runtime_error if an index or range is out of bounds.
+PackedIndices packIndices(const uint32_t *indices, size_t indexCount, size_t vertexCount,
+                          const std::vector<MeshLod> &ranges,
+                          size_t minTrianglesPerDraw = defaultMinTrianglesPerDraw);
@@ -0,0 +1,265 @@
+#include "LodSelection.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+constexpr float infinity = std::numeric_limits<float>::infinity();
+constexpr float minClipW = 1e-6f;   // Spheres reaching behind the eye get the finest level
+
+/*
+    Everything select() derives from the matrix and settings once per frame
+*/
+struct FrameConstants {
+    float row3[4];          // Clip w = row3 . (x, y, z, 1)
+    float row3Length;       // Largest change of w per unit of distance
+    float pixelScale;       // Pixels per unit at w = 1
+    float budget;
+    float coarsenBudget;
+    float cullPixels;
+    float uncullPixels;
+};
+
+struct Streams {
+    const float *centerX, *centerY, *centerZ, *radius;
+    const float *errors[maxLodLevels];
+    int32_t *levels;
+};
+
+#if defined(__SSE2__)
+/*
+    SSE2 - four objects per register, level picks are counted with compare masks (-1 per hit)
+*/
+void selectSimd(const Streams &s, size_t count, const FrameConstants &f) {
+    const __m128 row30 = _mm_set1_ps(f.row3[0]), row31 = _mm_set1_ps(f.row3[1]);
+    const __m128 row32 = _mm_set1_ps(f.row3[2]), row33 = _mm_set1_ps(f.row3[3]);
+    const __m128 row3Length = _mm_set1_ps(f.row3Length);
+    const __m128 pixelScale = _mm_set1_ps(f.pixelScale);
+    const __m128 minW = _mm_set1_ps(minClipW);
+    const __m128 budget = _mm_set1_ps(f.budget), coarsenBudget = _mm_set1_ps(f.coarsenBudget);
+    const __m128 cullPixels = _mm_set1_ps(f.cullPixels), uncullPixels = _mm_set1_ps(f.uncullPixels);
+    const __m128i culled = _mm_set1_epi32(culledLevel);
+
+    for (size_t i = 0; i < count; i += 4) {
+        const __m128 x = _mm_loadu_ps(s.centerX + i), y = _mm_loadu_ps(s.centerY + i);
+        const __m128 z = _mm_loadu_ps(s.centerZ + i), r = _mm_loadu_ps(s.radius + i);
+
+        __m128 w = _mm_add_ps(_mm_add_ps(_mm_mul_ps(row30, x), _mm_mul_ps(row31, y)),
+                              _mm_add_ps(_mm_mul_ps(row32, z), row33));
+        w = _mm_max_ps(_mm_sub_ps(w, _mm_mul_ps(r, row3Length)), minW);
+        const __m128 pixelsPerUnit = _mm_div_ps(pixelScale, w);
+
+        __m128i target = _mm_setzero_si128(), coarse = _mm_setzero_si128();
+        for (size_t level = 1; level < maxLodLevels; ++level) {
+            const __m128 projected = _mm_mul_ps(_mm_loadu_ps(s.errors[level] + i), pixelsPerUnit);
+            target = _mm_sub_epi32(target, _mm_castps_si128(_mm_cmple_ps(projected, budget)));
+            coarse = _mm_sub_epi32(coarse, _mm_castps_si128(_mm_cmple_ps(projected, coarsenBudget)));
+        }
+
+        const __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s.levels + i));
+        const __m128i refine = _mm_cmplt_epi32(target, current);
+        const __m128i coarsen = _mm_cmpgt_epi32(coarse, current);
+        __m128i next = _mm_or_si128(_mm_and_si128(refine, target), _mm_andnot_si128(refine, current));
+        next = _mm_or_si128(_mm_and_si128(coarsen, coarse), _mm_andnot_si128(coarsen, next));
+
+        const __m128 wasCulled = _mm_castsi128_ps(_mm_cmpeq_epi32(current, culled));
+        const __m128 threshold = _mm_or_ps(_mm_and_ps(wasCulled, uncullPixels), _mm_andnot_ps(wasCulled, cullPixels));
+        const __m128i visible = _mm_castps_si128(_mm_cmpge_ps(_mm_mul_ps(r, pixelsPerUnit), threshold));
+        next = _mm_or_si128(_mm_and_si128(visible, next), _mm_andnot_si128(visible, culled));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(s.levels + i), next);
+    }
+}
+
+#elif defined(__ARM_NEON)
+/*
+    NEON - same as SSE2, comparisons give all-ones lanes that are subtracted to count
+*/
+void selectSimd(const Streams &s, size_t count, const FrameConstants &f) {
+    const float32x4_t minW = vdupq_n_f32(minClipW);
+    const float32x4_t budget = vdupq_n_f32(f.budget), coarsenBudget = vdupq_n_f32(f.coarsenBudget);
+    const float32x4_t cullPixels = vdupq_n_f32(f.cullPixels), uncullPixels = vdupq_n_f32(f.uncullPixels);
+    const int32x4_t culled = vdupq_n_s32(culledLevel);
+
+    for (size_t i = 0; i < count; i += 4) {
+        const float32x4_t x = vld1q_f32(s.centerX + i), y = vld1q_f32(s.centerY + i);
+        const float32x4_t z = vld1q_f32(s.centerZ + i), r = vld1q_f32(s.radius + i);
+
+        float32x4_t w = vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(f.row3[3]), x, f.row3[0]), y, f.row3[1]), z,
+                                    f.row3[2]);
+        w = vmaxq_f32(vmlsq_n_f32(w, r, f.row3Length), minW);
+        const float32x4_t pixelsPerUnit = vdivq_f32(vdupq_n_f32(f.pixelScale), w);
+
+        int32x4_t target = vdupq_n_s32(0), coarse = vdupq_n_s32(0);
+        for (size_t level = 1; level < maxLodLevels; ++level) {
+            const float32x4_t projected = vmulq_f32(vld1q_f32(s.errors[level] + i), pixelsPerUnit);
+            target = vsubq_s32(target, vreinterpretq_s32_u32(vcleq_f32(projected, budget)));
+            coarse = vsubq_s32(coarse, vreinterpretq_s32_u32(vcleq_f32(projected, coarsenBudget)));
+        }
+
+        const int32x4_t current = vld1q_s32(s.levels + i);
+        int32x4_t next = vbslq_s32(vcltq_s32(target, current), target, current);
+        next = vbslq_s32(vcgtq_s32(coarse, current), coarse, next);
+
+        const float32x4_t threshold = vbslq_f32(vceqq_s32(current, culled), uncullPixels, cullPixels);
+        next = vbslq_s32(vcgeq_f32(vmulq_f32(r, pixelsPerUnit), threshold), next, culled);
+
+        vst1q_s32(s.levels + i, next);
+    }
+}
+
+#else
+/*
+    Scalar - one object at a time, what the SIMD paths compute per lane
+*/
+void selectScalar(const Streams &s, size_t begin, size_t end, const FrameConstants &f) {
+    for (size_t i = begin; i < end; ++i) {
+        const float w = f.row3[0] * s.centerX[i] + f.row3[1] * s.centerY[i] + f.row3[2] * s.centerZ[i] + f.row3[3];
+        const float pixelsPerUnit = f.pixelScale / std::max(w - s.radius[i] * f.row3Length, minClipW);
+
+        int32_t target = 0, coarse = 0;
+        for (size_t level = 1; level < maxLodLevels; ++level) {
+            const float projected = s.errors[level][i] * pixelsPerUnit;
+            target += projected <= f.budget;
+            coarse += projected <= f.coarsenBudget;
+        }
+
+        const int32_t current = s.levels[i];
+        int32_t next = current;
+        if (target < current)
+            next = target;
+        else if (coarse > current)
+            next = coarse;
+
+        const float radiusPixels = s.radius[i] * pixelsPerUnit;
+        const bool visible = radiusPixels >= (current == culledLevel ? f.uncullPixels : f.cullPixels);
+        s.levels[i] = visible ? next : culledLevel;
+    }
+}
+
+void selectSimd(const Streams &s, size_t count, const FrameConstants &f) {
+    selectScalar(s, 0, count, f);
+}
+#endif
+
+} // namespace
+
+/**
+ * @brief Registers an object, its bounds start out empty so it stays culled until setBounds().
+ *
+ * @param levels The object's levels of detail, finest first, with non-decreasing error.
+ * @return The object's index for setBounds() and getLevel().
+ */
+uint32_t LodSelector::addObject(const std::vector<MeshLod> &objectLevels) {
+    if (objectLevels.empty())
+        throw std::runtime_error("An object needs at least one level of detail");
+
+    const size_t object = count++;
+    const size_t padded = (count + 3) & ~size_t(3);
+    centerX.resize(padded, 0.0f);
+    centerY.resize(padded, 0.0f);
+    centerZ.resize(padded, 0.0f);
+    radius.resize(padded, 0.0f);
+    levels.resize(padded, culledLevel);
+    for (size_t level = 0; level < maxLodLevels; ++level) {
+        errors[level].resize(padded, infinity);
+        triangles[level].resize(padded, 0);
+        if (level < objectLevels.size()) {
+            errors[level][object] = objectLevels[level].error;
+            triangles[level][object] = objectLevels[level].indexCount / 3;
+        }
+    }
+    return static_cast<uint32_t>(object);
+}
+
+/**
+ * @brief Sets an object's world space bounding sphere, call whenever its transform changes.
+ */
+void LodSelector::setBounds(uint32_t object, float x, float y, float z, float sphereRadius) {
+    centerX[object] = x;
+    centerY[object] = y;
+    centerZ[object] = z;
+    radius[object] = sphereRadius;
+}
+
+void LodSelector::clear() {
+    count = 0;
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    radius.clear();
+    levels.clear();
+    for (size_t level = 0; level < maxLodLevels; ++level) {
+        errors[level].clear();
+        triangles[level].clear();
+    }
+    telemetry = {};
+}
+
+/**
+ * @brief Picks a level (or culls) every object for this frame and updates the telemetry.
+ *
+ * Projected sizes are measured at the sphere's nearest depth, so they err towards more detail.
+ *
+ * @param viewProjection Column-major 4x4 matrix from world space to clip space.
+ * @param viewportWidth Drawable width in pixels.
+ * @param viewportHeight Drawable height in pixels.
+ */
+void LodSelector::select(const float *viewProjection, float viewportWidth, float viewportHeight,
+                         const LodSettings &settings) {
+    const float *m = viewProjection;
+    FrameConstants frame{};
+    for (int c = 0; c < 4; ++c)
+        frame.row3[c] = m[c * 4 + 3];
+    frame.row3Length = std::sqrt(m[3] * m[3] + m[7] * m[7] + m[11] * m[11]);
+    // NDC spans 2 units across the viewport
+    const float row0Length = std::sqrt(m[0] * m[0] + m[4] * m[4] + m[8] * m[8]);
+    const float row1Length = std::sqrt(m[1] * m[1] + m[5] * m[5] + m[9] * m[9]);
+    frame.pixelScale = std::max(row0Length * 0.5f * viewportWidth, row1Length * 0.5f * viewportHeight);
+    frame.budget = settings.maxScreenErrorPixels;
+    frame.coarsenBudget = settings.maxScreenErrorPixels * (1.0f - settings.hysteresis);
+    frame.cullPixels = settings.cullPixels;
+    frame.uncullPixels = settings.cullPixels * (1.0f + settings.hysteresis);
+
+    Streams streams{centerX.data(), centerY.data(), centerZ.data(), radius.data(), {}, levels.data()};
+    for (size_t level = 0; level < maxLodLevels; ++level)
+        streams.errors[level] = errors[level].data();
+
+    // Kept for the level change count, the kernel updates levels in place
+    previousLevels.assign(levels.begin(), levels.begin() + count);
+    selectSimd(streams, levels.size(), frame);
+
+    telemetry = {};
+    for (size_t i = 0; i < count; ++i) {
+        const int32_t level = levels[i];
+        telemetry.levelChanges += level != previousLevels[i];
+        telemetry.fullDetailTriangles += triangles[0][i];
+        if (level == culledLevel) {
+            telemetry.culled++;
+            continue;
+        }
+        telemetry.objectsPerLevel[level]++;
+        telemetry.triangles += triangles[level][i];
+    }
+}
+
+int32_t LodSelector::getLevel(uint32_t object) const {
+    return levels[object];
+}
+
+const LodTelemetry &LodSelector::getTelemetry() const {
+    return telemetry;
+}
+
+size_t LodSelector::size() const {
+    return count;
+}
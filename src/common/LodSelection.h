@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Mesh.h"
+
+/**
+ * @brief Per-frame level of detail selection for every object in the scene at once.
+ *
+ * Each object is a world space bounding sphere plus the error of each of its levels (see
+ * MeshLod). select() projects the spheres with the view-projection matrix, culls the ones
+ * that end up smaller than a few pixels and picks for the rest the coarsest level whose
+ * error stays under a pixel budget. Objects are processed four at a time from
+ * structure-of-arrays storage (SSE2 or NEON, scalar elsewhere).
+ *
+ * Hysteresis keeps objects near a threshold from flickering between two levels:
+ * - A finer level is picked as soon as the current one exceeds the error budget.
+ * - A coarser level is only picked once it is under (1 - hysteresis) of the budget.
+ * - A culled object only reappears once it is (1 + hysteresis) times the cull size.
+ */
+
+constexpr size_t maxLodLevels = 8;
+constexpr int32_t culledLevel = -1;
+
+struct LodSettings {
+    float maxScreenErrorPixels{1.0f};   // Largest projected level error allowed
+    float hysteresis{0.25f};            // Relative band around each threshold
+    float cullPixels{1.0f};             // Objects with a smaller projected radius are skipped
+};
+
+/**
+ * @brief What the last select() did, for tuning the thresholds on real scenes.
+ */
+struct LodTelemetry {
+    std::array<uint32_t, maxLodLevels> objectsPerLevel{};
+    uint32_t culled{0};
+    uint32_t levelChanges{0};           // Objects whose level (or culled state) changed
+    uint64_t triangles{0};              // Drawn at the selected levels
+    uint64_t fullDetailTriangles{0};    // Drawing every object at level 0 would cost this
+};
+
+class LodSelector final {
+public:
+    // Levels are ordered finest first with non-decreasing error, extras beyond maxLodLevels are dropped
+    uint32_t addObject(const std::vector<MeshLod> &levels);
+
+    void setBounds(uint32_t object, float centerX, float centerY, float centerZ, float radius);
+
+    void clear();
+
+    // viewProjection is column-major (Eigen's default), world space to clip space
+    void select(const float *viewProjection, float viewportWidth, float viewportHeight, const LodSettings &settings);
+
+    int32_t getLevel(uint32_t object) const;
+
+    const LodTelemetry &getTelemetry() const;
+
+    size_t size() const;
+
+private:
+    size_t count{0};
+
+    // Structure of arrays, padded to a multiple of 4 with culled dummies
+    std::vector<float> centerX, centerY, centerZ, radius;
+    std::array<std::vector<float>, maxLodLevels> errors;        // Infinite where a level is missing
+    std::array<std::vector<uint32_t>, maxLodLevels> triangles;
+    std::vector<int32_t> levels;
+    std::vector<int32_t> previousLevels;
+
+    LodTelemetry telemetry;
+};
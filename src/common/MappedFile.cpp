@@ -0,0 +1,95 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Maps @p fileName into memory, an empty file maps to a null pointer and size 0.
+ *
+ * @throws std::runtime_error If the file can't be opened or mapped.
+ */
+MappedFile::MappedFile(const std::string &fileName) {
+#if defined(_WIN32)
+    file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                       FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        file = nullptr;
+        throw std::runtime_error("Failed to open file: " + fileName);
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        throw std::runtime_error("Failed to get file size: " + fileName);
+    }
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if (length == 0)
+        return;
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping)
+        contents = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!contents) {
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("Failed to map file: " + fileName);
+    }
+#else
+    const int descriptor = open(fileName.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        throw std::runtime_error("Failed to open file: " + fileName);
+
+    struct stat status {};
+    if (fstat(descriptor, &status) != 0) {
+        close(descriptor);
+        throw std::runtime_error("Failed to get file size: " + fileName);
+    }
+    length = static_cast<size_t>(status.st_size);
+    if (length == 0) {
+        close(descriptor);
+        return;
+    }
+
+    void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);  // The mapping keeps the file open
+    if (address == MAP_FAILED)
+        throw std::runtime_error("Failed to map file: " + fileName);
+
+    // Parsers read front to back, ask for aggressive read-ahead
+    madvise(address, length, MADV_SEQUENTIAL);
+    madvise(address, length, MADV_WILLNEED);
+    contents = static_cast<const char *>(address);
+#endif
+}
+
+MappedFile::~MappedFile() {
+#if defined(_WIN32)
+    if (contents)
+        UnmapViewOfFile(contents);
+    if (mapping)
+        CloseHandle(mapping);
+    if (file)
+        CloseHandle(file);
+#else
+    if (contents)
+        munmap(const_cast<char *>(contents), length);
+#endif
+}
+
+const char *MappedFile::data() const {
+    return contents;
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @class MappedFile
+ * @brief A read-only memory mapping of a whole file.
+ *
+ * The file's pages are loaded on demand by the OS, so parsers can work on the contents as
+ * one contiguous buffer without reading it into memory first, and several threads can parse
+ * different parts at once. Uses mmap on POSIX systems and file mappings on Windows.
+ *
+ * Usage:
+ * - Keep the MappedFile alive for as long as pointers into data() are in use.
+ */
+class MappedFile final {
+public:
+    explicit MappedFile(const std::string &fileName);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const;
+    size_t size() const;
+
+private:
+    const char *contents{nullptr};
+    size_t length{0};
+#if defined(_WIN32)
+    void *file{nullptr};
+    void *mapping{nullptr};
+#endif
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief CPU-side indexed triangle mesh, the common currency of the loaders, generators and
+ * mesh optimization passes before anything is uploaded to the GPU.
+ *
+ * Attributes are stored as separate tightly packed float arrays. Optional attributes are
+ * either empty or hold exactly one entry per vertex.
+ */
+struct Mesh {
+    std::vector<float> positions;   // xyz per vertex
+    std::vector<float> normals;     // xyz per vertex, optional
+    std::vector<float> colors;      // rgba per vertex, optional
+    std::vector<uint32_t> indices;  // Triangle list
+
+    size_t vertexCount() const { return positions.size() / 3; }
+    size_t triangleCount() const { return indices.size() / 3; }
+};
+
+/**
+ * @brief One level of detail, a range of LodChain::indices.
+ *
+ * error is the largest distance, in object units, between this level's surface and the full
+ * detail mesh (an estimate from the simplifier's quadrics), so it can be projected to pixels.
+ */
+struct MeshLod {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    float error;
+};
+
+/**
+ * @brief Levels of detail for a Mesh, all sharing its vertices.
+ *
+ * Level 0 is the full detail triangle list, later levels have fewer triangles. Every level is
+ * stored back to back in one index array so the GPU needs a single index buffer.
+ */
+struct LodChain {
+    std::vector<uint32_t> indices;
+    std::vector<MeshLod> levels;
+};
+
+/**
+ * @brief A small cluster of triangles with its own local vertex list, for GPU culling and
+ * mesh shaders.
+ *
+ * vertexOffset indexes MeshletSet::vertices and triangleOffset indexes MeshletSet::triangles
+ * (in bytes, three per triangle, each a position in the meshlet's vertex list).
+ */
+struct Meshlet {
+    uint32_t vertexOffset;
+    uint32_t triangleOffset;
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+    float center[3];                // Bounding sphere, object space
+    float radius;
+};
+
+struct MeshletSet {
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> vertices;     // Mesh vertex indices
+    std::vector<uint8_t> triangles;     // Local vertex indices
+};
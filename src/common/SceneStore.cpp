@@ -0,0 +1,353 @@
+#include "SceneStore.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "ThreadPool.h"
+
+namespace {
+
+constexpr Matrix4 identityMatrix{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+constexpr Color4 white{1, 1, 1, 1};
+
+template <typename T>
+void moveLast(std::vector<T> &values, uint32_t row) {
+    if (values.empty())
+        return;
+    values[row] = values.back();
+    values.pop_back();
+}
+
+} // namespace
+
+/**
+ * @brief Creates an entity with default values for each of @p components.
+ *
+ * @throws std::runtime_error If @p components has bits outside AllComponents.
+ */
+Entity SceneStore::create(ComponentMask components) {
+    if (components & ~AllComponents)
+        throw std::runtime_error("Unknown scene component");
+
+    const uint32_t archetype = findArchetype(components);
+    const uint32_t index = allocateSlot();
+    Slot &slot = slots[index];
+    slot.archetype = archetype;
+    slot.row = static_cast<uint32_t>(archetypes[archetype].entities.size());
+    slot.alive = true;
+
+    const Entity entity{index, slot.generation};
+    appendRow(archetypes[archetype], entity);
+    ++liveCount;
+    ++version;
+    return entity;
+}
+
+/**
+ * @brief Creates @p count entities with the same components, growing each array once.
+ */
+void SceneStore::create(ComponentMask components, size_t count, std::vector<Entity> &out) {
+    if (components & ~AllComponents)
+        throw std::runtime_error("Unknown scene component");
+
+    Archetype &archetype = archetypes[findArchetype(components)];
+    const size_t rows = archetype.entities.size() + count;
+    archetype.entities.reserve(rows);
+    if (components & TransformComponent)
+        archetype.transforms.reserve(rows);
+    if (components & GeometryComponent)
+        archetype.geometries.reserve(rows);
+    if (components & ColorComponent)
+        archetype.colors.reserve(rows);
+    if (components & BoundsComponent)
+        archetype.bounds.reserve(rows);
+    if (components & VisibilityComponent)
+        archetype.visibility.reserve(rows);
+
+    out.reserve(out.size() + count);
+    for (size_t i = 0; i < count; ++i)
+        out.push_back(create(components));
+}
+
+/**
+ * @brief Destroys an entity, its handle and every copy of it become stale.
+ *
+ * @throws std::runtime_error If @p entity is stale.
+ */
+void SceneStore::destroy(Entity entity) {
+    if (!isAlive(entity))
+        throw std::runtime_error("Stale scene entity handle");
+    Slot &slot = slots[entity.index];
+    removeRow(archetypes[slot.archetype], slot.row);
+
+    slot.alive = false;
+    slot.transformDirty = false;    // A stale handle may stay listed, the slot's next entity gets its own entry
+    if (++slot.generation == 0)
+        slot.generation = 1;    // Generation 0 is reserved for the default handle
+    freeSlots.push_back(entity.index);
+    --liveCount;
+    ++version;
+}
+
+/**
+ * @brief Adds components with default values, keeping the ones the entity already has.
+ */
+void SceneStore::addComponents(Entity entity, ComponentMask components) {
+    if (components & ~AllComponents)
+        throw std::runtime_error("Unknown scene component");
+
+    const Slot &slot = slotOf(entity);
+    const ComponentMask current = archetypes[slot.archetype].components;
+    if ((current | components) == current)
+        return;
+    const uint32_t target = findArchetype(current | components);
+    moveRow(archetypes[slot.archetype], slot.row, archetypes[target]);
+}
+
+void SceneStore::removeComponents(Entity entity, ComponentMask components) {
+    const Slot &slot = slotOf(entity);
+    const ComponentMask current = archetypes[slot.archetype].components;
+    if ((current & ~components) == current)
+        return;
+    const uint32_t target = findArchetype(current & ~components);
+    moveRow(archetypes[slot.archetype], slot.row, archetypes[target]);
+}
+
+bool SceneStore::isAlive(Entity entity) const {
+    return entity.index < slots.size() && slots[entity.index].alive &&
+           slots[entity.index].generation == entity.generation;
+}
+
+ComponentMask SceneStore::getComponents(Entity entity) const {
+    return archetypes[slotOf(entity).archetype].components;
+}
+
+const Matrix4 &SceneStore::transform(Entity entity) const {
+    uint32_t row;
+    return archetypeWith(entity, TransformComponent, row).transforms[row];
+}
+
+uint32_t &SceneStore::geometry(Entity entity) {
+    uint32_t row;
+    return archetypeWith(entity, GeometryComponent, row).geometries[row];
+}
+
+Color4 &SceneStore::color(Entity entity) {
+    uint32_t row;
+    return archetypeWith(entity, ColorComponent, row).colors[row];
+}
+
+Sphere &SceneStore::bounds(Entity entity) {
+    uint32_t row;
+    return archetypeWith(entity, BoundsComponent, row).bounds[row];
+}
+
+uint8_t &SceneStore::visibility(Entity entity) {
+    uint32_t row;
+    return archetypeWith(entity, VisibilityComponent, row).visibility[row];
+}
+
+/**
+ * @brief Writes an entity's transform and lists it in getDirtyTransforms().
+ *
+ * @throws std::runtime_error If @p entity is stale or has no transform, or the matrix isn't
+ *         affine (last row 0 0 0 1), nothing is written then.
+ */
+void SceneStore::setTransform(Entity entity, const Matrix4 &matrix) {
+    if (matrix[3] != 0.0f || matrix[7] != 0.0f || matrix[11] != 0.0f || matrix[15] != 1.0f)
+        throw std::runtime_error("Scene transforms must be affine");
+    uint32_t row;
+    archetypeWith(entity, TransformComponent, row).transforms[row] = matrix;
+    Slot &slot = slots[entity.index];
+    if (!slot.transformDirty) {
+        slot.transformDirty = true;
+        dirtyTransforms.push_back(entity);
+    }
+}
+
+const std::vector<Entity> &SceneStore::getDirtyTransforms() const {
+    return dirtyTransforms;
+}
+
+void SceneStore::clearDirtyTransforms() {
+    for (const Entity &entity : dirtyTransforms)
+        if (isAlive(entity))
+            slots[entity.index].transformDirty = false;
+    dirtyTransforms.clear();
+}
+
+/**
+ * @brief Runs a system over every matching entity, in chunks spread over the shared ThreadPool.
+ *
+ * Chunks never span two archetypes. The system must be safe to run on several chunks at once.
+ */
+void SceneStore::forEachChunk(ComponentMask required, ComponentMask excluded, const System &system,
+                              size_t chunkRows) {
+    chunkRows = std::max<size_t>(chunkRows, 1);
+    std::vector<SceneChunk> chunks;
+    for (Archetype &archetype : archetypes) {
+        const ComponentMask components = archetype.components;
+        if ((components & required) != required || (components & excluded) != 0)
+            continue;
+        for (size_t first = 0; first < archetype.entities.size(); first += chunkRows) {
+            auto slice = [first](auto &values) { return values.empty() ? nullptr : values.data() + first; };
+            chunks.push_back({components, std::min(chunkRows, archetype.entities.size() - first),
+                              archetype.entities.data() + first, slice(archetype.transforms),
+                              slice(archetype.geometries), slice(archetype.colors), slice(archetype.bounds),
+                              slice(archetype.visibility)});
+        }
+    }
+
+    ThreadPool::shared().parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c)
+            system(chunks[c]);
+    });
+}
+
+void SceneStore::forEachChunk(ComponentMask required, const System &system, size_t chunkRows) {
+    forEachChunk(required, 0, system, chunkRows);
+}
+
+void SceneStore::forEachChunkInOrder(ComponentMask required, ComponentMask excluded, const System &system) {
+    for (Archetype &archetype : archetypes) {
+        const ComponentMask components = archetype.components;
+        if ((components & required) != required || (components & excluded) != 0 || archetype.entities.empty())
+            continue;
+        auto data = [](auto &values) { return values.empty() ? nullptr : values.data(); };
+        system({components, archetype.entities.size(), archetype.entities.data(), data(archetype.transforms),
+                data(archetype.geometries), data(archetype.colors), data(archetype.bounds), data(archetype.visibility)});
+    }
+}
+
+size_t SceneStore::size() const {
+    return liveCount;
+}
+
+void SceneStore::clear() {
+    for (Archetype &archetype : archetypes)
+        for (const Entity &entity : archetype.entities) {
+            Slot &slot = slots[entity.index];
+            slot.alive = false;
+            slot.transformDirty = false;
+            if (++slot.generation == 0)
+                slot.generation = 1;
+            freeSlots.push_back(entity.index);
+        }
+    for (Archetype &archetype : archetypes) {
+        archetype.entities.clear();
+        archetype.transforms.clear();
+        archetype.geometries.clear();
+        archetype.colors.clear();
+        archetype.bounds.clear();
+        archetype.visibility.clear();
+    }
+    dirtyTransforms.clear();
+    liveCount = 0;
+    ++version;
+}
+
+uint64_t SceneStore::getVersion() const {
+    return version;
+}
+
+void SceneStore::touch() {
+    ++version;
+}
+
+uint32_t SceneStore::findArchetype(ComponentMask components) {
+    if (archetypeOf.empty())
+        archetypeOf.assign(AllComponents + 1, -1);
+    if (archetypeOf[components] < 0) {
+        archetypeOf[components] = static_cast<int32_t>(archetypes.size());
+        archetypes.push_back({});
+        archetypes.back().components = components;
+    }
+    return static_cast<uint32_t>(archetypeOf[components]);
+}
+
+uint32_t SceneStore::allocateSlot() {
+    if (!freeSlots.empty()) {
+        const uint32_t index = freeSlots.back();
+        freeSlots.pop_back();
+        return index;
+    }
+    if (slots.size() >= UINT32_MAX)
+        throw std::runtime_error("Too many scene entities");
+    slots.emplace_back();
+    return static_cast<uint32_t>(slots.size() - 1);
+}
+
+const SceneStore::Slot &SceneStore::slotOf(Entity entity) const {
+    if (!isAlive(entity))
+        throw std::runtime_error("Stale scene entity handle");
+    return slots[entity.index];
+}
+
+void SceneStore::appendRow(Archetype &archetype, Entity entity) {
+    archetype.entities.push_back(entity);
+    if (archetype.components & TransformComponent)
+        archetype.transforms.push_back(identityMatrix);
+    if (archetype.components & GeometryComponent)
+        archetype.geometries.push_back(noGeometry);
+    if (archetype.components & ColorComponent)
+        archetype.colors.push_back(white);
+    if (archetype.components & BoundsComponent)
+        archetype.bounds.push_back({});
+    if (archetype.components & VisibilityComponent)
+        archetype.visibility.push_back(1);
+}
+
+/*
+    Moves a row to another archetype, components both have keep their values
+*/
+void SceneStore::moveRow(Archetype &from, uint32_t row, Archetype &to) {
+    const Entity entity = from.entities[row];
+    const ComponentMask shared = from.components & to.components;
+    const uint32_t toRow = static_cast<uint32_t>(to.entities.size());
+    appendRow(to, entity);
+    if (shared & TransformComponent)
+        to.transforms[toRow] = from.transforms[row];
+    if (shared & GeometryComponent)
+        to.geometries[toRow] = from.geometries[row];
+    if (shared & ColorComponent)
+        to.colors[toRow] = from.colors[row];
+    if (shared & BoundsComponent)
+        to.bounds[toRow] = from.bounds[row];
+    if (shared & VisibilityComponent)
+        to.visibility[toRow] = from.visibility[row];
+    removeRow(from, row);
+
+    Slot &slot = slots[entity.index];
+    slot.archetype = static_cast<uint32_t>(&to - archetypes.data());
+    slot.row = toRow;
+    ++version;
+}
+
+/*
+    Fills the row with the archetype's last one so the arrays stay dense
+*/
+void SceneStore::removeRow(Archetype &archetype, uint32_t row) {
+    const Entity moved = archetype.entities.back();
+    moveLast(archetype.entities, row);
+    moveLast(archetype.transforms, row);
+    moveLast(archetype.geometries, row);
+    moveLast(archetype.colors, row);
+    moveLast(archetype.bounds, row);
+    moveLast(archetype.visibility, row);
+    if (row < archetype.entities.size())
+        slots[moved.index].row = row;
+}
+
+SceneStore::Archetype &SceneStore::archetypeWith(Entity entity, ComponentMask component, uint32_t &row) {
+    return const_cast<Archetype &>(std::as_const(*this).archetypeWith(entity, component, row));
+}
+
+const SceneStore::Archetype &SceneStore::archetypeWith(Entity entity, ComponentMask component, uint32_t &row) const {
+    const Slot &slot = slotOf(entity);
+    const Archetype &archetype = archetypes[slot.archetype];
+    if (!(archetype.components & component))
+        throw std::runtime_error("Scene entity lacks the component");
+    row = slot.row;
+    return archetype;
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/*
+-------------------------------------------------------------------
+  SCENE STORE  ------------------------------------------------------
+
+  Entity-component storage for scene objects. An entity is a generational handle, its
+  components live in dense arrays grouped by archetype (the set of components an entity has):
+
+    Transform     column-major 4x4 world matrix, affine (last row 0 0 0 1), identity by default
+    Geometry      what to draw, an index into a table the owner keeps (noGeometry by default)
+    Color         rgba, opaque white by default
+    Bounds        object space bounding sphere, xyz center and radius
+    Visibility    nonzero to draw, visible by default
+
+  Each archetype keeps one array per component it has and one of entities, in the same row
+  order, so a system reads only the arrays it needs, front to back. Destroying an entity moves
+  the last row of its archetype into its place, adding or removing components moves it to
+  another archetype. Both keep the arrays dense.
+
+  A handle holds the generation of its slot when it was created. Destroying the entity bumps
+  the generation, so stale handles are detected instead of reaching whatever reuses the slot.
+
+  forEachChunk() hands systems slices of at most chunkRows rows of every matching archetype,
+  in parallel on the shared ThreadPool, forEachChunkInOrder() whole archetypes one at a time.
+  Components may be written through a chunk, but nothing may be created, destroyed or moved
+  while chunks are running. References returned by the accessors are invalidated by the same
+  operations.
+
+  Transforms are the exception: they are read-only in chunks and written with setTransform(),
+  which lists the entity once in getDirtyTransforms() until clearDirtyTransforms(). A consumer
+  (the renderer copying matrices to its primitives) then visits only what moved instead of
+  every entity.
+-------------------------------------------------------------------
+*/
+
+using ComponentMask = uint32_t;
+
+constexpr ComponentMask TransformComponent = 1u << 0;
+constexpr ComponentMask GeometryComponent = 1u << 1;
+constexpr ComponentMask ColorComponent = 1u << 2;
+constexpr ComponentMask BoundsComponent = 1u << 3;
+constexpr ComponentMask VisibilityComponent = 1u << 4;
+constexpr ComponentMask AllComponents = (1u << 5) - 1;
+
+constexpr uint32_t noGeometry = UINT32_MAX;
+constexpr size_t defaultChunkRows = 4096;
+
+using Matrix4 = std::array<float, 16>;
+using Color4 = std::array<float, 4>;
+using Sphere = std::array<float, 4>;
+
+/**
+ * @brief A generational handle, the default one never refers to an entity.
+ */
+struct Entity {
+    uint32_t index{0};
+    uint32_t generation{0};
+
+    bool operator==(const Entity &) const = default;
+};
+
+/**
+ * @brief Rows [0, count) of one archetype, components it lacks are null.
+ */
+struct SceneChunk {
+    ComponentMask components;
+    size_t count;
+    const Entity *entities;
+    const Matrix4 *transforms;      // Written with SceneStore::setTransform()
+    uint32_t *geometries;
+    Color4 *colors;
+    Sphere *bounds;
+    uint8_t *visibility;
+};
+
+class SceneStore final {
+public:
+    using System = std::function<void(const SceneChunk &chunk)>;
+
+    // Unknown component bits throw std::runtime_error
+    Entity create(ComponentMask components);
+
+    // Appends count entities to out, faster than one at a time
+    void create(ComponentMask components, size_t count, std::vector<Entity> &out);
+
+    // These throw std::runtime_error for stale handles
+    void destroy(Entity entity);
+
+    void addComponents(Entity entity, ComponentMask components);
+
+    void removeComponents(Entity entity, ComponentMask components);
+
+    bool isAlive(Entity entity) const;
+
+    ComponentMask getComponents(Entity entity) const;
+
+    // Throw std::runtime_error for stale handles or if the entity lacks the component
+    const Matrix4 &transform(Entity entity) const;
+    uint32_t &geometry(Entity entity);
+    Color4 &color(Entity entity);
+    Sphere &bounds(Entity entity);
+    uint8_t &visibility(Entity entity);
+
+    // Writes the transform and adds the entity to getDirtyTransforms(), throws like transform()
+    // and for matrices that aren't affine
+    void setTransform(Entity entity, const Matrix4 &matrix);
+
+    // Entities given a transform since the last clearDirtyTransforms(), each once. Handles
+    // destroyed since are left in, check isAlive()
+    const std::vector<Entity> &getDirtyTransforms() const;
+
+    void clearDirtyTransforms();
+
+    // Entities whose components include all of required and none of excluded
+    void forEachChunk(ComponentMask required, ComponentMask excluded, const System &system,
+                      size_t chunkRows = defaultChunkRows);
+
+    void forEachChunk(ComponentMask required, const System &system, size_t chunkRows = defaultChunkRows);
+
+    // One chunk per archetype, in creation order on the calling thread, for systems with shared output
+    void forEachChunkInOrder(ComponentMask required, ComponentMask excluded, const System &system);
+
+    size_t size() const;
+
+    // Destroys every entity, handles given out so far all become stale
+    void clear();
+
+    // Bumped by every create, destroy or component change, to tell when cached views are stale
+    uint64_t getVersion() const;
+
+    // Bumps the version after writing components a cached view depends on (e.g. visibility)
+    void touch();
+
+private:
+    struct Archetype {
+        ComponentMask components;
+        std::vector<Entity> entities;
+        std::vector<Matrix4> transforms;
+        std::vector<uint32_t> geometries;
+        std::vector<Color4> colors;
+        std::vector<Sphere> bounds;
+        std::vector<uint8_t> visibility;
+    };
+
+    struct Slot {
+        uint32_t generation{1};
+        uint32_t archetype{0};
+        uint32_t row{0};
+        bool alive{false};
+        bool transformDirty{false};     // Listed in dirtyTransforms
+    };
+
+    std::vector<Archetype> archetypes;
+    std::vector<int32_t> archetypeOf;   // By component mask, -1 if not created yet
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    std::vector<Entity> dirtyTransforms;
+    size_t liveCount{0};
+    uint64_t version{0};
+
+    uint32_t findArchetype(ComponentMask components);
+    uint32_t allocateSlot();
+    const Slot &slotOf(Entity entity) const;
+    void appendRow(Archetype &archetype, Entity entity);
+    void moveRow(Archetype &from, uint32_t row, Archetype &to);
+    void removeRow(Archetype &archetype, uint32_t row);
+    Archetype &archetypeWith(Entity entity, ComponentMask component, uint32_t &row);
+    const Archetype &archetypeWith(Entity entity, ComponentMask component, uint32_t &row) const;
+};
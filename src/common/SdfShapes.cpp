@@ -0,0 +1,103 @@
+#include "SdfShapes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "VertexQuantization.h"
+
+/**
+ * @brief Builds an instance, packing the color to RGBA8.
+ *
+ * @param rgba Color as 4 floats in [0, 1].
+ * @param cornerRadius Only used by rounded rectangles, clamped to the smaller half extent.
+ * @param thickness Outline width, 0 for a filled shape. Rings have no filled form, a ring needs a
+ * thickness > 0 or it would have no width to cover.
+ */
+SdfInstance packSdfInstance(SdfShape shape, float centerX, float centerY, float halfWidth, float halfHeight,
+                            const float rgba[4], float cornerRadius, float thickness) {
+    if (shape == SdfShape::Ring && !(thickness > 0.0f))
+        throw std::runtime_error("Ring thickness must be greater than 0");
+
+    SdfInstance instance{};
+    instance.center[0] = centerX;
+    instance.center[1] = centerY;
+    instance.halfExtents[0] = std::fabs(halfWidth);
+    instance.halfExtents[1] = std::fabs(halfHeight);
+    instance.cornerRadius = std::clamp(cornerRadius, 0.0f, std::min(instance.halfExtents[0], instance.halfExtents[1]));
+    instance.thickness = std::max(thickness, 0.0f);
+    instance.shape = static_cast<uint32_t>(shape);
+    encodeColors(rgba, 1, &instance.color);
+    return instance;
+}
+
+/**
+ * @brief Signed distance from a point to the instance's outline, negative inside.
+ *
+ * Must stay in sync with sdfDistance() in shaders.metal.
+ *
+ * @param x Point in the same space as the instance center.
+ * @param y Point in the same space as the instance center.
+ */
+float sdfDistance(const SdfInstance &instance, float x, float y) {
+    const float px = x - instance.center[0];
+    const float py = y - instance.center[1];
+    const float hx = instance.halfExtents[0];
+    const float hy = instance.halfExtents[1];
+
+    float distance;
+    switch (static_cast<SdfShape>(instance.shape)) {
+        case SdfShape::RoundedRect: {
+            const float c = instance.cornerRadius;
+            const float qx = std::fabs(px) - (hx - c);
+            const float qy = std::fabs(py) - (hy - c);
+            const float outside = std::hypot(std::max(qx, 0.0f), std::max(qy, 0.0f));
+            distance = outside + std::min(std::max(qx, qy), 0.0f) - c;
+            break;
+        }
+        case SdfShape::Capsule: {
+            // Segment along the longer axis, radius is the shorter half extent
+            const bool alongX = hx >= hy;
+            const float radius = alongX ? hy : hx;
+            const float halfLength = (alongX ? hx : hy) - radius;
+            const float along = alongX ? px : py;
+            const float across = alongX ? py : px;
+            distance = std::hypot(along - std::clamp(along, -halfLength, halfLength), across) - radius;
+            break;
+        }
+        case SdfShape::Circle:
+        case SdfShape::Ring:
+        default:
+            distance = std::hypot(px, py) - hx;
+            break;
+    }
+
+    if (instance.thickness > 0.0f || static_cast<SdfShape>(instance.shape) == SdfShape::Ring)
+        distance = std::fabs(distance) - 0.5f * instance.thickness;
+    return distance;
+}
+
+/**
+ * @brief Analytic antialiasing: fraction of a pixel covered at @p distance.
+ *
+ * A linear ramp one pixel wide centered on the outline, which is what fragment_sdf computes
+ * with fwidth() as the pixel size.
+ *
+ * @param distance Signed distance from sdfDistance().
+ * @param pixelSize Size of one pixel in the same units as the distance.
+ */
+float sdfCoverage(float distance, float pixelSize) {
+    if (pixelSize <= 0.0f)
+        return distance <= 0.0f ? 1.0f : 0.0f;
+    return std::clamp(0.5f - distance / pixelSize, 0.0f, 1.0f);
+}
+
+/**
+ * @brief Half size of the quad drawn for the instance along @p axis (0 = x, 1 = y).
+ *
+ * Includes half the outline thickness and @p padding (one pixel, in object units) so the
+ * antialiasing ramp is never clipped by the quad's edge.
+ */
+float sdfQuadExtent(const SdfInstance &instance, int axis, float padding) {
+    return instance.halfExtents[axis] + 0.5f * instance.thickness + padding;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Shapes drawn analytically as one instanced quad each.
+ *
+ * Instead of tessellating, the fragment shader evaluates the shape's signed distance function
+ * and turns it into coverage with a one pixel wide ramp. This file is the CPU reference for
+ * the math in fragment_sdf and the packing of the per-instance data it reads.
+ */
+enum class SdfShape : uint32_t {
+    Circle,         // halfExtents.x is the radius
+    Ring,           // Circle outline, thickness is the ring width and must be > 0
+    RoundedRect,    // cornerRadius rounds the corners of the halfExtents box
+    Capsule         // Stadium along the longer axis of halfExtents
+};
+
+/**
+ * @brief One shape instance, matches SdfInstance in shaders.metal (32 bytes).
+ *
+ * A thickness > 0 turns any shape into an outline of that width.
+ */
+struct SdfInstance {
+    float center[2];
+    float halfExtents[2];
+    float cornerRadius;
+    float thickness;
+    uint32_t shape;         // SdfShape
+    uint32_t color;         // RGBA8 unorm, red in the lowest byte
+};
+
+static_assert(sizeof(SdfInstance) == 32, "SdfInstance must match the shader layout");
+
+SdfInstance packSdfInstance(SdfShape shape, float centerX, float centerY, float halfWidth, float halfHeight,
+                            const float rgba[4], float cornerRadius = 0.0f, float thickness = 0.0f);
+
+float sdfDistance(const SdfInstance &instance, float x, float y);
+
+float sdfCoverage(float distance, float pixelSize);
+
+float sdfQuadExtent(const SdfInstance &instance, int axis, float padding);
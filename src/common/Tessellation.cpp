@@ -0,0 +1,85 @@
+#include "Tessellation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "common.h"
+
+/**
+ * @brief Fewest power-of-two segments whose chord error stays under @p maxErrorPixels.
+ *
+ * Results are rounded up to a power of two so levels can share one vertex ring and the number
+ * of distinct levels stays small enough to cache.
+ *
+ * @param radiusPixels Projected radius of the shape on screen.
+ * @param maxErrorPixels Largest allowed distance between chord and arc, in pixels.
+ * @param minSegments Lower clamp, a power of two >= 3.
+ * @param maxSegments Upper clamp, a power of two.
+ */
+uint32_t segmentsForChordError(float radiusPixels, float maxErrorPixels, uint32_t minSegments, uint32_t maxSegments) {
+    if (!(radiusPixels > maxErrorPixels) || maxErrorPixels <= 0.0f)
+        return minSegments;
+
+    // sagitta = r * (1 - cos(pi / n))  =>  n = pi / acos(1 - e / r)
+    const double halfAngle = std::acos(1.0 - static_cast<double>(maxErrorPixels) / radiusPixels);
+    const double exact = M_PI / halfAngle;
+    if (!(exact < maxSegments))
+        return maxSegments;
+
+    uint32_t segments = minSegments;
+    while (segments < exact && segments < maxSegments)
+        segments <<= 1;
+    return segments;
+}
+
+/**
+ * @brief Appends a triangle-list fan for @p segments segments of a shared vertex ring.
+ *
+ * The ring is vertex 0 (center) followed by @p ringSegments rim vertices. A level with fewer
+ * segments uses every (ringSegments / segments)-th rim vertex, so all levels share one vertex
+ * buffer. Exactly one triangle is emitted per segment.
+ *
+ * @throws std::runtime_error If @p segments does not evenly divide @p ringSegments.
+ */
+void appendFanIndices(std::vector<uint16_t> &indices, uint32_t segments, uint32_t ringSegments) {
+    if (segments < 3 || ringSegments % segments != 0 || ringSegments >= UINT16_MAX)
+        throw std::runtime_error("Invalid fan segment count");
+
+    const uint32_t stride = ringSegments / segments;
+    indices.reserve(indices.size() + segments * 3);
+    for (uint32_t i = 0; i < segments; ++i) {
+        indices.push_back(0);
+        indices.push_back(static_cast<uint16_t>(1 + i * stride));
+        indices.push_back(static_cast<uint16_t>(1 + ((i + 1) % segments) * stride));
+    }
+}
+
+/**
+ * @brief Projects a radius around the object origin to screen space.
+ *
+ * Measures the larger of the projected x and y radius so non-uniform scale still gets enough
+ * segments. The matrix may include a perspective projection, points are divided by their w.
+ *
+ * @param matrix The object's model-view-projection matrix, object to clip space.
+ * @return Radius in pixels, 0 if the center is behind the camera.
+ */
+float projectedRadiusPixels(const Matrix4f &matrix, float radius, float viewportWidth, float viewportHeight) {
+    const Eigen::Vector4f center = matrix * Eigen::Vector4f(0.0f, 0.0f, 0.0f, 1.0f);
+    if (center.w() <= 0.0f)
+        return 0.0f;
+
+    const Eigen::Vector4f axisX = matrix * Eigen::Vector4f(radius, 0.0f, 0.0f, 1.0f);
+    const Eigen::Vector4f axisY = matrix * Eigen::Vector4f(0.0f, radius, 0.0f, 1.0f);
+
+    // NDC spans 2 units across the viewport
+    const Eigen::Vector2f toPixels(0.5f * viewportWidth, 0.5f * viewportHeight);
+    const Eigen::Vector2f c = center.head<2>() / center.w();
+    auto pixelDistance = [&](const Eigen::Vector4f &p) {
+        if (p.w() <= 0.0f)
+            return 0.0f;
+        return (p.head<2>() / p.w() - c).cwiseProduct(toPixels).norm();
+    };
+
+    return std::max(pixelDistance(axisX), pixelDistance(axisY));
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Transform.h"
+
+/**
+ * @brief Helpers for tessellating analytic shapes to a screen-space error target.
+ *
+ * A circle of radius r drawn with n segments deviates from the true circle by at most the
+ * sagitta r * (1 - cos(pi / n)). Solving that for n gives the fewest segments that keep the
+ * error under a pixel budget, so tiny circles get a handful of triangles and large ones get
+ * smooth outlines.
+ */
+
+/**
+ * @brief One cached level of detail inside a shared index buffer.
+ */
+struct TessellationLevel {
+    uint32_t segments;
+    uint32_t indexOffset;   // In indices, not bytes
+    uint32_t indexCount;
+};
+
+uint32_t segmentsForChordError(float radiusPixels, float maxErrorPixels, uint32_t minSegments, uint32_t maxSegments);
+
+void appendFanIndices(std::vector<uint16_t> &indices, uint32_t segments, uint32_t ringSegments);
+
+float projectedRadiusPixels(const Matrix4f &matrix, float radius, float viewportWidth, float viewportHeight);
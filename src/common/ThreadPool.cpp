@@ -0,0 +1,150 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace {
+// True while this thread is running a chunk, nested parallelFor calls then run inline
+thread_local bool insideParallelFor = false;
+}
+
+struct ThreadPool::Job {
+    const Task *task;
+    size_t count;
+    size_t grain;
+    size_t chunkCount;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> completed{0};
+    std::mutex errorMutex;
+    std::exception_ptr error;
+};
+
+/**
+ * @brief Starts the worker threads.
+ *
+ * @param threadCount Threads that run chunks including the caller, 0 uses every hardware thread.
+ */
+ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    // The calling thread also runs chunks, so it counts as one
+    for (size_t i = 1; i < threadCount; ++i)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+size_t ThreadPool::size() const {
+    return workers.size() + 1;
+}
+
+/**
+ * @brief Runs @p task over [0, count) in chunks of @p grain, blocking until all are done.
+ *
+ * @param task Called as task(begin, end) for each chunk, possibly from several threads at once.
+ */
+void ThreadPool::parallelFor(size_t count, size_t grain, const Task &task) {
+    if (count == 0)
+        return;
+
+    grain = std::max<size_t>(grain, 1);
+    const size_t chunkCount = (count + grain - 1) / grain;
+    if (workers.empty() || chunkCount == 1 || insideParallelFor) {
+        task(0, count);
+        return;
+    }
+
+    std::lock_guard<std::mutex> submitLock(submitMutex);
+
+    Job job;
+    job.task = &task;
+    job.count = count;
+    job.grain = grain;
+    job.chunkCount = chunkCount;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current = &job;
+        ++generation;
+    }
+    wake.notify_all();
+
+    runChunks(job);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&]() { return job.completed.load() == chunkCount && activeWorkers == 0; });
+        current = nullptr;
+    }
+
+    if (job.error)
+        std::rethrow_exception(job.error);
+}
+
+void ThreadPool::parallelFor(size_t count, const Task &task) {
+    const size_t grain = std::max<size_t>(1, count / (size() * 4));
+    parallelFor(count, grain, task);
+}
+
+ThreadPool &ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::workerLoop() {
+    uint64_t seen = 0;
+    while (true) {
+        Job *job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+            job = current;
+            if (!job)
+                continue;   // Woke up after the job already finished
+            ++activeWorkers;
+        }
+
+        runChunks(*job);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --activeWorkers;
+        }
+        done.notify_all();
+    }
+}
+
+void ThreadPool::runChunks(Job &job) {
+    insideParallelFor = true;
+    while (true) {
+        const size_t chunk = job.next.fetch_add(1);
+        if (chunk >= job.chunkCount)
+            break;
+
+        const size_t begin = chunk * job.grain;
+        const size_t end = std::min(job.count, begin + job.grain);
+        try {
+            (*job.task)(begin, end);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(job.errorMutex);
+            if (!job.error)
+                job.error = std::current_exception();
+        }
+        job.completed.fetch_add(1);
+    }
+    insideParallelFor = false;
+}
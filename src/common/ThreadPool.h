@@ -0,0 +1,59 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class ThreadPool
+ * @brief A fixed set of worker threads that split index ranges between them.
+ *
+ * parallelFor() cuts [0, count) into chunks of @p grain and runs them on the workers and the
+ * calling thread, returning once all chunks are done. The first exception thrown by a chunk
+ * is rethrown on the caller. Calls made from inside a chunk run serially on that thread, so
+ * nested use never deadlocks.
+ *
+ * Usage:
+ * - ThreadPool::shared() is sized to the machine and meant for most work.
+ * - Construct a separate pool to control the thread count (e.g. for benchmarks).
+ */
+class ThreadPool final {
+public:
+    using Task = std::function<void(size_t begin, size_t end)>;
+
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Number of threads that run chunks, including the caller
+    size_t size() const;
+
+    void parallelFor(size_t count, size_t grain, const Task &task);
+
+    // Picks a grain that gives every thread a few chunks to balance load
+    void parallelFor(size_t count, const Task &task);
+
+    static ThreadPool &shared();
+
+private:
+    struct Job;
+
+    void workerLoop();
+    static void runChunks(Job &job);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;       // Workers wait here for a job
+    std::condition_variable done;       // The caller waits here for workers to finish
+    std::mutex submitMutex;             // One job at a time
+    Job *current{nullptr};
+    uint64_t generation{0};
+    size_t activeWorkers{0};
+    bool stopping{false};
+};
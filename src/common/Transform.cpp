@@ -5,18 +5,20 @@
 #include "Transform.h"
 
 #include <iostream>
+#include <stdexcept>
 
 /**
  * @class Transform
  * @brief A class for managing 3D transformations, including translation, rotation, and scaling.
  *
- * This class uses Eigen matrices to represent and manipulate 4x4 transformation matrices.
+ * This class uses Eigen matrices to represent and manipulate affine transformation matrices, stored
+ * as their first three rows (the last one is always 0 0 0 1).
  * It provides methods to apply translation, rotation, and scaling transformations, as well as
  * to reset the transformation matrix to the identity matrix.
  */
 Transform::Transform() {
     std::cout << "Transform::Transform()" << std::endl;
-    transformMatrix = Eigen::Matrix4f::Identity();
+    transformMatrix = AffineMatrix::Identity();
 }
 /**
  * @brief Applies a translation transformation to the current transformation matrix.
@@ -26,13 +28,9 @@ Transform::Transform() {
  * @param z The translation along the Z-axis.
  */
 void Transform::setTranslation(float x, float y, float z) {
-
-    Eigen::Matrix4f translationMatrix = Eigen::Matrix4f::Identity();
-    translationMatrix(0, 3) = x;
-    translationMatrix(1, 3) = y;
-    translationMatrix(2, 3) = z;
-
-    transformMatrix = translationMatrix * transformMatrix;
+    // Translating after the matrix only moves its translation column
+    transformMatrix.col(3) += Eigen::Vector3f(x, y, z);
+    ++version;
 
 }
 /**
@@ -48,10 +46,8 @@ void Transform::setRotation(float angleRadians, float x, float y, float z) {
     Eigen::AngleAxisf rotation(angleRadians, axis.normalized());
     Eigen::Matrix3f rotMatrix = rotation.toRotationMatrix();
 
-    Eigen::Matrix4f rotationMatrix = Eigen::Matrix4f::Identity();
-    rotationMatrix.block<3,3>(0,0) = rotMatrix;
-
-    transformMatrix = rotationMatrix * transformMatrix;
+    transformMatrix = (rotMatrix * transformMatrix).eval();
+    ++version;
 }
 /**
  * @brief Applies a scaling transformation to the current transformation matrix.
@@ -61,28 +57,88 @@ void Transform::setRotation(float angleRadians, float x, float y, float z) {
  * @param z The scaling factor along the Z-axis.
  */
 void Transform::setScale(float x, float y, float z) {
-    Eigen::Matrix4f scaleMatrix = Eigen::Matrix4f::Identity();
-    scaleMatrix(0, 0) = x;
-    scaleMatrix(1, 1) = y;
-    scaleMatrix(2, 2) = z;
-
-    transformMatrix = scaleMatrix * transformMatrix;
+    transformMatrix.row(0) *= x;
+    transformMatrix.row(1) *= y;
+    transformMatrix.row(2) *= z;
+    ++version;
 
 }
+/**
+ * @brief Replaces the transformation matrix, discarding any translation, rotation or scale applied so far.
+ *
+ * @param matrix The new model matrix, e.g. a glTF node's world matrix.
+ * @throws std::runtime_error If the last row isn't 0 0 0 1.
+ */
+void Transform::setMatrix(const Matrix4f &matrix) {
+    if (!isAffine(matrix))
+        throw std::runtime_error("Transform matrix isn't affine");
+    setMatrix(AffineMatrix(matrix.topRows<3>()));
+}
+void Transform::setMatrix(const AffineMatrix &matrix) {
+    transformMatrix = matrix;
+    ++version;
+}
 /**
  * @brief Resets the transformation matrix to the identity matrix.
  */
 void Transform::reset() {
-    transformMatrix = Eigen::Matrix4f::Identity();
+    transformMatrix = AffineMatrix::Identity();
+    ++version;
 }
 /**
  * @brief Retrieves the current transformation matrix.
  *
- * @return A constant reference to the 4x4 transformation matrix.
+ * @return A constant reference to the first three rows, the layout uploaded to the GPU.
  */
-const Eigen::Matrix4f& Transform::getMatrix() const {
+const AffineMatrix &Transform::getAffine() const {
     return transformMatrix;
 }
+/**
+ * @brief Retrieves the current transformation matrix as a 4x4 matrix.
+ *
+ * @return The affine matrix with 0 0 0 1 as its last row.
+ */
+Matrix4f Transform::getMatrix() const {
+    return expandAffine(transformMatrix);
+}
+/**
+ * @brief Counts the changes made to the matrix.
+ *
+ * @return 0 for a new Transform, one more after each set or reset call.
+ */
+uint64_t Transform::getVersion() const {
+    return version;
+}
+
+bool isAffine(const Matrix4f &matrix) {
+    return matrix.row(3) == Eigen::RowVector4f(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+Matrix4f expandAffine(const AffineMatrix &matrix) {
+    Matrix4f expanded;
+    expanded.topRows<3>() = matrix;
+    expanded.row(3) << 0.0f, 0.0f, 0.0f, 1.0f;
+    return expanded;
+}
+
+/**
+ * @brief Builds the clip space scale and offset that shows one window of the image.
+ *
+ * Works on clip coordinates (before the divide by w), so it applies to perspective projections as
+ * well and depth is left unchanged.
+ *
+ * @param left, right The window's horizontal extent in normalized device coordinates.
+ * @param bottom, top Its vertical extent, +1 is the top of the image.
+ * @return The matrix to multiply onto the projection (or onto clip space model matrices).
+ */
+Matrix4f offCenterProjection(float left, float right, float bottom, float top) {
+    Eigen::Matrix4f projection = Eigen::Matrix4f::Identity();
+    projection(0, 0) = 2.0f / (right - left);
+    projection(0, 3) = -(right + left) / (right - left);
+    projection(1, 1) = 2.0f / (top - bottom);
+    projection(1, 3) = -(top + bottom) / (top - bottom);
+    return projection;
+}
 
 /*
  *      Operator overloads  ---------------------
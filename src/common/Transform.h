@@ -4,8 +4,14 @@
 
 #pragma once
 
+#include <cstdint>
+
 #include <eigen/Eigen/Dense>        // TODO try and fix include path
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 /**
  * @class Transform
  * @brief A class to manage transformations (translation, rotation, scaling) for 3D objects.
@@ -21,6 +27,10 @@
  */
 using Matrix4f = Eigen::Matrix4f;
 
+// Model matrices are affine, the last row is always 0 0 0 1 so only the first three are kept.
+// Row-major, each row is a float4: the 48 bytes are what vertex shaders read from buffer(11)
+using AffineMatrix = Eigen::Matrix<float, 3, 4, Eigen::RowMajor>;
+
 class Transform final {
 public:
     Transform();
@@ -30,6 +40,11 @@ public:
     void setRotation(float angleRadians, float x, float y, float z);
     void setScale(float x, float y, float z);
 
+    // Replace the whole matrix, e.g. with a scene node's world matrix.
+    // Throws std::runtime_error if the 4x4 matrix isn't affine
+    void setMatrix(const Matrix4f &matrix);
+    void setMatrix(const AffineMatrix &matrix);
+
     // Reset to identity Matrix
     void reset();
 
@@ -37,13 +52,109 @@ public:
     friend std::ostream& operator<<(std::ostream& os, const Transform& transform);
     //friend void operator*(float scale);         // Scale entire matrix by single value
 
-    const Matrix4f &getMatrix() const;
+    const AffineMatrix &getAffine() const;
+
+    // The affine matrix with its last row, built on every call
+    Matrix4f getMatrix() const;
+
+    // Bumped by every change, so a copy of the matrix (e.g. on the GPU) can tell it is stale
+    uint64_t getVersion() const;
 
 private:
     // Hide implementation
     //Matrix4f translation;
-    Matrix4f transformMatrix;
+    AffineMatrix transformMatrix;
+    uint64_t version{0};
 };
 
+// True if the last row is 0 0 0 1
+bool isAffine(const Matrix4f &matrix);
+
+Matrix4f expandAffine(const AffineMatrix &matrix);
+
+/*
+    affineMultiply() and affineInverse() are inline so loops over many matrices keep them in
+    registers. With SSE2 each works on whole rows (one __m128 per row) and beats Eigen's 4x4
+    operator* and inverse() (tools/affinebench), elsewhere they fall back to Eigen on the 3x4 rows.
+*/
+
+// a * b as 4x4 matrices, applying b first, without the multiplications by the last rows
+inline AffineMatrix affineMultiply(const AffineMatrix &a, const AffineMatrix &b) {
+    AffineMatrix product;
+#if defined(__SSE2__)
+    // Row r of the product is sum over k of a(r, k) * row k of b, where b's last row is 0 0 0 1
+    const __m128 b0 = _mm_loadu_ps(b.data());
+    const __m128 b1 = _mm_loadu_ps(b.data() + 4);
+    const __m128 b2 = _mm_loadu_ps(b.data() + 8);
+    const __m128 w = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+    for (int r = 0; r < 3; ++r) {
+        const __m128 row = _mm_loadu_ps(a.data() + 4 * r);
+        __m128 sum = _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(3, 3, 3, 3)), w));
+        _mm_storeu_ps(product.data() + 4 * r, sum);
+    }
+#else
+    const Eigen::RowVector4f w(0.0f, 0.0f, 0.0f, 1.0f);
+    for (int r = 0; r < 3; ++r)
+        product.row(r) = a(r, 0) * b.row(0) + a(r, 1) * b.row(1) + a(r, 2) * b.row(2) + a(r, 3) * w;
+#endif
+    return product;
+}
+
+// Inverts the 3x3 part and moves the translation back, matrix must be invertible (a singular
+// 3x3 part gives non-finite values)
+inline AffineMatrix affineInverse(const AffineMatrix &matrix) {
+    AffineMatrix inverse;
+#if defined(__SSE2__)
+    /*
+        The inverse of [A t] is [A^-1  -A^-1 t]. The cross products of A's rows are the rows of
+        its cofactor matrix, A^-1 is that transposed over the determinant. Transposing the three
+        scaled cofactor rows together with -A^-1 t, their sum weighted by t, gives the rows of the
+        result in one go.
+    */
+    const auto cross = [](__m128 a, __m128 b) {
+        const __m128 a1 = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+        const __m128 b1 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+        const __m128 c = _mm_sub_ps(_mm_mul_ps(a, b1), _mm_mul_ps(a1, b));
+        return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+    };
+    const __m128 r0 = _mm_loadu_ps(matrix.data());
+    const __m128 r1 = _mm_loadu_ps(matrix.data() + 4);
+    const __m128 r2 = _mm_loadu_ps(matrix.data() + 8);
+    __m128 c0 = cross(r1, r2);
+    __m128 c1 = cross(r2, r0);
+    __m128 c2 = cross(r0, r1);
+
+    const __m128 xyz = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    __m128 determinant = _mm_mul_ps(_mm_and_ps(r0, xyz), c0);
+    determinant = _mm_add_ps(determinant, _mm_shuffle_ps(determinant, determinant, _MM_SHUFFLE(2, 3, 0, 1)));
+    determinant = _mm_add_ps(determinant, _mm_shuffle_ps(determinant, determinant, _MM_SHUFFLE(1, 0, 3, 2)));
+    const __m128 scale = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+    c0 = _mm_mul_ps(c0, scale);
+    c1 = _mm_mul_ps(c1, scale);
+    c2 = _mm_mul_ps(c2, scale);
+
+    __m128 moved = _mm_mul_ps(c0, _mm_shuffle_ps(r0, r0, _MM_SHUFFLE(3, 3, 3, 3)));
+    moved = _mm_add_ps(moved, _mm_mul_ps(c1, _mm_shuffle_ps(r1, r1, _MM_SHUFFLE(3, 3, 3, 3))));
+    moved = _mm_add_ps(moved, _mm_mul_ps(c2, _mm_shuffle_ps(r2, r2, _MM_SHUFFLE(3, 3, 3, 3))));
+    moved = _mm_sub_ps(_mm_setzero_ps(), moved);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, moved);
+    _mm_storeu_ps(inverse.data(), c0);
+    _mm_storeu_ps(inverse.data() + 4, c1);
+    _mm_storeu_ps(inverse.data() + 8, c2);
+#else
+    inverse.leftCols<3>() = matrix.leftCols<3>().inverse();
+    inverse.col(3) = -(inverse.leftCols<3>() * matrix.col(3));
+#endif
+    return inverse;
+}
+
+// Stretches the part [left, right] x [bottom, top] of normalized device coordinates over the whole
+// viewport. Applied after a projection it gives the off-center frustum of that part of the image,
+// e.g. one tile of an image too large for a single render target
+Matrix4f offCenterProjection(float left, float right, float bottom, float top);
+
 
 
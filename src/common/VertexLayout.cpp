@@ -0,0 +1,117 @@
+#include "VertexLayout.h"
+
+#include <stdexcept>
+
+/**
+ * @brief Picks the layout for a mesh based on how its vertices are read.
+ *
+ * Chosen with tools/layoutbench.cpp, which fetches every vertex through a shuffled index
+ * buffer the way the GPU draws indexed meshes (x86-64, best of 3 to 10 rounds):
+ *
+ *     vertices    shading, interleaved vs split    position only, packed vs interleaved
+ *     1M          1.05x faster                     1.23x faster
+ *     8M          0.97x                            1.31x faster
+ *     16M         1.17x faster                     1.35x faster
+ *
+ * - Shading reads position and color together. Interleaved touches one cache line per vertex
+ *   instead of two, which pays off once the mesh is well out of cache and is never much worse.
+ *   Read sequentially (unindexed) split streams were faster, but meshes are drawn indexed.
+ * - Position-only passes waste half of every interleaved fetch on color, a packed position
+ *   stream was 1.2x to 1.35x faster indexed and about 2x sequentially.
+ * - Meshes used by both get the hybrid layout and pay for the duplicated positions in memory.
+ *
+ * @param usage What the mesh's vertices are read for.
+ * @return The layout to build the mesh's buffers with.
+ */
+VertexLayout defaultVertexLayout(VertexUsage usage) {
+    switch (usage) {
+        case VertexUsage::Shading:
+            return VertexLayout::Interleaved;
+        case VertexUsage::PositionOnly:
+            return VertexLayout::Split;
+        case VertexUsage::Both:
+            return VertexLayout::Hybrid;
+    }
+    return VertexLayout::Split;
+}
+
+/**
+ * @brief Describes the buffers a layout is made of.
+ */
+VertexStreams vertexStreams(VertexLayout layout, VertexFormat format) {
+    if (format != VertexFormat::Float32) {
+        // Quantized positions are 4 x 16 bit in their own stream, colors are RGBA8
+        switch (layout) {
+            case VertexLayout::Interleaved:
+                return {12, 0, 0};
+            case VertexLayout::Split:
+                return {8, 4, 0};
+            case VertexLayout::Hybrid:
+                return {12, 0, 8};
+        }
+    }
+
+    switch (layout) {
+        case VertexLayout::Interleaved:
+            return {sizeof(Vertex), 0, 0};
+        case VertexLayout::Split:
+            return {sizeof(Position), sizeof(Color), 0};
+        case VertexLayout::Hybrid:
+            return {sizeof(Vertex), 0, sizeof(Position)};
+    }
+    return {sizeof(Position), sizeof(Color), 0};
+}
+
+/**
+ * @brief Name of the vertex function in shaders.metal used for shading with this layout.
+ */
+const char *vertexFunctionName(VertexLayout layout, VertexFormat format) {
+    const bool quantized = format != VertexFormat::Float32;
+    switch (layout) {
+        case VertexLayout::Interleaved:
+        case VertexLayout::Hybrid:
+            return quantized ? "vertex_quantized_interleaved" : "vertex_interleaved";
+        case VertexLayout::Split:
+            return quantized ? "vertex_quantized" : "vertex_main";
+    }
+    return "vertex_main";
+}
+
+/**
+ * @brief Name of the vertex function used by position-only passes with this layout.
+ *
+ * Split and hybrid meshes bind their packed position stream, interleaved meshes have to read
+ * positions out of the full Vertex stream.
+ */
+const char *positionOnlyFunctionName(VertexLayout layout, VertexFormat format) {
+    const bool quantized = format != VertexFormat::Float32;
+    switch (layout) {
+        case VertexLayout::Interleaved:
+            return quantized ? "vertex_quantized_interleaved_position_only" : "vertex_interleaved_position_only";
+        case VertexLayout::Split:
+        case VertexLayout::Hybrid:
+            return quantized ? "vertex_quantized_position_only" : "vertex_position_only";
+    }
+    return "vertex_position_only";
+}
+
+/**
+ * @brief Packs separate position and color arrays into an interleaved Vertex array.
+ *
+ * @throws std::runtime_error If the arrays are empty or differ in length.
+ */
+std::vector<Vertex> interleaveVertices(const std::vector<float4> &positions, const std::vector<float4> &colors) {
+    if (positions.empty())
+        throw std::runtime_error("No vertices defined");
+    if (positions.size() != colors.size())
+        throw std::runtime_error("Position and color counts differ");
+
+    std::vector<Vertex> vertices;
+    vertices.reserve(positions.size());
+    for (size_t i = 0; i < positions.size(); ++i) {
+        const float4 &p = positions[i];
+        const float4 &c = colors[i];
+        vertices.push_back({{p.x(), p.y(), p.z(), p.w()}, {c.x(), c.y(), c.z(), c.w()}});
+    }
+    return vertices;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "common.h"
+#include "vec4.h"
+
+/**
+ * @brief How a mesh's vertex attributes are laid out in GPU buffers.
+ *
+ * - Interleaved (AoS): one stream of Vertex {position, color}, bound to buffer(0).
+ * - Split (SoA):       positions in buffer(0), colors in buffer(1).
+ * - Hybrid:            an interleaved Vertex stream for shading plus a duplicate
+ *                      position-only stream for depth / culling passes.
+ *
+ * Each layout has a matching vertex function in shaders.metal, see vertexFunctionName().
+ */
+enum class VertexLayout {
+    Interleaved,
+    Split,
+    Hybrid
+};
+
+/**
+ * @brief How the attributes inside a layout's streams are stored.
+ *
+ * - Float32: float4 positions and float4 colors, 32 bytes per vertex.
+ * - Snorm16: 16-bit normalized positions with per-mesh scale/offset and RGBA8 colors.
+ * - Half:    half-float positions with per-mesh scale/offset and RGBA8 colors.
+ *
+ * The quantized formats take 12 bytes per vertex, see VertexQuantization.h.
+ */
+enum class VertexFormat {
+    Float32,
+    Snorm16,
+    Half
+};
+
+/**
+ * @brief What a mesh's vertices are read for.
+ */
+enum class VertexUsage {
+    Shading,        // Position and color, e.g. the main color pass
+    PositionOnly,   // Depth pre-pass, shadow or culling passes
+    Both            // Drawn by both kinds of passes
+};
+
+/**
+ * @brief The vertex buffers a layout needs, in bytes per vertex.
+ */
+struct VertexStreams {
+    size_t shadingStride;       // Stream bound to buffer(0) for the shading pass
+    size_t colorStride;         // Stream bound to buffer(1), 0 if none
+    size_t positionStride;      // Extra position-only stream, 0 if none
+};
+
+VertexLayout defaultVertexLayout(VertexUsage usage);
+
+VertexStreams vertexStreams(VertexLayout layout, VertexFormat format = VertexFormat::Float32);
+
+const char *vertexFunctionName(VertexLayout layout, VertexFormat format = VertexFormat::Float32);
+
+const char *positionOnlyFunctionName(VertexLayout layout, VertexFormat format = VertexFormat::Float32);
+
+std::vector<Vertex> interleaveVertices(const std::vector<float4> &positions, const std::vector<float4> &colors);
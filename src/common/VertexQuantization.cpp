@@ -0,0 +1,495 @@
+#include "VertexQuantization.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(__F16C__) || defined(__GNUC__)
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+constexpr float kSnorm16Max = 32767.0f;
+
+// IEEE 754 binary16 conversion for targets without hardware support, round to nearest even
+uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xffu) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffffu;
+
+    if (exponent <= 0) {
+        if (exponent < -10)
+            return static_cast<uint16_t>(sign);
+        // Subnormal half
+        mantissa |= 0x800000u;
+        const uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        const uint32_t remainder = mantissa & ((1u << shift) - 1u);
+        const uint32_t halfway = 1u << (shift - 1u);
+        if (remainder > halfway || (remainder == halfway && (half & 1u)))
+            ++half;
+        return static_cast<uint16_t>(sign | half);
+    }
+    if (exponent >= 31)
+        return static_cast<uint16_t>(sign | 0x7c00u);   // Inputs are in [-1, 1], never reached
+
+    uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    const uint32_t remainder = mantissa & 0x1fffu;
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+        ++half;     // May carry into the exponent, which is still correctly rounded
+    return static_cast<uint16_t>(sign | half);
+}
+
+float halfToFloat(uint16_t half) {
+    const uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+    uint32_t exponent = (half >> 10) & 0x1fu;
+    uint32_t mantissa = half & 0x3ffu;
+    uint32_t bits;
+
+    if (exponent == 0) {
+        if (mantissa == 0) {
+            bits = sign;
+        } else {
+            // Normalize the subnormal
+            exponent = 127 - 15 + 1;
+            while (!(mantissa & 0x400u)) {
+                mantissa <<= 1;
+                --exponent;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+        }
+    } else if (exponent == 31) {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/*
+    Scalar paths - used for tails and on targets without SIMD
+*/
+float encodeSnorm16Scalar(const float *in, size_t count, const QuantizationParams &params, uint16_t *out) {
+    float maxError = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            const float value = in[i * 4 + c];
+            const float normalized = (value - params.offset[c]) / params.scale[c];
+            const float q = std::round(std::clamp(normalized, -1.0f, 1.0f) * kSnorm16Max);
+            out[i * 4 + c] = static_cast<uint16_t>(static_cast<int16_t>(q));
+
+            const float decoded = params.offset[c] + params.scale[c] * (q / kSnorm16Max);
+            maxError = std::max(maxError, std::fabs(decoded - value));
+        }
+        out[i * 4 + 3] = 0;
+    }
+    return maxError;
+}
+
+float encodeHalfScalar(const float *in, size_t count, const QuantizationParams &params, uint16_t *out) {
+    float maxError = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            const float value = in[i * 4 + c];
+            const float normalized = std::clamp((value - params.offset[c]) / params.scale[c], -1.0f, 1.0f);
+            const uint16_t h = floatToHalf(normalized);
+            out[i * 4 + c] = h;
+
+            const float decoded = params.offset[c] + params.scale[c] * halfToFloat(h);
+            maxError = std::max(maxError, std::fabs(decoded - value));
+        }
+        out[i * 4 + 3] = 0;
+    }
+    return maxError;
+}
+
+uint32_t encodeColorScalar(const float *c) {
+    uint32_t packed = 0;
+    for (int i = 0; i < 4; ++i) {
+        const float v = std::clamp(c[i], 0.0f, 1.0f) * 255.0f;
+        packed |= static_cast<uint32_t>(std::lrint(v)) << (8 * i);
+    }
+    return packed;
+}
+
+#if defined(__SSE2__)
+/*
+    SSE2 - one vertex per register, two vertices per 16 byte store
+*/
+constexpr const char *simdName = "SSE2";
+
+float encodeSnorm16Simd(const float *in, size_t count, const QuantizationParams &params, uint16_t *out) {
+    const __m128 offset = _mm_set_ps(0.0f, params.offset[2], params.offset[1], params.offset[0]);
+    const __m128 encodeScale = _mm_set_ps(0.0f, kSnorm16Max / params.scale[2], kSnorm16Max / params.scale[1],
+                                          kSnorm16Max / params.scale[0]);
+    const __m128 decodeScale = _mm_set_ps(0.0f, params.scale[2] / kSnorm16Max, params.scale[1] / kSnorm16Max,
+                                          params.scale[0] / kSnorm16Max);
+    const __m128 lo = _mm_set1_ps(-kSnorm16Max);
+    const __m128 hi = _mm_set1_ps(kSnorm16Max);
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 maxError = _mm_setzero_ps();
+
+    auto encodeOne = [&](const float *p) {
+        // w is multiplied by 0 and compared against offset 0, so it never adds error
+        const __m128 v = _mm_and_ps(_mm_loadu_ps(p), _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1)));
+        const __m128 scaled = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(v, offset), encodeScale), lo), hi);
+        const __m128i q = _mm_cvtps_epi32(scaled);  // Round to nearest
+        const __m128 decoded = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(q), decodeScale), offset);
+        maxError = _mm_max_ps(maxError, _mm_and_ps(_mm_sub_ps(decoded, v), absMask));
+        return q;
+    };
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const __m128i q0 = encodeOne(in + i * 4);
+        const __m128i q1 = encodeOne(in + i * 4 + 4);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 4), _mm_packs_epi32(q0, q1));
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, maxError);
+    float result = std::max(std::max(lanes[0], lanes[1]), lanes[2]);
+
+    if (i < count)
+        result = std::max(result, encodeSnorm16Scalar(in + i * 4, count - i, params, out + i * 4));
+    return result;
+}
+
+#if defined(__F16C__) || defined(__GNUC__)
+/*
+    F16C - compiled for it even when the rest of the file targets plain SSE2, and only called
+    when the CPU has it (hasF16c())
+*/
+#if defined(__GNUC__)
+[[gnu::target("f16c")]]
+#endif
+float encodeHalfF16c(const float *in, size_t count, const QuantizationParams &params, uint16_t *out) {
+    const __m128 offset = _mm_set_ps(0.0f, params.offset[2], params.offset[1], params.offset[0]);
+    const __m128 scale = _mm_set_ps(1.0f, params.scale[2], params.scale[1], params.scale[0]);
+    const __m128 encodeScale = _mm_set_ps(0.0f, 1.0f / params.scale[2], 1.0f / params.scale[1], 1.0f / params.scale[0]);
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 maxError = _mm_setzero_ps();
+
+    for (size_t i = 0; i < count; ++i) {
+        const __m128 v = _mm_and_ps(_mm_loadu_ps(in + i * 4), _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1)));
+        const __m128 normalized = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(v, offset), encodeScale), lo), hi);
+        const __m128i h = _mm_cvtps_ph(normalized, _MM_FROUND_TO_NEAREST_INT);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out + i * 4), h);
+
+        const __m128 decoded = _mm_add_ps(_mm_mul_ps(_mm_cvtph_ps(h), scale), offset);
+        maxError = _mm_max_ps(maxError, _mm_and_ps(_mm_sub_ps(decoded, v), absMask));
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, maxError);
+    return std::max(std::max(lanes[0], lanes[1]), lanes[2]);
+}
+
+bool hasF16c() {
+#if defined(__F16C__)
+    return true;
+#else
+    static const bool supported = __builtin_cpu_supports("f16c");
+    return supported;
+#endif
+}
+
+float encodeHalfSimd(const float *in, size_t count, const QuantizationParams &params, uint16_t *out) {
+    if (hasF16c())
+        return encodeHalfF16c(in, count, params, out);
+    return encodeHalfScalar(in, count, params, out);
+}
+
+const char *halfEncoderName() {
+    return hasF16c() ? "F16C" : "scalar";
+}
+#else
+float encodeHalfSimd(const float *in, size_t count, const QuantizationParams &params, uint16_t *out) {
+    return encodeHalfScalar(in, count, params, out);
+}
+
+const char *halfEncoderName() {
+    return "scalar";
+}
+#endif
+
+void encodeColorsSimd(const float *in, size_t count, uint32_t *out) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 unorm8 = _mm_set1_ps(255.0f);
+
+    auto convert = [&](const float *c) {
+        return _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(c), zero), one), unorm8));
+    };
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i c01 = _mm_packs_epi32(convert(in + i * 4), convert(in + i * 4 + 4));
+        const __m128i c23 = _mm_packs_epi32(convert(in + i * 4 + 8), convert(in + i * 4 + 12));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packus_epi16(c01, c23));
+    }
+    for (; i < count; ++i)
+        out[i] = encodeColorScalar(in + i * 4);
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+/*
+    NEON - one vertex per register
+*/
+constexpr const char *simdName = "NEON";
+
+float encodeSnorm16Simd(const float *in, size_t count, const QuantizationParams &params, uint16_t *out) {
+    const float32x4_t offset = {params.offset[0], params.offset[1], params.offset[2], 0.0f};
+    const float32x4_t encodeScale = {kSnorm16Max / params.scale[0], kSnorm16Max / params.scale[1],
+                                     kSnorm16Max / params.scale[2], 0.0f};
+    const float32x4_t decodeScale = {params.scale[0] / kSnorm16Max, params.scale[1] / kSnorm16Max,
+                                     params.scale[2] / kSnorm16Max, 0.0f};
+    const float32x4_t lo = vdupq_n_f32(-kSnorm16Max);
+    const float32x4_t hi = vdupq_n_f32(kSnorm16Max);
+    const float32x4_t xyz = {1.0f, 1.0f, 1.0f, 0.0f};
+    float32x4_t maxError = vdupq_n_f32(0.0f);
+
+    for (size_t i = 0; i < count; ++i) {
+        const float32x4_t v = vmulq_f32(vld1q_f32(in + i * 4), xyz);
+        const float32x4_t scaled = vminq_f32(vmaxq_f32(vmulq_f32(vsubq_f32(v, offset), encodeScale), lo), hi);
+        const int32x4_t q = vcvtnq_s32_f32(scaled);
+        vst1_s16(reinterpret_cast<int16_t *>(out + i * 4), vqmovn_s32(q));
+
+        const float32x4_t decoded = vaddq_f32(vmulq_f32(vcvtq_f32_s32(q), decodeScale), offset);
+        maxError = vmaxq_f32(maxError, vabdq_f32(decoded, v));
+    }
+    return vmaxvq_f32(maxError);
+}
+
+float encodeHalfSimd(const float *in, size_t count, const QuantizationParams &params, uint16_t *out) {
+    const float32x4_t offset = {params.offset[0], params.offset[1], params.offset[2], 0.0f};
+    const float32x4_t scale = {params.scale[0], params.scale[1], params.scale[2], 1.0f};
+    const float32x4_t encodeScale = {1.0f / params.scale[0], 1.0f / params.scale[1], 1.0f / params.scale[2], 0.0f};
+    const float32x4_t lo = vdupq_n_f32(-1.0f);
+    const float32x4_t hi = vdupq_n_f32(1.0f);
+    const float32x4_t xyz = {1.0f, 1.0f, 1.0f, 0.0f};
+    float32x4_t maxError = vdupq_n_f32(0.0f);
+
+    for (size_t i = 0; i < count; ++i) {
+        const float32x4_t v = vmulq_f32(vld1q_f32(in + i * 4), xyz);
+        const float32x4_t normalized = vminq_f32(vmaxq_f32(vmulq_f32(vsubq_f32(v, offset), encodeScale), lo), hi);
+        const float16x4_t h = vcvt_f16_f32(normalized);
+        vst1_u16(out + i * 4, vreinterpret_u16_f16(h));
+
+        const float32x4_t decoded = vaddq_f32(vmulq_f32(vcvt_f32_f16(h), scale), offset);
+        maxError = vmaxq_f32(maxError, vabdq_f32(decoded, v));
+    }
+    return vmaxvq_f32(maxError);
+}
+
+void encodeColorsSimd(const float *in, size_t count, uint32_t *out) {
+    const float32x4_t unorm8 = vdupq_n_f32(255.0f);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+
+    for (size_t i = 0; i < count; ++i) {
+        const float32x4_t c = vmulq_f32(vminq_f32(vmaxq_f32(vld1q_f32(in + i * 4), zero), one), unorm8);
+        const uint16x4_t narrow = vqmovn_u32(vcvtnq_u32_f32(c));
+        const uint8x8_t bytes = vqmovn_u16(vcombine_u16(narrow, narrow));
+        out[i] = vget_lane_u32(vreinterpret_u32_u8(bytes), 0);
+    }
+}
+
+const char *halfEncoderName() {
+    return simdName;
+}
+
+#else
+constexpr const char *simdName = "scalar";
+
+float encodeSnorm16Simd(const float *in, size_t count, const QuantizationParams &params, uint16_t *out) {
+    return encodeSnorm16Scalar(in, count, params, out);
+}
+
+float encodeHalfSimd(const float *in, size_t count, const QuantizationParams &params, uint16_t *out) {
+    return encodeHalfScalar(in, count, params, out);
+}
+
+void encodeColorsSimd(const float *in, size_t count, uint32_t *out) {
+    for (size_t i = 0; i < count; ++i)
+        out[i] = encodeColorScalar(in + i * 4);
+}
+
+const char *halfEncoderName() {
+    return simdName;
+}
+#endif
+
+} // namespace
+
+/**
+ * @brief Computes per-mesh scale and offset that map the position bounds onto [-1, 1].
+ *
+ * @param positions xyzw floats, 4 per vertex.
+ * @param count Number of vertices.
+ * @param format Snorm16 or Half.
+ * @throws std::runtime_error If there are no positions or the format is not quantized.
+ */
+QuantizationParams computeQuantization(const float *positions, size_t count, VertexFormat format) {
+    if (!positions || count == 0)
+        throw std::runtime_error("No vertices defined");
+    if (format == VertexFormat::Float32)
+        throw std::runtime_error("Float32 positions are not quantized");
+
+    float lo[3] = {positions[0], positions[1], positions[2]};
+    float hi[3] = {positions[0], positions[1], positions[2]};
+    for (size_t i = 1; i < count; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            lo[c] = std::min(lo[c], positions[i * 4 + c]);
+            hi[c] = std::max(hi[c], positions[i * 4 + c]);
+        }
+    }
+
+    QuantizationParams params{};
+    for (int c = 0; c < 3; ++c) {
+        params.offset[c] = 0.5f * (lo[c] + hi[c]);
+        const float extent = 0.5f * (hi[c] - lo[c]);
+        params.scale[c] = extent > 0.0f ? extent : 1.0f;    // Flat axis, any scale works
+    }
+    params.scale[3] = 0.0f;
+    params.offset[3] = 1.0f;
+    params.format = static_cast<uint32_t>(format);
+    return params;
+}
+
+/**
+ * @brief Encodes positions into 4 x 16 bit per vertex (snorm16 or half, depending on params).
+ *
+ * Uses SSE2 or NEON when available. Halfs use F16C on x86 CPUs that have it, picked at run
+ * time, and the scalar conversion otherwise.
+ *
+ * @param positions xyzw floats, 4 per vertex. w is assumed to be 1 and is not stored.
+ * @param out 4 values per vertex, the 4th is written as 0.
+ * @return The largest absolute error of any decoded x, y or z component.
+ */
+float encodePositions(const float *positions, size_t count, const QuantizationParams &params, uint16_t *out) {
+    if (params.format == static_cast<uint32_t>(VertexFormat::Half))
+        return encodeHalfSimd(positions, count, params, out);
+    return encodeSnorm16Simd(positions, count, params, out);
+}
+
+/**
+ * @brief Names the code encodePositions() runs for a format on this machine.
+ *
+ * @return "SSE2", "NEON", "F16C" (halfs on x86 CPUs that have it) or "scalar".
+ */
+const char *positionEncoderName(VertexFormat format) {
+    return format == VertexFormat::Half ? halfEncoderName() : simdName;
+}
+
+/**
+ * @brief Encodes rgba floats into RGBA8 unorm, red in the lowest byte.
+ */
+void encodeColors(const float *colors, size_t count, uint32_t *out) {
+    encodeColorsSimd(colors, count, out);
+}
+
+/**
+ * @brief encodePositions() without SIMD, the reference the SIMD paths are measured and checked against.
+ */
+float encodePositionsScalar(const float *positions, size_t count, const QuantizationParams &params, uint16_t *out) {
+    if (params.format == static_cast<uint32_t>(VertexFormat::Half))
+        return encodeHalfScalar(positions, count, params, out);
+    return encodeSnorm16Scalar(positions, count, params, out);
+}
+
+/**
+ * @brief encodeColors() without SIMD.
+ */
+void encodeColorsScalar(const float *colors, size_t count, uint32_t *out) {
+    for (size_t i = 0; i < count; ++i)
+        out[i] = encodeColorScalar(colors + i * 4);
+}
+
+/**
+ * @brief Worst case absolute position error for the given params, before encoding anything.
+ *
+ * Snorm16 rounds to a step of scale / 32767. Half has an 11 bit significand, so for values in
+ * [-1, 1] the step is at most 2^-11 (times scale). The decode itself is done in float, which
+ * adds a few ulps of the decoded magnitude on top.
+ */
+float positionErrorBound(const QuantizationParams &params) {
+    float bound = 0.0f;
+    for (int c = 0; c < 3; ++c) {
+        const float step = params.format == static_cast<uint32_t>(VertexFormat::Half)
+                               ? params.scale[c] * std::ldexp(1.0f, -12)
+                               : params.scale[c] * 0.5f / kSnorm16Max;
+        const float rounding = 4.0f * FLT_EPSILON * (std::fabs(params.offset[c]) + params.scale[c]);
+        bound = std::max(bound, step + rounding);
+    }
+    return bound;
+}
+
+/**
+ * @brief Quantizes a mesh's positions and colors into split streams.
+ *
+ * @throws std::runtime_error If the arrays are empty, differ in length or the format is Float32.
+ */
+QuantizedStreams quantizeVertices(const std::vector<float4> &positions, const std::vector<float4> &colors,
+                                  VertexFormat format) {
+    if (positions.size() != colors.size())
+        throw std::runtime_error("Position and color counts differ");
+
+    static_assert(sizeof(float4) == 4 * sizeof(float), "float4 must be tightly packed");
+    const float *p = reinterpret_cast<const float *>(positions.data());
+    const float *c = reinterpret_cast<const float *>(colors.data());
+
+    QuantizedStreams streams;
+    streams.params = computeQuantization(p, positions.size(), format);
+    streams.positions.resize(positions.size() * 4);
+    streams.colors.resize(colors.size());
+    streams.maxError = encodePositions(p, positions.size(), streams.params, streams.positions.data());
+    encodeColors(c, colors.size(), streams.colors.data());
+    return streams;
+}
+
+/**
+ * @brief Packs quantized split streams into 12 byte interleaved vertices.
+ */
+std::vector<QuantizedVertex> interleaveQuantized(const QuantizedStreams &streams) {
+    std::vector<QuantizedVertex> vertices(streams.colors.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        vertices[i].position[0] = streams.positions[i * 4 + 0];
+        vertices[i].position[1] = streams.positions[i * 4 + 1];
+        vertices[i].position[2] = streams.positions[i * 4 + 2];
+        vertices[i].pad = 0;
+        vertices[i].color = streams.colors[i];
+    }
+    return vertices;
+}
+
+/**
+ * @brief Decodes one stored position into xyzw, as decodePosition() in shaders.metal does.
+ *
+ * @param bits The 3 stored x, y and z values.
+ */
+void decodePosition(const uint16_t *bits, const QuantizationParams &params, float *out) {
+    for (int c = 0; c < 3; ++c) {
+        const float q = params.format == static_cast<uint32_t>(VertexFormat::Half)
+                            ? halfToFloat(bits[c])
+                            : std::max(static_cast<int16_t>(bits[c]) / kSnorm16Max, -1.0f);
+        out[c] = params.offset[c] + params.scale[c] * q;
+    }
+    out[3] = params.offset[3];
+}
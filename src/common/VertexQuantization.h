@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "VertexLayout.h"
+
+/**
+ * @brief Dequantization constants for one mesh, sent to buffer(12).
+ *
+ * Matches Dequantization in shaders.metal. A decoded position is offset + scale * q where q
+ * is the stored value in [-1, 1]. scale.w is 0 and offset.w is 1, so w comes out as 1 without
+ * being stored.
+ */
+struct QuantizationParams {
+    float scale[4];
+    float offset[4];
+    uint32_t format;        // VertexFormat of the position stream
+    uint32_t pad[3];
+};
+
+/**
+ * @brief Interleaved quantized vertex, 12 bytes instead of the 32 of Vertex.
+ *
+ * Matches QuantizedVertex in shaders.metal.
+ */
+struct QuantizedVertex {
+    uint16_t position[3];   // snorm16 or half bits, depending on the mesh's VertexFormat
+    uint16_t pad;
+    uint32_t color;         // RGBA8 unorm, red in the lowest byte
+};
+
+/**
+ * @brief Result of quantizing a mesh's split position and color arrays.
+ */
+struct QuantizedStreams {
+    QuantizationParams params;
+    std::vector<uint16_t> positions;    // 4 values per vertex, the last one is padding
+    std::vector<uint32_t> colors;       // RGBA8 unorm
+    float maxError;                     // Largest absolute position error of any component
+};
+
+QuantizationParams computeQuantization(const float *positions, size_t count, VertexFormat format);
+
+float encodePositions(const float *positions, size_t count, const QuantizationParams &params, uint16_t *out);
+
+// The SIMD path encodePositions() takes for format on this CPU, for benchmarks and logs
+const char *positionEncoderName(VertexFormat format);
+
+void encodeColors(const float *colors, size_t count, uint32_t *out);
+
+// The scalar code the SIMD paths fall back to, they agree to one rounding step (ties may round differently)
+float encodePositionsScalar(const float *positions, size_t count, const QuantizationParams &params, uint16_t *out);
+void encodeColorsScalar(const float *colors, size_t count, uint32_t *out);
+
+float positionErrorBound(const QuantizationParams &params);
+
+QuantizedStreams quantizeVertices(const std::vector<float4> &positions, const std::vector<float4> &colors,
+                                  VertexFormat format);
+
+std::vector<QuantizedVertex> interleaveQuantized(const QuantizedStreams &streams);
+
+// CPU side of the shaders' dequantization, xyzw out
+void decodePosition(const uint16_t *bits, const QuantizationParams &params, float *out);
@@ -0,0 +1,149 @@
+#include "headless.h"
+#include "poster.h"
+#include "renderer.h"
+#include "backend/CaptureDevice.h"
+#include "backend/SoftwareDevice.h"
+#include "common/FrameWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+uint64_t parseCount(const std::string &option, const std::string &value)
+{
+  size_t end = 0;
+  unsigned long long count = 0;
+  try {
+    count = std::stoull(value, &end);
+  }
+  catch (const std::exception &) {
+    end = 0;
+  }
+  if (end == 0 || end != value.size() || count == 0)
+    throw std::runtime_error("Expected a positive number for " + option + ": " + value);
+  return count;
+}
+
+// WIDTHxHEIGHT, each at most limit
+void parseSize(const std::string &option, const std::string &value, uint64_t limit, uint32_t &width, uint32_t &height)
+{
+  const size_t x = value.find('x');
+  if (x == std::string::npos)
+    throw std::runtime_error("Expected WIDTHxHEIGHT for " + option + ": " + value);
+  const uint64_t columns = parseCount(option, value.substr(0, x));
+  const uint64_t rows = parseCount(option, value.substr(x + 1));
+  if (columns > limit || rows > limit)
+    throw std::runtime_error("At most " + std::to_string(limit) + " pixels on a side for " + option + ": " + value);
+  width = static_cast<uint32_t>(columns);
+  height = static_cast<uint32_t>(rows);
+}
+
+} // namespace
+
+bool isHeadless(int argc, char **argv)
+{
+  for (int i = 1; i < argc; ++i)
+    if (std::strcmp(argv[i], "--headless") == 0)
+      return true;
+  return false;
+}
+
+/**
+ * @brief Reads --frames, --size, --fps, --output, --poster, --memory and --capture, each followed by its value.
+ *
+ * @throws std::runtime_error For unknown options, missing values and sizes the software backend can't render.
+ */
+HeadlessOptions parseHeadlessOptions(int argc, char **argv)
+{
+  HeadlessOptions options;
+  bool output = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::string option = argv[i];
+    if (option == "--headless")
+      continue;
+    if (i + 1 >= argc)
+      throw std::runtime_error("Missing value for " + option);
+    const std::string value = argv[++i];
+
+    if (option == "--frames")
+      options.frames = parseCount(option, value);
+    else if (option == "--fps")
+      options.framesPerSecond = static_cast<uint32_t>(std::min<uint64_t>(parseCount(option, value), UINT32_MAX));
+    else if (option == "--output") {
+      options.output = value;
+      output = true;
+    }
+    else if (option == "--size")
+      parseSize(option, value, SoftwareRasterizer::maxTargetSize, options.width, options.height);
+    else if (option == "--poster")
+      parseSize(option, value, UINT32_MAX, options.posterWidth, options.posterHeight);
+    else if (option == "--memory")
+      options.memoryBudget = static_cast<size_t>(std::min<uint64_t>(parseCount(option, value), SIZE_MAX >> 20)) << 20;
+    else if (option == "--capture")
+      options.capture = value;
+    else
+      throw std::runtime_error("Unknown option: " + option);
+  }
+  if (options.posterWidth && !output)
+    options.output = "poster.png";
+  if (options.posterWidth && !options.capture.empty())
+    throw std::runtime_error("--capture records frames, not posters");
+  if (options.frames > UINT32_MAX && !options.capture.empty())
+    throw std::runtime_error("At most " + std::to_string(UINT32_MAX) + " frames with --capture");
+  frameFormatFromPath(options.output);    // Throws for an unsupported format before rendering
+  return options;
+}
+
+/**
+ * @brief Renders the demo scene options.frames times and writes every frame, or the poster if one was asked for.
+ *
+ * Rendering only waits on the writer when it falls queueDepth frames behind. With a capture file every frame's
+ * commands are captured too and saved at the end.
+ */
+void renderHeadless(const HeadlessOptions &options)
+{
+  using Clock = std::chrono::steady_clock;
+
+  if (options.posterWidth)
+  {
+    PosterOptions poster;
+    poster.width = options.posterWidth;
+    poster.height = options.posterHeight;
+    poster.memoryBudget = options.memoryBudget;
+    poster.output = options.output;
+    renderPoster(poster, [](Renderer &renderer) { renderer.loadDemoScene(); });
+    return;
+  }
+
+  SoftwareDevice software(options.width, options.height);
+  CaptureDevice capture(software);
+  GfxDevice &device = options.capture.empty() ? static_cast<GfxDevice &>(software) : capture;
+  Renderer renderer(device);
+  renderer.loadDemoScene();
+  if (!options.capture.empty())
+    capture.startCapture(static_cast<uint32_t>(options.frames));
+
+  FrameWriter writer(options.output, frameFormatFromPath(options.output), options.width, options.height,
+                     PixelOrder::Rgba, options.framesPerSecond);
+  const auto start = Clock::now();
+  for (uint64_t frame = 0; frame < options.frames; ++frame) {
+    renderer.renderFrame();
+    software.readPixels(writer.beginFrame());
+    writer.endFrame();
+  }
+  const double rendered = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  writer.close();
+  const double written = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  std::cout << "Rendered " << options.frames << " frames at " << options.width << "x" << options.height << " in "
+            << rendered << " ms, written to " << options.output << " after " << written << " ms" << std::endl;
+
+  if (!options.capture.empty()) {
+    capture.getCapture().save(options.capture);
+    std::cout << "Captured " << capture.getCapture().commands.size() << " commands to " << options.capture << std::endl;
+  }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/*
+  Offscreen rendering for batch jobs, no window or display needed:
+
+    Transformations --headless [--frames N] [--size WxH] [--fps N] [--output PATH] [--capture FILE]
+    Transformations --headless --poster WxH [--memory MB] [--output PATH]
+
+  The demo scene is drawn with the software backend and every frame streamed to disk by
+  FrameWriter, PATH's extension picks the format (.ppm, .png or .y4m). --poster renders one
+  image of any size in tiles instead (see poster.h), as PPM or PNG. --capture also saves the
+frames' command stream for tools/replay (see backend/CaptureDevice.h).
+*/
+
+struct HeadlessOptions
+{
+  uint32_t width{600};
+  uint32_t height{600};
+  uint64_t frames{60};
+  uint32_t framesPerSecond{60};     // Y4M only
+  std::string output{"frame%04d.png"};
+  uint32_t posterWidth{0};          // A poster instead of frames when set
+  uint32_t posterHeight{0};
+  size_t memoryBudget{size_t(256) << 20};
+  std::string capture;              // Command capture file, none when empty
+};
+
+// True if the arguments ask for --headless
+bool isHeadless(int argc, char **argv);
+
+// Throws std::runtime_error for unknown options and bad values
+HeadlessOptions parseHeadlessOptions(int argc, char **argv);
+
+void renderHeadless(const HeadlessOptions &options);
@@ -1,3 +1,4 @@
+#ifdef __APPLE__
 // Prevent GLFW from including OpenGL headers (we're using Metal instead)
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
@@ -18,10 +19,29 @@
 
 #include "window.h"
 #include "renderer.h"
+#include "backend/MetalDevice.h"
+#endif /* __APPLE__ */
+
+#include "headless.h"
 
 #include <iostream>
 
-int main(){
+int main(int argc, char **argv){
+  // Offscreen to files, no window (see headless.h)
+  if (isHeadless(argc, argv))
+  {
+    try {
+      renderHeadless(parseHeadlessOptions(argc, argv));
+    }
+    catch (const std::exception &e)
+    {
+      std::cerr << "Error from main: " << e.what() << std::endl;
+      return -1;
+    }
+    return EXIT_SUCCESS;
+  }
+
+#ifdef __APPLE__
   // Test glfw
   if (!glfwInit())
   {
@@ -31,7 +51,15 @@ int main(){
 
   try {
     Window window;
-    Renderer renderer(window);
+    MetalDevice device(window.getMetalLayer());
+    Renderer renderer(device);
+    renderer.loadDemoScene();
+
+    while (!glfwWindowShouldClose(window.getGLFWWindow()))
+    {
+      glfwPollEvents();
+      renderer.renderFrame();
+    }
   }
   catch (const std::exception &e)
   {
@@ -43,4 +71,8 @@ int main(){
   glfwTerminate();
 
   return EXIT_SUCCESS;
+#else
+  std::cerr << "This build has no window (Metal is macOS only), run with --headless" << std::endl;
+  return -1;
+#endif /* __APPLE__ */
 }
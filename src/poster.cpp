@@ -0,0 +1,71 @@
+#include "poster.h"
+#include "renderer.h"
+#include "backend/SoftwareDevice.h"
+#include "common/FrameWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @brief Renders and streams the poster band by band.
+ *
+ * Per band pixel the budget pays for the tile's color and depth (8 bytes), two band buffers so one
+ * renders while the other is written (8) and the writer's RGB and PNG chunk copies (6). Bands are
+ * at least one row, so very wide images may exceed a small budget.
+ *
+ * Tiles render one after another, each one spread over every core by the software rasterizer.
+ */
+void renderPoster(const PosterOptions &options, const std::function<void(Renderer &)> &loadScene)
+{
+  using Clock = std::chrono::steady_clock;
+  const uint32_t width = options.width, height = options.height;
+  if (width == 0 || height == 0)
+    throw std::runtime_error("Posters must be at least 1x1");
+
+  // Tiles across as even as possible, bands as tall as the budget allows
+  const uint32_t maxSize = SoftwareRasterizer::maxTargetSize;
+  const uint32_t tilesAcross = (width + maxSize - 1) / maxSize;
+  const uint32_t tileWidth = (width + tilesAcross - 1) / tilesAcross;
+  const size_t budgetRows = options.memoryBudget / (size_t(width) * posterBytesPerPixel);
+  const uint32_t bandHeight = static_cast<uint32_t>(std::clamp<size_t>(budgetRows, 1, std::min(height, maxSize)));
+
+  SoftwareDevice device(tileWidth, bandHeight);
+  Renderer renderer(device);
+  loadScene(renderer);
+
+  ImageWriter image(options.output, frameFormatFromPath(options.output), width, height);
+  std::vector<uint32_t> bands[2];
+  std::future<void> writing;    // The previous band
+  const auto start = Clock::now();
+  uint32_t band = 0;
+  for (uint32_t top = 0; top < height; top += bandHeight, band ^= 1)
+  {
+    std::vector<uint32_t> &pixels = bands[band];
+    pixels.resize(size_t(width) * bandHeight);
+    for (uint32_t left = 0; left < width; left += tileWidth)
+    {
+      // The tile's window of the image in normalized device coordinates, +y up
+      renderer.setProjection(offCenterProjection(2.0f * left / width - 1.0f, 2.0f * (left + tileWidth) / width - 1.0f,
+                                                 1.0f - 2.0f * (top + bandHeight) / height, 1.0f - 2.0f * top / height));
+      renderer.renderFrame();
+      device.readPixels(pixels.data() + left, width, std::min(tileWidth, width - left), bandHeight);
+    }
+
+    if (writing.valid())
+      writing.get();
+    const uint32_t rows = std::min(bandHeight, height - top);
+    writing = std::async(std::launch::async, [&image, &pixels, rows, width]() {
+      image.writeRows(pixels.data(), rows, width, PixelOrder::Rgba);
+    });
+  }
+  writing.get();
+  image.close();
+
+  const double elapsed = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  std::cout << "Rendered a " << width << "x" << height << " poster to " << options.output << " in " << elapsed
+            << " ms, " << tilesAcross << " tiles of " << tileWidth << "x" << bandHeight << " per band" << std::endl;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+class Renderer;
+
+/*
+  Tiled rendering of images larger than any render target, for print:
+
+    Transformations --headless --poster 16384x16384 [--memory MB] --output poster.png
+
+  The image is rendered in bands of rows, each band split across into tiles of at most
+  SoftwareRasterizer::maxTargetSize pixels. Every tile is one frame of the scene with an
+  off-center projection (offCenterProjection() in Transform.h) that shows only its part of the
+  image. Bands are as tall as the memory budget allows and streamed into the PPM or PNG while
+  the next one renders, so peak memory depends on the budget and the width, never the height.
+*/
+
+struct PosterOptions
+{
+  uint32_t width{16384};
+  uint32_t height{16384};
+  size_t memoryBudget{size_t(256) << 20};   // Bytes, for the tiles and bands in flight
+  std::string output{"poster.png"};
+};
+
+// Bytes of tile and band memory per pixel of a band
+constexpr size_t posterBytesPerPixel = 22;
+
+// Creates a software device of the tile size and a renderer on it, adds the scene with loadScene
+// and writes the image. Throws std::runtime_error if the output can't be written
+void renderPoster(const PosterOptions &options, const std::function<void(Renderer &)> &loadScene);
@@ -1,27 +1,36 @@
 #include "common/common.h"
 #include "renderer.h"
+#include "MeshLoader/gltfLoader.h"
+#include "MeshLoader/meshFile.h"
+#include "MeshGenerator/proceduralShapes.h"
 
 //#define TRIANGLE
 #define QUAD
 //#define CIRCLE
+//#define SHAPES
+//#define GLTF_SCENE "scene.glb"
+//#define MESH_FILE "scene.mesh"
+//#define PROCEDURAL_FIELD
 //#define LOG
 
 /**
  * @brief Constructor for the Renderer class.
  *
- * Initializes the Metal device, command queue, and creates the triangle or quad object.
+ * Starts with an empty scene, see loadDemoScene().
  *
- * @param window Reference to the Window object.
+ * @param device The backend every primitive is created on and every frame is drawn with.
  */
-Renderer::Renderer(Window &window) : device(nullptr), commandQueue(nullptr), window(window),
-                                     triangle1(nullptr),triangle2(nullptr),quad1(nullptr),quad2(nullptr), previousTime(std::chrono::high_resolution_clock::now()), totalTime(0.0),
-                                     lastPrintedSecond(-1), frames(0)
+Renderer::Renderer(GfxDevice &device) : device(&device), transformBuffer(device),
+                                        previousTime(std::chrono::high_resolution_clock::now()),
+                                        totalTime(0.0), lastPrintedSecond(-1), frames(0)
 {
-  // Get device from the windows metal layer
-  device = window.getMetalLayer()->device();
-  if (!device)
-    throw std::runtime_error("Failed to get Metal Device");
+}
 
+/**
+ * @brief Adds the objects picked by the defines at the top of this file.
+ */
+void Renderer::loadDemoScene()
+{
   /*
    *    Quad
    */
@@ -41,7 +50,7 @@ Renderer::Renderer(Window &window) : device(nullptr), commandQueue(nullptr), win
     {-0.75, 0.0, 0.0, 1.0}
   };
 
-  quad1 = new Quad(device, positions, color );
+  addObject(new Quad(device, positions, color ));
 
   // Quad 2
   color = {
@@ -51,10 +60,11 @@ Renderer::Renderer(Window &window) : device(nullptr), commandQueue(nullptr), win
       {1.0, 0.0, 0.0, 1.0}
   };
 
-  quad2 = new Quad(device, positions, color );
+  Quad *quad2 = new Quad(device, positions, color );
   Transform &matrix = quad2->getTransform();
-  matrix.setRotation(-pi, 0, 0, 1);
+  matrix.setRotation(-M_PI, 0, 0, 1);
   matrix.setScale(.5, .5, 0);
+  addObject(quad2);
 
 
 
@@ -82,127 +92,519 @@ Renderer::Renderer(Window &window) : device(nullptr), commandQueue(nullptr), win
       {0.5, 0.5, 0.5, 1.0}, // Gray color
       {0.5, 0.5, 0.5, 1.0}}; // Gray color
 
-  triangle1 = new Triangle(device, position, color);
+  addObject(new Triangle(device, position, color));
   // Colors
    color = {
       {1.0, 0.0, 0.0, 1.0}, // Red color
       {1.0, 0.0, 0.0, 1.0}, // Red color
       {1.0, 0.0, 0.0, 1.0}}; // Red color
-  triangle2 = new Triangle(device, position, color);
+  Triangle *triangle2 = new Triangle(device, position, color);
   Transform &matrix = triangle2->getTransform();
   matrix.reset();
   std::cout << "Before: \n" << matrix << std::endl;
-  matrix.setRotation(-pi, 0, 0, 1);
+  matrix.setRotation(-M_PI, 0, 0, 1);
   matrix.setScale(.5,.5,.5);
   matrix.setTranslation(0, -0.3, 0);
   std::cout << "After: \n" << matrix << std::endl;
+  addObject(triangle2);
 #endif /* TRIANGLE */
   /*
-   *Command Queue
+   *      Shapes - analytic SDF quads, one instance per shape
    */
-  // Create the command queue (created from the device)
-  commandQueue = device->newCommandQueue()->retain();
-
-  // Render
-  render();
+#ifdef SHAPES
+  {
+    const float white[4] = {1.0, 1.0, 1.0, 1.0};
+    const float red[4] = {1.0, 0.0, 0.0, 1.0};
+    const float blue[4] = {0.2, 0.3, 1.0, 1.0};
+
+    std::vector<SdfInstance> instances = {
+      packSdfInstance(SdfShape::Circle, -0.5, 0.5, 0.25, 0.25, white),
+      packSdfInstance(SdfShape::Ring, 0.5, 0.5, 0.25, 0.25, red, 0.0, 0.05),
+      packSdfInstance(SdfShape::RoundedRect, -0.5, -0.5, 0.3, 0.2, blue, 0.08),
+      packSdfInstance(SdfShape::Capsule, 0.5, -0.5, 0.3, 0.1, white)
+    };
+    addObject(new ShapeBatch(device, instances));
+  }
+#endif /* SHAPES */
+  /*
+   *      glTF scene - one MeshPrimitive per triangle primitive of every mesh node
+   */
+#ifdef GLTF_SCENE
+  addGltfScene(GLTF_SCENE);
+#endif /* GLTF_SCENE */
+  /*
+   *      Baked mesh - levels of detail come from the file, no simplification at startup
+   */
+#ifdef MESH_FILE
+  {
+    const BakedMesh baked = MeshFile(MESH_FILE).load();
+    addMesh(new MeshPrimitive(device, baked.mesh, LodChain{{}, baked.levels}));
+  }
+#endif /* MESH_FILE */
+  /*
+   *      Procedural field - a grid of every generated shape type, turned to show their sides, in one mesh
+   */
+#ifdef PROCEDURAL_FIELD
+  {
+    const int side = 6;
+    std::vector<ShapeInstance> field;
+    for (int i = 0; i < side * side; ++i)
+    {
+      ShapeInstance instance;
+      instance.shape.type = static_cast<ShapeType>(i % 6);   // Everything but heightfield grids
+      instance.shape.segments = instance.shape.type == ShapeType::Icosphere ? 4 : 16;
+      const Eigen::Affine3f placement =
+          Eigen::Translation3f((2.0f * (i % side) + 1.0f) / side - 1.0f, (2.0f * (i / side) + 1.0f) / side - 1.0f, 0.0f) *
+          Eigen::AngleAxisf(0.4f * i, Eigen::Vector3f(1, 1, 0).normalized()) * Eigen::Scaling(0.09f);
+      Eigen::Map<Eigen::Matrix4f>(instance.transform.data()) = placement.matrix();
+      instance.color = {0.3f + 0.7f * (i % side) / side, 0.3f + 0.7f * (i / side) / side, 0.8f, 1.0f};
+      field.push_back(instance);
+    }
+    addMesh(new MeshPrimitive(device, generateShapes(field)));
+  }
+#endif /* PROCEDURAL_FIELD */
 }
 /**
  * @brief Destructor for the Renderer class.
  *
- * Cleans up allocated resources. Currently commented out due to segfault issues.
+ * Retires every primitive's GPU resources, waits for the GPU to finish the frames that still
+ * reference them, then frees everything.
  */
 Renderer::~Renderer()
 {
-    // FIXME: There is a segfault here when deallocating?
-  if (triangle1)
+  for (DrawSegment &segment : segments)
+    for (DrawRun &run : segment.runs)
+      destructionQueue.retireOwned(frameIndex, run.packet);
+  segments.clear();
+  transformBuffer.retire(destructionQueue, frameIndex);
+  for (Primitive *&geometry : geometries)
+    destroyPrimitive(geometry);
+  geometries.clear();
+  meshes.clear();
+  scene.clear();
+
+  waitForGPU();
+
+  // Nothing is in flight anymore
+  destructionQueue.flush();
+}
+
+/**
+ * @brief Deletes a primitive without releasing resources the GPU may still be reading.
+ *
+ * The primitive's buffers are retired with the current frame index and are freed by the
+ * destruction queue once that frame completes. Its pipeline is the device's and stays.
+ *
+ * @param primitive The primitive to delete, set to nullptr afterwards.
+ */
+void Renderer::destroyPrimitive(Primitive *&primitive)
+{
+  if (!primitive)
+    return;
+
+  primitive->retireResources(destructionQueue, frameIndex);
+  delete primitive;
+  primitive = nullptr;
+}
+
+/**
+ * @brief Blocks until every command buffer committed so far has completed.
+ *
+ * Only used at shutdown, never per frame.
+ */
+void Renderer::waitForGPU()
+{
+  device->waitIdle();
+  completedFrame.store(frameIndex, std::memory_order_release);
+}
+
+/**
+ * @brief Blocks until the GPU has completed @p frame, returns at once when it already has.
+ *
+ * Keeps the CPU from getting more than TransformBuffer::framesInFlight frames ahead.
+ */
+void Renderer::waitForFrame(uint64_t frame)
+{
+  for (uint64_t completed = completedFrame.load(std::memory_order_acquire); completed < frame;
+       completed = completedFrame.load(std::memory_order_acquire))
+    completedFrame.wait(completed, std::memory_order_acquire);
+}
+
+GfxDevice &Renderer::getDevice()
+{
+  return *device;
+}
+/**
+ * @brief Takes ownership of a primitive and adds an entity drawing it.
+ *
+ * The entity starts out visible with the primitive's current transform.
+ *
+ * @param geometry The primitive, deleted by removeObject() or the destructor.
+ * @param components Extra components for the entity, e.g. BoundsComponent.
+ * @return The entity's handle.
+ */
+Entity Renderer::addObject(Primitive *geometry, ComponentMask components)
+{
+  uint32_t index = static_cast<uint32_t>(geometries.size());
+  if (!freeGeometries.empty())
+  {
+    index = freeGeometries.back();
+    freeGeometries.pop_back();
+    geometries[index] = geometry;
+  }
+  else
+  {
+    geometries.push_back(geometry);
+  }
+
+  geometry->setTransformSlot(index);
+  transformBuffer.setSource(index, &geometry->getTransform());
+
+  const Entity entity = scene.create(TransformComponent | GeometryComponent | VisibilityComponent | components);
+  scene.geometry(entity) = index;
+  Matrix4 matrix;
+  Eigen::Map<Eigen::Matrix4f>(matrix.data()) = geometry->getTransform().getMatrix();
+  scene.setTransform(entity, matrix);
+  return entity;
+}
+
+/**
+ * @brief Destroys an entity and its primitive, the GPU resources are freed once unused.
+ *
+ * @throws std::runtime_error If @p entity is stale.
+ */
+void Renderer::removeObject(Entity entity)
+{
+  const uint32_t index = scene.geometry(entity);
+  scene.destroy(entity);
+
+  const auto mesh = std::find(meshes.begin(), meshes.end(), geometries[index]);
+  if (mesh != meshes.end())
   {
-    delete triangle1;
-    triangle1 = nullptr;
+    meshes.erase(mesh);
+    meshesChanged = true;
   }
+  transformBuffer.setSource(index, nullptr);
+  destroyPrimitive(geometries[index]);
+  freeGeometries.push_back(index);
+}
+
+/**
+ * @brief Takes ownership of a mesh and registers its levels of detail for selection.
+ */
+Entity Renderer::addMesh(MeshPrimitive *mesh)
+{
+  const Entity entity = addObject(mesh, BoundsComponent);
+  scene.bounds(entity) = mesh->getBoundingSphere();
+  meshes.push_back(mesh);
+  lodSelector.addObject(mesh->getLevels());
+  return entity;
+}
 
-  if (commandQueue)
-    commandQueue->release();
+/**
+ * @brief Loads a .gltf or .glb file and adds a mesh for every triangle primitive in its scene.
+ *
+ * Each mesh's Transform gets its node's world matrix. Vertex data is gathered once per glTF mesh
+ * straight from the mapped file, meshes used by several nodes are shared between them.
+ *
+ * @param fileName Path to the glTF asset.
+ */
+void Renderer::addGltfScene(const std::string &fileName)
+{
+  const GltfAsset asset(fileName);
+  const std::vector<GltfMesh> &gltfMeshes = asset.getMeshes();
+  std::vector<std::vector<Mesh>> gathered(gltfMeshes.size());
 
+  for (const int32_t index : asset.getSceneNodes())
+  {
+    const GltfNode &node = asset.getNodes()[index];
+    if (node.mesh < 0)
+      continue;
+
+    std::vector<Mesh> &parts = gathered[node.mesh];
+    if (parts.empty())
+      for (const GltfPrimitive &primitive : gltfMeshes[node.mesh].primitives)
+        parts.push_back(primitive.mode >= 4 && primitive.mode <= 6 ? GltfAsset::toMesh(primitive) : Mesh{});
+
+    for (const Mesh &part : parts)
+    {
+      if (part.indices.empty())
+        continue;   // Points and lines
+      MeshPrimitive *mesh = new MeshPrimitive(device, part);
+      mesh->getTransform().setMatrix(Matrix4f(Eigen::Map<const Eigen::Matrix4f>(node.world.data())));
+      addMesh(mesh);
+    }
+  }
 }
+
 /**
- * @brief Main render loop.
+ * @brief Picks every mesh's level of detail for this frame in one batch.
  *
- * Continuously renders frames until the window is closed.
+ * Bounding spheres are moved to where each transform puts them. There is no camera yet, the
+ * transforms map straight to clip space, so the view-projection matrix is the identity.
+ *
+ * @param viewportWidth Drawable width in pixels.
+ * @param viewportHeight Drawable height in pixels.
  */
-void Renderer::render()
+void Renderer::selectLods(float viewportWidth, float viewportHeight)
 {
+  if (meshesChanged)
+  {
+    lodSelector.clear();
+    for (MeshPrimitive *mesh : meshes)
+      lodSelector.addObject(mesh->getLevels());
+    meshesChanged = false;
+  }
+  if (meshes.empty())
+    return;
 
-  while (!glfwWindowShouldClose(window.getGLFWWindow()))
+  for (size_t i = 0; i < meshes.size(); ++i)
   {
-    glfwPollEvents();
-    // #define LOG
+    const std::array<float, 4> &sphere = meshes[i]->getBoundingSphere();
+    const AffineMatrix &matrix = meshes[i]->getTransform().getAffine();
+    const Eigen::Vector3f center = matrix * Eigen::Vector4f(sphere[0], sphere[1], sphere[2], 1.0f);
+    const float scale = matrix.topLeftCorner<3, 3>().colwise().norm().maxCoeff();
+    lodSelector.setBounds(static_cast<uint32_t>(i), center.x(), center.y(), center.z(), sphere[3] * scale);
+  }
+
+  lodSelector.select(viewProjection.data(), viewportWidth, viewportHeight, lodSettings);
+
+  for (size_t i = 0; i < meshes.size(); ++i)
+    meshes[i]->setLodLevel(lodSelector.getLevel(static_cast<uint32_t>(i)));
+}
+
+/**
+ * @brief Sets the view and projection, world to clip space, from the next frame on.
+ *
+ * Sent to the shaders once per pass, separately from the objects' affine transforms, so it may
+ * be a perspective projection and changing it rewrites no transform. E.g. an off-center crop
+ * of the image for tiled rendering (offCenterProjection()).
+ */
+void Renderer::setProjection(const Matrix4f &projection)
+{
+  viewProjection = projection;
+}
+
+const LodTelemetry &Renderer::getLodTelemetry() const
+{
+  return lodSelector.getTelemetry();
+}
+
+SceneStore &Renderer::getScene()
+{
+  return scene;
+}
+
+/**
+ * @brief Records and commits one frame.
+ *
+ * Does nothing if the device has no drawable for this frame. The caller owns the loop, see
+ * main.cpp for the windowed one and tools/framebench.cpp for a headless one.
+ */
+void Renderer::renderFrame()
+{
+  // #define LOG
 #ifdef LOG
-    logFPS();
+  logFPS();
 #endif /*LOG*/
-    {  // create local scope
-      NS::AutoreleasePool *pool = NS::AutoreleasePool::alloc()->init();
-      CA::MetalDrawable *drawable = window.getMetalLayer()->nextDrawable();
-      if (!drawable)
-      {
-        std::cerr << "Drawable is null!" << std::endl;
-        pool->release();
-        break;
-      }
-
-      // Create command buffer per frame
-      MTL::CommandBuffer *commandBuffer = commandQueue->commandBuffer();
+  // Free resources whose last frame has finished on the GPU
+  destructionQueue.collect(completedFrame.load(std::memory_order_acquire));
 
-      // Create render pass descriptor
-      MTL::RenderPassDescriptor *renderPass = MTL::RenderPassDescriptor::alloc()->init();
-      MTL::RenderPassColorAttachmentDescriptor *colorAttachment = renderPass->colorAttachments()->object(0);
-      colorAttachment->setTexture(drawable->texture());
-      colorAttachment->setLoadAction(MTL::LoadActionClear);
-      colorAttachment->setClearColor(MTL::ClearColor(4.0, 2.0, 5.0, 1.0));
-      colorAttachment->setStoreAction(MTL::StoreActionStore);
+  GfxDrawable *drawable = device->beginFrame();
+  if (!drawable)
+    return;
+  const uint64_t frame = ++frameIndex;
 
+  // Entity transforms are the source of truth, only the ones set since the last frame are copied to their primitives
+  // and have their slot written. SceneStore::setTransform() already checked they are affine
+  for (const Entity &entity : scene.getDirtyTransforms())
+  {
+    if (!scene.isAlive(entity) || !(scene.getComponents(entity) & GeometryComponent))
+      continue;
+    const uint32_t index = scene.geometry(entity);
+    Primitive *geometry = geometries[index];
+    const uint64_t version = geometry->getTransform().getVersion();
+    geometry->setTransform(Eigen::Map<const Eigen::Matrix4f>(scene.transform(entity).data()).topRows<3>());
+    if (geometry->getTransform().getVersion() != version)
+      transformBuffer.markDirty(index);
+  }
+  scene.clearDirtyTransforms();
 
-      /*
-       *      Encoding
-       */
-      MTL::RenderCommandEncoder *encoder = commandBuffer->renderCommandEncoder(renderPass);
+  // The buffer written now was last read framesInFlight frames ago
+  if (frame > TransformBuffer::framesInFlight)
+    waitForFrame(frame - TransformBuffer::framesInFlight);
+  GfxBuffer *transforms = transformBuffer.upload(frame, destructionQueue);
 
-      {
-      //float currTime = sin(totalTime);
-      //std::cout << currTime << std::endl;
-      //encoder->setVertexBytes(&currTime, sizeof(float), 11);
-      }
+  /*
+   *      Encoding
+   */
+  GfxEncoder *encoder = device->beginPass({4.0, 2.0, 5.0, 1.0});
+  if (transforms)
+    encoder->setVertexBuffer(transforms, transformIndex);
+  encoder->setVertexBytes(viewProjection.data(), viewProjectionSize, viewProjectionIndex);
+
+  // Let shapes with levels of detail pick one for this drawable size, meshes (with bounds) in one batch
+  const float viewportWidth = static_cast<float>(drawable->getWidth());
+  const float viewportHeight = static_cast<float>(drawable->getHeight());
+  scene.forEachChunk(GeometryComponent, BoundsComponent, [&](const SceneChunk &chunk) {
+    for (size_t i = 0; i < chunk.count; ++i)
+      geometries[chunk.geometries[i]]->updateLod(viewProjection, viewportWidth, viewportHeight);
+  });
+  selectLods(viewportWidth, viewportHeight);
+
+  // Draw records only change with the scene or a level of detail (transforms live in the transform buffer), and only in
+  // the segments holding them
+  if (scene.getVersion() != segmentsVersion)
+    rebuildSegments();
+  else
+    scene.forEachChunkInOrder(GeometryComponent | VisibilityComponent, 0, [this](const SceneChunk &chunk) {
+      for (size_t i = 0; i < chunk.count; ++i)
+        if (chunk.visibility[i] && geometries[chunk.geometries[i]]->hasChangedDraws())
+        {
+          const auto [segment, object] = segmentOf[chunk.geometries[i]];
+          segments[segment].regroup |= segments[segment].unchangedFrames[object] >= staticFrames;
+          segments[segment].unchangedFrames[object] = 0;
+        }
+    });
+  encodeSegments(encoder);
+  const TransformUploadStats &upload = transformBuffer.getStats();
+  drawTelemetry.transformsUploaded = upload.slots;
+  drawTelemetry.uploadRanges = upload.ranges;
+  drawTelemetry.uploadBytes = upload.bytes;
+  encoder->endEncoding();
+
+  // Present and commit
+  device->endFrame([this, frame]() {
+    completedFrame.store(frame, std::memory_order_release);
+    completedFrame.notify_all();
+  });
+}
 
-      if (quad1) {
-        quad1->encodeRenderCommands(encoder); // Needs a RenderCommandEncoder, NOT CommandEncoder
-        quad1->draw(encoder);
-      }
-      if (quad2) {
-        quad2->encodeRenderCommands(encoder); // Needs a RenderCommandEncoder, NOT CommandEncoder
-        quad2->draw(encoder);
-      }
+/**
+ * @brief Splits the visible primitives, in draw order, into segments of at most packetObjects objects.
+ *
+ * Every object starts out live, with no frames unchanged.
+ */
+void Renderer::rebuildSegments()
+{
+  for (DrawSegment &segment : segments)
+    for (DrawRun &run : segment.runs)
+      destructionQueue.retireOwned(frameIndex, run.packet);
+  segments.clear();
+  segmentOf.assign(geometries.size(), {UINT32_MAX, UINT32_MAX});
+
+  scene.forEachChunkInOrder(GeometryComponent | VisibilityComponent, 0, [this](const SceneChunk &chunk) {
+    for (size_t i = 0; i < chunk.count; ++i)
+    {
+      if (!chunk.visibility[i])
+        continue;
+      if (segments.empty() || segments.back().objects.size() == packetObjects)
+        segments.emplace_back();
+      DrawSegment &segment = segments.back();
+      segmentOf[chunk.geometries[i]] = {static_cast<uint32_t>(segments.size() - 1),
+                                        static_cast<uint32_t>(segment.objects.size())};
+      segment.objects.push_back(chunk.geometries[i]);
+    }
+  });
+  for (DrawSegment &segment : segments)
+  {
+    segment.unchangedFrames.assign(segment.objects.size(), 0);
+    segment.runs.push_back({0, static_cast<uint32_t>(segment.objects.size()), false, nullptr});
+  }
+  segmentsVersion = scene.getVersion();
+}
 
-      if (triangle1) {
-        triangle1->encodeRenderCommands(encoder); // Needs a RenderCommandEncoder, NOT CommandEncoder
-        triangle1->draw(encoder);
-      }
-      if (triangle2) {
-        triangle2->encodeRenderCommands(encoder); // Needs a RenderCommandEncoder, NOT CommandEncoder
-        triangle2->draw(encoder);
-      }
+/**
+ * @brief Splits a segment into runs of static and live objects again, baking the static runs.
+ *
+ * A static run keeps its packet if the last grouping had the same run, so only runs next to an object that changed
+ * are baked again.
+ */
+void Renderer::regroupSegment(DrawSegment &segment)
+{
+  std::vector<DrawRun> runs;
+  for (uint32_t object = 0; object < segment.objects.size(); ++object)
+  {
+    const bool baked = segment.unchangedFrames[object] >= staticFrames;
+    if (runs.empty() || runs.back().baked != baked)
+      runs.push_back({object, object, baked, nullptr});
+    runs.back().last = object + 1;
+  }
 
-      encoder->endEncoding();
+  for (DrawRun &run : runs)
+  {
+    if (!run.baked)
+      continue;
+    const auto old = std::find_if(segment.runs.begin(), segment.runs.end(), [&run](const DrawRun &previous) {
+      return previous.baked && previous.first == run.first && previous.last == run.last;
+    });
+    if (old != segment.runs.end())
+    {
+      std::swap(run.packet, old->packet);
+      continue;
+    }
 
-      // Present
-      commandBuffer->presentDrawable(drawable);
-      commandBuffer->commit();
+    liveRecords.clear();
+    for (uint32_t object = run.first; object < run.last; ++object)
+      geometries[segment.objects[object]]->appendDraws(liveRecords);   // Nothing if culled
+    if (!liveRecords.empty())
+    {
+      run.packet = device->newDrawPacket(liveRecords.data(), liveRecords.size());
+      ++drawTelemetry.packetsBaked;
+    }
+  }
 
-      renderPass->release();
+  for (DrawRun &run : segment.runs)
+    destructionQueue.retireOwned(frameIndex, run.packet);
+  segment.runs = std::move(runs);
+  segment.regroup = false;
+}
 
-      pool->release();
+/**
+ * @brief Encodes every segment's runs in order, static ones from their packets.
+ *
+ * Live objects count the frames they go unchanged and turn static after staticFrames. A steady frame executes one
+ * packet per static run and only appends and submits the records of live objects, so its cost follows what changed
+ * rather than the size of the scene.
+ */
+void Renderer::encodeSegments(GfxEncoder *encoder)
+{
+  drawTelemetry = DrawTelemetry{};
+  drawTelemetry.segments = static_cast<uint32_t>(segments.size());
+  for (DrawSegment &segment : segments)
+  {
+    for (const DrawRun &run : segment.runs)
+      if (!run.baked)
+        for (uint32_t object = run.first; object < run.last; ++object)
+          segment.regroup |= ++segment.unchangedFrames[object] == staticFrames;
+    if (segment.regroup)
+      regroupSegment(segment);
+
+    for (const DrawRun &run : segment.runs)
+    {
+      if (run.baked)
+      {
+        if (!run.packet)
+          continue;
+        encoder->execute(run.packet);
+        ++drawTelemetry.packets;
+        drawTelemetry.recordsInPackets += run.packet->getDrawCount();
+        continue;
+      }
+      liveRecords.clear();
+      for (uint32_t object = run.first; object < run.last; ++object)
+        geometries[segment.objects[object]]->appendDraws(liveRecords);   // Nothing if culled
+      encoder->submit(liveRecords.data(), liveRecords.size());
+      drawTelemetry.recordsSubmitted += liveRecords.size();
     }
   }
 }
 
+const DrawTelemetry &Renderer::getDrawTelemetry() const
+{
+  return drawTelemetry;
+}
+
 void Renderer::logFPS()
 {
   using Clock = std::chrono::high_resolution_clock;
@@ -227,6 +629,16 @@ void Renderer::logFPS()
     std::cout << "Total Time: " << currentSecond << " seconds" << std::endl;
     std::cout << "FPS: " << frames << std::endl;
 
+    if (!meshes.empty())
+    {
+      const LodTelemetry &lod = lodSelector.getTelemetry();
+      std::cout << "LOD objects per level:";
+      for (size_t level = 0; level < maxLodLevels; ++level)
+        std::cout << ' ' << lod.objectsPerLevel[level];
+      std::cout << ", culled " << lod.culled << ", changed " << lod.levelChanges << ", triangles "
+                << lod.triangles << " / " << lod.fullDetailTriangles << std::endl;
+    }
+
     // Update the last printed second and reset frame counter
     lastPrintedSecond = currentSecond;
     frames = 0;
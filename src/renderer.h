@@ -1,41 +1,118 @@
 #pragma once
-// Include Apple's framework headers for Metal and related APIs
-#include <Metal/Metal.hpp>
-#include <simd/simd.h>
-
-#include "window.h"
+#include "./backend/GfxDevice.h"
+#include "./backend/TransformBuffer.h"
 #include "./Primitive/primitive.h"
+#include "./common/DestructionQueue.h"
+#include "./common/LodSelection.h"
+#include "./common/SceneStore.h"
 
 
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <string>
+#include <utility>
+
+// How the last frame's draws were submitted, see Renderer::renderFrame()
+struct DrawTelemetry
+{
+  uint32_t segments{0};
+  uint32_t packets{0};              // Executed
+  uint32_t packetsBaked{0};
+  uint64_t recordsSubmitted{0};     // Of objects that changed recently, encoded one by one
+  uint64_t recordsInPackets{0};
+  uint32_t transformsUploaded{0};   // Matrices written to the transform buffer
+  uint32_t uploadRanges{0};         // And the ranges flushed to the GPU
+  uint64_t uploadBytes{0};
+};
 
 class Renderer
 {
 public:
-  explicit Renderer(Window &window);
+  explicit Renderer(GfxDevice &device);
   ~Renderer();
 
   // Getter
-  MTL::Device *getDevice();
+  GfxDevice &getDevice();
+
+  // Per-level object counts from the last frame's LOD selection
+  const LodTelemetry &getLodTelemetry() const;
+
+  const DrawTelemetry &getDrawTelemetry() const;
+
+  // The objects picked by the defines at the top of renderer.cpp
+  void loadDemoScene();
+
+  // Takes ownership of the primitive, which must have been created on this renderer's device
+  Entity addObject(Primitive *geometry, ComponentMask components = 0);
+  Entity addMesh(MeshPrimitive *mesh);
+  void removeObject(Entity entity);
 
-  // Render method
-  void render();
+  // Entity components, written between frames. Transforms go through SceneStore::setTransform()
+  SceneStore &getScene();
+
+  // World to clip space, applied after every object's transform, identity by default (see
+  // offCenterProjection()). May be a perspective projection, it is sent once per pass
+  void setProjection(const Matrix4f &projection);
+
+  // Records and commits one frame
+  void renderFrame();
 
 private:
   void logFPS();
-  MTL::Device *device;
-  MTL::CommandQueue *commandQueue;
-  Window &window;
-
-  // Scene objects
-  //Triangle *triangle;
-  //Quad* quad;
-
-  // New objs using abc
-  Primitive* triangle1;    // Base ptr
-  Primitive* triangle2;    // Base ptr
-  Primitive* quad1;
-  Primitive* quad2;
+  void destroyPrimitive(Primitive *&primitive);
+  void waitForGPU();
+  void waitForFrame(uint64_t frame);
+  void addGltfScene(const std::string &fileName);
+  void selectLods(float viewportWidth, float viewportHeight);
+  void rebuildSegments();
+  void encodeSegments(GfxEncoder *encoder);
+  GfxDevice *device;
+
+  // Scene objects - an entity's transform (affine) is copied to its geometry in the frame after it is set
+  SceneStore scene;
+  Matrix4f viewProjection{Matrix4f::Identity()};  // Sent once per pass, see setProjection()
+  std::vector<Primitive *> geometries;      // Owned, indexed by the Geometry component, null when free
+  std::vector<uint32_t> freeGeometries;
+
+  // Every primitive's matrix, in the slot of its geometry index. Only the slots of primitives that moved are written
+  TransformBuffer transformBuffer;
+
+  // Meshes with levels of detail, picked in one batch per frame (index = LodSelector object)
+  std::vector<MeshPrimitive *> meshes;
+  LodSelector lodSelector;
+  LodSettings lodSettings;
+  bool meshesChanged{false};                // The selector is rebuilt after a mesh is removed
+
+  // Every visible primitive in draw order, split into segments of at most packetObjects objects. Runs of objects
+  // that haven't changed for staticFrames frames are drawn from a draw packet, the others from their current records
+  struct DrawRun
+  {
+    uint32_t first;                         // Objects [first, last) of the segment
+    uint32_t last;
+    bool baked;
+    GfxDrawPacket *packet;                  // Owned, null when live or when nothing is drawn
+  };
+  struct DrawSegment
+  {
+    std::vector<uint32_t> objects;          // Geometry indices
+    std::vector<uint32_t> unchangedFrames;  // Per object, stops counting once baked
+    std::vector<DrawRun> runs;
+    bool regroup{false};                    // An object turned static, or changed while baked
+  };
+  void regroupSegment(DrawSegment &segment);
+  static constexpr size_t packetObjects = 256;
+  static constexpr uint32_t staticFrames = 4;
+  std::vector<DrawSegment> segments;
+  std::vector<std::pair<uint32_t, uint32_t>> segmentOf;  // Segment and object by geometry index
+  std::vector<DrawRecord> liveRecords;      // Scratch for the live runs
+  uint64_t segmentsVersion{UINT64_MAX};     // Scene version the segments were built from
+  DrawTelemetry drawTelemetry;
+
+  // Deferred destruction - resources are freed once the last frame using them completes
+  DestructionQueue destructionQueue;
+  uint64_t frameIndex{0};                   // Last frame encoded on the CPU
+  std::atomic<uint64_t> completedFrame{0};  // Last frame the GPU reported as complete
 
   std::chrono::high_resolution_clock::time_point previousTime;
   double totalTime;
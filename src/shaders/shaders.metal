@@ -8,22 +8,240 @@ struct VertexOut {
     float4 color;                 // Color to pass to the fragment shader
 };
 
+struct PositionOut {
+    float4 position [[position]]; // Position in clip space, nothing else for depth/culling passes
+};
+
+// Interleaved (AoS) vertex, matches Vertex in common.h
+struct Vertex {
+    float4 position;
+    float4 color;
+};
+
+// Quantized interleaved vertex, matches QuantizedVertex in VertexQuantization.h (12 bytes)
+struct QuantizedVertex {
+    packed_ushort3 position;    // snorm16 or half bits
+    ushort pad;
+    uint color;                 // RGBA8 unorm
+};
+
+// Every vertex function takes its object's matrix from buffer(11): a slot of the transform
+// buffer (TransformBuffer.h) at a 48 byte offset, which the device address space allows where
+// constant buffers need 256 byte aligned offsets, or bytes set for the draw.
+// Model matrices are affine, so only their first three rows are stored, matches AffineMatrix
+// in Transform.h (48 bytes)
+struct AffineTransform {
+    float4 rows[3];
+};
+
+// The model matrix's last row is 0 0 0 1, so w passes through it. The pass's view and
+// projection follow, a column-major float4x4 in buffer(14) that may be a perspective one
+static float4 transformPosition(device const AffineTransform &m, constant float4x4 &viewProjection, float4 p) {
+    return viewProjection * float4(dot(m.rows[0], p), dot(m.rows[1], p), dot(m.rows[2], p), p.w);
+}
+
+// Per-mesh dequantization in buffer(12), matches QuantizationParams in VertexQuantization.h
+struct Dequantization {
+    float4 scale;               // scale.w = 0
+    float4 offset;              // offset.w = 1, so w is always 1
+    uint format;                // VertexFormat: 1 = snorm16, 2 = half
+};
+
+// One analytic shape drawn as an instanced quad, matches SdfInstance in SdfShapes.h (32 bytes)
+struct SdfInstance {
+    float2 center;
+    float2 halfExtents;
+    float cornerRadius;
+    float thickness;            // > 0 draws an outline of this width
+    uint shape;                 // SdfShape: 0 circle, 1 ring, 2 rounded rect, 3 capsule
+    uint color;                 // RGBA8 unorm
+};
+
+struct SdfOut {
+    float4 position [[position]];
+    float2 local;               // Offset from the shape center in object units
+    float4 color;
+    float2 halfExtents [[flat]];
+    float cornerRadius [[flat]];
+    float thickness [[flat]];
+    uint shape [[flat]];
+};
+
+static float4 decodePosition(ushort3 bits, constant Dequantization &dq) {
+    float3 q = dq.format == 2 ? float3(as_type<half3>(bits))
+                              : max(float3(as_type<short3>(bits)) / 32767.0, float3(-1.0));
+    return dq.offset + dq.scale * float4(q, 0.0);
+}
+
 // TODO: decouple vertex attributes into separate buffers using vertexId
     //constant packed_float4 *positions [[buffer(0)]],
 vertex VertexOut vertex_main(
     constant float4 *positions [[buffer(0)]],
     constant float4 *color [[buffer(1)]],
-    constant float4x4 &matrix [[buffer(11)]],
+    device const AffineTransform &matrix [[buffer(11)]],
+    constant float4x4 &viewProjection [[buffer(14)]],
     uint vertexID [[vertex_id]]
     ) {
     VertexOut out;
-    out.position = matrix * positions[vertexID]; // Pass position to clip space
+    out.position = transformPosition(matrix, viewProjection, positions[vertexID]); // Pass position to clip space
     out.color = color[vertexID];
     // Compute color based on position
 
     return out;
 }
 
+// Interleaved and hybrid layouts - one Vertex stream in buffer(0)
+vertex VertexOut vertex_interleaved(
+    constant Vertex *vertices [[buffer(0)]],
+    device const AffineTransform &matrix [[buffer(11)]],
+    constant float4x4 &viewProjection [[buffer(14)]],
+    uint vertexID [[vertex_id]]
+    ) {
+    VertexOut out;
+    out.position = transformPosition(matrix, viewProjection, vertices[vertexID].position);
+    out.color = vertices[vertexID].color;
+
+    return out;
+}
+
+// Split and hybrid layouts - packed position stream in buffer(0)
+vertex PositionOut vertex_position_only(
+    constant float4 *positions [[buffer(0)]],
+    device const AffineTransform &matrix [[buffer(11)]],
+    constant float4x4 &viewProjection [[buffer(14)]],
+    uint vertexID [[vertex_id]]
+    ) {
+    PositionOut out;
+    out.position = transformPosition(matrix, viewProjection, positions[vertexID]);
+
+    return out;
+}
+
+// Interleaved layout without a position stream - reads positions out of the Vertex stream
+vertex PositionOut vertex_interleaved_position_only(
+    constant Vertex *vertices [[buffer(0)]],
+    device const AffineTransform &matrix [[buffer(11)]],
+    constant float4x4 &viewProjection [[buffer(14)]],
+    uint vertexID [[vertex_id]]
+    ) {
+    PositionOut out;
+    out.position = transformPosition(matrix, viewProjection, vertices[vertexID].position);
+
+    return out;
+}
+
+// Quantized split layout - 8 byte positions in buffer(0), RGBA8 colors in buffer(1)
+vertex VertexOut vertex_quantized(
+    constant ushort4 *positions [[buffer(0)]],
+    constant uint *color [[buffer(1)]],
+    device const AffineTransform &matrix [[buffer(11)]],
+    constant float4x4 &viewProjection [[buffer(14)]],
+    constant Dequantization &dq [[buffer(12)]],
+    uint vertexID [[vertex_id]]
+    ) {
+    VertexOut out;
+    out.position = transformPosition(matrix, viewProjection, decodePosition(positions[vertexID].xyz, dq));
+    out.color = unpack_unorm4x8_to_float(color[vertexID]);
+
+    return out;
+}
+
+// Quantized interleaved and hybrid layouts - 12 byte QuantizedVertex stream in buffer(0)
+vertex VertexOut vertex_quantized_interleaved(
+    constant QuantizedVertex *vertices [[buffer(0)]],
+    device const AffineTransform &matrix [[buffer(11)]],
+    constant float4x4 &viewProjection [[buffer(14)]],
+    constant Dequantization &dq [[buffer(12)]],
+    uint vertexID [[vertex_id]]
+    ) {
+    VertexOut out;
+    out.position = transformPosition(matrix, viewProjection, decodePosition(ushort3(vertices[vertexID].position), dq));
+    out.color = unpack_unorm4x8_to_float(vertices[vertexID].color);
+
+    return out;
+}
+
+vertex PositionOut vertex_quantized_position_only(
+    constant ushort4 *positions [[buffer(0)]],
+    device const AffineTransform &matrix [[buffer(11)]],
+    constant float4x4 &viewProjection [[buffer(14)]],
+    constant Dequantization &dq [[buffer(12)]],
+    uint vertexID [[vertex_id]]
+    ) {
+    PositionOut out;
+    out.position = transformPosition(matrix, viewProjection, decodePosition(positions[vertexID].xyz, dq));
+
+    return out;
+}
+
+vertex PositionOut vertex_quantized_interleaved_position_only(
+    constant QuantizedVertex *vertices [[buffer(0)]],
+    device const AffineTransform &matrix [[buffer(11)]],
+    constant float4x4 &viewProjection [[buffer(14)]],
+    constant Dequantization &dq [[buffer(12)]],
+    uint vertexID [[vertex_id]]
+    ) {
+    PositionOut out;
+    out.position = transformPosition(matrix, viewProjection, decodePosition(ushort3(vertices[vertexID].position), dq));
+
+    return out;
+}
+
+// Signed distance to the shape outline, negative inside. Mirrors sdfDistance() in SdfShapes.cpp
+static float sdfDistance(float2 p, float2 h, float cornerRadius, float thickness, uint shape) {
+    float d;
+    if (shape == 2) {           // Rounded rect
+        float2 q = abs(p) - (h - cornerRadius);
+        d = length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - cornerRadius;
+    } else if (shape == 3) {    // Capsule along the longer axis
+        bool alongX = h.x >= h.y;
+        float radius = alongX ? h.y : h.x;
+        float halfLength = (alongX ? h.x : h.y) - radius;
+        float2 a = alongX ? p : p.yx;
+        d = length(float2(a.x - clamp(a.x, -halfLength, halfLength), a.y)) - radius;
+    } else {                    // Circle and ring
+        d = length(p) - h.x;
+    }
+
+    if (thickness > 0.0 || shape == 1)
+        d = abs(d) - 0.5 * thickness;
+    return d;
+}
+
+// Instanced quad per shape - draw 4 vertices as a triangle strip, one instance per shape
+vertex SdfOut vertex_sdf(
+    constant SdfInstance *instances [[buffer(0)]],
+    device const AffineTransform &matrix [[buffer(11)]],
+    constant float &padding [[buffer(13)]],   // One pixel in object units, keeps the AA ramp inside the quad
+    constant float4x4 &viewProjection [[buffer(14)]],
+    uint vertexID [[vertex_id]],
+    uint instanceID [[instance_id]]
+    ) {
+    constant SdfInstance &shape = instances[instanceID];
+    float2 corner = float2((vertexID & 1) ? 1.0 : -1.0, (vertexID & 2) ? 1.0 : -1.0);
+    float2 local = corner * (shape.halfExtents + 0.5 * shape.thickness + padding);
+
+    SdfOut out;
+    out.position = transformPosition(matrix, viewProjection, float4(shape.center + local, 0.0, 1.0));
+    out.local = local;
+    out.color = unpack_unorm4x8_to_float(shape.color);
+    out.halfExtents = shape.halfExtents;
+    out.cornerRadius = shape.cornerRadius;
+    out.thickness = shape.thickness;
+    out.shape = shape.shape;
+
+    return out;
+}
+
+fragment float4 fragment_sdf(SdfOut in [[stage_in]]) {
+    float d = sdfDistance(in.local, in.halfExtents, in.cornerRadius, in.thickness, in.shape);
+    float pixelSize = max(fwidth(d), 1e-6);
+    float coverage = saturate(0.5 - d / pixelSize);   // Analytic antialiasing, one pixel ramp
+    if (coverage <= 0.0)
+        discard_fragment();
+    return float4(in.color.rgb, in.color.a * coverage);
+}
+
 fragment float4 fragment_main(VertexOut in [[stage_in]]) {
     return in.color; // Use the interpolated color
 }
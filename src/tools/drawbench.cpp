@@ -0,0 +1,276 @@
+/*
+-------------------------------------------------------------------
+  drawbench  --------------------------------------------------------
+
+  Measures CPU draw submission cost per object without a GPU: the old path (a virtual draw()
+  on each heap-allocated primitive after encodeRenderCommands) against a flat DrawList
+  (common/DrawList.h). Both drive the same counting encoder, whose calls are kept out of line
+  like a real driver's.
+
+    drawbench [objects] [frames]        defaults 1000000 objects, 10 frames, best frame reported
+
+  The draw list is only rebuilt when the scene or a level of detail changes, so its cost is
+  reported apart from the submission every frame pays.
+-------------------------------------------------------------------
+*/
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../common/DrawList.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/*
+    Stands in for MTL::RenderCommandEncoder, every call is counted and folded into a checksum.
+    The draws get their own, so both paths can be checked to submit the same ones
+*/
+struct CountingEncoder {
+    uint64_t binds{0};
+    uint64_t draws{0};
+    uint64_t checksum{0};
+    uint64_t drawChecksum{0};      // Of the draws alone, in order
+
+    [[gnu::noinline]] void setPipeline(const void *pipeline) {
+        ++binds;
+        checksum += reinterpret_cast<uintptr_t>(pipeline);
+    }
+
+    [[gnu::noinline]] void setVertexBuffer(const void *buffer, uint32_t index) {
+        ++binds;
+        checksum += reinterpret_cast<uintptr_t>(buffer) + index;
+    }
+
+    [[gnu::noinline]] void setVertexBufferOffset(size_t offset, uint32_t index) {
+        ++binds;
+        checksum += offset + index;
+    }
+
+    [[gnu::noinline]] void setVertexBytes(const void *bytes, size_t size, uint32_t index) {
+        ++binds;
+        checksum += static_cast<const uint8_t *>(bytes)[0] + size + index;
+    }
+
+    [[gnu::noinline]] void drawIndexedPrimitives(uint32_t count, IndexFormat format, const void *indexBuffer,
+                                                  uint32_t byteOffset, uint32_t baseVertex) {
+        ++draws;
+        drawChecksum = drawChecksum * 31 + count + uint32_t(format) + reinterpret_cast<uintptr_t>(indexBuffer) +
+                   byteOffset + baseVertex;
+    }
+
+    // DrawList entry points
+    void draw(const DrawRecord &record) {
+        drawIndexedPrimitives(record.count, record.indexFormat, nullptr, record.start, record.baseVertex);
+    }
+
+    void drawIndexed(const DrawRecord &record) {
+        drawIndexedPrimitives(record.count, record.indexFormat, record.indexBuffer, record.start, record.baseVertex);
+    }
+};
+
+// Fake GPU objects, only their addresses are used
+std::vector<std::array<uint8_t, 64>> pipelines(64), buffers;
+
+/*
+    The old path: one virtual call per object after the shared binding code
+*/
+class VirtualPrimitive {
+public:
+    VirtualPrimitive(size_t id, const void *pipeline)
+        : pipeline(pipeline), vertexBuffer(&buffers[id * 2]), indexBuffer(&buffers[id * 2 + 1]) {
+        transform[0] = transform[5] = transform[10] = 1.0f;
+        transform[3] = static_cast<float>(id);
+    }
+
+    virtual ~VirtualPrimitive() = default;
+
+    void encodeRenderCommands(CountingEncoder &encoder) const {
+        if (!pipeline)
+            throw std::runtime_error("No Pipeline State");
+        if (!vertexBuffer)
+            throw std::runtime_error("No Vertex Buffer");
+        encoder.setPipeline(pipeline);
+        encoder.setVertexBuffer(vertexBuffer, vertexStreamIndex);
+        encoder.setVertexBytes(transform.data(), sizeof(transform), transformIndex);
+    }
+
+    virtual void draw(CountingEncoder &encoder) = 0;
+
+    // Same draws as a compiled record list
+    virtual void appendRecords(std::vector<DrawRecord> &records) const = 0;
+
+protected:
+    const void *pipeline;
+    const void *vertexBuffer;
+    const void *indexBuffer;
+    std::array<float, 12> transform{};     // Row-major 3x4 affine, like Transform's
+
+    DrawRecord makeRecord(uint32_t count) const {
+        DrawRecord record{};
+        record.pipeline = pipeline;
+        record.vertexBuffer = vertexBuffer;
+        record.indexBuffer = indexBuffer;
+        record.transform = transform.data();
+        record.count = count;
+        record.instanceCount = 1;
+        return record;
+    }
+};
+
+class VirtualTriangle final : public VirtualPrimitive {
+public:
+    using VirtualPrimitive::VirtualPrimitive;
+
+    void draw(CountingEncoder &encoder) override {
+        encoder.drawIndexedPrimitives(3, IndexFormat::UInt16, indexBuffer, 0, 0);
+    }
+
+    void appendRecords(std::vector<DrawRecord> &records) const override {
+        records.push_back(makeRecord(3));
+    }
+};
+
+class VirtualQuad final : public VirtualPrimitive {
+public:
+    using VirtualPrimitive::VirtualPrimitive;
+
+    void draw(CountingEncoder &encoder) override {
+        encoder.drawIndexedPrimitives(6, IndexFormat::UInt16, indexBuffer, 0, 0);
+    }
+
+    void appendRecords(std::vector<DrawRecord> &records) const override {
+        records.push_back(makeRecord(6));
+    }
+};
+
+// A mesh split into two uint16 windows, as packIndices() does for large meshes
+class VirtualMesh final : public VirtualPrimitive {
+public:
+    using VirtualPrimitive::VirtualPrimitive;
+
+    void draw(CountingEncoder &encoder) override {
+        for (const Range &range : ranges)
+            encoder.drawIndexedPrimitives(range.count, IndexFormat::UInt16, indexBuffer, range.byteOffset,
+                                          range.baseVertex);
+    }
+
+    void appendRecords(std::vector<DrawRecord> &records) const override {
+        for (const Range &range : ranges) {
+            DrawRecord record = makeRecord(range.count);
+            record.start = range.byteOffset;
+            record.baseVertex = range.baseVertex;
+            records.push_back(record);
+        }
+    }
+
+private:
+    struct Range {
+        uint32_t count, byteOffset, baseVertex;
+    };
+    std::vector<Range> ranges{{3 * 8192, 0, 0}, {3 * 4096, 2 * 3 * 8192, 32768}};
+};
+
+/*
+    The flat path: records compiled once per object, copied into the frame's list and submitted
+*/
+struct CompiledObject {
+    uint32_t firstRecord;
+    uint32_t recordCount;
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+    try {
+        const size_t objectCount = argc > 1 ? std::stoul(argv[1]) : 1000000;
+        const size_t frames = argc > 2 ? std::max<size_t>(1, std::stoul(argv[2])) : 10;
+        buffers.resize(objectCount * 2);
+
+        // Shuffled allocation order, like primitives created and destroyed over a session, and
+        // mixed types so the virtual call can't be predicted
+        std::vector<std::unique_ptr<VirtualPrimitive>> objects(objectCount);
+        std::vector<size_t> order(objectCount);
+        for (size_t i = 0; i < objectCount; ++i)
+            order[i] = i;
+        std::mt19937 random(1);
+        std::shuffle(order.begin(), order.end(), random);
+        for (size_t i : order) {
+            const void *pipeline = &pipelines[i * pipelines.size() / objectCount];
+            switch (random() % 8) {
+                case 0: objects[i] = std::make_unique<VirtualMesh>(i, pipeline); break;
+                case 1: case 2: case 3: objects[i] = std::make_unique<VirtualTriangle>(i, pipeline); break;
+                default: objects[i] = std::make_unique<VirtualQuad>(i, pipeline); break;
+            }
+        }
+
+        std::vector<DrawRecord> compiled;
+        std::vector<CompiledObject> compiledObjects(objectCount);
+        for (size_t i = 0; i < objectCount; ++i) {
+            compiledObjects[i].firstRecord = static_cast<uint32_t>(compiled.size());
+            objects[i]->appendRecords(compiled);
+            compiledObjects[i].recordCount = static_cast<uint32_t>(compiled.size()) - compiledObjects[i].firstRecord;
+        }
+
+        double virtualBest = 1e30, rebuildBest = 1e30, submitBest = 1e30;
+        CountingEncoder virtualEncoder, flatEncoder;
+        std::vector<DrawRecord> drawList;
+        for (size_t frame = 0; frame < frames; ++frame) {
+            virtualEncoder = {};
+            auto start = Clock::now();
+            for (const auto &object : objects) {
+                object->encodeRenderCommands(virtualEncoder);
+                object->draw(virtualEncoder);
+            }
+            virtualBest = std::min(virtualBest, millisecondsSince(start));
+
+            // Only needed in frames where the scene or a level of detail changed
+            start = Clock::now();
+            drawList.clear();
+            for (const CompiledObject &object : compiledObjects)
+                drawList.insert(drawList.end(), compiled.begin() + object.firstRecord,
+                                compiled.begin() + object.firstRecord + object.recordCount);
+            rebuildBest = std::min(rebuildBest, millisecondsSince(start));
+
+            flatEncoder = {};
+            start = Clock::now();
+            submitDrawList(drawList, flatEncoder);
+            submitBest = std::min(submitBest, millisecondsSince(start));
+        }
+
+        if (virtualEncoder.drawChecksum != flatEncoder.drawChecksum)
+            throw std::runtime_error("Both paths must submit the same draws");
+
+        auto report = [&](const char *name, double milliseconds) {
+            std::cout << name << milliseconds << " ms, " << milliseconds * 1e6 / objectCount << " ns/object"
+                      << std::endl;
+        };
+        std::cout << objectCount << " objects, " << compiled.size() << " draw records (" << sizeof(DrawRecord)
+                  << " bytes each), best of " << frames << " frames" << std::endl;
+        report("  virtual draw():       ", virtualBest);
+        std::cout << "                        " << virtualEncoder.binds << " binds, " << virtualEncoder.draws
+                  << " draws" << std::endl;
+        report("  draw list submit:     ", submitBest);
+        std::cout << "                        " << flatEncoder.binds << " binds, " << flatEncoder.draws
+                  << " draws" << std::endl;
+        report("  draw list rebuild:    ", rebuildBest);
+    }
+    catch (const std::exception &e) {
+        std::cerr << "Error from drawbench: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
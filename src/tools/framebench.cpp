@@ -0,0 +1,182 @@
+/*
+-------------------------------------------------------------------
+  framebench  -------------------------------------------------------
+
+  Runs the renderer's whole CPU side of a frame headless, on the recording backend
+  (backend/RecordingDevice.h): the transform sync and upload, levels of detail, the draw list
+  and its submission. Checks every frame submits one draw and one transform slot per object,
+  then reports CPU time, commands and the transform bytes uploaded per frame.
+
+    framebench [objects] [frames] [capture]     defaults 10000 objects, 100 frames
+
+  Runs on a null device that only counts commands (the renderer's own overhead) with every
+  object moving, then with one in a hundred moving, where the rest are drawn from baked draw
+  packets and only the moving objects' matrices are uploaded, and on a device that captures
+  every command with its arguments. Given a file name, also saves one frame of the scene as a
+  command capture (backend/CaptureDevice.h) for the replay tool.
+-------------------------------------------------------------------
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../renderer.h"
+#include "../backend/CaptureDevice.h"
+#include "../backend/RecordingDevice.h"
+#include "../MeshGenerator/proceduralShapes.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+uint64_t count(const GfxCommandStats &stats, GfxCommandType type) {
+    return stats.counts[static_cast<size_t>(type)];
+}
+
+uint64_t bytes(const GfxCommandStats &stats, GfxCommandType type) {
+    return stats.bytes[static_cast<size_t>(type)];
+}
+
+std::vector<Entity> addObjects(Renderer &renderer, GfxDevice &device, size_t objectCount) {
+    // Primitives log as they are built, not useful for thousands of them
+    std::ostringstream quiet;
+    std::streambuf *console = std::cout.rdbuf(quiet.rdbuf());
+    const Mesh cube = generateShape(ShapeDesc{ShapeType::Cube});
+    std::vector<Entity> entities;
+    for (size_t i = 0; i < objectCount; ++i) {
+        switch (i % 4) {
+            case 0: entities.push_back(renderer.addObject(new Triangle(&device))); break;
+            case 1: entities.push_back(renderer.addObject(new Quad(&device))); break;
+            default: entities.push_back(renderer.addObject(new MeshPrimitive(&device, cube))); break;
+        }
+    }
+    std::cout.rdbuf(console);
+    return entities;
+}
+
+// Moves every movingStride-th object
+void moveObjects(Renderer &renderer, const std::vector<Entity> &entities, size_t frame, uint32_t movingStride) {
+    SceneStore &scene = renderer.getScene();
+    for (size_t i = 0; i < entities.size(); i += movingStride) {
+        Matrix4 matrix = scene.transform(entities[i]);
+        matrix[12] = 0.001f * static_cast<float>(frame % 100);
+        scene.setTransform(entities[i], matrix);
+    }
+}
+
+void run(size_t objectCount, size_t frames, bool capture, uint32_t movingStride) {
+    RecordingDevice device(1280, 720, capture);
+    Renderer renderer(device);
+
+    auto start = Clock::now();
+    const std::vector<Entity> entities = addObjects(renderer, device, objectCount);
+    const double createMilliseconds = millisecondsSince(start);
+
+    // The first frames build the draw list and bake what stands still
+    for (size_t frame = 0; frame < 8; ++frame) {
+        moveObjects(renderer, entities, frame, movingStride);
+        renderer.renderFrame();
+    }
+    device.resetStats();
+    device.clearCommands();
+
+    double best = 1e30, total = 0.0;
+    DrawTelemetry draws;
+    for (size_t frame = 0; frame < frames; ++frame) {
+        start = Clock::now();
+        moveObjects(renderer, entities, frame, movingStride);
+        renderer.renderFrame();
+        const double milliseconds = millisecondsSince(start);
+        best = std::min(best, milliseconds);
+        total += milliseconds;
+        draws.packets += renderer.getDrawTelemetry().packets;
+        draws.packetsBaked += renderer.getDrawTelemetry().packetsBaked;
+        draws.recordsSubmitted += renderer.getDrawTelemetry().recordsSubmitted;
+        draws.recordsInPackets += renderer.getDrawTelemetry().recordsInPackets;
+        draws.transformsUploaded += renderer.getDrawTelemetry().transformsUploaded;
+        draws.uploadRanges += renderer.getDrawTelemetry().uploadRanges;
+
+        if (capture) {
+            size_t draws = 0, transforms = 0;
+            for (const GfxCommand &command : device.getCommands()) {
+                draws += command.type == GfxCommandType::Draw || command.type == GfxCommandType::DrawIndexed;
+                transforms += command.type == GfxCommandType::SetVertexBufferOffset && command.index == transformIndex;
+            }
+            if (draws != objectCount || transforms != objectCount)
+                throw std::runtime_error("Expected one draw and one transform per object");
+            device.clearCommands();
+        }
+    }
+
+    const GfxCommandStats &stats = device.getStats();
+    const double perFrame = 1.0 / static_cast<double>(frames);
+    uint64_t commands = 0;
+    for (uint64_t typeCount : stats.counts)
+        commands += typeCount;
+    std::cout << device.getName() << " device, " << objectCount << " objects (created in " << createMilliseconds
+              << " ms), " << (movingStride == 1 ? std::string("all") : "1 in " + std::to_string(movingStride))
+              << " moving, " << frames << " frames" << std::endl;
+    std::cout << "  frame:     best " << best << " ms, mean " << total * perFrame << " ms, "
+              << best * 1e6 / objectCount << " ns/object" << std::endl;
+    std::cout << "  commands:  " << commands * perFrame << " per frame, "
+              << count(stats, GfxCommandType::Draw) * perFrame << " draws, "
+              << count(stats, GfxCommandType::DrawIndexed) * perFrame << " indexed draws, "
+              << count(stats, GfxCommandType::SetPipeline) * perFrame << " pipeline binds, "
+              << count(stats, GfxCommandType::SetVertexBuffer) * perFrame << " buffer binds" << std::endl;
+    std::cout << "  bytes:     " << bytes(stats, GfxCommandType::SetVertexBytes) * perFrame << " set per frame, "
+              << bytes(stats, GfxCommandType::DrawIndexed) * perFrame << " of indices read, "
+              << stats.vertices * perFrame << " vertices" << std::endl;
+    std::cout << "  uploads:   " << bytes(stats, GfxCommandType::UpdateBuffer) * perFrame << " transform bytes per frame, "
+              << draws.transformsUploaded * perFrame << " matrices in " << draws.uploadRanges * perFrame << " ranges"
+              << std::endl;
+    std::cout << "  packets:   " << draws.packets * perFrame << " per frame in " << renderer.getDrawTelemetry().segments
+              << " segments, " << draws.recordsInPackets * perFrame << " records from packets, "
+              << draws.recordsSubmitted * perFrame << " submitted, " << draws.packetsBaked * perFrame << " baked"
+              << std::endl;
+}
+
+void saveCapture(size_t objectCount, const std::string &fileName) {
+    RecordingDevice null(1280, 720, false);
+    CaptureDevice device(null);
+    Renderer renderer(device);
+    addObjects(renderer, device, objectCount);
+
+    renderer.renderFrame();
+    device.startCapture(1);
+    renderer.renderFrame();
+    const GfxCapture &capture = device.getCapture();
+    capture.save(fileName);
+    std::cout << "captured 1 frame to " << fileName << ": " << capture.commands.size() << " commands, "
+              << capture.pipelines.size() << " pipelines, " << capture.buffers.size() << " buffers, "
+              << capture.payload.size() << " payload bytes" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    try {
+        const size_t objectCount = argc > 1 ? std::stoul(argv[1]) : 10000;
+        const size_t frames = argc > 2 ? std::max<size_t>(1, std::stoul(argv[2])) : 100;
+
+        run(objectCount, frames, false, 1);
+        run(objectCount, frames, false, 100);
+        run(objectCount, frames, true, 100);
+        if (argc > 3)
+            saveCapture(objectCount, argv[3]);
+    }
+    catch (const std::exception &e) {
+        std::cerr << "Error from framebench: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
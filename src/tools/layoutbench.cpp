@@ -0,0 +1,125 @@
+/*
+-------------------------------------------------------------------
+  layoutbench  ------------------------------------------------------
+
+  Measures CPU vertex fetch bandwidth of the vertex layouts (common/VertexLayout.h), the
+  numbers defaultVertexLayout() is chosen from. Each pass reads every vertex once, through a
+  shuffled index buffer the way the GPU fetches indexed meshes, and sequentially:
+
+    shading         position and color, from the interleaved stream or both split streams
+    position only   position, from the interleaved stream or the packed position stream
+
+    layoutbench [vertices] [rounds]     defaults 8000000 vertices, 5 rounds, best round reported
+-------------------------------------------------------------------
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../common/common.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// What a vertex function computes from what it read, summed so the reads can't be dropped
+inline float shade(const Position &position, const Color &color) {
+    return position.x + position.y + position.z + position.w + color.r + color.g + color.b + color.a;
+}
+
+inline float place(const Position &position) {
+    return position.x + position.y + position.z + position.w;
+}
+
+struct Timing {
+    double best{1e30};
+    float checksum{0.0f};
+};
+
+template <typename Pass>
+void measure(Timing &timing, Pass pass) {
+    const auto start = Clock::now();
+    timing.checksum = pass();
+    timing.best = std::min(timing.best, millisecondsSince(start));
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    try {
+        const size_t count = argc > 1 ? std::stoul(argv[1]) : 8000000;
+        const size_t rounds = argc > 2 ? std::max<size_t>(1, std::stoul(argv[2])) : 5;
+
+        std::vector<Vertex> interleaved(count);
+        std::vector<Position> positions(count);
+        std::vector<Color> colors(count);
+        for (size_t i = 0; i < count; ++i) {
+            const float f = static_cast<float>(i % 1024);
+            interleaved[i] = {{f, -f, 0.5f * f, 1.0f}, {0.25f, 0.5f, f / 1024.0f, 1.0f}};
+            positions[i] = interleaved[i].position;
+            colors[i] = interleaved[i].color;
+        }
+        std::vector<uint32_t> shuffled(count), sequential(count);
+        std::iota(sequential.begin(), sequential.end(), 0u);
+        shuffled = sequential;
+        std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(1));
+
+        std::cout << count << " vertices, best of " << rounds << " rounds" << std::endl;
+        for (const std::vector<uint32_t> *indices : {&shuffled, &sequential}) {
+            Timing shadeInterleaved, shadeSplit, placeInterleaved, placePacked;
+            for (size_t round = 0; round < rounds; ++round) {
+                measure(shadeInterleaved, [&] {
+                    float sum = 0.0f;
+                    for (uint32_t i : *indices)
+                        sum += shade(interleaved[i].position, interleaved[i].color);
+                    return sum;
+                });
+                measure(shadeSplit, [&] {
+                    float sum = 0.0f;
+                    for (uint32_t i : *indices)
+                        sum += shade(positions[i], colors[i]);
+                    return sum;
+                });
+                measure(placeInterleaved, [&] {
+                    float sum = 0.0f;
+                    for (uint32_t i : *indices)
+                        sum += place(interleaved[i].position);
+                    return sum;
+                });
+                measure(placePacked, [&] {
+                    float sum = 0.0f;
+                    for (uint32_t i : *indices)
+                        sum += place(positions[i]);
+                    return sum;
+                });
+            }
+            if (shadeInterleaved.checksum != shadeSplit.checksum || placeInterleaved.checksum != placePacked.checksum)
+                throw std::runtime_error("Layouts must read the same vertices");
+
+            std::cout << (indices == &shuffled ? "indexed (shuffled)" : "sequential") << std::endl;
+            std::cout << "  shading:        interleaved " << shadeInterleaved.best << " ms, split "
+                      << shadeSplit.best << " ms, interleaved " << shadeSplit.best / shadeInterleaved.best
+                      << "x faster" << std::endl;
+            std::cout << "  position only:  interleaved " << placeInterleaved.best << " ms, packed "
+                      << placePacked.best << " ms, packed " << placeInterleaved.best / placePacked.best
+                      << "x faster" << std::endl;
+        }
+    }
+    catch (const std::exception &e) {
+        std::cerr << "Error from layoutbench: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
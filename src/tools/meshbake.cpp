@@ -0,0 +1,92 @@
+/*
+-------------------------------------------------------------------
+  meshbake  ---------------------------------------------------------
+
+  Converts a mesh into a baked .mesh file (MeshLoader/meshFile.h): optimized for the vertex
+  cache, overdraw and fetch, with levels of detail and meshlets, vertex and index streams
+  compressed unless --raw is given.
+
+    meshbake [--raw] [--no-lod] <input.obj|.ply|.gltf|.glb|.mesh> <output.mesh>
+
+  Load times of the result can be compared with the source using meshload.
+-------------------------------------------------------------------
+*/
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "../MeshLoader/meshFile.h"
+#include "../MeshLoader/meshLoader.h"
+#include "../MeshOptimizer/meshOptimizer.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    int arg = 1;
+    bool compress = true, lod = true;
+    for (; arg < argc; ++arg) {
+        const std::string option = argv[arg];
+        if (option == "--raw")
+            compress = false;
+        else if (option == "--no-lod")
+            lod = false;
+        else
+            break;
+    }
+
+    if (argc != arg + 2) {
+        std::cerr << "Usage: meshbake [--raw] [--no-lod] <input.obj|.ply|.gltf|.glb|.mesh> <output.mesh>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const std::string input = argv[arg], output = argv[arg + 1];
+        auto start = Clock::now();
+        BakedMesh baked;
+        baked.mesh = loadMesh(input);
+        std::cout << baked.mesh.vertexCount() << " vertices, " << baked.mesh.triangleCount() << " triangles ("
+                  << millisecondsSince(start) << " ms to load)" << std::endl;
+
+        start = Clock::now();
+        optimizeMesh(baked.mesh);
+        if (lod) {
+            LodChain chain = generateLodChain(baked.mesh, {0.5f, 0.25f, 0.125f, 0.0625f});
+            baked.mesh.indices = std::move(chain.indices);
+            baked.levels = std::move(chain.levels);
+        }
+        // Level 0 is the full detail mesh at the start of the indices
+        const size_t fullIndexCount = baked.levels.empty() ? baked.mesh.indices.size() : baked.levels[0].indexCount;
+        baked.meshlets = buildMeshlets(baked.mesh, baked.mesh.indices.data(), fullIndexCount);
+        std::cout << baked.levels.size() << " levels of detail, " << baked.meshlets.meshlets.size() << " meshlets ("
+                  << millisecondsSince(start) << " ms)" << std::endl;
+
+        start = Clock::now();
+        writeMeshFile(output, baked, compress);
+        const double writeTime = millisecondsSince(start);
+
+        const MeshFile file(output);
+        size_t rawBytes = 0;
+        for (uint32_t type = 1; type <= static_cast<uint32_t>(MeshSection::MeshletTriangles); ++type)
+            if (const MeshFileSection *section = file.findSection(static_cast<MeshSection>(type)))
+                rawBytes += size_t(section->elementSize) * section->elementCount;
+        const double megabytes = static_cast<double>(file.getHeader().fileSize) / (1024.0 * 1024.0);
+        std::cout << "Wrote " << output << ": " << megabytes << " MB, " << rawBytes / (1024.0 * 1024.0)
+                  << " MB of streams, ratio " << static_cast<double>(file.getHeader().fileSize) / rawBytes << " ("
+                  << writeTime << " ms)" << std::endl;
+    }
+    catch (const std::exception &e) {
+        std::cerr << "Error from meshbake: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
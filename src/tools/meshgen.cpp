@@ -0,0 +1,82 @@
+/*
+-------------------------------------------------------------------
+  meshgen  ----------------------------------------------------------
+
+  Generates a field of procedural shapes (MeshGenerator/proceduralShapes.h), one of each
+  type in turn on a square grid, and reports how long it took.
+
+    meshgen <count> [resolution] [output.mesh]      resolution is segments per shape (default 16),
+                                                    the output is raw, without levels of detail
+-------------------------------------------------------------------
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "../MeshGenerator/proceduralShapes.h"
+#include "../MeshLoader/meshFile.h"
+#include "../common/ThreadPool.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: meshgen <count> [resolution] [output.mesh]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const size_t count = std::stoul(argv[1]);
+        const uint32_t resolution = argc > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : 16;
+        const size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+
+        // Icospheres grow with the square of their resolution, so they get a quarter of it
+        std::vector<ShapeInstance> field(count);
+        std::vector<float> heights(size_t(resolution + 1) * (resolution + 1));
+        for (size_t i = 0; i < heights.size(); ++i)
+            heights[i] = 0.2f * std::sin(0.5f * (i % (resolution + 1))) * std::cos(0.5f * (i / (resolution + 1)));
+        for (size_t i = 0; i < count; ++i) {
+            ShapeInstance &instance = field[i];
+            instance.shape.type = static_cast<ShapeType>(i % 7);
+            instance.shape.segments = instance.shape.type == ShapeType::Icosphere ? std::max(1u, resolution / 4) : resolution;
+            instance.shape.rings = std::max(3u, resolution / 2);
+            instance.shape.heights = heights.data();
+            const float scale = 0.4f / side;
+            instance.transform[0] = instance.transform[5] = instance.transform[10] = scale;
+            instance.transform[12] = (2.0f * (i % side) + 1.0f) / side - 1.0f;
+            instance.transform[13] = (2.0f * (i / side) + 1.0f) / side - 1.0f;
+            instance.color = {float(i % side) / side, float(i / side) / side, 0.5f, 1.0f};
+        }
+
+        auto start = Clock::now();
+        BakedMesh baked;
+        baked.mesh = generateShapes(field);
+        const double milliseconds = millisecondsSince(start);
+        std::cout << count << " shapes, " << baked.mesh.vertexCount() << " vertices, " << baked.mesh.triangleCount()
+                  << " triangles in " << milliseconds << " ms: "
+                  << baked.mesh.vertexCount() / (milliseconds * 1000.0) << " M vertices/s ("
+                  << ThreadPool::shared().size() << " threads)" << std::endl;
+
+        if (argc > 3) {
+            writeMeshFile(argv[3], baked, false);
+            std::cout << "Wrote " << argv[3] << std::endl;
+        }
+    }
+    catch (const std::exception &e) {
+        std::cerr << "Error from meshgen: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
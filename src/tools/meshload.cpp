@@ -0,0 +1,239 @@
+/*
+-------------------------------------------------------------------
+  meshload  ---------------------------------------------------------
+
+  Measures mesh loading throughput, and writes synthetic scans large enough to
+  measure it with.
+
+    meshload <file.obj|.ply|.glb|.mesh> [repeat]    Loads the file repeat times (default 3)
+                                                    and reports the best MB/s
+    meshload --write <file.obj|.ply|.glb> <triangles> [ascii|binary]
+                                                    Writes a wavy grid with normals and colors,
+                                                    PLY defaults to binary
+-------------------------------------------------------------------
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../MeshLoader/gltfLoader.h"
+#include "../MeshLoader/meshFile.h"
+#include "../MeshLoader/meshLoader.h"
+#include "../common/MappedFile.h"
+#include "../common/ThreadPool.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+bool endsWith(const std::string &text, const std::string &suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+Mesh makeScan(size_t triangles) {
+    const size_t side = std::max<size_t>(2, static_cast<size_t>(std::sqrt(triangles / 2.0)));
+    Mesh mesh;
+    for (size_t y = 0; y <= side; ++y) {
+        for (size_t x = 0; x <= side; ++x) {
+            const float u = static_cast<float>(x) / side;
+            const float v = static_cast<float>(y) / side;
+            const float height = 0.1f * std::sin(20.0f * u) * std::cos(20.0f * v);
+            const float du = 2.0f * std::cos(20.0f * u) * std::cos(20.0f * v);
+            const float dv = -2.0f * std::sin(20.0f * u) * std::sin(20.0f * v);
+            const float length = std::sqrt(du * du + dv * dv + 1.0f);
+            mesh.positions.insert(mesh.positions.end(), {u, v, height});
+            mesh.normals.insert(mesh.normals.end(), {-du / length, -dv / length, 1.0f / length});
+            mesh.colors.insert(mesh.colors.end(), {u, v, 0.5f + 5.0f * height, 1.0f});
+        }
+    }
+    const uint32_t row = static_cast<uint32_t>(side + 1);
+    for (size_t y = 0; y < side; ++y) {
+        for (size_t x = 0; x < side; ++x) {
+            const uint32_t i = static_cast<uint32_t>(y * row + x);
+            mesh.indices.insert(mesh.indices.end(), {i, i + 1, i + row + 1, i, i + row + 1, i + row});
+        }
+    }
+    return mesh;
+}
+
+void writeObj(std::FILE *file, const Mesh &mesh) {
+    for (size_t v = 0; v < mesh.vertexCount(); ++v) {
+        const float *p = &mesh.positions[v * 3], *c = &mesh.colors[v * 4];
+        std::fprintf(file, "v %.6f %.6f %.6f %.4f %.4f %.4f\n", p[0], p[1], p[2], c[0], c[1], c[2]);
+    }
+    for (size_t v = 0; v < mesh.vertexCount(); ++v) {
+        const float *n = &mesh.normals[v * 3];
+        std::fprintf(file, "vn %.5f %.5f %.5f\n", n[0], n[1], n[2]);
+    }
+    for (size_t t = 0; t < mesh.triangleCount(); ++t) {
+        const uint32_t *i = &mesh.indices[t * 3];
+        std::fprintf(file, "f %u//%u %u//%u %u//%u\n", i[0] + 1, i[0] + 1, i[1] + 1, i[1] + 1, i[2] + 1, i[2] + 1);
+    }
+}
+
+void writePly(std::FILE *file, const Mesh &mesh, bool binary) {
+    std::fprintf(file,
+                 "ply\nformat %s 1.0\nelement vertex %zu\n"
+                 "property float x\nproperty float y\nproperty float z\n"
+                 "property float nx\nproperty float ny\nproperty float nz\n"
+                 "property uchar red\nproperty uchar green\nproperty uchar blue\n"
+                 "element face %zu\nproperty list uchar uint vertex_indices\nend_header\n",
+                 binary ? "binary_little_endian" : "ascii", mesh.vertexCount(), mesh.triangleCount());
+
+    for (size_t v = 0; v < mesh.vertexCount(); ++v) {
+        const float *p = &mesh.positions[v * 3], *n = &mesh.normals[v * 3];
+        unsigned char rgb[3];
+        for (int i = 0; i < 3; ++i)
+            rgb[i] = static_cast<unsigned char>(std::clamp(mesh.colors[v * 4 + i], 0.0f, 1.0f) * 255.0f + 0.5f);
+        if (!binary) {
+            std::fprintf(file, "%.6f %.6f %.6f %.5f %.5f %.5f %u %u %u\n", p[0], p[1], p[2], n[0], n[1], n[2], rgb[0],
+                         rgb[1], rgb[2]);
+            continue;
+        }
+        // The format is little endian, like every machine this runs on
+        std::fwrite(p, sizeof(float), 3, file);
+        std::fwrite(n, sizeof(float), 3, file);
+        std::fwrite(rgb, 1, 3, file);
+    }
+    for (size_t t = 0; t < mesh.triangleCount(); ++t) {
+        const uint32_t *i = &mesh.indices[t * 3];
+        if (!binary) {
+            std::fprintf(file, "3 %u %u %u\n", i[0], i[1], i[2]);
+            continue;
+        }
+        const unsigned char corners = 3;
+        std::fwrite(&corners, 1, 1, file);
+        std::fwrite(i, sizeof(uint32_t), 3, file);
+    }
+}
+
+/*
+    One mesh under a scaled root node, colors as normalized bytes like most exporters write them
+*/
+void writeGlb(std::FILE *file, const Mesh &mesh) {
+    std::vector<uint8_t> colors(mesh.vertexCount() * 4);
+    for (size_t i = 0; i < colors.size(); ++i)
+        colors[i] = static_cast<uint8_t>(std::clamp(mesh.colors[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+
+    const size_t positionBytes = mesh.positions.size() * sizeof(float);
+    const size_t colorOffset = positionBytes * 2, indexOffset = colorOffset + colors.size();
+    const size_t binarySize = indexOffset + mesh.indices.size() * sizeof(uint32_t);
+
+    std::ostringstream json;
+    json << R"({"asset":{"version":"2.0","generator":"meshload"},"scene":0,"scenes":[{"nodes":[0]}],)"
+         << R"("nodes":[{"name":"root","scale":[2,2,2],"children":[1]},{"name":"scan","mesh":0,"translation":[-0.5,-0.5,0]}],)"
+         << R"("meshes":[{"name":"scan","primitives":[{"attributes":{"POSITION":0,"NORMAL":1,"COLOR_0":2},"indices":3}]}],)"
+         << R"("buffers":[{"byteLength":)" << binarySize << "}],"
+         << R"("bufferViews":[{"buffer":0,"byteLength":)" << positionBytes * 2 << R"(,"byteStride":12},)"
+         << R"({"buffer":0,"byteOffset":)" << colorOffset << R"(,"byteLength":)" << colors.size() << "},"
+         << R"({"buffer":0,"byteOffset":)" << indexOffset << R"(,"byteLength":)" << binarySize - indexOffset << "}],"
+         << R"("accessors":[{"bufferView":0,"componentType":5126,"count":)" << mesh.vertexCount() << R"(,"type":"VEC3"},)"
+         << R"({"bufferView":0,"byteOffset":)" << positionBytes << R"(,"componentType":5126,"count":)" << mesh.vertexCount()
+         << R"(,"type":"VEC3"},)"
+         << R"({"bufferView":1,"componentType":5121,"normalized":true,"count":)" << mesh.vertexCount() << R"(,"type":"VEC4"},)"
+         << R"({"bufferView":2,"componentType":5125,"count":)" << mesh.indices.size() << R"(,"type":"SCALAR"}]})";
+    std::string text = json.str();
+    text.resize((text.size() + 3) / 4 * 4, ' ');
+    const size_t paddedBinary = (binarySize + 3) / 4 * 4;
+
+    auto writeWord = [&](uint32_t word) { std::fwrite(&word, sizeof(word), 1, file); };
+    writeWord(0x46546C67);
+    writeWord(2);
+    writeWord(static_cast<uint32_t>(12 + 8 + text.size() + 8 + paddedBinary));
+    writeWord(static_cast<uint32_t>(text.size()));
+    writeWord(0x4E4F534A);
+    std::fwrite(text.data(), 1, text.size(), file);
+    writeWord(static_cast<uint32_t>(paddedBinary));
+    writeWord(0x004E4942);
+    std::fwrite(mesh.positions.data(), 1, positionBytes, file);
+    std::fwrite(mesh.normals.data(), 1, positionBytes, file);
+    std::fwrite(colors.data(), 1, colors.size(), file);
+    std::fwrite(mesh.indices.data(), sizeof(uint32_t), mesh.indices.size(), file);
+    std::fwrite("\0\0\0", 1, paddedBinary - binarySize, file);
+}
+
+void writeScan(const std::string &fileName, size_t triangles, bool binary) {
+    const Mesh mesh = makeScan(triangles);
+    std::FILE *file = std::fopen(fileName.c_str(), "wb");
+    if (!file)
+        throw std::runtime_error("Failed to write mesh file: " + fileName);
+    if (endsWith(fileName, ".obj"))
+        writeObj(file, mesh);
+    else if (endsWith(fileName, ".glb"))
+        writeGlb(file, mesh);
+    else
+        writePly(file, mesh, binary);
+    std::fclose(file);
+    std::cout << "Wrote " << mesh.vertexCount() << " vertices, " << mesh.triangleCount() << " triangles to "
+              << fileName << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2 || (std::string(argv[1]) == "--write" && argc < 4)) {
+        std::cerr << "Usage: meshload <file.obj|.ply|.glb|.mesh> [repeat]\n"
+                     "       meshload --write <file.obj|.ply|.glb> <triangles> [ascii|binary]"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        if (std::string(argv[1]) == "--write") {
+            writeScan(argv[2], std::stoul(argv[3]), argc < 5 || std::string(argv[4]) != "ascii");
+            return EXIT_SUCCESS;
+        }
+
+        const std::string fileName = argv[1];
+        const int repeat = argc > 2 ? std::max(1, std::stoi(argv[2])) : 3;
+        const double megabytes = static_cast<double>(MappedFile(fileName).size()) / (1024.0 * 1024.0);
+
+        // The first run also pulls the file into the page cache, the best run measures parsing
+        double best = 0.0;
+        Mesh mesh;
+        for (int i = 0; i < repeat; ++i) {
+            const auto start = Clock::now();
+            mesh = loadMesh(fileName);
+            const double milliseconds = millisecondsSince(start);
+            best = i == 0 ? milliseconds : std::min(best, milliseconds);
+            std::cout << "Run " << i + 1 << ": " << milliseconds << " ms" << std::endl;
+        }
+
+        std::cout << mesh.vertexCount() << " vertices, " << mesh.triangleCount() << " triangles"
+                  << (mesh.normals.empty() ? "" : ", normals") << (mesh.colors.empty() ? "" : ", colors") << std::endl;
+        // Opening a glTF asset only parses its JSON, the rest of the time is reading vertex data
+        if (endsWith(fileName, ".glb") || endsWith(fileName, ".gltf")) {
+            const auto start = Clock::now();
+            const GltfAsset asset(fileName);
+            std::cout << "glTF header parsed in " << millisecondsSince(start) << " ms, "
+                      << asset.getBufferBytes() / (1024.0 * 1024.0) << " MB of buffers mapped, "
+                      << asset.getSceneNodes().size() << " nodes" << std::endl;
+        }
+        // Opening a .mesh file only checks its tables, raw sections could be uploaded from there
+        if (endsWith(fileName, ".mesh")) {
+            const auto start = Clock::now();
+            const MeshFile file(fileName);
+            std::cout << ".mesh opened in " << millisecondsSince(start) << " ms, " << file.getHeader().lodCount
+                      << " levels of detail, " << file.getHeader().meshletCount << " meshlets" << std::endl;
+        }
+        std::cout << megabytes << " MB in " << best << " ms: " << megabytes / (best / 1000.0) << " MB/s ("
+                  << ThreadPool::shared().size() << " threads)" << std::endl;
+    }
+    catch (const std::exception &e) {
+        std::cerr << "Error from meshload: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
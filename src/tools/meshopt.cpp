@@ -0,0 +1,192 @@
+/*
+-------------------------------------------------------------------
+  meshopt  ----------------------------------------------------------
+
+  Runs the mesh optimization passes on a mesh and reports post-transform
+  cache statistics (ACMR / ATVR) before and after, plus the time each pass took.
+
+    meshopt [options] <input.obj|.ply> [output.obj]
+    meshopt [options] --grid <triangles>    Synthetic shuffled grid, for benchmarking
+    meshopt [options] --soup <triangles>    The same grid with 3 unshared vertices per
+                                            triangle, for benchmarking welding
+
+  Options:
+    --weld <epsilon>    Merge duplicate vertices first, 0 merges bit-identical vertices only
+    --lod               Build levels of detail at 1/2, 1/4, 1/8 and 1/16 of the triangles
+-------------------------------------------------------------------
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "../MeshLoader/meshLoader.h"
+#include "../MeshOptimizer/meshOptimizer.h"
+#include "../common/ThreadPool.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void writeObj(const std::string &fileName, const Mesh &mesh) {
+    std::ofstream file(fileName);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to write mesh file: " + fileName);
+
+    for (size_t v = 0; v < mesh.vertexCount(); ++v)
+        file << "v " << mesh.positions[v * 3] << ' ' << mesh.positions[v * 3 + 1] << ' ' << mesh.positions[v * 3 + 2]
+             << '\n';
+    for (size_t t = 0; t < mesh.triangleCount(); ++t)
+        file << "f " << mesh.indices[t * 3] + 1 << ' ' << mesh.indices[t * 3 + 1] + 1 << ' '
+             << mesh.indices[t * 3 + 2] + 1 << '\n';
+}
+
+/*
+    A wavy grid with its triangles shuffled - worst case input for the cache
+*/
+Mesh makeShuffledGrid(size_t triangles) {
+    const size_t side = std::max<size_t>(2, static_cast<size_t>(std::sqrt(triangles / 2.0)));
+    Mesh mesh;
+    for (size_t y = 0; y <= side; ++y) {
+        for (size_t x = 0; x <= side; ++x) {
+            const float u = static_cast<float>(x) / side;
+            const float v = static_cast<float>(y) / side;
+            mesh.positions.insert(mesh.positions.end(), {u, v, 0.1f * std::sin(20.0f * u) * std::cos(20.0f * v)});
+        }
+    }
+
+    std::vector<uint32_t> quads;
+    for (size_t y = 0; y < side; ++y) {
+        for (size_t x = 0; x < side; ++x) {
+            const uint32_t i = static_cast<uint32_t>(y * (side + 1) + x);
+            const uint32_t row = static_cast<uint32_t>(side + 1);
+            mesh.indices.insert(mesh.indices.end(), {i, i + 1, i + row + 1, i, i + row + 1, i + row});
+        }
+    }
+
+    // Shuffle whole triangles
+    std::vector<uint32_t> order(mesh.triangleCount());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = static_cast<uint32_t>(i);
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+    std::vector<uint32_t> shuffled(mesh.indices.size());
+    for (size_t t = 0; t < order.size(); ++t)
+        std::copy_n(mesh.indices.begin() + order[t] * 3, 3, shuffled.begin() + t * 3);
+    mesh.indices.swap(shuffled);
+    return mesh;
+}
+
+/*
+    Every triangle gets its own copy of its vertices, as in an STL file
+*/
+Mesh makeSoup(size_t triangles) {
+    const Mesh grid = makeShuffledGrid(triangles);
+    Mesh soup;
+    soup.positions.resize(grid.indices.size() * 3);
+    soup.indices.resize(grid.indices.size());
+    for (size_t i = 0; i < grid.indices.size(); ++i) {
+        std::copy_n(&grid.positions[grid.indices[i] * 3], 3, &soup.positions[i * 3]);
+        soup.indices[i] = static_cast<uint32_t>(i);
+    }
+    return soup;
+}
+
+void printStats(const char *label, const Mesh &mesh) {
+    const VertexCacheStats stats = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount());
+    std::cout << label << ": ACMR " << stats.acmr << ", ATVR " << stats.atvr << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    int arg = 1;
+    bool weld = false, lod = false;
+    WeldOptions weldOptions;
+    while (arg < argc) {
+        const std::string option = argv[arg];
+        if (option == "--weld" && arg + 1 < argc) {
+            weld = true;
+            weldOptions.positionEpsilon = std::stof(argv[arg + 1]);
+            arg += 2;
+        } else if (option == "--lod") {
+            lod = true;
+            ++arg;
+        } else {
+            break;
+        }
+    }
+
+    if (argc <= arg) {
+        std::cerr << "Usage: meshopt [--weld <epsilon>] [--lod] <input.obj|.ply> [output.obj]\n"
+                     "       meshopt [--weld <epsilon>] [--lod] --grid|--soup <triangles>"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        Mesh mesh;
+        std::string output;
+
+        auto start = Clock::now();
+        const std::string input = argv[arg];
+        if (input == "--grid" || input == "--soup") {
+            const size_t triangles = argc > arg + 1 ? std::stoul(argv[arg + 1]) : 1000000;
+            mesh = input == "--grid" ? makeShuffledGrid(triangles) : makeSoup(triangles);
+        } else {
+            mesh = loadMesh(input);
+            if (argc > arg + 1)
+                output = argv[arg + 1];
+        }
+        std::cout << mesh.vertexCount() << " vertices, " << mesh.triangleCount() << " triangles ("
+                  << millisecondsSince(start) << " ms to load)" << std::endl;
+
+        if (weld) {
+            start = Clock::now();
+            const WeldResult result = weldVertices(mesh, weldOptions);
+            std::cout << "Weld: " << result.verticesBefore << " -> " << result.verticesAfter << " vertices, "
+                      << result.trianglesRemoved << " degenerate triangles removed (" << millisecondsSince(start)
+                      << " ms, " << ThreadPool::shared().size() << " threads)" << std::endl;
+        }
+        printStats("Input", mesh);
+
+        std::vector<uint32_t> indices(mesh.indices.size());
+        start = Clock::now();
+        optimizeVertexCache(indices.data(), mesh.indices.data(), mesh.indices.size(), mesh.vertexCount());
+        const double cacheTime = millisecondsSince(start);
+        const VertexCacheStats cacheStats = analyzeVertexCache(indices.data(), indices.size(), mesh.vertexCount());
+        std::cout << "Vertex cache: ACMR " << cacheStats.acmr << ", ATVR " << cacheStats.atvr << " (" << cacheTime
+                  << " ms)" << std::endl;
+
+        start = Clock::now();
+        optimizeMesh(mesh);
+        std::cout << "Full pipeline (cache + overdraw + fetch): " << millisecondsSince(start) << " ms" << std::endl;
+        printStats("Output", mesh);
+
+        if (lod) {
+            start = Clock::now();
+            const LodChain chain = generateLodChain(mesh, {0.5f, 0.25f, 0.125f, 0.0625f});
+            std::cout << "Levels of detail (" << millisecondsSince(start) << " ms, " << ThreadPool::shared().size()
+                      << " threads):" << std::endl;
+            for (size_t i = 0; i < chain.levels.size(); ++i)
+                std::cout << "  LOD " << i << ": " << chain.levels[i].indexCount / 3 << " triangles, error "
+                          << chain.levels[i].error << std::endl;
+        }
+
+        if (!output.empty())
+            writeObj(output, mesh);
+    }
+    catch (const std::exception &e) {
+        std::cerr << "Error from meshopt: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+/*
+-------------------------------------------------------------------
+  quantbench  -------------------------------------------------------
+
+  Measures the vertex quantization encoders (common/VertexQuantization.h): snorm16 and half
+  positions and RGBA8 colors, the SIMD path this build and CPU take against the scalar one.
+  Both must stay within positionErrorBound() and agree to one step (they may round ties
+  differently).
+
+    quantbench [vertices] [rounds]      defaults 4000000 vertices, 10 rounds, best round reported
+-------------------------------------------------------------------
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../common/VertexQuantization.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+template <typename Encode>
+double best(size_t rounds, Encode encode) {
+    double milliseconds = 1e30;
+    for (size_t round = 0; round < rounds; ++round) {
+        const auto start = Clock::now();
+        encode();
+        milliseconds = std::min(milliseconds, millisecondsSince(start));
+    }
+    return milliseconds;
+}
+
+// Largest difference between two encodings, in steps of the stored integer or half bits
+template <typename T>
+uint32_t maxStepDifference(const std::vector<T> &a, const std::vector<T> &b) {
+    uint32_t worst = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+        worst = std::max<uint32_t>(worst, std::abs(int32_t(int16_t(a[i])) - int32_t(int16_t(b[i]))));
+    return worst;
+}
+
+uint32_t maxByteDifference(const std::vector<uint32_t> &a, const std::vector<uint32_t> &b) {
+    uint32_t worst = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+        for (int shift = 0; shift < 32; shift += 8)
+            worst = std::max<uint32_t>(worst, std::abs(int32_t((a[i] >> shift) & 0xff) - int32_t((b[i] >> shift) & 0xff)));
+    return worst;
+}
+
+void report(const char *name, double scalar, double simd, size_t count, const char *path) {
+    std::cout << name << "scalar " << scalar << " ms, " << path << " " << simd << " ms, "
+              << count / (simd * 1e3) << " M vertices/s, " << scalar / simd << "x" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    try {
+        const size_t count = argc > 1 ? std::stoul(argv[1]) : 4000000;
+        const size_t rounds = argc > 2 ? std::max<size_t>(1, std::stoul(argv[2])) : 10;
+
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> coordinate(-50.0f, 50.0f), unit(-0.1f, 1.1f);
+        std::vector<float> positions(count * 4), colors(count * 4);
+        for (size_t i = 0; i < count; ++i) {
+            for (int c = 0; c < 3; ++c)
+                positions[i * 4 + c] = coordinate(random);
+            positions[i * 4 + 3] = 1.0f;
+            for (int c = 0; c < 4; ++c)
+                colors[i * 4 + c] = unit(random);        // Some out of range, they clamp
+        }
+
+        std::cout << count << " vertices, best of " << rounds << " rounds" << std::endl;
+        for (VertexFormat format : {VertexFormat::Snorm16, VertexFormat::Half}) {
+            const QuantizationParams params = computeQuantization(positions.data(), count, format);
+            std::vector<uint16_t> scalar(count * 4), simd(count * 4);
+            float scalarError = 0.0f, simdError = 0.0f;
+            const double scalarTime = best(rounds, [&] {
+                scalarError = encodePositionsScalar(positions.data(), count, params, scalar.data());
+            });
+            const double simdTime = best(rounds, [&] {
+                simdError = encodePositions(positions.data(), count, params, simd.data());
+            });
+
+            const float bound = positionErrorBound(params);
+            if (scalarError > bound || simdError > bound)
+                throw std::runtime_error("Position error above positionErrorBound()");
+            if (maxStepDifference(scalar, simd) > 1)
+                throw std::runtime_error("SIMD and scalar positions differ by more than a step");
+            report(format == VertexFormat::Half ? "  half positions:     " : "  snorm16 positions:  ", scalarTime,
+                   simdTime, count, positionEncoderName(format));
+        }
+
+        std::vector<uint32_t> scalar(count), simd(count);
+        const double scalarTime = best(rounds, [&] { encodeColorsScalar(colors.data(), count, scalar.data()); });
+        const double simdTime = best(rounds, [&] { encodeColors(colors.data(), count, simd.data()); });
+        if (maxByteDifference(scalar, simd) > 1)
+            throw std::runtime_error("SIMD and scalar colors differ by more than a step");
+        report("  RGBA8 colors:       ", scalarTime, simdTime, count, positionEncoderName(VertexFormat::Snorm16));
+    }
+    catch (const std::exception &e) {
+        std::cerr << "Error from quantbench: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
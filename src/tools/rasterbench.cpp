@@ -0,0 +1,116 @@
+/*
+-------------------------------------------------------------------
+  rasterbench  ------------------------------------------------------
+
+  Renders a field of procedural shapes with the software backend (backend/SoftwareDevice.h)
+  on 1, 2, 4, ... threads up to the machine's, and reports triangles and pixels per second
+  for each. Every thread count must produce the same image.
+
+    rasterbench [shapes] [frames] [size]    defaults 400 shapes, 10 frames, 1024 pixels square
+
+  Shapes are spheres, cubes, cylinders and tori of 16 segments, about 300 triangles each.
+-------------------------------------------------------------------
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <eigen/Eigen/Dense>
+
+#include "../renderer.h"
+#include "../backend/SoftwareDevice.h"
+#include "../MeshGenerator/proceduralShapes.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+Mesh makeField(size_t count) {
+    const size_t side = std::max<size_t>(1, static_cast<size_t>(std::ceil(std::sqrt(double(count)))));
+    std::vector<ShapeInstance> field;
+    for (size_t i = 0; i < count; ++i) {
+        ShapeInstance instance;
+        instance.shape.type = static_cast<ShapeType>(i % 5);   // Spheres, cubes, cylinders and tori
+        instance.shape.segments = instance.shape.type == ShapeType::Icosphere ? 2 : 16;
+        const Eigen::Affine3f placement =
+            Eigen::Translation3f((2.0f * (i % side) + 1.0f) / side - 1.0f, (2.0f * (i / side) + 1.0f) / side - 1.0f, 0.5f) *
+            Eigen::AngleAxisf(0.4f * i, Eigen::Vector3f(1, 1, 0).normalized()) * Eigen::Scaling(1.2f / side);
+        Eigen::Map<Eigen::Matrix4f>(instance.transform.data()) = placement.matrix();
+        instance.color = {0.3f + 0.7f * (i % side) / side, 0.3f + 0.7f * (i / side) / side, 0.8f, 1.0f};
+        field.push_back(instance);
+    }
+    return generateShapes(field);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    try {
+        const size_t shapes = argc > 1 ? std::stoul(argv[1]) : 400;
+        const size_t frames = argc > 2 ? std::max<size_t>(1, std::stoul(argv[2])) : 10;
+        const uint32_t size = argc > 3 ? static_cast<uint32_t>(std::stoul(argv[3])) : 1024;
+        const Mesh field = makeField(shapes);
+
+        std::vector<size_t> threadCounts{1};
+        const size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+        while (threadCounts.back() * 2 <= hardware)
+            threadCounts.push_back(threadCounts.back() * 2);
+        if (threadCounts.back() != hardware)
+            threadCounts.push_back(hardware);
+
+        std::vector<uint32_t> reference;
+        for (size_t threads : threadCounts) {
+            ThreadPool pool(threads);
+            SoftwareDevice device(size, size, true, pool);
+            Renderer renderer(device);
+
+            std::ostringstream quiet;
+            std::streambuf *console = std::cout.rdbuf(quiet.rdbuf());
+            renderer.addMesh(new MeshPrimitive(&device, field));
+            std::cout.rdbuf(console);
+
+            renderer.renderFrame();     // Builds the draw list
+            device.resetStats();
+            double best = 1e30;
+            for (size_t frame = 0; frame < frames; ++frame) {
+                const auto start = Clock::now();
+                renderer.renderFrame();
+                best = std::min(best, millisecondsSince(start));
+            }
+
+            const std::vector<uint32_t> pixels = device.readPixels();
+            if (reference.empty())
+                reference = pixels;
+            else if (pixels != reference)
+                throw std::runtime_error("The image depends on the thread count");
+
+            const RasterStats &stats = device.getStats();
+            const double triangles = double(stats.triangles) / frames;
+            const double written = double(stats.pixels) / frames;
+            std::cout << threads << (threads == 1 ? " thread:  " : " threads: ") << best << " ms/frame, "
+                      << triangles / (best * 1e3) << " M triangles/s, " << written / (best * 1e3)
+                      << " M pixels/s" << std::endl;
+            if (threads == threadCounts.back())
+                std::cout << "  " << triangles << " triangles, " << double(stats.clipped) / frames << " clipped, "
+                          << double(stats.binned) / frames << " tile bins, " << written << " pixels written, "
+                          << size << "x" << size << std::endl;
+        }
+    }
+    catch (const std::exception &e) {
+        std::cerr << "Error from rasterbench: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
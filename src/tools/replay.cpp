@@ -0,0 +1,113 @@
+/*
+-------------------------------------------------------------------
+  replay  -----------------------------------------------------------
+
+  Replays a command capture (backend/CaptureDevice.h) headless in a timing loop, a benchmark
+  of submission cost that doesn't depend on the scene code that produced it.
+
+    replay <capture> [iterations] [null|software]     defaults 100 iterations, null
+
+  null       RecordingDevice without capture, times submission alone
+  software   SoftwareDevice at the captured size, rasterizes every frame too
+
+  Before timing, one replay on a recording device checks the replay emits exactly the
+  captured binds and draws.
+
+  Captures come from framebench (framebench 10000 100 scene.gfxcap) or from
+  Transformations --headless --capture scene.gfxcap, which captures every frame it renders.
+-------------------------------------------------------------------
+*/
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "../backend/CaptureReplayer.h"
+#include "../backend/RecordingDevice.h"
+#include "../backend/SoftwareDevice.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Replays once on a recording device and compares its commands with the capture's
+void checkStream(const GfxCapture &capture) {
+    std::array<uint64_t, gfxCommandTypeCount> captured{};
+    for (const CapturedCommand &command : capture.commands)
+        ++captured[static_cast<size_t>(command.type)];
+
+    RecordingDevice device(capture.width, capture.height, false);
+    {
+        CaptureReplayer replayer(capture, device);
+        replayer.replay();
+    }
+    for (GfxCommandType type : {GfxCommandType::BeginFrame, GfxCommandType::UpdateBuffer, GfxCommandType::BeginPass,
+                                GfxCommandType::SetPipeline, GfxCommandType::SetVertexBuffer,
+                                GfxCommandType::SetVertexBufferOffset, GfxCommandType::SetVertexBytes,
+                                GfxCommandType::Draw, GfxCommandType::DrawIndexed, GfxCommandType::EndPass,
+                                GfxCommandType::EndFrame}) {
+        const size_t slot = static_cast<size_t>(type);
+        if (device.getStats().counts[slot] != captured[slot])
+            throw std::runtime_error(std::string("The replay's ") + gfxCommandName(type) + " calls differ from the capture: " +
+                                     std::to_string(device.getStats().counts[slot]) + " instead of " +
+                                     std::to_string(captured[slot]));
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    try {
+        if (argc < 2) {
+            std::cerr << "Usage: replay <capture> [iterations] [null|software]" << std::endl;
+            return EXIT_FAILURE;
+        }
+        const size_t iterations = argc > 2 ? std::max<size_t>(1, std::stoul(argv[2])) : 100;
+        const std::string deviceName = argc > 3 ? argv[3] : "null";
+
+        const GfxCapture capture = GfxCapture::load(argv[1]);
+        size_t contents = 0;
+        for (const CapturedBuffer &buffer : capture.buffers)
+            contents += !buffer.contents.empty();
+        std::cout << argv[1] << ": " << capture.frames << " frames at " << capture.width << "x" << capture.height << ", "
+                  << capture.commands.size() << " commands, " << capture.pipelines.size() << " pipelines, "
+                  << capture.buffers.size() << " buffers (" << contents << " with contents), " << capture.payload.size()
+                  << " payload bytes" << std::endl;
+        checkStream(capture);
+
+        std::unique_ptr<GfxDevice> device;
+        if (deviceName == "null")
+            device = std::make_unique<RecordingDevice>(capture.width, capture.height, false);
+        else if (deviceName == "software")
+            device = std::make_unique<SoftwareDevice>(std::max(capture.width, 1u), std::max(capture.height, 1u));
+        else
+            throw std::runtime_error("Unknown device: " + deviceName);
+
+        CaptureReplayer replayer(capture, *device);
+        replayer.replay();      // Warm up
+        double best = 1e30, total = 0.0;
+        for (size_t i = 0; i < iterations; ++i) {
+            const auto start = Clock::now();
+            replayer.replay();
+            const double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            best = std::min(best, milliseconds);
+            total += milliseconds;
+        }
+
+        const double frames = std::max<uint32_t>(replayer.getFrameCount(), 1);
+        std::cout << device->getName() << " device, " << iterations << " iterations of " << replayer.getFrameCount()
+                  << " frames, " << replayer.getDrawCount() / frames << " draws per frame" << std::endl;
+        std::cout << "  frame:  best " << best / frames << " ms, mean " << total / (iterations * frames) << " ms, "
+                  << best * 1e6 / std::max<size_t>(replayer.getDrawCount(), 1) << " ns/draw" << std::endl;
+    }
+    catch (const std::exception &e) {
+        std::cerr << "Error from replay: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,131 @@
+/*
+-------------------------------------------------------------------
+  scenebench  -------------------------------------------------------
+
+  Measures the scene store (common/SceneStore.h): how fast entities are created and
+  destroyed, and how fast a system runs over them in parallel chunks.
+
+    scenebench [entities] [rounds]      defaults 100000 entities, 10 churn rounds
+
+  Each churn round destroys a random half of the entities and creates as many again, mixing
+  two archetypes. Every transform is then moved with setTransform(), and the system turns each
+  bounding sphere into world space, the usual per-frame work before culling.
+-------------------------------------------------------------------
+*/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../common/SceneStore.h"
+#include "../common/ThreadPool.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+constexpr ComponentMask drawable = TransformComponent | GeometryComponent | BoundsComponent | VisibilityComponent;
+constexpr ComponentMask colored = drawable | ColorComponent;
+
+} // namespace
+
+int main(int argc, char **argv) {
+    try {
+        const size_t count = argc > 1 ? std::stoul(argv[1]) : 100000;
+        const size_t rounds = argc > 2 ? std::stoul(argv[2]) : 10;
+        std::mt19937 random(1);
+
+        SceneStore scene;
+        std::vector<Entity> entities;
+        auto start = Clock::now();
+        scene.create(drawable, count / 2, entities);
+        scene.create(colored, count - count / 2, entities);
+        const double createMilliseconds = millisecondsSince(start);
+        for (size_t i = 0; i < entities.size(); ++i) {
+            scene.geometry(entities[i]) = static_cast<uint32_t>(i);
+            scene.bounds(entities[i]) = {0.0f, 0.0f, 0.0f, 1.0f};
+        }
+
+        // Churn, stale handles must all be caught
+        std::vector<Entity> destroyed;
+        size_t churned = 0;
+        start = Clock::now();
+        for (size_t round = 0; round < rounds; ++round) {
+            std::shuffle(entities.begin(), entities.end(), random);
+            const size_t half = entities.size() / 2;
+            for (size_t i = half; i < entities.size(); ++i)
+                scene.destroy(entities[i]);
+            destroyed.assign(entities.begin() + half, entities.end());
+            entities.resize(half);
+            for (size_t i = half; i < count; ++i)
+                entities.push_back(scene.create(i % 2 ? colored : drawable));
+            churned += 2 * (count - half);
+        }
+        const double churnMilliseconds = millisecondsSince(start);
+        for (const Entity &entity : destroyed)
+            if (scene.isAlive(entity))
+                throw std::runtime_error("A destroyed handle still resolves");
+
+        // Move everything, then compute world space bounds, a few times to warm up
+        std::vector<Sphere> world(count);     // By entity index, slots are reused so there are never more
+        double moveMilliseconds = 1e30, systemMilliseconds = 1e30;
+        for (int repeat = 0; repeat < 5; ++repeat) {
+            start = Clock::now();
+            for (const Entity &entity : entities) {
+                Matrix4 m = scene.transform(entity);
+                m[12] += 0.001f;
+                scene.setTransform(entity, m);
+            }
+            if (scene.getDirtyTransforms().size() != scene.size())
+                throw std::runtime_error("Moved entities must be listed once each");
+            scene.clearDirtyTransforms();
+            moveMilliseconds = std::min(moveMilliseconds, millisecondsSince(start));
+
+            std::atomic<size_t> visited{0};
+            start = Clock::now();
+            scene.forEachChunk(TransformComponent | BoundsComponent, [&](const SceneChunk &chunk) {
+                for (size_t i = 0; i < chunk.count; ++i) {
+                    const Matrix4 &m = chunk.transforms[i];
+                    const Sphere &b = chunk.bounds[i];
+                    const float scale = std::max({m[0] * m[0] + m[1] * m[1] + m[2] * m[2],
+                                                  m[4] * m[4] + m[5] * m[5] + m[6] * m[6],
+                                                  m[8] * m[8] + m[9] * m[9] + m[10] * m[10]});
+                    world[chunk.entities[i].index] = {
+                        m[0] * b[0] + m[4] * b[1] + m[8] * b[2] + m[12],
+                        m[1] * b[0] + m[5] * b[1] + m[9] * b[2] + m[13],
+                        m[2] * b[0] + m[6] * b[1] + m[10] * b[2] + m[14], b[3] * std::sqrt(scale)};
+                }
+                visited += chunk.count;
+            });
+            systemMilliseconds = std::min(systemMilliseconds, millisecondsSince(start));
+            if (visited != scene.size())
+                throw std::runtime_error("The system missed entities");
+        }
+
+        std::cout << scene.size() << " entities, " << ThreadPool::shared().size() << " threads" << std::endl;
+        std::cout << "  create:  " << createMilliseconds << " ms, " << count / (createMilliseconds * 1000.0)
+                  << " M entities/s" << std::endl;
+        std::cout << "  churn:   " << churnMilliseconds << " ms for " << churned << " creates and destroys, "
+                  << churned / (churnMilliseconds * 1000.0) << " M/s" << std::endl;
+        std::cout << "  move:    " << moveMilliseconds << " ms, " << moveMilliseconds * 1e6 / scene.size()
+                  << " ns/entity through setTransform()" << std::endl;
+        std::cout << "  system:  " << systemMilliseconds << " ms, " << systemMilliseconds * 1e6 / scene.size()
+                  << " ns/entity" << std::endl;
+    }
+    catch (const std::exception &e) {
+        std::cerr << "Error from scenebench: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,170 @@
+/*
+    Batch inverse and normal matrix kernels (common/AffineBatch.h) and affineMultiply() and
+    affineInverse() (common/Transform.h) against Eigen in double precision, general and rigid,
+    and the AVX2 kernels against the baseline ones on CPUs that have it
+*/
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "common/AffineBatchKernels.h"
+#include "TestCheck.h"
+
+namespace {
+
+constexpr double maxRelativeError = 1e-5;
+constexpr size_t objectCount = 1003;        // Not a multiple of 8, the last step runs over padding
+
+AffineMatrix randomAffine(std::mt19937 &random, bool rigid) {
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f), scale(0.5f, 2.0f);
+    const Eigen::Quaternionf rotation =
+        Eigen::Quaternionf(unit(random), unit(random), unit(random), unit(random)).normalized();
+    Eigen::Affine3f matrix = Eigen::Translation3f(10.0f * unit(random), 10.0f * unit(random), 10.0f * unit(random)) *
+                             rotation;
+    if (!rigid)
+        matrix = matrix * Eigen::Scaling(scale(random), scale(random), scale(random));
+    return matrix.matrix().topRows<3>();
+}
+
+// Largest element difference over the largest element of the reference
+template <typename Result, typename Reference>
+double relativeError(const Result &result, const Reference &reference) {
+    return (result.template cast<double>() - reference).cwiseAbs().maxCoeff() / reference.cwiseAbs().maxCoeff();
+}
+
+struct Matrices {
+    std::vector<AffineMatrix> matrices;
+    AffineBatch batch;
+};
+
+Matrices randomMatrices(bool rigid) {
+    std::mt19937 random(rigid ? 2 : 1);
+    Matrices result;
+    result.batch.resize(objectCount);
+    for (size_t i = 0; i < objectCount; ++i) {
+        result.matrices.push_back(randomAffine(random, rigid));
+        result.batch.set(i, result.matrices.back());
+    }
+    return result;
+}
+
+void invertsLikeEigen() {
+    for (AffineKind kind : {AffineKind::General, AffineKind::Rigid}) {
+        const Matrices input = randomMatrices(kind == AffineKind::Rigid);
+        AffineBatch inverses;
+        invertAffineBatch(input.batch, inverses, kind);
+        CHECK(inverses.size() == objectCount);
+
+        double worst = 0.0;
+        for (size_t i = 0; i < objectCount; ++i) {
+            const Eigen::Matrix4d reference = expandAffine(input.matrices[i]).cast<double>().inverse();
+            worst = std::max(worst, relativeError(expandAffine(inverses.get(i)), reference));
+        }
+        CHECK(worst <= maxRelativeError);
+
+        // Padding holds identity, its inverse is identity again
+        for (size_t i = objectCount; i < inverses.paddedSize(); ++i)
+            CHECK(inverses.get(i) == AffineMatrix::Identity());
+    }
+}
+
+void buildsNormalMatricesLikeEigen() {
+    for (AffineKind kind : {AffineKind::General, AffineKind::Rigid}) {
+        const Matrices input = randomMatrices(kind == AffineKind::Rigid);
+        NormalMatrixBatch normals;
+        normalMatrixBatch(input.batch, normals, kind);
+        CHECK(normals.size() == objectCount);
+
+        double worst = 0.0;
+        for (size_t i = 0; i < objectCount; ++i) {
+            const Eigen::Matrix3d reference = input.matrices[i].leftCols<3>().cast<double>().inverse().transpose();
+            worst = std::max(worst, relativeError(normals.get(i), reference));
+        }
+        CHECK(worst <= maxRelativeError);
+    }
+}
+
+void multipliesAndInvertsSingleMatrices() {
+    const Matrices a = randomMatrices(false), b = randomMatrices(true);
+    double worstProduct = 0.0, worstInverse = 0.0;
+    for (size_t i = 0; i < objectCount; ++i) {
+        const AffineMatrix product = affineMultiply(a.matrices[i], b.matrices[i]);
+        const Eigen::Matrix4d reference =
+            expandAffine(a.matrices[i]).cast<double>() * expandAffine(b.matrices[i]).cast<double>();
+        worstProduct = std::max(worstProduct, relativeError(expandAffine(product), reference));
+        const Eigen::Matrix4d inverse = expandAffine(a.matrices[i]).cast<double>().inverse();
+        worstInverse = std::max(worstInverse, relativeError(expandAffine(affineInverse(a.matrices[i])), inverse));
+    }
+    CHECK(worstProduct <= maxRelativeError);
+    CHECK(worstInverse <= maxRelativeError);
+    CHECK(affineMultiply(a.matrices[0], affineInverse(a.matrices[0])).isApprox(AffineMatrix::Identity(), 1e-5f));
+}
+
+void detectsRigidMatrices() {
+    std::mt19937 random(3);
+    for (int i = 0; i < 100; ++i) {
+        CHECK(isRigid(randomAffine(random, true)));
+        CHECK(!isRigid(randomAffine(random, false)));
+    }
+
+    AffineMatrix mirrored = AffineMatrix::Identity();
+    mirrored(0, 0) = -1.0f;
+    CHECK(isRigid(mirrored));
+
+    AffineMatrix sheared = AffineMatrix::Identity();
+    sheared(0, 1) = 0.01f;
+    CHECK(!isRigid(sheared));
+    CHECK(isRigid(sheared, 0.1f));
+}
+
+template <uint32_t Rows, uint32_t Columns>
+std::array<float *, Rows * Columns> streams(MatrixBatch<Rows, Columns> &batch) {
+    std::array<float *, Rows * Columns> elements;
+    for (uint32_t e = 0; e < Rows * Columns; ++e)
+        elements[e] = batch.elements(e / Columns, e % Columns);
+    return elements;
+}
+
+// Same operations in the same order, they only differ if the build contracts them into FMAs
+void avx2MatchesBaseline() {
+    const AffineBatchKernels *avx2 = avx2AffineBatchKernels();
+    if (!avx2 || std::strcmp(affineBatchKernelName(), avx2->name) != 0) {
+        std::cout << "AVX2 kernels not built or not supported, comparing skipped" << std::endl;
+        return;
+    }
+    CHECK(affineBatchLanes() == 8);
+
+    const AffineBatchKernels &baseline = baselineAffineBatchKernels();
+    Matrices input = randomMatrices(false);
+    std::array<float *, 12> in = streams(input.batch);
+    for (AffineKind kind : {AffineKind::General, AffineKind::Rigid}) {
+        AffineBatch expected, actual;
+        expected.resize(objectCount);
+        actual.resize(objectCount);
+        baseline.invert(in.data(), streams(expected).data(), input.batch.paddedSize(), kind);
+        avx2->invert(in.data(), streams(actual).data(), input.batch.paddedSize(), kind);
+        for (size_t i = 0; i < objectCount; ++i)
+            CHECK(relativeError(actual.get(i), expected.get(i).cast<double>()) <= 1e-6);
+    }
+
+    NormalMatrixBatch expected, actual;
+    expected.resize(objectCount);
+    actual.resize(objectCount);
+    baseline.normals(in.data(), streams(expected).data(), input.batch.paddedSize());
+    avx2->normals(in.data(), streams(actual).data(), input.batch.paddedSize());
+    for (size_t i = 0; i < objectCount; ++i)
+        CHECK(relativeError(actual.get(i), expected.get(i).cast<double>()) <= 1e-6);
+}
+
+} // namespace
+
+int main() {
+    invertsLikeEigen();
+    buildsNormalMatricesLikeEigen();
+    multipliesAndInvertsSingleMatrices();
+    detectsRigidMatrices();
+    avx2MatchesBaseline();
+    return testResult();
+}
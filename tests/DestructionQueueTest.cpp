@@ -0,0 +1,102 @@
+/*
+    DestructionQueue (common/DestructionQueue.h) against simulated frame completions
+*/
+#include <string>
+#include <vector>
+
+#include "common/DestructionQueue.h"
+#include "TestCheck.h"
+
+namespace {
+
+// Counts its instances, for retireOwned()
+struct Owned {
+    static int alive;
+    Owned() { ++alive; }
+    ~Owned() { --alive; }
+};
+int Owned::alive = 0;
+
+void releasesOnlyCompletedFrames() {
+    DestructionQueue queue;
+    std::vector<std::string> released;
+    queue.retire(1, [&] { released.push_back("a"); });
+    queue.retire(2, [&] { released.push_back("b"); });
+    queue.retire(4, [&] { released.push_back("c"); });
+
+    CHECK(queue.collect(0) == 0);
+    CHECK(queue.collect(2) == 2);
+    CHECK((released == std::vector<std::string>{"a", "b"}));
+    CHECK(queue.collect(3) == 0);
+    CHECK(queue.pending() == 1);
+    CHECK(queue.collect(4) == 1);
+    CHECK(queue.pending() == 0);
+}
+
+// A frame older than the newest entry is held until that entry's frame completes
+void clampsOutOfOrderRetires() {
+    DestructionQueue queue;
+    std::vector<int> released;
+    queue.retire(5, [&] { released.push_back(5); });
+    queue.retire(2, [&] { released.push_back(2); });
+
+    CHECK(queue.collect(2) == 0);
+    CHECK(queue.collect(4) == 0);
+    CHECK(queue.collect(5) == 2);
+    CHECK((released == std::vector<int>{5, 2}));
+}
+
+void collectRespectsBudget() {
+    DestructionQueue queue;
+    int released = 0;
+    for (int i = 0; i < 10; ++i)
+        queue.retire(1, [&] { ++released; });
+
+    CHECK(queue.collect(1, 4) == 4);
+    CHECK(released == 4);
+    CHECK(queue.collect(1, 4) == 4);
+    CHECK(queue.collect(1, 4) == 2);
+    CHECK(released == 10);
+    CHECK(queue.collect(1, 0) == 0);
+}
+
+void retireOwnedDeletes() {
+    DestructionQueue queue;
+    queue.retireOwned(3, new Owned);
+    queue.retireOwned<Owned>(3, nullptr);       // Ignored
+    queue.retire(3, nullptr);                   // Ignored
+    CHECK(Owned::alive == 1);
+    CHECK(queue.pending() == 1);
+    queue.collect(2);
+    CHECK(Owned::alive == 1);
+    queue.collect(3);
+    CHECK(Owned::alive == 0);
+}
+
+void flushAndDestructorReleaseEverything() {
+    int released = 0;
+    {
+        DestructionQueue queue;
+        queue.retire(100, [&] { ++released; });
+        queue.retire(200, [&] { ++released; });
+        CHECK(queue.flush() == 2);
+        CHECK(released == 2);
+        CHECK(queue.pending() == 0);
+
+        queue.retireOwned(300, new Owned);
+        queue.retire(300, [&] { ++released; });
+    }
+    CHECK(released == 3);
+    CHECK(Owned::alive == 0);
+}
+
+} // namespace
+
+int main() {
+    releasesOnlyCompletedFrames();
+    clampsOutOfOrderRetires();
+    collectRespectsBudget();
+    retireOwnedDeletes();
+    flushAndDestructorReleaseEverything();
+    return testResult();
+}
@@ -0,0 +1,112 @@
+/*
+    SceneStore (common/SceneStore.h) transform writes and the dirty list consumers sync from
+*/
+#include <stdexcept>
+#include <vector>
+
+#include "common/SceneStore.h"
+#include "TestCheck.h"
+
+namespace {
+
+constexpr ComponentMask drawable = TransformComponent | GeometryComponent;
+
+Matrix4 translation(float x) {
+    return {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, x, 0, 0, 1};
+}
+
+void listsEachMovedEntityOnce() {
+    SceneStore scene;
+    std::vector<Entity> entities;
+    scene.create(drawable, 4, entities);
+    CHECK(scene.getDirtyTransforms().empty());
+
+    scene.setTransform(entities[2], translation(1.0f));
+    scene.setTransform(entities[0], translation(2.0f));
+    scene.setTransform(entities[2], translation(3.0f));
+    CHECK((scene.getDirtyTransforms() == std::vector<Entity>{entities[2], entities[0]}));
+    CHECK(scene.transform(entities[2])[12] == 3.0f);
+
+    scene.clearDirtyTransforms();
+    CHECK(scene.getDirtyTransforms().empty());
+    scene.setTransform(entities[2], translation(4.0f));
+    CHECK((scene.getDirtyTransforms() == std::vector<Entity>{entities[2]}));
+}
+
+// Moving a row to another archetype keeps the transform without listing it again
+void componentChangesKeepTransforms() {
+    SceneStore scene;
+    const Entity entity = scene.create(drawable);
+    scene.setTransform(entity, translation(5.0f));
+    scene.clearDirtyTransforms();
+
+    scene.addComponents(entity, BoundsComponent);
+    CHECK(scene.transform(entity)[12] == 5.0f);
+    CHECK(scene.getDirtyTransforms().empty());
+}
+
+// A destroyed entity's handle stays listed but is stale, its reused slot is listed again
+void destroyedEntitiesStayStale() {
+    SceneStore scene;
+    const Entity entity = scene.create(drawable);
+    scene.setTransform(entity, translation(1.0f));
+    scene.destroy(entity);
+    CHECK(scene.getDirtyTransforms().size() == 1);
+    CHECK(!scene.isAlive(scene.getDirtyTransforms()[0]));
+
+    const Entity reused = scene.create(drawable);
+    CHECK(reused.index == entity.index);
+    scene.setTransform(reused, translation(2.0f));
+    CHECK((scene.getDirtyTransforms() == std::vector<Entity>{entity, reused}));
+
+    scene.clearDirtyTransforms();
+    scene.setTransform(reused, translation(3.0f));
+    CHECK(scene.getDirtyTransforms().size() == 1);
+
+    scene.clear();
+    CHECK(scene.getDirtyTransforms().empty());
+}
+
+void rejectsEntitiesWithoutTransforms() {
+    SceneStore scene;
+    const Entity entity = scene.create(GeometryComponent);
+    bool threw = false;
+    try {
+        scene.setTransform(entity, translation(1.0f));
+    }
+    catch (const std::runtime_error &) {
+        threw = true;
+    }
+    CHECK(threw);
+    CHECK(scene.getDirtyTransforms().empty());
+}
+
+// Perspective belongs in the renderer's view-projection, a transform's last row must be 0 0 0 1
+void rejectsProjectiveTransforms() {
+    SceneStore scene;
+    const Entity entity = scene.create(drawable);
+    Matrix4 perspective = translation(1.0f);
+    perspective[11] = -1.0f;
+    perspective[15] = 0.0f;
+    bool threw = false;
+    try {
+        scene.setTransform(entity, perspective);
+    }
+    catch (const std::runtime_error &) {
+        threw = true;
+    }
+    CHECK(threw);
+    CHECK(scene.transform(entity)[15] == 1.0f);
+    CHECK(scene.getDirtyTransforms().empty());
+}
+
+} // namespace
+
+int main() {
+    listsEachMovedEntityOnce();
+    componentChangesKeepTransforms();
+    destroyedEntitiesStayStale();
+    rejectsEntitiesWithoutTransforms();
+    rejectsProjectiveTransforms();
+    return testResult();
+}
@@ -0,0 +1,146 @@
+/*
+    CPU reference of the SDF shapes (common/SdfShapes.h): distances, coverage and instance packing
+    for every shape kind
+*/
+#include <cmath>
+#include <stdexcept>
+
+#include "common/SdfShapes.h"
+#include "TestCheck.h"
+
+namespace {
+
+constexpr float tolerance = 1e-5f;
+constexpr float white[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+void packsInstances() {
+    const float red[4] = {1.0f, 0.0f, 0.0f, 1.0f};
+    const SdfInstance rect = packSdfInstance(SdfShape::RoundedRect, 1.0f, -2.0f, -3.0f, 2.0f, red, 5.0f, -1.0f);
+    CHECK(rect.center[0] == 1.0f && rect.center[1] == -2.0f);
+    CHECK(rect.halfExtents[0] == 3.0f && rect.halfExtents[1] == 2.0f);
+    CHECK(rect.cornerRadius == 2.0f);           // Clamped to the smaller half extent
+    CHECK(rect.thickness == 0.0f);
+    CHECK(rect.shape == static_cast<uint32_t>(SdfShape::RoundedRect));
+    CHECK(rect.color == 0xff0000ffu);
+
+    const float blue[4] = {0.0f, 0.0f, 1.0f, 0.0f};
+    const SdfInstance ring = packSdfInstance(SdfShape::Ring, 0.0f, 0.0f, 1.0f, 1.0f, blue, -1.0f, 0.25f);
+    CHECK(ring.cornerRadius == 0.0f);
+    CHECK(ring.thickness == 0.25f);
+    CHECK(ring.shape == static_cast<uint32_t>(SdfShape::Ring));
+    CHECK(ring.color == 0x00ff0000u);
+
+    CHECK(packSdfInstance(SdfShape::Circle, 0, 0, 1, 1, white).shape == static_cast<uint32_t>(SdfShape::Circle));
+    CHECK(packSdfInstance(SdfShape::Capsule, 0, 0, 2, 1, white).shape == static_cast<uint32_t>(SdfShape::Capsule));
+}
+
+// A ring without thickness has no width, it must be rejected rather than silently not drawn
+void rejectsRingsWithoutThickness() {
+    for (float thickness : {0.0f, -0.5f}) {
+        bool threw = false;
+        try {
+            packSdfInstance(SdfShape::Ring, 0.0f, 0.0f, 1.0f, 1.0f, white, 0.0f, thickness);
+        }
+        catch (const std::runtime_error &) {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+}
+
+void circleDistances() {
+    const SdfInstance circle = packSdfInstance(SdfShape::Circle, 1.0f, 2.0f, 0.5f, 0.5f, white);
+    CHECK_NEAR(sdfDistance(circle, 1.0f, 2.0f), -0.5f, tolerance);
+    CHECK_NEAR(sdfDistance(circle, 1.5f, 2.0f), 0.0f, tolerance);
+    CHECK_NEAR(sdfDistance(circle, 1.0f, 3.0f), 0.5f, tolerance);
+    CHECK_NEAR(sdfDistance(circle, 1.3f, 2.4f), 0.0f, tolerance);
+
+    // Thickness turns it into an outline centered on the circle
+    const SdfInstance outline = packSdfInstance(SdfShape::Circle, 0.0f, 0.0f, 1.0f, 1.0f, white, 0.0f, 0.5f);
+    CHECK_NEAR(sdfDistance(outline, 1.0f, 0.0f), -0.25f, tolerance);
+    CHECK_NEAR(sdfDistance(outline, 0.0f, 0.0f), 0.75f, tolerance);
+}
+
+void ringDistances() {
+    const SdfInstance ring = packSdfInstance(SdfShape::Ring, 0.0f, 0.0f, 1.0f, 1.0f, white, 0.0f, 0.2f);
+    CHECK_NEAR(sdfDistance(ring, 1.0f, 0.0f), -0.1f, tolerance);
+    CHECK_NEAR(sdfDistance(ring, 0.0f, -1.1f), 0.0f, tolerance);
+    CHECK_NEAR(sdfDistance(ring, 0.9f, 0.0f), 0.0f, tolerance);
+    CHECK_NEAR(sdfDistance(ring, 0.0f, 0.0f), 0.9f, tolerance);     // The hole is outside
+    CHECK_NEAR(sdfDistance(ring, 1.3f, 0.0f), 0.2f, tolerance);
+}
+
+void roundedRectDistances() {
+    const SdfInstance rect = packSdfInstance(SdfShape::RoundedRect, 0.0f, 0.0f, 2.0f, 1.0f, white, 0.5f);
+    CHECK_NEAR(sdfDistance(rect, 0.0f, 0.0f), -1.0f, tolerance);
+    CHECK_NEAR(sdfDistance(rect, 3.0f, 0.0f), 1.0f, tolerance);
+    CHECK_NEAR(sdfDistance(rect, 0.0f, -1.0f), 0.0f, tolerance);
+    CHECK_NEAR(sdfDistance(rect, 1.5f, 0.5f), -0.5f, tolerance);
+    // The corner is cut by the radius: the box corner is outside the rounded one
+    CHECK_NEAR(sdfDistance(rect, 2.0f, 1.0f), std::sqrt(0.5f) - 0.5f, tolerance);
+
+    const SdfInstance square = packSdfInstance(SdfShape::RoundedRect, 0.0f, 0.0f, 1.0f, 1.0f, white);
+    CHECK_NEAR(sdfDistance(square, 2.0f, 2.0f), std::sqrt(2.0f), tolerance);
+
+    const SdfInstance outline = packSdfInstance(SdfShape::RoundedRect, 0.0f, 0.0f, 2.0f, 1.0f, white, 0.0f, 0.2f);
+    CHECK_NEAR(sdfDistance(outline, 2.0f, 0.0f), -0.1f, tolerance);
+    CHECK_NEAR(sdfDistance(outline, 0.0f, 0.0f), 0.9f, tolerance);
+}
+
+void capsuleDistances() {
+    // Along x: radius 0.5, segment from -1.5 to 1.5
+    const SdfInstance wide = packSdfInstance(SdfShape::Capsule, 0.0f, 0.0f, 2.0f, 0.5f, white);
+    CHECK_NEAR(sdfDistance(wide, 0.0f, 0.0f), -0.5f, tolerance);
+    CHECK_NEAR(sdfDistance(wide, 2.0f, 0.0f), 0.0f, tolerance);
+    CHECK_NEAR(sdfDistance(wide, 3.0f, 0.0f), 1.0f, tolerance);
+    CHECK_NEAR(sdfDistance(wide, 0.0f, 1.0f), 0.5f, tolerance);
+    CHECK_NEAR(sdfDistance(wide, 1.5f, 0.5f), 0.0f, tolerance);
+
+    // Along y when it is taller than wide
+    const SdfInstance tall = packSdfInstance(SdfShape::Capsule, 1.0f, 1.0f, 0.5f, 2.0f, white);
+    CHECK_NEAR(sdfDistance(tall, 1.0f, 4.0f), 1.0f, tolerance);
+    CHECK_NEAR(sdfDistance(tall, 2.0f, 1.0f), 0.5f, tolerance);
+
+    // Equal extents are a circle
+    const SdfInstance round = packSdfInstance(SdfShape::Capsule, 0.0f, 0.0f, 1.0f, 1.0f, white);
+    CHECK_NEAR(sdfDistance(round, 0.6f, 0.8f), 0.0f, tolerance);
+}
+
+void coverage() {
+    CHECK_NEAR(sdfCoverage(0.0f, 1.0f), 0.5f, tolerance);
+    CHECK_NEAR(sdfCoverage(0.25f, 1.0f), 0.25f, tolerance);
+    CHECK_NEAR(sdfCoverage(-0.25f, 0.5f), 1.0f, tolerance);
+    CHECK_NEAR(sdfCoverage(-0.1f, 0.5f), 0.7f, tolerance);
+    CHECK(sdfCoverage(-10.0f, 1.0f) == 1.0f);
+    CHECK(sdfCoverage(10.0f, 1.0f) == 0.0f);
+
+    // No pixel size, a hard edge
+    CHECK(sdfCoverage(0.0f, 0.0f) == 1.0f);
+    CHECK(sdfCoverage(0.01f, 0.0f) == 0.0f);
+    CHECK(sdfCoverage(-0.01f, -1.0f) == 1.0f);
+}
+
+void quadExtents() {
+    const SdfInstance ring = packSdfInstance(SdfShape::Ring, 0.0f, 0.0f, 1.0f, 2.0f, white, 0.0f, 0.5f);
+    CHECK_NEAR(sdfQuadExtent(ring, 0, 0.1f), 1.35f, tolerance);
+    CHECK_NEAR(sdfQuadExtent(ring, 1, 0.1f), 2.35f, tolerance);
+
+    // The quad must cover every point with non-zero coverage
+    const float padding = 0.1f;
+    const float x = sdfQuadExtent(ring, 0, padding);
+    CHECK(sdfCoverage(sdfDistance(ring, x, 0.0f), padding) == 0.0f);
+}
+
+} // namespace
+
+int main() {
+    packsInstances();
+    rejectsRingsWithoutThickness();
+    circleDistances();
+    ringDistances();
+    roundedRectDistances();
+    capsuleDistances();
+    coverage();
+    quadExtents();
+    return testResult();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+/*
+-------------------------------------------------------------------
+  TEST CHECKS  ------------------------------------------------------
+
+  The unit tests are plain executables registered with add_test(), a failed CHECK prints its
+  file, line and expression and the test exits with testResult() != 0. Checks don't stop the
+  test, so one run reports every failure.
+-------------------------------------------------------------------
+*/
+
+inline int &testFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+inline void checkFailed(const char *file, int line, const char *expression) {
+    std::cerr << file << ":" << line << ": CHECK(" << expression << ") failed" << std::endl;
+    ++testFailures();
+}
+
+#define CHECK(condition) ((condition) ? (void)0 : checkFailed(__FILE__, __LINE__, #condition))
+
+// |a - b| <= tolerance
+#define CHECK_NEAR(a, b, tolerance) CHECK(std::fabs(double(a) - double(b)) <= double(tolerance))
+
+inline int testResult() {
+    if (testFailures())
+        std::cerr << testFailures() << " check(s) failed" << std::endl;
+    return testFailures() ? EXIT_FAILURE : EXIT_SUCCESS;
+}